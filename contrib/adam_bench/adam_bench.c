@@ -0,0 +1,965 @@
+/*
+ * ADAM - similarity search benchmark
+ * name: adam_bench
+ * description: benchmark for the nearest neighbour search measuring throughput, latency, I/O and recall
+ *
+ * contrib/adam_bench/adam_bench.c
+ *
+ *
+ *
+ *
+ * addendum: adam_bench -i generates feature vectors (uniformly distributed,
+ * clustered or skewed, for several dimensionalities) or loads them from a file in
+ * the format of the SIFT/GIST data sets (.fvecs or .bvecs), stores them in the
+ * table adam_bench_<data set> and builds a VA index with equifrequent marks on it
+ *
+ * adam_bench (without -i) runs kNN queries on these tables in the modes
+ *
+ * - seq: sequential search (enable_vascan is switched off)
+ * - va: search using the VA index
+ * - filter: search using the VA index combined with a predicate selecting about
+ *   10% of the tuples
+ *
+ * for several k and numbers of concurrent clients; the clients are served in a
+ * single thread with asynchronous connections, as in pgbench; for every run the
+ * queries per second, the latency percentiles, the blocks read and hit (taken
+ * from pg_statio_user_tables, hence approximate) and the recall@k are reported;
+ * the ground truth for the recall is computed by a sequential search with the
+ * largest k (ties in the distance may cost some recall)
+ *
+ */
+#include "postgres_fe.h"
+
+#include "getopt_long.h"
+#include "libpq-fe.h"
+#include "pqexpbuffer.h"
+#include "portability/instr_time.h"
+
+#include <math.h>
+
+#ifndef WIN32
+#include <sys/time.h>
+#include <unistd.h>
+#endif   /* ! WIN32 */
+
+#ifdef HAVE_SYS_SELECT_H
+#include <sys/select.h>
+#endif
+
+#define MAX_LIST		16			/* max. number of values in a list option */
+#define MAX_CLIENTS		64
+#define NUM_CLUSTERS	16			/* clusters of the clustered data sets */
+#define CLUSTER_SIGMA	0.05		/* standard deviation within a cluster */
+#define SKEW_EXPONENT	4.0			/* skewed data sets: u^SKEW_EXPONENT */
+#define NUM_CATEGORIES	10			/* values of the column cat used by the filter mode */
+
+typedef enum Distribution
+{
+	DIST_UNIFORM,
+	DIST_CLUSTERED,
+	DIST_SKEWED,
+	DIST_FILE
+} Distribution;
+
+typedef enum Mode
+{
+	MODE_SEQ,
+	MODE_VA,
+	MODE_FILTER
+} Mode;
+
+static const char *distributionNames[] = {"uniform", "clustered", "skewed", "file"};
+static const char *modeNames[] = {"seq", "va", "filter"};
+
+/*
+ * a data set, i.e. a table with its queries and the ground truth of the queries
+ */
+typedef struct DataSet
+{
+	Distribution dist;
+	int			dimensions;
+	char		table[NAMEDATALEN];
+	float	   *queries;			/* nqueries * dimensions */
+	int			nqueries;
+	int		   *truth;				/* nqueries * kmax ids, -1 if missing */
+	int		   *truthFilter;		/* same for the filter mode */
+} DataSet;
+
+/*
+ * a client of a run
+ */
+typedef struct Client
+{
+	PGconn	   *con;
+	int			query;				/* query currently running, -1 if idle */
+	instr_time	start;
+} Client;
+
+static const char *progname;
+
+static char *pghost = NULL;
+static char *pgport = NULL;
+static char *login = NULL;
+static char *dbName = NULL;
+
+static bool initialize = false;
+static int	nvectors = 10000;
+static int	nqueries = 100;
+static int	dimensions[MAX_LIST] = {16, 64};
+static int	ndimensions = 2;
+static int	ks[MAX_LIST] = {1, 10, 100};
+static int	nks = 3;
+static int	clients[MAX_LIST] = {1, 4};
+static int	nclients = 2;
+static bool distributions[3] = {true, true, true};
+static bool modes[3] = {true, true, true};
+static char *baseFile = NULL;
+static char *queryFile = NULL;
+static unsigned short seed[3] = {0x330E, 0xABCD, 0x1234};
+
+static void usage(void);
+static int	parseList(const char *arg, int *values);
+static PGconn *doConnect(void);
+static void executeStatement(PGconn *con, const char *sql);
+static double randomNormal(unsigned short *state);
+static void generateVector(Distribution dist, int dims, float *centers, unsigned short *state, float *result);
+static void appendFeature(PQExpBuffer buf, const float *vector, int dims);
+static bool readVector(FILE *file, bool bytes, int *dims, float **vector);
+static void initDataSet(PGconn *con, DataSet *ds);
+static void prepareQueries(DataSet *ds);
+static char *buildQuery(DataSet *ds, int q, Mode mode, int k);
+static void computeTruth(PGconn *con, DataSet *ds, Mode mode, int kmax, int *truth);
+static void getBlocks(PGconn *con, DataSet *ds, double *read, double *hit);
+static void runBenchmark(PGconn *con, DataSet *ds, Mode mode, int k, int nclient, int kmax);
+static int	compareDouble(const void *a, const void *b);
+
+
+static void
+usage(void)
+{
+	printf("%s is a benchmark for the nearest neighbour search of ADAM.\n\n"
+		   "Usage:\n"
+		   "  %s [OPTION]... [DBNAME]\n"
+		   "\nInitialization options:\n"
+		   "  -i           generate or load the data sets and build the VA indexes\n"
+		   "  -n NUM       number of vectors per data set (default: 10000)\n"
+		   "  -f FILE      load the vectors from a .fvecs or .bvecs file instead of generating them\n"
+		   "\nData set options:\n"
+		   "  -D LIST      distributions: uniform, clustered, skewed (default: all)\n"
+		   "  -d LIST      dimensionalities (default: 16,64)\n"
+		   "  -Q FILE      load the queries from a .fvecs or .bvecs file\n"
+		   "  -S NUM       seed of the random generator\n"
+		   "\nBenchmarking options:\n"
+		   "  -q NUM       number of queries (default: 100)\n"
+		   "  -k LIST      numbers of neighbours (default: 1,10,100)\n"
+		   "  -c LIST      numbers of concurrent clients (default: 1,4)\n"
+		   "  -m LIST      modes: seq, va, filter (default: all)\n"
+		   "\nCommon options:\n"
+		   "  -h HOSTNAME  database server host or socket directory\n"
+		   "  -p PORT      database server port number\n"
+		   "  -U USERNAME  connect as specified database user\n"
+		   "  --help       show this help, then exit\n"
+		   "\nLists are separated by commas, e.g. -k 1,10,100.\n",
+		   progname, progname);
+}
+
+/*
+ * parses a comma separated list of positive integers
+ */
+static int
+parseList(const char *arg, int *values)
+{
+	int			n = 0;
+	const char *ptr = arg;
+
+	while (*ptr)
+	{
+		if (n >= MAX_LIST)
+		{
+			fprintf(stderr, "%s: too many values in list \"%s\"\n", progname, arg);
+			exit(1);
+		}
+
+		values[n] = atoi(ptr);
+
+		if (values[n] <= 0)
+		{
+			fprintf(stderr, "%s: invalid value in list \"%s\"\n", progname, arg);
+			exit(1);
+		}
+
+		n++;
+
+		while (*ptr && *ptr != ',')
+			ptr++;
+		if (*ptr == ',')
+			ptr++;
+	}
+
+	return n;
+}
+
+static PGconn *
+doConnect(void)
+{
+	PGconn	   *conn;
+	const char *keywords[7];
+	const char *values[7];
+
+	keywords[0] = "host";
+	values[0] = pghost;
+	keywords[1] = "port";
+	values[1] = pgport;
+	keywords[2] = "user";
+	values[2] = login;
+	keywords[3] = "dbname";
+	values[3] = dbName;
+	keywords[4] = "fallback_application_name";
+	values[4] = progname;
+	keywords[5] = NULL;
+	values[5] = NULL;
+
+	conn = PQconnectdbParams(keywords, values, true);
+
+	if (!conn || PQstatus(conn) == CONNECTION_BAD)
+	{
+		fprintf(stderr, "%s: connection to database \"%s\" failed: %s",
+				progname, dbName ? dbName : "", conn ? PQerrorMessage(conn) : "\n");
+		exit(1);
+	}
+
+	return conn;
+}
+
+static void
+executeStatement(PGconn *con, const char *sql)
+{
+	PGresult   *res;
+
+	res = PQexec(con, sql);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK && PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		fprintf(stderr, "%s: %s", progname, PQerrorMessage(con));
+		exit(1);
+	}
+	PQclear(res);
+}
+
+/*
+ * normally distributed random number (Box-Muller)
+ */
+static double
+randomNormal(unsigned short *state)
+{
+	double		u1 = pg_erand48(state);
+	double		u2 = pg_erand48(state);
+
+	if (u1 < 1e-12)
+		u1 = 1e-12;
+
+	return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static void
+generateVector(Distribution dist, int dims, float *centers, unsigned short *state, float *result)
+{
+	int			i;
+	int			cluster;
+
+	switch (dist)
+	{
+		case DIST_CLUSTERED:
+			cluster = (int) (pg_erand48(state) * NUM_CLUSTERS) % NUM_CLUSTERS;
+			for (i = 0; i < dims; i++)
+				result[i] = centers[cluster * dims + i] + CLUSTER_SIGMA * randomNormal(state);
+			break;
+		case DIST_SKEWED:
+			for (i = 0; i < dims; i++)
+				result[i] = pow(pg_erand48(state), SKEW_EXPONENT);
+			break;
+		case DIST_UNIFORM:
+		default:
+			for (i = 0; i < dims; i++)
+				result[i] = pg_erand48(state);
+			break;
+	}
+}
+
+static void
+appendFeature(PQExpBuffer buf, const float *vector, int dims)
+{
+	int			i;
+
+	appendPQExpBufferChar(buf, '<');
+	for (i = 0; i < dims; i++)
+		appendPQExpBuffer(buf, i ? ",%.7g" : "%.7g", vector[i]);
+	appendPQExpBufferChar(buf, '>');
+}
+
+/*
+ * reads a vector of a SIFT/GIST file: the dimensionality as 4 byte integer followed
+ * by the values as 4 byte floats (.fvecs) or as bytes (.bvecs)
+ */
+static bool
+readVector(FILE *file, bool bytes, int *dims, float **vector)
+{
+	int32		d;
+	int			i;
+
+	if (fread(&d, sizeof(int32), 1, file) != 1)
+		return false;
+
+	if (d <= 0 || (*dims > 0 && d != *dims))
+	{
+		fprintf(stderr, "%s: invalid dimensionality %d in vector file\n", progname, d);
+		exit(1);
+	}
+
+	if (*vector == NULL)
+		*vector = pg_malloc(sizeof(float) * d);
+	*dims = d;
+
+	if (bytes)
+	{
+		unsigned char *values = pg_malloc(d);
+
+		if (fread(values, 1, d, file) != d)
+			return false;
+		for (i = 0; i < d; i++)
+			(*vector)[i] = values[i];
+		free(values);
+	}
+	else if (fread(*vector, sizeof(float), d, file) != d)
+		return false;
+
+	return true;
+}
+
+static bool
+isByteFile(const char *filename)
+{
+	size_t		len = strlen(filename);
+
+	return len > 6 && strcmp(filename + len - 6, ".bvecs") == 0;
+}
+
+/*
+ * creates the table of the data set, fills it and builds the VA index
+ */
+static void
+initDataSet(PGconn *con, DataSet *ds)
+{
+	PQExpBufferData buf;
+	PGresult   *res;
+	unsigned short state[3];
+	float	   *centers = NULL;
+	float	   *vector = NULL;
+	FILE	   *file = NULL;
+	int			i;
+
+	memcpy(state, seed, sizeof(state));
+	initPQExpBuffer(&buf);
+
+	fprintf(stderr, "creating %s...\n", ds->table);
+
+	printfPQExpBuffer(&buf, "DROP TABLE IF EXISTS %s", ds->table);
+	executeStatement(con, buf.data);
+	printfPQExpBuffer(&buf, "CREATE TABLE %s (id int4 NOT NULL, cat int4 NOT NULL, f feature)", ds->table);
+	executeStatement(con, buf.data);
+
+	if (ds->dist == DIST_FILE)
+	{
+		file = fopen(baseFile, "rb");
+		if (!file)
+		{
+			fprintf(stderr, "%s: could not open \"%s\": %s\n", progname, baseFile, strerror(errno));
+			exit(1);
+		}
+	}
+	else
+	{
+		vector = pg_malloc(sizeof(float) * ds->dimensions);
+
+		if (ds->dist == DIST_CLUSTERED)
+		{
+			centers = pg_malloc(sizeof(float) * NUM_CLUSTERS * ds->dimensions);
+			for (i = 0; i < NUM_CLUSTERS * ds->dimensions; i++)
+				centers[i] = pg_erand48(state);
+		}
+	}
+
+	printfPQExpBuffer(&buf, "COPY %s FROM STDIN", ds->table);
+	res = PQexec(con, buf.data);
+	if (PQresultStatus(res) != PGRES_COPY_IN)
+	{
+		fprintf(stderr, "%s: %s", progname, PQerrorMessage(con));
+		exit(1);
+	}
+	PQclear(res);
+
+	for (i = 0; i < nvectors; i++)
+	{
+		if (file)
+		{
+			if (!readVector(file, isByteFile(baseFile), &ds->dimensions, &vector))
+				break;
+		}
+		else
+			generateVector(ds->dist, ds->dimensions, centers, state, vector);
+
+		printfPQExpBuffer(&buf, "%d\t%d\t", i, i % NUM_CATEGORIES);
+		appendFeature(&buf, vector, ds->dimensions);
+		appendPQExpBufferChar(&buf, '\n');
+
+		if (PQputCopyData(con, buf.data, buf.len) != 1)
+		{
+			fprintf(stderr, "%s: %s", progname, PQerrorMessage(con));
+			exit(1);
+		}
+	}
+
+	if (PQputCopyEnd(con, NULL) != 1)
+	{
+		fprintf(stderr, "%s: %s", progname, PQerrorMessage(con));
+		exit(1);
+	}
+	res = PQgetResult(con);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+	{
+		fprintf(stderr, "%s: %s", progname, PQerrorMessage(con));
+		exit(1);
+	}
+	PQclear(res);
+
+	fprintf(stderr, "%d vectors loaded, building VA index...\n", i);
+
+	printfPQExpBuffer(&buf, "CREATE INDEX %s_cat ON %s (cat)", ds->table, ds->table);
+	executeStatement(con, buf.data);
+	printfPQExpBuffer(&buf, "CREATE VA %s_va ON %s (f) USING EQUIFREQUENT MARKS", ds->table, ds->table);
+	executeStatement(con, buf.data);
+	printfPQExpBuffer(&buf, "VACUUM ANALYZE %s", ds->table);
+	executeStatement(con, buf.data);
+
+	if (file)
+		fclose(file);
+	if (centers)
+		free(centers);
+	if (vector)
+		free(vector);
+	termPQExpBuffer(&buf);
+}
+
+/*
+ * creates the queries of the data set; they follow the distribution of the data,
+ * but are generated with another seed
+ */
+static void
+prepareQueries(DataSet *ds)
+{
+	unsigned short state[3];
+	float	   *centers = NULL;
+	int			i;
+
+	ds->nqueries = nqueries;
+	ds->queries = NULL;
+
+	if (queryFile)
+	{
+		FILE	   *file = fopen(queryFile, "rb");
+		float	   *vector = NULL;
+		int			dims = ds->dimensions;
+
+		if (!file)
+		{
+			fprintf(stderr, "%s: could not open \"%s\": %s\n", progname, queryFile, strerror(errno));
+			exit(1);
+		}
+
+		for (i = 0; i < nqueries && readVector(file, isByteFile(queryFile), &dims, &vector); i++)
+		{
+			if (ds->queries == NULL)
+			{
+				ds->dimensions = dims;
+				ds->queries = pg_malloc(sizeof(float) * nqueries * dims);
+			}
+			memcpy(ds->queries + i * dims, vector, sizeof(float) * dims);
+		}
+
+		ds->nqueries = i;
+		fclose(file);
+		if (vector)
+			free(vector);
+		return;
+	}
+
+	//the centers have to be the ones of the data
+	memcpy(state, seed, sizeof(state));
+	if (ds->dist == DIST_CLUSTERED)
+	{
+		centers = pg_malloc(sizeof(float) * NUM_CLUSTERS * ds->dimensions);
+		for (i = 0; i < NUM_CLUSTERS * ds->dimensions; i++)
+			centers[i] = pg_erand48(state);
+	}
+
+	state[0] ^= 0x5A5A;
+	ds->queries = pg_malloc(sizeof(float) * nqueries * ds->dimensions);
+
+	for (i = 0; i < nqueries; i++)
+		generateVector(ds->dist == DIST_FILE ? DIST_UNIFORM : ds->dist,
+					   ds->dimensions, centers, state, ds->queries + i * ds->dimensions);
+
+	if (centers)
+		free(centers);
+}
+
+static char *
+buildQuery(DataSet *ds, int q, Mode mode, int k)
+{
+	PQExpBufferData buf;
+
+	initPQExpBuffer(&buf);
+
+	appendPQExpBuffer(&buf, "SELECT id FROM %s ", ds->table);
+	if (mode == MODE_FILTER)
+		appendPQExpBuffer(&buf, "WHERE cat = %d ", q % NUM_CATEGORIES);
+	appendPQExpBuffer(&buf, "USING DISTANCE MINKOWSKI(2)(f, '");
+	appendFeature(&buf, ds->queries + q * ds->dimensions, ds->dimensions);
+	appendPQExpBuffer(&buf, "') ORDER USING DISTANCE LIMIT %d", k);
+
+	return buf.data;
+}
+
+/*
+ * computes the kmax nearest neighbours of all queries by a sequential search
+ */
+static void
+computeTruth(PGconn *con, DataSet *ds, Mode mode, int kmax, int *truth)
+{
+	int			q;
+	int			i;
+
+	executeStatement(con, "SET enable_vascan = off");
+
+	for (q = 0; q < ds->nqueries; q++)
+	{
+		char	   *sql = buildQuery(ds, q, mode, kmax);
+		PGresult   *res = PQexec(con, sql);
+		int			idcol;
+
+		if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		{
+			fprintf(stderr, "%s: %s", progname, PQerrorMessage(con));
+			exit(1);
+		}
+
+		idcol = PQfnumber(res, "id");
+
+		for (i = 0; i < kmax; i++)
+			truth[q * kmax + i] = (i < PQntuples(res)) ? atoi(PQgetvalue(res, i, idcol)) : -1;
+
+		PQclear(res);
+		free(sql);
+	}
+
+	executeStatement(con, "RESET enable_vascan");
+}
+
+/*
+ * blocks of the table and its indexes read from disk and found in the buffers
+ */
+static void
+getBlocks(PGconn *con, DataSet *ds, double *read, double *hit)
+{
+	PQExpBufferData buf;
+	PGresult   *res;
+
+	initPQExpBuffer(&buf);
+	printfPQExpBuffer(&buf,
+					  "SELECT coalesce(heap_blks_read, 0) + coalesce(idx_blks_read, 0), "
+					  "coalesce(heap_blks_hit, 0) + coalesce(idx_blks_hit, 0) "
+					  "FROM pg_statio_user_tables WHERE relname = '%s'", ds->table);
+
+	res = PQexec(con, buf.data);
+	if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) != 1)
+	{
+		*read = *hit = 0;
+	}
+	else
+	{
+		*read = atof(PQgetvalue(res, 0, 0));
+		*hit = atof(PQgetvalue(res, 0, 1));
+	}
+
+	PQclear(res);
+	termPQExpBuffer(&buf);
+}
+
+static int
+compareDouble(const void *a, const void *b)
+{
+	double		x = *(const double *) a;
+	double		y = *(const double *) b;
+
+	return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+/*
+ * runs all queries of the data set with nclient concurrent clients and prints
+ * one line of results
+ */
+static void
+runBenchmark(PGconn *con, DataSet *ds, Mode mode, int k, int nclient, int kmax)
+{
+	Client		clientState[MAX_CLIENTS];
+	double	   *latencies = pg_malloc(sizeof(double) * ds->nqueries);
+	int		   *truth = (mode == MODE_FILTER) ? ds->truthFilter : ds->truth;
+	int			next = 0;
+	int			done = 0;
+	double		recall = 0;
+	double		readBefore, hitBefore, readAfter, hitAfter;
+	instr_time	start, end;
+	double		elapsed;
+	int			i;
+
+	getBlocks(con, ds, &readBefore, &hitBefore);
+
+	for (i = 0; i < nclient; i++)
+	{
+		clientState[i].con = doConnect();
+		clientState[i].query = -1;
+
+		if (mode == MODE_SEQ)
+			executeStatement(clientState[i].con, "SET enable_vascan = off");
+	}
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	while (done < ds->nqueries)
+	{
+		fd_set		input_mask;
+		int			maxsock = -1;
+
+		//give every idle client the next query
+		for (i = 0; i < nclient; i++)
+		{
+			Client	   *c = &clientState[i];
+
+			if (c->query < 0 && next < ds->nqueries)
+			{
+				char	   *sql = buildQuery(ds, next, mode, k);
+
+				INSTR_TIME_SET_CURRENT(c->start);
+				if (!PQsendQuery(c->con, sql))
+				{
+					fprintf(stderr, "%s: %s", progname, PQerrorMessage(c->con));
+					exit(1);
+				}
+				c->query = next++;
+				free(sql);
+			}
+		}
+
+		FD_ZERO(&input_mask);
+		for (i = 0; i < nclient; i++)
+		{
+			if (clientState[i].query >= 0)
+			{
+				int			sock = PQsocket(clientState[i].con);
+
+				FD_SET(sock, &input_mask);
+				if (sock > maxsock)
+					maxsock = sock;
+			}
+		}
+
+		if (select(maxsock + 1, &input_mask, NULL, NULL, NULL) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "%s: select failed: %s\n", progname, strerror(errno));
+			exit(1);
+		}
+
+		for (i = 0; i < nclient; i++)
+		{
+			Client	   *c = &clientState[i];
+			PGresult   *res;
+			instr_time	now;
+			int			j, l;
+			int			found = 0;
+
+			if (c->query < 0 || !FD_ISSET(PQsocket(c->con), &input_mask))
+				continue;
+
+			if (!PQconsumeInput(c->con))
+			{
+				fprintf(stderr, "%s: %s", progname, PQerrorMessage(c->con));
+				exit(1);
+			}
+			if (PQisBusy(c->con))
+				continue;
+
+			res = PQgetResult(c->con);
+			INSTR_TIME_SET_CURRENT(now);
+			INSTR_TIME_SUBTRACT(now, c->start);
+			latencies[c->query] = INSTR_TIME_GET_MILLISEC(now);
+
+			if (PQresultStatus(res) != PGRES_TUPLES_OK)
+			{
+				fprintf(stderr, "%s: %s", progname, PQerrorMessage(c->con));
+				exit(1);
+			}
+
+			//recall@k: share of the true k nearest neighbours found
+			for (j = 0; j < PQntuples(res); j++)
+			{
+				int			id = atoi(PQgetvalue(res, j, PQfnumber(res, "id")));
+
+				for (l = 0; l < k && l < kmax; l++)
+				{
+					if (truth[c->query * kmax + l] == id)
+					{
+						found++;
+						break;
+					}
+				}
+			}
+
+			for (l = 0; l < k && l < kmax && truth[c->query * kmax + l] >= 0; l++)
+				;
+			recall += (l > 0) ? ((double) found) / l : 1.0;
+
+			PQclear(res);
+			while ((res = PQgetResult(c->con)) != NULL)
+				PQclear(res);
+
+			c->query = -1;
+			done++;
+		}
+	}
+
+	INSTR_TIME_SET_CURRENT(end);
+	INSTR_TIME_SUBTRACT(end, start);
+	elapsed = INSTR_TIME_GET_DOUBLE(end);
+
+	//the backends report their I/O statistics when they exit
+	for (i = 0; i < nclient; i++)
+		PQfinish(clientState[i].con);
+	pg_usleep(1000000L);
+
+	getBlocks(con, ds, &readAfter, &hitAfter);
+
+	qsort(latencies, ds->nqueries, sizeof(double), compareDouble);
+
+	printf("%-24s %-6s %5d %7d %9.1f %9.3f %9.3f %9.3f %7.4f %11.0f %11.0f\n",
+		   ds->table, modeNames[mode], k, nclient,
+		   elapsed > 0 ? ds->nqueries / elapsed : 0,
+		   latencies[(int) (0.50 * (ds->nqueries - 1))],
+		   latencies[(int) (0.95 * (ds->nqueries - 1))],
+		   latencies[(int) (0.99 * (ds->nqueries - 1))],
+		   recall / ds->nqueries,
+		   readAfter - readBefore, hitAfter - hitBefore);
+	fflush(stdout);
+
+	free(latencies);
+}
+
+int
+main(int argc, char **argv)
+{
+	static struct option long_options[] = {
+		{"help", no_argument, NULL, '?'},
+		{NULL, 0, NULL, 0}
+	};
+
+	DataSet		datasets[3 * MAX_LIST];
+	int			ndatasets = 0;
+	int			kmax = 0;
+	PGconn	   *con;
+	int			c;
+	int			optindex;
+	int			i, j, m, n;
+
+	progname = get_progname(argv[0]);
+
+	if (argc > 1 && (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-?") == 0))
+	{
+		usage();
+		exit(0);
+	}
+
+	while ((c = getopt_long(argc, argv, "ih:p:U:n:f:D:d:Q:S:q:k:c:m:", long_options, &optindex)) != -1)
+	{
+		switch (c)
+		{
+			case 'i':
+				initialize = true;
+				break;
+			case 'h':
+				pghost = pg_strdup(optarg);
+				break;
+			case 'p':
+				pgport = pg_strdup(optarg);
+				break;
+			case 'U':
+				login = pg_strdup(optarg);
+				break;
+			case 'n':
+				nvectors = atoi(optarg);
+				break;
+			case 'f':
+				baseFile = pg_strdup(optarg);
+				break;
+			case 'D':
+				memset(distributions, 0, sizeof(distributions));
+				for (i = DIST_UNIFORM; i <= DIST_SKEWED; i++)
+					distributions[i] = (strstr(optarg, distributionNames[i]) != NULL);
+				break;
+			case 'd':
+				ndimensions = parseList(optarg, dimensions);
+				break;
+			case 'Q':
+				queryFile = pg_strdup(optarg);
+				break;
+			case 'S':
+				seed[1] = (unsigned short) atoi(optarg);
+				seed[2] = (unsigned short) (atoi(optarg) >> 16);
+				break;
+			case 'q':
+				nqueries = atoi(optarg);
+				break;
+			case 'k':
+				nks = parseList(optarg, ks);
+				break;
+			case 'c':
+				nclients = parseList(optarg, clients);
+				break;
+			case 'm':
+				for (i = MODE_SEQ; i <= MODE_FILTER; i++)
+					modes[i] = (strstr(optarg, modeNames[i]) != NULL);
+				break;
+			default:
+				fprintf(stderr, "Try \"%s --help\" for more information.\n", progname);
+				exit(1);
+		}
+	}
+
+	if (optind < argc)
+		dbName = argv[optind];
+
+	if (nvectors <= 0 || nqueries <= 0)
+	{
+		fprintf(stderr, "%s: the number of vectors and queries must be positive\n", progname);
+		exit(1);
+	}
+
+	for (i = 0; i < nclients; i++)
+	{
+		if (clients[i] > MAX_CLIENTS)
+		{
+			fprintf(stderr, "%s: at most %d clients are supported\n", progname, MAX_CLIENTS);
+			exit(1);
+		}
+	}
+
+	for (i = 0; i < nks; i++)
+		kmax = Max(kmax, ks[i]);
+
+	//the data sets
+	if (baseFile)
+	{
+		DataSet    *ds = &datasets[ndatasets++];
+
+		memset(ds, 0, sizeof(DataSet));
+		ds->dist = DIST_FILE;
+		snprintf(ds->table, NAMEDATALEN, "adam_bench_file");
+	}
+	else
+	{
+		for (i = DIST_UNIFORM; i <= DIST_SKEWED; i++)
+		{
+			if (!distributions[i])
+				continue;
+
+			for (j = 0; j < ndimensions; j++)
+			{
+				DataSet    *ds = &datasets[ndatasets++];
+
+				memset(ds, 0, sizeof(DataSet));
+				ds->dist = (Distribution) i;
+				ds->dimensions = dimensions[j];
+				snprintf(ds->table, NAMEDATALEN, "adam_bench_%s_%d",
+						 distributionNames[i], dimensions[j]);
+			}
+		}
+	}
+
+	con = doConnect();
+
+	if (initialize)
+	{
+		for (i = 0; i < ndatasets; i++)
+			initDataSet(con, &datasets[i]);
+
+		PQfinish(con);
+		fprintf(stderr, "done.\n");
+		return 0;
+	}
+
+	printf("%-24s %-6s %5s %7s %9s %9s %9s %9s %7s %11s %11s\n",
+		   "data set", "mode", "k", "clients", "qps", "p50 ms", "p95 ms", "p99 ms",
+		   "recall", "blks read", "blks hit");
+
+	for (i = 0; i < ndatasets; i++)
+	{
+		DataSet    *ds = &datasets[i];
+
+		//the dimensionality of a loaded data set is the one of the stored features
+		if (ds->dist == DIST_FILE)
+		{
+			PQExpBufferData buf;
+			PGresult   *res;
+
+			initPQExpBuffer(&buf);
+			printfPQExpBuffer(&buf, "SELECT array_length(f::float8[], 1) FROM %s LIMIT 1", ds->table);
+			res = PQexec(con, buf.data);
+			if (PQresultStatus(res) == PGRES_TUPLES_OK && PQntuples(res) == 1)
+				ds->dimensions = atoi(PQgetvalue(res, 0, 0));
+			PQclear(res);
+			termPQExpBuffer(&buf);
+		}
+
+		prepareQueries(ds);
+
+		if (ds->nqueries == 0 || ds->dimensions <= 0)
+		{
+			fprintf(stderr, "%s: no queries for %s\n", progname, ds->table);
+			continue;
+		}
+
+		fprintf(stderr, "computing the ground truth of %s...\n", ds->table);
+
+		ds->truth = pg_malloc(sizeof(int) * ds->nqueries * kmax);
+		computeTruth(con, ds, MODE_VA, kmax, ds->truth);
+
+		if (modes[MODE_FILTER])
+		{
+			ds->truthFilter = pg_malloc(sizeof(int) * ds->nqueries * kmax);
+			computeTruth(con, ds, MODE_FILTER, kmax, ds->truthFilter);
+		}
+
+		for (m = MODE_SEQ; m <= MODE_FILTER; m++)
+		{
+			if (!modes[m])
+				continue;
+
+			for (j = 0; j < nks; j++)
+				for (n = 0; n < nclients; n++)
+					runBenchmark(con, ds, (Mode) m, ks[j], clients[n], kmax);
+		}
+	}
+
+	PQfinish(con);
+
+	return 0;
+}
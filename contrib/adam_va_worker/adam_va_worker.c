@@ -0,0 +1,754 @@
+/*
+ * ADAM - background re-quantization of VA files
+ * name: adam_va_worker
+ * description: background worker rebuilding VA files whose marks do no longer fit the data
+ *
+ * contrib/adam_va_worker/adam_va_worker.c
+ *
+ *
+ *
+ *
+ * addendum: the marks of a VA file are computed once when the index is built; if
+ * the data changes afterwards, more and more tuples fall into the same cells and
+ * the filtering gets worse; this worker (based on worker_spi) checks the VA files
+ * of a database every adam_va_worker.naptime seconds and rebuilds a VA file with
+ * fresh marks if
+ *
+ * - the cells of its equifrequent marks are populated too unevenly (see
+ *   vaCellImbalance), compared to the imbalance right after the last rebuild by
+ *   the worker (data with many duplicates cannot be balanced by any marks), or
+ * - the number of tuples inserted or removed since the last build exceeds a share
+ *   of the tuples indexed
+ *
+ * the new VA file is built concurrently (as in CREATE INDEX CONCURRENTLY), then it
+ * takes over the name of the old VA file in a single transaction, and finally the
+ * old VA file is dropped concurrently; only the renaming needs an exclusive lock on
+ * the indexes, reads and writes of the table are never blocked for longer; if the
+ * build fails, the invalid new VA file is dropped again
+ *
+ * the VA indexes are looked up in the catalog only when pg_index has changed, and
+ * the imbalance of the cells is measured again only when the VA file has changed
+ * since the last check; each VA index is checked in a transaction of its own, an
+ * error (e.g. a damaged VA file) is logged and does not stop the worker
+ *
+ * the worker is started by adding adam_va_worker to shared_preload_libraries;
+ * expression and partial VA indexes are not rebuilt
+ *
+ */
+#include "postgres.h"
+
+/* These are always necessary for a bgworker */
+#include "miscadmin.h"
+#include "postmaster/bgworker.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+
+/* these headers are used by this particular worker's code */
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/reloptions.h"
+#include "access/xact.h"
+#include "catalog/namespace.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_index.h"
+#include "commands/defrem.h"
+#include "commands/tablecmds.h"
+#include "commands/tablespace.h"
+#include "executor/spi.h"
+#include "fmgr.h"
+#include "nodes/makefuncs.h"
+#include "pgstat.h"
+#include "utils/adam_index_va.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/syscache.h"
+
+PG_MODULE_MAGIC;
+
+void		_PG_init(void);
+
+/* flags set by signal handlers */
+static volatile sig_atomic_t got_sighup = false;
+static volatile sig_atomic_t got_sigterm = false;
+
+/* GUC variables */
+static int	adam_va_worker_naptime = 60;
+static char *adam_va_worker_database = NULL;
+static double adam_va_worker_max_imbalance = 0.25;
+static double adam_va_worker_max_changes = 0.2;
+
+/* VA indexes that are candidates for a rebuild */
+typedef struct VAIndexEntry
+{
+	Oid			indexOid;		/* hash key */
+	double		builtImbalance; /* imbalance right after the last rebuild */
+	double		imbalance;		/* imbalance at the last check */
+	uint32		nChanges;		/* changes of the VA file at the last check */
+	bool		checked;		/* imbalance and nChanges are set */
+	bool		present;		/* found by the last catalog scan */
+} VAIndexEntry;
+
+static HTAB *vaIndexes = NULL;
+
+/* set when pg_index has changed, the VA indexes must be looked up again */
+static bool vaIndexesStale = true;
+
+/*
+ * memory of a rebuild; concurrent builds and drops commit transactions, so
+ * their statements must not live in the transaction's memory
+ */
+static MemoryContext rebuildContext = NULL;
+
+static void vaIndexesInvalidate(Datum arg, int cacheid, uint32 hashvalue);
+static Oid *getVAIndexes(int *nindexes);
+static bool needsRebuild(Oid indexOid, IndexStmt **stmt);
+static bool checkMarks(VAIndexEntry *entry, IndexStmt **stmt);
+static void rebuildIndex(Oid indexOid, IndexStmt *stmt);
+static void dropInvalidIndex(IndexStmt *stmt);
+static List *getIndexOptions(Oid indexOid, int marks);
+
+
+/*
+ * Signal handler for SIGTERM
+ *		Set a flag to let the main loop to terminate, and set our latch to wake
+ *		it up.
+ */
+static void
+adam_va_worker_sigterm(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_sigterm = true;
+	if (MyProc)
+		SetLatch(&MyProc->procLatch);
+
+	errno = save_errno;
+}
+
+/*
+ * Signal handler for SIGHUP
+ *		Set a flag to let the main loop to reread the config file, and set
+ *		our latch to wake it up.
+ */
+static void
+adam_va_worker_sighup(SIGNAL_ARGS)
+{
+	got_sighup = true;
+	if (MyProc)
+		SetLatch(&MyProc->procLatch);
+}
+
+/*
+ * syscache callback, an index has been created, dropped or validated
+ */
+static void
+vaIndexesInvalidate(Datum arg, int cacheid, uint32 hashvalue)
+{
+	vaIndexesStale = true;
+}
+
+/*
+ * returns the OIDs of the VA indexes that are candidates for a rebuild; the
+ * catalog is scanned only if pg_index has changed since the last scan; the
+ * array is allocated in TopMemoryContext
+ */
+static Oid *
+getVAIndexes(int *nindexes)
+{
+	Oid		   *result;
+	HASH_SEQ_STATUS status;
+	VAIndexEntry *entry;
+	int			i;
+
+	//starting the transaction processes the pending invalidations
+	SetCurrentStatementStartTimestamp();
+	StartTransactionCommand();
+
+	if (vaIndexesStale)
+	{
+		int			ret;
+
+		//changes committed after the snapshot below invalidate the list again
+		vaIndexesStale = false;
+
+		SPI_connect();
+		PushActiveSnapshot(GetTransactionSnapshot());
+		pgstat_report_activity(STATE_RUNNING, "looking for VA indexes");
+
+		ret = SPI_execute("SELECT i.indexrelid FROM pg_catalog.pg_index i "
+						  "JOIN pg_catalog.pg_class c ON c.oid = i.indexrelid "
+						  "WHERE c.relam = " CppAsString2(VA_AM_OID) " AND i.indisvalid "
+						  "AND i.indexprs IS NULL AND i.indpred IS NULL",
+						  true, 0);
+
+		if (ret != SPI_OK_SELECT)
+			elog(FATAL, "SPI_execute failed: error code %d", ret);
+
+		hash_seq_init(&status, vaIndexes);
+		while ((entry = (VAIndexEntry *) hash_seq_search(&status)) != NULL)
+			entry->present = false;
+
+		for (i = 0; i < SPI_processed; i++)
+		{
+			Oid			indexOid;
+			bool		isnull;
+			bool		found;
+
+			indexOid = DatumGetObjectId(SPI_getbinval(SPI_tuptable->vals[i],
+													  SPI_tuptable->tupdesc,
+													  1, &isnull));
+
+			entry = (VAIndexEntry *) hash_search(vaIndexes, &indexOid, HASH_ENTER, &found);
+			if (!found)
+			{
+				entry->builtImbalance = 0;
+				entry->checked = false;
+			}
+			entry->present = true;
+		}
+
+		//forget the indexes that have been dropped
+		hash_seq_init(&status, vaIndexes);
+		while ((entry = (VAIndexEntry *) hash_seq_search(&status)) != NULL)
+		{
+			if (!entry->present)
+				hash_search(vaIndexes, &entry->indexOid, HASH_REMOVE, NULL);
+		}
+
+		SPI_finish();
+		PopActiveSnapshot();
+	}
+
+	CommitTransactionCommand();
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	//the hash table changes while the indexes are rebuilt, return a copy
+	*nindexes = 0;
+	result = MemoryContextAlloc(TopMemoryContext,
+								sizeof(Oid) * (hash_get_num_entries(vaIndexes) + 1));
+
+	hash_seq_init(&status, vaIndexes);
+	while ((entry = (VAIndexEntry *) hash_seq_search(&status)) != NULL)
+		result[(*nindexes)++] = entry->indexOid;
+
+	return result;
+}
+
+/*
+ * checks whether the marks of the VA index are outdated; if so, the statement
+ * for building a copy of the index is returned in stmt; an error is reported
+ * and the index is skipped until the next cycle
+ */
+static bool
+needsRebuild(Oid indexOid, IndexStmt **stmt)
+{
+	VAIndexEntry *entry;
+	bool		result;
+
+	entry = (VAIndexEntry *) hash_search(vaIndexes, &indexOid, HASH_FIND, NULL);
+	if (entry == NULL)
+		return false;
+
+	SetCurrentStatementStartTimestamp();
+	StartTransactionCommand();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	pgstat_report_activity(STATE_RUNNING, "checking the marks of a VA index");
+
+	PG_TRY();
+	{
+		result = checkMarks(entry, stmt);
+	}
+	PG_CATCH();
+	{
+		//a broken index must not keep the worker from checking the others
+		MemoryContextSwitchTo(TopMemoryContext);
+		EmitErrorReport();
+		FlushErrorState();
+		AbortCurrentTransaction();
+		pgstat_report_activity(STATE_IDLE, NULL);
+
+		*stmt = NULL;
+		return false;
+	}
+	PG_END_TRY();
+
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	return result;
+}
+
+/*
+ * compares the imbalance and the changes of the VA index with the limits; the
+ * imbalance is measured again only if the VA file has changed since the last
+ * check
+ */
+static bool
+checkMarks(VAIndexEntry *entry, IndexStmt **stmt)
+{
+	Relation	index;
+	Oid			heapOid;
+	double		reltuples;
+	double		imbalance = 0;
+	uint32		nChanges;
+	int			marks;
+	bool		result = false;
+	int			i;
+
+	//the index may have been dropped in the meantime
+	index = try_relation_open(entry->indexOid, AccessShareLock);
+
+	if (index == NULL || index->rd_rel->relkind != RELKIND_INDEX ||
+		index->rd_rel->relam != VA_AM_OID || !IndexIsValid(index->rd_index))
+	{
+		if (index)
+			relation_close(index, AccessShareLock);
+
+		return false;
+	}
+
+	reltuples = index->rd_rel->reltuples;
+	nChanges = vaGetChanges(index);
+	marks = vaGetMarksStrategy(index);
+
+	if (entry->checked && entry->nChanges == nChanges)
+		imbalance = entry->imbalance;
+	else if (marks == VA_MARKS_EQUIFREQUENT)
+		imbalance = vaCellImbalance(index);
+
+	entry->imbalance = imbalance;
+	entry->nChanges = nChanges;
+	entry->checked = true;
+
+	//fresh marks cannot do better than right after the last rebuild
+	if (imbalance - entry->builtImbalance > adam_va_worker_max_imbalance)
+	{
+		elog(LOG, "%s: cells of VA index \"%s\" are unevenly populated (imbalance %.2f, %.2f after the last rebuild)",
+			 MyBgworkerEntry->bgw_name, RelationGetRelationName(index), imbalance, entry->builtImbalance);
+		result = true;
+	}
+	else if (reltuples > 0 && nChanges > adam_va_worker_max_changes * reltuples)
+	{
+		elog(LOG, "%s: VA index \"%s\" has been changed %u times since it has been built",
+			 MyBgworkerEntry->bgw_name, RelationGetRelationName(index), nChanges);
+		result = true;
+	}
+
+	if (result)
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(rebuildContext);
+		IndexStmt  *n = makeNode(IndexStmt);
+
+		heapOid = index->rd_index->indrelid;
+
+		n->idxname = ChooseRelationName(RelationGetRelationName(index), NULL,
+										"requant", RelationGetNamespace(index));
+		n->relation = makeRangeVar(get_namespace_name(get_rel_namespace(heapOid)),
+								   get_rel_name(heapOid), -1);
+		n->accessMethod = pstrdup("va");
+
+		if (OidIsValid(index->rd_rel->reltablespace))
+			n->tableSpace = get_tablespace_name(index->rd_rel->reltablespace);
+
+		for (i = 0; i < index->rd_index->indnatts; i++)
+		{
+			IndexElem  *elem = makeNode(IndexElem);
+
+			elem->name = get_attname(heapOid, index->rd_index->indkey.values[i]);
+			elem->ordering = SORTBY_DEFAULT;
+			elem->nulls_ordering = SORTBY_NULLS_DEFAULT;
+
+			n->indexParams = lappend(n->indexParams, elem);
+		}
+
+		n->options = getIndexOptions(entry->indexOid, marks);
+		n->vamarks = marks;
+		n->concurrent = true;
+
+		*stmt = n;
+
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	relation_close(index, AccessShareLock);
+
+	return result;
+}
+
+/*
+ * returns the storage parameters of the index (vamarks, vaprojection, ...) as
+ * a list of DefElem, so that the new index is built with the same options
+ */
+static List *
+getIndexOptions(Oid indexOid, int marks)
+{
+	HeapTuple	tuple;
+	Datum		reloptions;
+	bool		isnull;
+	List	   *options = NIL;
+	ListCell   *cell;
+
+	tuple = SearchSysCache1(RELOID, ObjectIdGetDatum(indexOid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for relation %u", indexOid);
+
+	reloptions = SysCacheGetAttr(RELOID, tuple, Anum_pg_class_reloptions, &isnull);
+	if (!isnull)
+		options = untransformRelOptions(reloptions);
+
+	ReleaseSysCache(tuple);
+
+	foreach(cell, options)
+	{
+		if (strcmp(((DefElem *) lfirst(cell))->defname, "vamarks") == 0)
+			return options;
+	}
+
+	return lappend(options, makeDefElem(pstrdup("vamarks"), (Node *) makeInteger(marks)));
+}
+
+/*
+ * drops the new index of a failed concurrent build, which is left behind as
+ * an invalid index
+ */
+static void
+dropInvalidIndex(IndexStmt *stmt)
+{
+	Oid			namespaceOid;
+	Oid			newOid;
+	HeapTuple	tuple;
+	bool		invalid = false;
+	DropStmt   *drop;
+
+	SetCurrentStatementStartTimestamp();
+	StartTransactionCommand();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	pgstat_report_activity(STATE_RUNNING, "dropping invalid VA index");
+
+	namespaceOid = get_namespace_oid(stmt->relation->schemaname, true);
+	newOid = OidIsValid(namespaceOid) ? get_relname_relid(stmt->idxname, namespaceOid) : InvalidOid;
+
+	if (OidIsValid(newOid))
+	{
+		tuple = SearchSysCache1(INDEXRELID, ObjectIdGetDatum(newOid));
+		if (HeapTupleIsValid(tuple))
+		{
+			invalid = !IndexIsValid((Form_pg_index) GETSTRUCT(tuple));
+			ReleaseSysCache(tuple);
+		}
+	}
+
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+
+	if (!invalid)
+	{
+		pgstat_report_activity(STATE_IDLE, NULL);
+		return;
+	}
+
+	SetCurrentStatementStartTimestamp();
+	StartTransactionCommand();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	MemoryContextSwitchTo(rebuildContext);
+
+	drop = makeNode(DropStmt);
+	drop->objects = list_make1(list_make2(makeString(stmt->relation->schemaname),
+										  makeString(stmt->idxname)));
+	drop->removeType = OBJECT_INDEX;
+	drop->behavior = DROP_RESTRICT;
+	drop->missing_ok = true;
+	drop->concurrent = true;
+
+	RemoveRelations(drop);
+
+	if (ActiveSnapshotSet())
+		PopActiveSnapshot();
+	CommitTransactionCommand();
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	elog(LOG, "%s: invalid VA index \"%s\" has been dropped",
+		 MyBgworkerEntry->bgw_name, stmt->idxname);
+}
+
+/*
+ * builds a new VA index concurrently and replaces the old one with it
+ */
+static void
+rebuildIndex(Oid indexOid, IndexStmt *stmt)
+{
+	Oid			newOid;
+	Oid			namespaceOid;
+	char	   *name;
+	char	   *oldName;
+	DropStmt   *drop;
+	Relation	index;
+	VAIndexEntry *entry;
+	double		imbalance = 0;
+	MemoryContext oldcxt;
+
+	//1. build the new index with fresh marks; DefineIndex commits the transaction
+	//several times and may pop the active snapshot
+	SetCurrentStatementStartTimestamp();
+	StartTransactionCommand();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	pgstat_report_activity(STATE_RUNNING, "building VA index with fresh marks");
+	MemoryContextSwitchTo(rebuildContext);
+
+	PG_TRY();
+	{
+		newOid = DefineIndex(stmt, InvalidOid, false, false, false, true);
+	}
+	PG_CATCH();
+	{
+		//report the error and clean up, a failed concurrent build leaves an
+		//invalid index behind
+		MemoryContextSwitchTo(TopMemoryContext);
+		EmitErrorReport();
+		FlushErrorState();
+		AbortCurrentTransaction();
+
+		dropInvalidIndex(stmt);
+		return;
+	}
+	PG_END_TRY();
+
+	if (ActiveSnapshotSet())
+		PopActiveSnapshot();
+	CommitTransactionCommand();
+
+	//2. swap the names of the indexes
+	SetCurrentStatementStartTimestamp();
+	StartTransactionCommand();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	pgstat_report_activity(STATE_RUNNING, "swapping VA indexes");
+
+	name = get_rel_name(indexOid);
+
+	if (name == NULL)
+	{
+		//the old index has been dropped in the meantime, keep the new one
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+		pgstat_report_activity(STATE_IDLE, NULL);
+		return;
+	}
+
+	//the names and the statement are needed after the commit
+	oldcxt = MemoryContextSwitchTo(rebuildContext);
+
+	name = pstrdup(name);
+	namespaceOid = get_rel_namespace(indexOid);
+	oldName = ChooseRelationName(name, NULL, "old", namespaceOid);
+
+	drop = makeNode(DropStmt);
+	drop->objects = list_make1(list_make2(makeString(get_namespace_name(namespaceOid)),
+										  makeString(oldName)));
+	drop->removeType = OBJECT_INDEX;
+	drop->behavior = DROP_RESTRICT;
+	drop->missing_ok = true;
+	drop->concurrent = true;
+
+	MemoryContextSwitchTo(oldcxt);
+
+	RenameRelationInternal(indexOid, oldName, true);
+	CommandCounterIncrement();
+	RenameRelationInternal(newOid, name, true);
+
+	//remember how balanced fresh marks are for this data
+	index = index_open(newOid, AccessShareLock);
+	if (vaGetMarksStrategy(index) == VA_MARKS_EQUIFREQUENT)
+		imbalance = vaCellImbalance(index);
+	index_close(index, AccessShareLock);
+
+	hash_search(vaIndexes, &indexOid, HASH_REMOVE, NULL);
+	entry = (VAIndexEntry *) hash_search(vaIndexes, &newOid, HASH_ENTER, NULL);
+	entry->builtImbalance = imbalance;
+	entry->checked = false;
+	entry->present = true;
+
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+
+	//3. drop the old index; index_drop commits the transaction several times as well
+	SetCurrentStatementStartTimestamp();
+	StartTransactionCommand();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	pgstat_report_activity(STATE_RUNNING, "dropping old VA index");
+	MemoryContextSwitchTo(rebuildContext);
+
+	RemoveRelations(drop);
+
+	if (ActiveSnapshotSet())
+		PopActiveSnapshot();
+	CommitTransactionCommand();
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	elog(LOG, "%s: VA index \"%s\" has been rebuilt with fresh marks",
+		 MyBgworkerEntry->bgw_name, name);
+}
+
+static void
+adam_va_worker_main(Datum main_arg)
+{
+	HASHCTL		ctl;
+
+	/* Establish signal handlers before unblocking signals. */
+	pqsignal(SIGHUP, adam_va_worker_sighup);
+	pqsignal(SIGTERM, adam_va_worker_sigterm);
+
+	/* We're now ready to receive signals */
+	BackgroundWorkerUnblockSignals();
+
+	/* Connect to our database */
+	BackgroundWorkerInitializeConnection(adam_va_worker_database, NULL);
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(Oid);
+	ctl.entrysize = sizeof(VAIndexEntry);
+	ctl.hash = oid_hash;
+	vaIndexes = hash_create("ADAM VA worker indexes", 64, &ctl,
+							HASH_ELEM | HASH_FUNCTION);
+
+	rebuildContext = AllocSetContextCreate(TopMemoryContext,
+										   "ADAM VA worker rebuild",
+										   ALLOCSET_DEFAULT_MINSIZE,
+										   ALLOCSET_DEFAULT_INITSIZE,
+										   ALLOCSET_DEFAULT_MAXSIZE);
+
+	//new, dropped and validated indexes change pg_index
+	CacheRegisterSyscacheCallback(INDEXRELID, vaIndexesInvalidate, (Datum) 0);
+
+	elog(LOG, "%s initialized with database %s",
+		 MyBgworkerEntry->bgw_name, adam_va_worker_database);
+
+	/*
+	 * Main loop: do this until the SIGTERM handler tells us to terminate
+	 */
+	while (!got_sigterm)
+	{
+		Oid		   *indexes;
+		int			nindexes;
+		int			i;
+		int			rc;
+
+		/*
+		 * Background workers mustn't call usleep() or any direct equivalent:
+		 * instead, they may wait on their process latch, which sleeps as
+		 * necessary, but is awakened if postmaster dies.  That way the
+		 * background process goes away immediately in an emergency.
+		 */
+		rc = WaitLatch(&MyProc->procLatch,
+					   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+					   adam_va_worker_naptime * 1000L);
+		ResetLatch(&MyProc->procLatch);
+
+		/* emergency bailout if postmaster has died */
+		if (rc & WL_POSTMASTER_DEATH)
+			proc_exit(1);
+
+		/*
+		 * In case of a SIGHUP, just reload the configuration.
+		 */
+		if (got_sighup)
+		{
+			got_sighup = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		indexes = getVAIndexes(&nindexes);
+
+		for (i = 0; i < nindexes && !got_sigterm; i++)
+		{
+			IndexStmt  *stmt = NULL;
+
+			if (needsRebuild(indexes[i], &stmt))
+				rebuildIndex(indexes[i], stmt);
+
+			MemoryContextReset(rebuildContext);
+		}
+
+		pfree(indexes);
+	}
+
+	proc_exit(0);
+}
+
+/*
+ * Entrypoint of this module.
+ */
+void
+_PG_init(void)
+{
+	BackgroundWorker worker;
+
+	/* get the configuration */
+	DefineCustomIntVariable("adam_va_worker.naptime",
+							"Duration between each check of the VA indexes (in seconds).",
+							NULL,
+							&adam_va_worker_naptime,
+							60,
+							1,
+							INT_MAX,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+	DefineCustomStringVariable("adam_va_worker.database",
+							   "Database whose VA indexes are checked.",
+							   NULL,
+							   &adam_va_worker_database,
+							   "postgres",
+							   PGC_POSTMASTER,
+							   0,
+							   NULL,
+							   NULL,
+							   NULL);
+	DefineCustomRealVariable("adam_va_worker.max_imbalance",
+							 "Imbalance of the cells of equifrequent marks above which a VA index is rebuilt.",
+							 "0 means that all cells are populated evenly, 1 that all tuples fall into one cell; "
+							 "after a rebuild, the imbalance is measured from the imbalance of the fresh marks.",
+							 &adam_va_worker_max_imbalance,
+							 0.25,
+							 0.0,
+							 1.0,
+							 PGC_SIGHUP,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+	DefineCustomRealVariable("adam_va_worker.max_changes",
+							 "Share of the indexed tuples that may be inserted or removed before a VA index is rebuilt.",
+							 NULL,
+							 &adam_va_worker_max_changes,
+							 0.2,
+							 0.0,
+							 100.0,
+							 PGC_SIGHUP,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS |
+		BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+	worker.bgw_restart_time = adam_va_worker_naptime;
+	worker.bgw_main = adam_va_worker_main;
+	worker.bgw_main_arg = (Datum) 0;
+	snprintf(worker.bgw_name, BGW_MAXLEN, "ADAM VA worker");
+
+	RegisterBackgroundWorker(&worker);
+}
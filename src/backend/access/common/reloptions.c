@@ -16,6 +16,8 @@
 #include "postgres.h"
 
 #include "utils/adam_data_feature.h"
+#include "utils/adam_index_lsh.h"
+#include "utils/adam_index_projection.h"
 #include "access/gist_private.h"
 #include "access/hash.h"
 #include "access/htup_details.h"
@@ -185,6 +187,34 @@ static relopt_int intRelOpts[] =
 			RELOPT_KIND_VA
 		}, -1, 0, 100
 	},
+	{
+		{
+			"vacomponents",
+			"Number of projected components approximated by the VA index",
+			RELOPT_KIND_VA
+		}, VA_DEFAULT_COMPONENTS, 1, VA_MAX_COMPONENTS
+	},
+	{
+		{
+			"lshtables",
+			"Number of hash tables of the LSH index",
+			RELOPT_KIND_LSH
+		}, LSH_DEFAULT_TABLES, 1, LSH_MAX_TABLES
+	},
+	{
+		{
+			"lshbits",
+			"Number of bits per hash code of the LSH index",
+			RELOPT_KIND_LSH
+		}, LSH_DEFAULT_BITS, 1, LSH_MAX_BITS
+	},
+	{
+		{
+			"lshprobes",
+			"Number of additional buckets probed per hash table of the LSH index",
+			RELOPT_KIND_LSH
+		}, LSH_DEFAULT_PROBES, 0, LSH_MAX_BITS
+	},
 	/* list terminator */
 	{{NULL}}
 };
@@ -256,6 +286,28 @@ static relopt_string stringRelOpts[] =
 		gistValidateBufferingOption,
 		"auto"
 	},
+	{
+		{
+			"lshfamily",
+			"Hash family of the LSH index (cosine or hamming)",
+			RELOPT_KIND_LSH
+		},
+		6,
+		false,
+		lshValidateFamilyOption,
+		"cosine"
+	},
+	{
+		{
+			"vaprojection",
+			"Projection of the features before the VA approximation (none, pca or random)",
+			RELOPT_KIND_VA
+		},
+		4,
+		false,
+		vaValidateProjectionOption,
+		"none"
+	},
 	/* list terminator */
 	{{NULL}}
 };
@@ -35,6 +35,8 @@
 #include "access/tuptoaster.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
+#include "catalog/pg_type.h"
+#include "utils/adam_data_compression.h"
 #include "utils/fmgroids.h"
 #include "utils/pg_lzcompress.h"
 #include "utils/rel.h"
@@ -81,6 +83,9 @@ static bool toastid_valueid_exists(Oid toastrelid, Oid valueid);
 static struct varlena *toast_fetch_datum(struct varlena * attr);
 static struct varlena *toast_fetch_datum_slice(struct varlena * attr,
 						int32 sliceoffset, int32 length);
+/* ADAM */
+static Datum toast_compress_attribute(Form_pg_attribute att, Datum value);
+static struct varlena *toast_decompress_datum(struct varlena * attr);
 
 
 /* ----------
@@ -137,11 +142,9 @@ heap_tuple_untoast_attr(struct varlena * attr)
 		/* If it's compressed, decompress it */
 		if (VARATT_IS_COMPRESSED(attr))
 		{
-			PGLZ_Header *tmp = (PGLZ_Header *) attr;
+			struct varlena *tmp = attr;
 
-			attr = (struct varlena *) palloc(PGLZ_RAW_SIZE(tmp) + VARHDRSZ);
-			SET_VARSIZE(attr, PGLZ_RAW_SIZE(tmp) + VARHDRSZ);
-			pglz_decompress(tmp, VARDATA(attr));
+			attr = toast_decompress_datum(tmp);
 			pfree(tmp);
 		}
 	}
@@ -150,11 +153,7 @@ heap_tuple_untoast_attr(struct varlena * attr)
 		/*
 		 * This is a compressed value inside of the main tuple
 		 */
-		PGLZ_Header *tmp = (PGLZ_Header *) attr;
-
-		attr = (struct varlena *) palloc(PGLZ_RAW_SIZE(tmp) + VARHDRSZ);
-		SET_VARSIZE(attr, PGLZ_RAW_SIZE(tmp) + VARHDRSZ);
-		pglz_decompress(tmp, VARDATA(attr));
+		attr = toast_decompress_datum(attr);
 	}
 	else if (VARATT_IS_SHORT(attr))
 	{
@@ -209,14 +208,11 @@ heap_tuple_untoast_attr_slice(struct varlena * attr,
 
 	if (VARATT_IS_COMPRESSED(preslice))
 	{
-		PGLZ_Header *tmp = (PGLZ_Header *) preslice;
-		Size		size = PGLZ_RAW_SIZE(tmp) + VARHDRSZ;
+		struct varlena *tmp = preslice;
 
-		preslice = (struct varlena *) palloc(size);
-		SET_VARSIZE(preslice, size);
-		pglz_decompress(tmp, VARDATA(preslice));
+		preslice = toast_decompress_datum(tmp);
 
-		if (tmp != (PGLZ_Header *) attr)
+		if (tmp != attr)
 			pfree(tmp);
 	}
 
@@ -645,7 +641,7 @@ toast_insert_or_update(Relation rel, HeapTuple newtup, HeapTuple oldtup,
 		if (att[i]->attstorage == 'x')
 		{
 			old_value = toast_values[i];
-			new_value = toast_compress_datum(old_value);
+			new_value = toast_compress_attribute(att[i], old_value);
 
 			if (DatumGetPointer(new_value) != NULL)
 			{
@@ -784,7 +780,7 @@ toast_insert_or_update(Relation rel, HeapTuple newtup, HeapTuple oldtup,
 		 */
 		i = biggest_attno;
 		old_value = toast_values[i];
-		new_value = toast_compress_datum(old_value);
+		new_value = toast_compress_attribute(att[i], old_value);
 
 		if (DatumGetPointer(new_value) != NULL)
 		{
@@ -1221,6 +1217,58 @@ toast_compress_datum(Datum value)
 }
 
 
+/* ----------
+ * toast_compress_attribute - ADAM
+ *
+ *	Create a compressed version of a varlena datum of the given attribute;
+ *	features are compressed as set by feature_compression (with
+ *	'none', they are left uncompressed and thus moved out-of-line as a
+ *	whole), all other types by toast_compress_datum.
+ * ----------
+ */
+static Datum
+toast_compress_attribute(Form_pg_attribute att, Datum value)
+{
+	if (att->atttypid != FEATURE)
+		return toast_compress_datum(value);
+
+	switch (feature_compression)
+	{
+		case FEATURE_COMPRESSION_NONE:
+			return PointerGetDatum(NULL);
+		case FEATURE_COMPRESSION_FLOAT:
+			return PointerGetDatum(featureCompress((struct varlena *) DatumGetPointer(value)));
+		default:
+			return toast_compress_datum(value);
+	}
+}
+
+
+/* ----------
+ * toast_decompress_datum - ADAM
+ *
+ *	Decompress an inline compressed varlena datum by the method it
+ *	has been compressed with (stored in the high bits of its raw size).
+ * ----------
+ */
+static struct varlena *
+toast_decompress_datum(struct varlena * attr)
+{
+	struct varlena *result;
+
+	Assert(VARATT_IS_COMPRESSED(attr));
+
+	if (VARCOMPRESSMETHOD_4B_C(attr) == TOAST_FEATURE_COMPRESSION)
+		return featureDecompress(attr);
+
+	result = (struct varlena *) palloc(PGLZ_RAW_SIZE((PGLZ_Header *) attr) + VARHDRSZ);
+	SET_VARSIZE(result, PGLZ_RAW_SIZE((PGLZ_Header *) attr) + VARHDRSZ);
+	pglz_decompress((PGLZ_Header *) attr, VARDATA(result));
+
+	return result;
+}
+
+
 /* ----------
  * toast_save_datum -
  *
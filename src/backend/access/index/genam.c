@@ -111,6 +111,9 @@ RelationGetIndexScan(Relation indexRelation, int nkeys, int norderbys)
 	scan->ignore_killed_tuples = !scan->xactStartedInRecovery;
 
 	scan->opaque = NULL;
+	scan->adamScanClause = NULL;
+	scan->adamQueue = NULL;
+	scan->adamInstrument = NULL;
 
 	scan->xs_itup = NULL;
 	scan->xs_itupdesc = NULL;
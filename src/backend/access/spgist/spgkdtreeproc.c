@@ -15,9 +15,13 @@
 
 #include "postgres.h"
 
+#include <math.h>
+
 #include "access/gist.h"		/* for RTree strategy numbers */
 #include "access/spgist.h"
 #include "catalog/pg_type.h"
+#include "utils/adam_data_feature.h"
+#include "utils/adam_retrieval_minkowski.h"
 #include "utils/builtins.h"
 #include "utils/geo_decls.h"
 
@@ -269,3 +273,400 @@ spg_kd_inner_consistent(PG_FUNCTION_ARGS)
  * since we support the same operators and the same leaf data type.
  * So we just borrow that function.
  */
+
+
+/*
+ * ADAM
+ *
+ * k-d tree over n-dimensional feature vectors.  The tree works exactly like
+ * the point k-d tree above, except that the splitting dimension cycles
+ * through all dimensions of the feature (level % ndims) and the split value
+ * is chosen as the median of a sample of the tuples to be split, so that
+ * splitting large leaf pages stays cheap.
+ *
+ * Besides exact-match (=) and the ADAM dummy operator (===), the opclass
+ * supports nearest neighbour search: the inner consistent function reports
+ * a lower bound on the Minkowski distance of every child node and the leaf
+ * consistent function reports the exact distance.  As in the VA-file, the
+ * distances are reported without taking the root, i.e. sum |x - q|^p (or the
+ * maximum for L_inf), which preserves the ordering.
+ */
+
+#define KD_FEATURE_EQUAL_STRATEGY	1		/* = */
+#define KD_FEATURE_DUMMY_STRATEGY	2		/* === */
+
+#define KD_SPLIT_SAMPLES			256		/* tuples used to find the median */
+
+static float8 *
+getFeatureData(Datum d, int *ndims)
+{
+	feature    *f = (feature *) PG_DETOAST_DATUM(d);
+
+	if (ARR_HASNULL(&f->data))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("feature vectors must not contain null values")));
+
+	*ndims = ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data));
+
+	return (float8 *) ARR_DATA_PTR(&f->data);
+}
+
+static int
+float8_cmp(const void *a, const void *b)
+{
+	float8		fa = *(const float8 *) a;
+	float8		fb = *(const float8 *) b;
+
+	if (fa == fb)
+		return 0;
+	return (fa > fb) ? 1 : -1;
+}
+
+/*
+ * lower bound of the distance between the query and a region described by
+ * its per-dimension gaps
+ */
+static double
+getGapBound(float8 *gaps, int ndims, double norm)
+{
+	double		result = 0;
+	int			i;
+
+	for (i = 0; i < ndims; i++)
+	{
+		if (gaps[i] == 0)
+			continue;
+
+		if (norm == MINKOWSKI_MAX_NORM)
+			result = Max(result, gaps[i]);
+		else if (norm == 1)
+			result += gaps[i];
+		else if (norm == 2)
+			result += gaps[i] * gaps[i];
+		else
+			result += pow(gaps[i], norm);
+	}
+
+	return result;
+}
+
+Datum
+spg_feature_kd_config(PG_FUNCTION_ARGS)
+{
+	/* spgConfigIn *cfgin = (spgConfigIn *) PG_GETARG_POINTER(0); */
+	spgConfigOut *cfg = (spgConfigOut *) PG_GETARG_POINTER(1);
+
+	cfg->prefixType = FLOAT8OID;
+	cfg->labelType = VOIDOID;	/* we don't need node labels */
+	cfg->canReturnData = true;
+	cfg->longValuesOK = false;
+	cfg->canNNSearch = true;
+	PG_RETURN_VOID();
+}
+
+Datum
+spg_feature_kd_choose(PG_FUNCTION_ARGS)
+{
+	spgChooseIn *in = (spgChooseIn *) PG_GETARG_POINTER(0);
+	spgChooseOut *out = (spgChooseOut *) PG_GETARG_POINTER(1);
+	float8	   *values;
+	int			ndims;
+	double		coord;
+
+	if (in->allTheSame)
+		elog(ERROR, "allTheSame should not occur for k-d trees");
+
+	Assert(in->hasPrefix);
+	coord = DatumGetFloat8(in->prefixDatum);
+
+	Assert(in->nNodes == 2);
+
+	values = getFeatureData(in->datum, &ndims);
+
+	out->resultType = spgMatchNode;
+	out->result.matchNode.nodeN =
+		(values[in->level % ndims] < coord) ? 0 : 1;
+	out->result.matchNode.levelAdd = 1;
+	out->result.matchNode.restDatum = in->datum;
+
+	PG_RETURN_VOID();
+}
+
+Datum
+spg_feature_kd_picksplit(PG_FUNCTION_ARGS)
+{
+	spgPickSplitIn *in = (spgPickSplitIn *) PG_GETARG_POINTER(0);
+	spgPickSplitOut *out = (spgPickSplitOut *) PG_GETARG_POINTER(1);
+	float8	   *coords;
+	float8	   *samples;
+	int			nSamples;
+	int			step;
+	int			counts[2] = {0, 0};
+	int			ndims;
+	int			dim;
+	int			i;
+	double		coord;
+
+	(void) getFeatureData(in->datums[0], &ndims);
+	dim = in->level % ndims;
+
+	/* fetch the coordinates of the splitting dimension */
+	coords = palloc(sizeof(float8) * in->nTuples);
+	for (i = 0; i < in->nTuples; i++)
+	{
+		int			n;
+		float8	   *values = getFeatureData(in->datums[i], &n);
+
+		if (n != ndims)
+			ereport(ERROR,
+					(errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+					 errmsg("all features in a k-d tree must have the same number of dimensions")));
+
+		coords[i] = values[dim];
+	}
+
+	/* the median of an evenly spread sample is good enough as split value */
+	step = Max(in->nTuples / KD_SPLIT_SAMPLES, 1);
+	nSamples = 0;
+	samples = palloc(sizeof(float8) * (in->nTuples / step + 1));
+	for (i = 0; i < in->nTuples; i += step)
+		samples[nSamples++] = coords[i];
+
+	qsort(samples, nSamples, sizeof(float8), float8_cmp);
+	coord = samples[nSamples >> 1];
+
+	out->hasPrefix = true;
+	out->prefixDatum = Float8GetDatum(coord);
+
+	out->nNodes = 2;
+	out->nodeLabels = NULL;		/* we don't need node labels */
+
+	out->mapTuplesToNodes = palloc(sizeof(int) * in->nTuples);
+	out->leafTupleDatums = palloc(sizeof(Datum) * in->nTuples);
+
+	for (i = 0; i < in->nTuples; i++)
+	{
+		out->leafTupleDatums[i] = in->datums[i];
+
+		if (coords[i] < coord)
+			out->mapTuplesToNodes[i] = 0;
+		else if (coords[i] > coord)
+			out->mapTuplesToNodes[i] = 1;
+		else
+			continue;
+
+		counts[out->mapTuplesToNodes[i]]++;
+	}
+
+	/*
+	 * Tuples equal to the split value go to the emptier side.  As the split
+	 * value is taken from the tuples themselves, this ensures that both nodes
+	 * are populated and we never trigger the allTheSame logic; the consistent
+	 * functions descend into both sides for such values.
+	 */
+	for (i = 0; i < in->nTuples; i++)
+	{
+		if (coords[i] == coord)
+		{
+			int			n = (counts[0] <= counts[1]) ? 0 : 1;
+
+			out->mapTuplesToNodes[i] = n;
+			counts[n]++;
+		}
+	}
+
+	PG_RETURN_VOID();
+}
+
+Datum
+spg_feature_kd_inner_consistent(PG_FUNCTION_ARGS)
+{
+	spgInnerConsistentIn *in = (spgInnerConsistentIn *) PG_GETARG_POINTER(0);
+	spgInnerConsistentOut *out = (spgInnerConsistentOut *) PG_GETARG_POINTER(1);
+	double		coord;
+	int			which;
+	int			i;
+
+	Assert(in->hasPrefix);
+	coord = DatumGetFloat8(in->prefixDatum);
+
+	if (in->allTheSame)
+		elog(ERROR, "allTheSame should not occur for k-d trees");
+
+	Assert(in->nNodes == 2);
+
+	/* "which" is a bitmask of children that satisfy all constraints */
+	which = (1 << 1) | (1 << 2);
+
+	for (i = 0; i < in->nkeys; i++)
+	{
+		float8	   *query;
+		int			ndims;
+		double		q;
+
+		switch (in->scankeys[i].sk_strategy)
+		{
+			case KD_FEATURE_EQUAL_STRATEGY:
+				query = getFeatureData(in->scankeys[i].sk_argument, &ndims);
+				q = query[in->level % ndims];
+
+				if (q < coord)
+					which &= (1 << 1);
+				else if (q > coord)
+					which &= (1 << 2);
+				break;
+			case KD_FEATURE_DUMMY_STRATEGY:
+				/* always true */
+				break;
+			default:
+				elog(ERROR, "unrecognized strategy number: %d",
+					 in->scankeys[i].sk_strategy);
+				break;
+		}
+
+		if (which == 0)
+			break;				/* no need to consider remaining conditions */
+	}
+
+	/* We must descend into the children identified by which */
+	out->nodeNumbers = (int *) palloc(sizeof(int) * 2);
+	out->nNodes = 0;
+	for (i = 1; i <= 2; i++)
+	{
+		if (which & (1 << i))
+			out->nodeNumbers[out->nNodes++] = i - 1;
+	}
+
+	/* Set up level increments, too */
+	out->levelAdds = (int *) palloc(sizeof(int) * 2);
+	out->levelAdds[0] = 1;
+	out->levelAdds[1] = 1;
+
+	/*
+	 * For nearest neighbour search, compute the lower bound of each child
+	 * region.  The traversal value holds the distance between the query and
+	 * the region in every dimension; descending into a child can only
+	 * increase the gap in the current splitting dimension.
+	 */
+	if (in->nnSearch && in->nkeys > 0)
+	{
+		float8	   *query;
+		float8	   *gaps = (float8 *) in->traversalValue;
+		int			ndims;
+		int			dim;
+		MemoryContext oldCtx;
+
+		query = getFeatureData(in->scankeys[0].sk_argument, &ndims);
+		dim = in->level % ndims;
+
+		out->distances = (double *) palloc(sizeof(double) * 2);
+		out->traversalValues = (void **) palloc(sizeof(void *) * 2);
+
+		oldCtx = MemoryContextSwitchTo(in->traversalMemoryContext);
+
+		for (i = 0; i < out->nNodes; i++)
+		{
+			float8	   *childGaps = (float8 *) palloc0(sizeof(float8) * ndims);
+			double		gap;
+
+			if (gaps != NULL)
+				memcpy(childGaps, gaps, sizeof(float8) * ndims);
+
+			if (out->nodeNumbers[i] == 0)
+				gap = (query[dim] > coord) ? query[dim] - coord : 0;
+			else
+				gap = (query[dim] < coord) ? coord - query[dim] : 0;
+
+			childGaps[dim] = Max(childGaps[dim], gap);
+
+			out->distances[i] = getGapBound(childGaps, ndims, in->nnNorm);
+			out->traversalValues[i] = childGaps;
+		}
+
+		MemoryContextSwitchTo(oldCtx);
+	}
+
+	PG_RETURN_VOID();
+}
+
+Datum
+spg_feature_kd_leaf_consistent(PG_FUNCTION_ARGS)
+{
+	spgLeafConsistentIn *in = (spgLeafConsistentIn *) PG_GETARG_POINTER(0);
+	spgLeafConsistentOut *out = (spgLeafConsistentOut *) PG_GETARG_POINTER(1);
+	float8	   *values;
+	int			ndims;
+	bool		res;
+	int			i,
+				j;
+
+	/* all tests are exact */
+	out->recheck = false;
+
+	/* leafDatum is what it is... */
+	out->leafValue = in->leafDatum;
+
+	values = getFeatureData(in->leafDatum, &ndims);
+
+	/* Perform the required comparison(s) */
+	res = true;
+	for (i = 0; i < in->nkeys; i++)
+	{
+		float8	   *query;
+		int			qdims;
+
+		switch (in->scankeys[i].sk_strategy)
+		{
+			case KD_FEATURE_EQUAL_STRATEGY:
+				query = getFeatureData(in->scankeys[i].sk_argument, &qdims);
+				res = (qdims == ndims);
+				for (j = 0; res && j < ndims; j++)
+					res = (query[j] == values[j]);
+				break;
+			case KD_FEATURE_DUMMY_STRATEGY:
+				/* always true */
+				break;
+			default:
+				elog(ERROR, "unrecognized strategy number: %d",
+					 in->scankeys[i].sk_strategy);
+				break;
+		}
+
+		if (!res)
+			break;
+	}
+
+	if (res && in->nnSearch && in->nkeys > 0)
+	{
+		float8	   *query;
+		int			qdims;
+		double		distance = 0;
+
+		query = getFeatureData(in->scankeys[0].sk_argument, &qdims);
+
+		if (qdims != ndims)
+			ereport(ERROR,
+					(errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+					 errmsg("the query feature has %d dimensions, but the features in the k-d tree have %d",
+							qdims, ndims)));
+
+		for (i = 0; i < ndims; i++)
+		{
+			double		diff = fabs(values[i] - query[i]);
+
+			if (in->nnNorm == MINKOWSKI_MAX_NORM)
+				distance = Max(distance, diff);
+			else if (in->nnNorm == 1)
+				distance += diff;
+			else if (in->nnNorm == 2)
+				distance += diff * diff;
+			else
+				distance += pow(diff, in->nnNorm);
+		}
+
+		out->distance = distance;
+	}
+
+	PG_RETURN_BOOL(res);
+}
@@ -18,6 +18,7 @@
 #include "access/relscan.h"
 #include "access/spgist_private.h"
 #include "miscadmin.h"
+#include "nodes/parsenodes.h"
 #include "storage/bufmgr.h"
 #include "utils/datum.h"
 #include "utils/memutils.h"
@@ -34,6 +35,27 @@ typedef struct ScanStackEntry
 	ItemPointerData ptr;		/* block and offset to scan from */
 } ScanStackEntry;
 
+/*
+ * ADAM: entry of the queue used for nearest neighbour search; it either
+ * denotes an index tuple still to be visited or a heap tuple to be reported
+ */
+typedef struct ScanNNItem
+{
+	double		distance;		/* lower bound resp. exact distance */
+	bool		isLeaf;			/* heap tuple to report? */
+	bool		recheck;		/* if so, must operator be rechecked? */
+	int			level;			/* level of items on this page */
+	ItemPointerData ptr;		/* index tuple resp. heap tuple */
+	void	   *traversalValue; /* opclass-specific value from parent */
+} ScanNNItem;
+
+typedef struct ScanNNQueue
+{
+	ScanNNItem *items;			/* binary min-heap on distance */
+	int			nItems;
+	int			maxItems;
+} ScanNNQueue;
+
 
 /* Free a ScanStackEntry */
 static void
@@ -263,7 +285,7 @@ static bool
 spgLeafTest(Relation index, SpGistScanOpaque so,
 			SpGistLeafTuple leafTuple, bool isnull,
 			int level, Datum reconstructedValue,
-			Datum *leafValue, bool *recheck)
+			Datum *leafValue, bool *recheck, double *distance)
 {
 	bool		result;
 	Datum		leafDatum;
@@ -292,9 +314,12 @@ spgLeafTest(Relation index, SpGistScanOpaque so,
 	in.level = level;
 	in.returnData = so->want_itup;
 	in.leafDatum = leafDatum;
+	in.nnSearch = so->nnSearch;
+	in.nnNorm = so->nnNorm;
 
 	out.leafValue = (Datum) 0;
 	out.recheck = false;
+	out.distance = 0;
 
 	procinfo = index_getprocinfo(index, 1, SPGIST_LEAF_CONSISTENT_PROC);
 	result = DatumGetBool(FunctionCall2Coll(procinfo,
@@ -304,6 +329,8 @@ spgLeafTest(Relation index, SpGistScanOpaque so,
 
 	*leafValue = out.leafValue;
 	*recheck = out.recheck;
+	if (distance)
+		*distance = out.distance;
 
 	MemoryContextSwitchTo(oldCtx);
 
@@ -390,7 +417,8 @@ redirect:
 									stackEntry->level,
 									stackEntry->reconstructedValue,
 									&leafValue,
-									&recheck))
+									&recheck,
+									NULL))
 					{
 						storeRes(so, &leafTuple->heapPtr,
 								 leafValue, isnull, recheck);
@@ -436,7 +464,8 @@ redirect:
 									stackEntry->level,
 									stackEntry->reconstructedValue,
 									&leafValue,
-									&recheck))
+									&recheck,
+									NULL))
 					{
 						storeRes(so, &leafTuple->heapPtr,
 								 leafValue, isnull, recheck);
@@ -487,6 +516,10 @@ redirect:
 			in.prefixDatum = SGITDATUM(innerTuple, &so->state);
 			in.nNodes = innerTuple->nNodes;
 			in.nodeLabels = spgExtractNodeLabels(&so->state, innerTuple);
+			in.nnSearch = false;
+			in.nnNorm = 0;
+			in.traversalValue = NULL;
+			in.traversalMemoryContext = NULL;
 
 			/* collect node pointers */
 			nodes = (SpGistNodeTuple *) palloc(sizeof(SpGistNodeTuple) * in.nNodes);
@@ -562,6 +595,348 @@ redirect:
 		UnlockReleaseBuffer(buffer);
 }
 
+/*
+ * ADAM: add an item to the nearest neighbour queue
+ */
+static void
+nnQueueAdd(ScanNNQueue *queue, ScanNNItem *item)
+{
+	int			i;
+
+	if (queue->nItems >= queue->maxItems)
+	{
+		queue->maxItems *= 2;
+		queue->items = (ScanNNItem *)
+			repalloc(queue->items, sizeof(ScanNNItem) * queue->maxItems);
+	}
+
+	/* sift up */
+	i = queue->nItems++;
+	while (i > 0)
+	{
+		int			parent = (i - 1) / 2;
+
+		if (queue->items[parent].distance < item->distance ||
+			(queue->items[parent].distance == item->distance &&
+			 (queue->items[parent].isLeaf || !item->isLeaf)))
+			break;
+
+		queue->items[i] = queue->items[parent];
+		i = parent;
+	}
+	queue->items[i] = *item;
+}
+
+/*
+ * ADAM: remove the item with the smallest distance from the nearest
+ * neighbour queue; on ties, heap tuples are preferred over index tuples
+ */
+static void
+nnQueuePop(ScanNNQueue *queue, ScanNNItem *item)
+{
+	ScanNNItem	last;
+	int			i = 0;
+
+	Assert(queue->nItems > 0);
+
+	*item = queue->items[0];
+	last = queue->items[--queue->nItems];
+
+	/* sift down */
+	for (;;)
+	{
+		int			child = 2 * i + 1;
+		ScanNNItem *c;
+
+		if (child >= queue->nItems)
+			break;
+
+		c = &queue->items[child];
+		if (child + 1 < queue->nItems &&
+			(queue->items[child + 1].distance < c->distance ||
+			 (queue->items[child + 1].distance == c->distance &&
+			  queue->items[child + 1].isLeaf && !c->isLeaf)))
+			c = &queue->items[++child];
+
+		if (last.distance < c->distance ||
+			(last.distance == c->distance && (last.isLeaf || !c->isLeaf)))
+			break;
+
+		queue->items[i] = *c;
+		i = child;
+	}
+	queue->items[i] = last;
+}
+
+/*
+ * ADAM: walk the tree in best-first order and report the so->nnLimit heap
+ * tuples nearest to the query to the storeRes subroutine.
+ *
+ * Index tuples are visited in increasing order of the lower distance bound
+ * reported by the inner consistent function, so that subtrees that cannot
+ * contain any of the nearest neighbours are never read.  The opclass must
+ * guarantee that the bound of a child is never smaller than the bound of
+ * its parent and that the exact distance of a leaf is never smaller than
+ * the bound of the node it lives in.
+ */
+static void
+spgWalkNN(Relation index, SpGistScanOpaque so, storeRes_func storeRes)
+{
+	Buffer		buffer = InvalidBuffer;
+	MemoryContext nnCxt;
+	MemoryContext oldCtx;
+	ScanNNQueue queue;
+	ScanNNItem	item;
+	int			reported = 0;
+
+	/* queue and traversal values live until the end of the walk */
+	nnCxt = AllocSetContextCreate(CurrentMemoryContext,
+								  "SP-GiST nearest neighbour context",
+								  ALLOCSET_DEFAULT_MINSIZE,
+								  ALLOCSET_DEFAULT_INITSIZE,
+								  ALLOCSET_DEFAULT_MAXSIZE);
+
+	queue.maxItems = 64;
+	queue.nItems = 0;
+	queue.items = (ScanNNItem *) MemoryContextAlloc(nnCxt,
+										sizeof(ScanNNItem) * queue.maxItems);
+
+	memset(&item, 0, sizeof(item));
+	ItemPointerSet(&item.ptr, SPGIST_ROOT_BLKNO, FirstOffsetNumber);
+	nnQueueAdd(&queue, &item);
+
+	while (reported < so->nnLimit && queue.nItems > 0)
+	{
+		BlockNumber blkno;
+		OffsetNumber offset;
+		Page		page;
+
+		nnQueuePop(&queue, &item);
+
+		if (item.isLeaf)
+		{
+			storeRes(so, &item.ptr, (Datum) 0, false, item.recheck);
+			reported++;
+			continue;
+		}
+
+redirect:
+		/* Check for interrupts, just in case of infinite loop */
+		CHECK_FOR_INTERRUPTS();
+
+		blkno = ItemPointerGetBlockNumber(&item.ptr);
+		offset = ItemPointerGetOffsetNumber(&item.ptr);
+
+		if (buffer == InvalidBuffer)
+		{
+			buffer = ReadBuffer(index, blkno);
+			LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		}
+		else if (blkno != BufferGetBlockNumber(buffer))
+		{
+			UnlockReleaseBuffer(buffer);
+			buffer = ReadBuffer(index, blkno);
+			LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		}
+		/* else new pointer points to the same page, no work needed */
+
+		page = BufferGetPage(buffer);
+
+		if (SpGistPageIsLeaf(page))
+		{
+			SpGistLeafTuple leafTuple;
+			OffsetNumber max = PageGetMaxOffsetNumber(page);
+			Datum		leafValue = (Datum) 0;
+			ScanNNItem	leafItem;
+
+			memset(&leafItem, 0, sizeof(leafItem));
+			leafItem.isLeaf = true;
+
+			if (SpGistBlockIsRoot(blkno))
+			{
+				/* When root is a leaf, examine all its tuples */
+				for (offset = FirstOffsetNumber; offset <= max; offset++)
+				{
+					leafTuple = (SpGistLeafTuple)
+						PageGetItem(page, PageGetItemId(page, offset));
+					if (leafTuple->tupstate != SPGIST_LIVE)
+					{
+						/* all tuples on root should be live */
+						elog(ERROR, "unexpected SPGiST tuple state: %d",
+							 leafTuple->tupstate);
+					}
+
+					Assert(ItemPointerIsValid(&leafTuple->heapPtr));
+					if (spgLeafTest(index, so,
+									leafTuple, false,
+									item.level,
+									(Datum) 0,
+									&leafValue,
+									&leafItem.recheck,
+									&leafItem.distance))
+					{
+						leafItem.ptr = leafTuple->heapPtr;
+						nnQueueAdd(&queue, &leafItem);
+					}
+				}
+			}
+			else
+			{
+				/* Normal case: just examine the chain we arrived at */
+				while (offset != InvalidOffsetNumber)
+				{
+					Assert(offset >= FirstOffsetNumber && offset <= max);
+					leafTuple = (SpGistLeafTuple)
+						PageGetItem(page, PageGetItemId(page, offset));
+					if (leafTuple->tupstate != SPGIST_LIVE)
+					{
+						if (leafTuple->tupstate == SPGIST_REDIRECT)
+						{
+							/* redirection tuple should be first in chain */
+							Assert(offset == ItemPointerGetOffsetNumber(&item.ptr));
+							/* transfer attention to redirect point */
+							item.ptr = ((SpGistDeadTuple) leafTuple)->pointer;
+							Assert(ItemPointerGetBlockNumber(&item.ptr) != SPGIST_METAPAGE_BLKNO);
+							goto redirect;
+						}
+						if (leafTuple->tupstate == SPGIST_DEAD)
+						{
+							/* dead tuple should be first in chain */
+							Assert(offset == ItemPointerGetOffsetNumber(&item.ptr));
+							/* No live entries on this page */
+							Assert(leafTuple->nextOffset == InvalidOffsetNumber);
+							break;
+						}
+						/* We should not arrive at a placeholder */
+						elog(ERROR, "unexpected SPGiST tuple state: %d",
+							 leafTuple->tupstate);
+					}
+
+					Assert(ItemPointerIsValid(&leafTuple->heapPtr));
+					if (spgLeafTest(index, so,
+									leafTuple, false,
+									item.level,
+									(Datum) 0,
+									&leafValue,
+									&leafItem.recheck,
+									&leafItem.distance))
+					{
+						leafItem.ptr = leafTuple->heapPtr;
+						nnQueueAdd(&queue, &leafItem);
+					}
+
+					offset = leafTuple->nextOffset;
+				}
+			}
+		}
+		else	/* page is inner */
+		{
+			SpGistInnerTuple innerTuple;
+			spgInnerConsistentIn in;
+			spgInnerConsistentOut out;
+			FmgrInfo   *procinfo;
+			SpGistNodeTuple *nodes;
+			SpGistNodeTuple node;
+			int			i;
+
+			innerTuple = (SpGistInnerTuple) PageGetItem(page,
+												PageGetItemId(page, offset));
+
+			if (innerTuple->tupstate != SPGIST_LIVE)
+			{
+				if (innerTuple->tupstate == SPGIST_REDIRECT)
+				{
+					/* transfer attention to redirect point */
+					item.ptr = ((SpGistDeadTuple) innerTuple)->pointer;
+					Assert(ItemPointerGetBlockNumber(&item.ptr) != SPGIST_METAPAGE_BLKNO);
+					goto redirect;
+				}
+				elog(ERROR, "unexpected SPGiST tuple state: %d",
+					 innerTuple->tupstate);
+			}
+
+			/* use temp context for calling inner_consistent */
+			oldCtx = MemoryContextSwitchTo(so->tempCxt);
+
+			in.scankeys = so->keyData;
+			in.nkeys = so->numberOfKeys;
+			in.reconstructedValue = (Datum) 0;
+			in.level = item.level;
+			in.returnData = false;
+			in.allTheSame = innerTuple->allTheSame;
+			in.hasPrefix = (innerTuple->prefixSize > 0);
+			in.prefixDatum = SGITDATUM(innerTuple, &so->state);
+			in.nNodes = innerTuple->nNodes;
+			in.nodeLabels = spgExtractNodeLabels(&so->state, innerTuple);
+			in.nnSearch = true;
+			in.nnNorm = so->nnNorm;
+			in.traversalValue = item.traversalValue;
+			in.traversalMemoryContext = nnCxt;
+
+			/* collect node pointers */
+			nodes = (SpGistNodeTuple *) palloc(sizeof(SpGistNodeTuple) * in.nNodes);
+			SGITITERATE(innerTuple, i, node)
+			{
+				nodes[i] = node;
+			}
+
+			memset(&out, 0, sizeof(out));
+
+			procinfo = index_getprocinfo(index, 1, SPGIST_INNER_CONSISTENT_PROC);
+			FunctionCall2Coll(procinfo,
+							  index->rd_indcollation[0],
+							  PointerGetDatum(&in),
+							  PointerGetDatum(&out));
+
+			MemoryContextSwitchTo(oldCtx);
+
+			/* If allTheSame, they should all or none of 'em match */
+			if (innerTuple->allTheSame)
+				if (out.nNodes != 0 && out.nNodes != in.nNodes)
+					elog(ERROR, "inconsistent inner_consistent results for allTheSame inner tuple");
+
+			for (i = 0; i < out.nNodes; i++)
+			{
+				int			nodeN = out.nodeNumbers[i];
+
+				Assert(nodeN >= 0 && nodeN < in.nNodes);
+				if (ItemPointerIsValid(&nodes[nodeN]->t_tid))
+				{
+					ScanNNItem	newItem;
+
+					/* Create new work item for this node */
+					memset(&newItem, 0, sizeof(newItem));
+					newItem.ptr = nodes[nodeN]->t_tid;
+					if (out.levelAdds)
+						newItem.level = item.level + out.levelAdds[i];
+					else
+						newItem.level = item.level;
+					/* a child can never be closer than its parent */
+					if (out.distances)
+						newItem.distance = Max(out.distances[i], item.distance);
+					else
+						newItem.distance = item.distance;
+					if (out.traversalValues)
+						newItem.traversalValue = out.traversalValues[i];
+
+					nnQueueAdd(&queue, &newItem);
+				}
+			}
+		}
+
+		/* done with this item */
+		if (item.traversalValue != NULL)
+			pfree(item.traversalValue);
+		/* clear temp context before proceeding to the next one */
+		MemoryContextReset(so->tempCxt);
+	}
+
+	if (buffer != InvalidBuffer)
+		UnlockReleaseBuffer(buffer);
+
+	MemoryContextDelete(nnCxt);
+}
+
 /* storeRes subroutine for getbitmap case */
 static void
 storeBitmap(SpGistScanOpaque so, ItemPointer heapPtr,
@@ -577,6 +952,7 @@ spggetbitmap(PG_FUNCTION_ARGS)
 	IndexScanDesc scan = (IndexScanDesc) PG_GETARG_POINTER(0);
 	TIDBitmap  *tbm = (TIDBitmap *) PG_GETARG_POINTER(1);
 	SpGistScanOpaque so = (SpGistScanOpaque) scan->opaque;
+	AdamScanClause *adamOptions = (AdamScanClause *) scan->adamScanClause;
 
 	/* Copy want_itup to *so so we don't need to pass it around separately */
 	so->want_itup = false;
@@ -584,7 +960,31 @@ spggetbitmap(PG_FUNCTION_ARGS)
 	so->tbm = tbm;
 	so->ntids = 0;
 
-	spgWalk(scan->indexRelation, so, true, storeBitmap);
+	/*
+	 * ADAM: for a nearest neighbour query without further restrictions only
+	 * the nn_limit nearest tuples have to be reported, provided the opclass
+	 * is able to bound distances (which it only does for unweighted ones)
+	 */
+	so->nnSearch = false;
+	if (adamOptions && adamOptions->nn_limit > 0 &&
+		adamOptions->nn_distance == ADAM_DISTANCE_MINKOWSKI &&
+		adamOptions->nn_weights == NULL &&
+		!adamOptions->extendedWhereClause && !adamOptions->check_tid &&
+		so->state.config.canNNSearch &&
+		so->numberOfKeys > 0 && so->searchNonNulls && !so->searchNulls)
+	{
+		so->nnSearch = true;
+		so->nnNorm = adamOptions->nn_minkowski;
+		so->nnLimit = adamOptions->nn_limit;
+	}
+
+	if (so->nnSearch)
+	{
+		spgWalkNN(scan->indexRelation, so, storeBitmap);
+		so->nnSearch = false;
+	}
+	else
+		spgWalk(scan->indexRelation, so, true, storeBitmap);
 
 	PG_RETURN_INT64(so->ntids);
 }
@@ -17,6 +17,8 @@
 #include "commands/adam_data_featurefunctioncmds.h"
 #include "catalog/adam_data_featurefunction.h"
 #include "catalog/adam_data_featurefunction_fn.h"
+#include "catalog/adam_data_codebook.h"
+#include "utils/adam_retrieval_bow.h"
 #include "access/htup_details.h"
 #include "access/xact.h"
 #include "catalog/dependency.h"
@@ -159,6 +161,7 @@ static const Oid object_classes[MAX_OCLASS] = {
 	ExtensionRelationId,		/* OCLASS_EXTENSION */
 	EventTriggerRelationId,		/* OCLASS_EVENT_TRIGGER */
 	AdamFeatureFunRelationId,   /* OCLASS_ADAMFEATUREFUN */
+	AdamCodebookRelationId,		/* OCLASS_ADAMCODEBOOK */
 };
 
 
@@ -1256,6 +1259,10 @@ doDeletion(const ObjectAddress *object, int flags)
 		case OCLASS_ADAMFEATUREFUN:
 			removeFeatureFun(object->objectId);
 			break;
+
+		case OCLASS_ADAMCODEBOOK:
+			removeCodebookById(object->objectId);
+			break;
 		default:
 			elog(ERROR, "unrecognized object class: %u",
 				 object->classId);
@@ -2317,6 +2324,9 @@ getObjectClass(const ObjectAddress *object)
 			return OCLASS_EVENT_TRIGGER;
 		case AdamFeatureFunRelationId:
 			return OCLASS_ADAMFEATUREFUN;
+
+		case AdamCodebookRelationId:
+			return OCLASS_ADAMCODEBOOK;
 	}
 
 	/* shouldn't get here */
@@ -626,6 +626,7 @@ UpdateIndexRelation(Oid indexoid,
 		nulls[Anum_pg_index_indpred - 1] = true;
 
 	nulls[Anum_pg_index_marks - 1] = true;
+	nulls[Anum_pg_index_projection - 1] = true;
 
 	tuple = heap_form_tuple(RelationGetDescr(pg_index), values, nulls);
 
@@ -3552,7 +3553,7 @@ ResetReindexPending(void)
 
 
 void
-	UpdateIndexAddMarks(Oid index, Datum marks)
+	UpdateIndexAddMarks(Oid index, Datum marks, Datum projection)
 {
 	Datum		values[Natts_pg_index];
 	bool		nulls[Natts_pg_index];
@@ -3578,6 +3579,13 @@ void
 		values[Anum_pg_index_marks - 1] = marks;
 	}
 
+	//the projection is replaced in any case, as it may have been dropped
+	replaces[Anum_pg_index_projection - 1] = true;
+	if(projection != (Datum) 0){
+		nulls[Anum_pg_index_projection - 1] = false;
+		values[Anum_pg_index_projection - 1] = projection;
+	}
+
 	pg_index = heap_open(IndexRelationId, RowExclusiveLock);
 
 	tuple = SearchSysCacheCopy1(INDEXRELID, ObjectIdGetDatum(index));
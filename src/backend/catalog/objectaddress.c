@@ -17,6 +17,7 @@
 
 #include "catalog/adam_data_featurefunction.h"
 #include "parser/adam_data_parse_featurefunction.h"
+#include "utils/adam_retrieval_bow.h"
 #include "access/htup_details.h"
 #include "access/sysattr.h"
 #include "catalog/catalog.h"
@@ -2180,6 +2181,11 @@ getObjectDescription(const ObjectAddress *object)
 				break;
 			}
 
+		case OCLASS_ADAMCODEBOOK:
+			appendStringInfo(&buffer, _("codebook %s"),
+							 getCodebookName(object->objectId));
+			break;
+
 		default:
 			appendStringInfo(&buffer, "unrecognized object %u %u %d",
 							 object->classId,
@@ -2591,6 +2597,10 @@ getObjectTypeDescription(const ObjectAddress *object)
 			appendStringInfo(&buffer, "event trigger");
 			break;
 
+		case OCLASS_ADAMCODEBOOK:
+			appendStringInfo(&buffer, "codebook");
+			break;
+
 		default:
 			appendStringInfo(&buffer, "unrecognized %u", object->classId);
 			break;
@@ -3334,6 +3344,11 @@ getObjectIdentity(const ObjectAddress *object)
 				break;
 			}
 
+		case OCLASS_ADAMCODEBOOK:
+			appendStringInfo(&buffer, "%s",
+							 quote_identifier(getCodebookName(object->objectId)));
+			break;
+
 		default:
 			appendStringInfo(&buffer, "unrecognized object %u %u %d",
 							 object->classId,
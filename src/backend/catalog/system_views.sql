@@ -520,6 +520,25 @@ CREATE VIEW pg_stat_user_indexes AS
     WHERE schemaname NOT IN ('pg_catalog', 'information_schema') AND
           schemaname !~ '^pg_toast';
 
+-- ADAM: cumulative statistics of the VA indexes, see EXPLAIN ANALYZE for single searches
+CREATE VIEW pg_stat_va_indexes AS
+    SELECT
+            C.oid AS relid,
+            I.oid AS indexrelid,
+            N.nspname AS schemaname,
+            C.relname AS relname,
+            I.relname AS indexrelname,
+            pg_stat_get_numscans(I.oid) AS va_scan,
+            pg_stat_get_va_candidates(I.oid) AS va_candidates,
+            now() - va_build_time(I.oid) AS rebuild_age,
+            va_changes(I.oid) AS n_changes
+    FROM pg_class C JOIN
+            pg_index X ON C.oid = X.indrelid JOIN
+            pg_class I ON I.oid = X.indexrelid JOIN
+            pg_am A ON A.oid = I.relam
+            LEFT JOIN pg_namespace N ON (N.oid = C.relnamespace)
+    WHERE C.relkind IN ('r', 'm') AND A.amname = 'va' AND X.indisvalid;
+
 CREATE VIEW pg_statio_all_indexes AS
     SELECT
             C.oid AS relid,
@@ -69,6 +69,7 @@ Oid
 	List	   *as_clause;
 	TypeName   *typname;
 	Oid			ffunoid = InvalidOid;
+	List	   *elemTypes = NIL;
 
 	/* Convert list of names to a name and namespace */
 	ffnamespace = QualifiedNameGetCreationNamespace(stmt->fstmt.funcname, &funcname);
@@ -157,6 +158,25 @@ Oid
 		lappend(stmt->fstmt.parameters, param);*/
 	}
 
+	// the features taken by a distance carry the type of their elements as
+	// type modifier, which the feature type itself does not accept; remember
+	// the element types for the checks below and strip the modifiers
+	if(fftype == DISTANCEOID){
+		ListCell *cell;
+
+		foreach(cell, stmt->fstmt.parameters){
+			FunctionParameter *fp = (FunctionParameter *) lfirst(cell);
+
+			if(fp->argType->typmods != NULL){
+				TypeName *name = (TypeName *) linitial(fp->argType->typmods);
+				elemTypes = lappend_oid(elemTypes, typenameTypeId(NULL, name));
+				fp->argType->typmods = NIL;
+			} else {
+				elemTypes = lappend_oid(elemTypes, InvalidOid);
+			}
+		}
+	}
+
 	/*
 	* Convert remaining parameters of CREATE to form wanted by
 	* ProcedureCreate.
@@ -271,20 +291,21 @@ Oid
 				ffname)));
 		}
 
+		//distances in batch form return one distance per candidate
+		if (parameterTypes->dim1 >= 2 && parameterTypes->values[1] == FEATUREARRAYOID && prorettype != FLOAT8ARRAYOID){
+			ereport(ERROR,
+				(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+				errmsg("%s \"%s\" takes an array of candidates and must return double precision[]", 
+				typeTypeName(typeidType(fftype)), 
+				ffname)));
+		}
+
 		//function parameters are identical
-		cell = list_head(stmt->fstmt.parameters);
+		cell = list_head(elemTypes);
 		for (i = 0; i <= 1 && cell != NULL; i++){
-			Oid temptypmod = InvalidOid;
-			FunctionParameter *fp = (FunctionParameter *) lfirst(cell);
-
-			if(fp->argType->typmods != NULL){
-				TypeName *name = (TypeName *) linitial(fp->argType->typmods);
-				temptypmod = typenameTypeId(NULL, name);
-			} else {
-				temptypmod = -1;
-			}
+			Oid temptypmod = lfirst_oid(cell);
 
-			if(typemod == InvalidOid){
+			if(i == 0){
 				typemod = temptypmod;
 			} else if(typemod == temptypmod){
 				// do nothing
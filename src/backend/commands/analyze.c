@@ -1298,6 +1298,38 @@ acquire_sample_rows(Relation onerel, int elevel,
 	return numrows;
 }
 
+/*
+ * acquire_sample_rows_outside_analyze -- sample rows for a non-ANALYZE caller
+ *
+ * vac_strategy is only valid while analyze_rel runs; afterwards it points
+ * into the freed vacuum memory context.  Callers such as the ADAM index
+ * builds sample through the shared buffers without a strategy instead.
+ */
+int
+acquire_sample_rows_outside_analyze(Relation onerel, int elevel,
+									HeapTuple *rows, int targrows,
+									double *totalrows, double *totaldeadrows)
+{
+	BufferAccessStrategy save_strategy = vac_strategy;
+	int			numrows;
+
+	vac_strategy = NULL;
+	PG_TRY();
+	{
+		numrows = acquire_sample_rows(onerel, elevel, rows, targrows,
+									  totalrows, totaldeadrows);
+	}
+	PG_CATCH();
+	{
+		vac_strategy = save_strategy;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	vac_strategy = save_strategy;
+
+	return numrows;
+}
+
 /* Select a random value R uniformly distributed in (0 - 1) */
 double
 anl_random_fract(void)
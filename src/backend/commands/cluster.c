@@ -28,6 +28,7 @@
 #include "catalog/index.h"
 #include "catalog/namespace.h"
 #include "catalog/objectaccess.h"
+#include "catalog/pg_am.h"
 #include "catalog/toasting.h"
 #include "commands/cluster.h"
 #include "commands/tablecmds.h"
@@ -39,6 +40,7 @@
 #include "storage/predicate.h"
 #include "storage/smgr.h"
 #include "utils/acl.h"
+#include "utils/adam_index_va.h"
 #include "utils/fmgroids.h"
 #include "utils/inval.h"
 #include "utils/lsyscache.h"
@@ -751,6 +753,9 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex,
 	RewriteState rwstate;
 	bool		use_sort;
 	Tuplesortstate *tuplesort;
+	VAClusterState *vaCluster;
+	Buffer		vaBuffer = InvalidBuffer;
+	HeapTupleData vaTuple;
 	double		num_tuples = 0,
 				tups_vacuumed = 0,
 				tups_recently_dead = 0;
@@ -887,12 +892,27 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex,
 	else
 		tuplesort = NULL;
 
+	/*
+	 * ADAM: on a VA file, the tuples are ordered by the similarity of their
+	 * features; vaBeginCluster scans the OldHeap and returns the tuples in
+	 * that order, which we then fetch one by one
+	 */
+	if (OldIndex != NULL && OldIndex->rd_rel->relam == VA_AM_OID)
+		vaCluster = vaBeginCluster(OldHeap, OldIndex, OldestXmin);
+	else
+		vaCluster = NULL;
+
 	/*
 	 * Prepare to scan the OldHeap.  To ensure we see recently-dead tuples
 	 * that still need to be copied, we scan with SnapshotAny and use
 	 * HeapTupleSatisfiesVacuum for the visibility test.
 	 */
-	if (OldIndex != NULL && !use_sort)
+	if (vaCluster != NULL)
+	{
+		heapScan = NULL;
+		indexScan = NULL;
+	}
+	else if (OldIndex != NULL && !use_sort)
 	{
 		heapScan = NULL;
 		indexScan = index_beginscan(OldHeap, OldIndex, SnapshotAny, 0, 0);
@@ -905,7 +925,13 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex,
 	}
 
 	/* Log what we're doing */
-	if (indexScan != NULL)
+	if (vaCluster != NULL)
+		ereport(elevel,
+				(errmsg("clustering \"%s.%s\" by similarity on \"%s\"",
+						get_namespace_name(RelationGetNamespace(OldHeap)),
+						RelationGetRelationName(OldHeap),
+						RelationGetRelationName(OldIndex))));
+	else if (indexScan != NULL)
 		ereport(elevel,
 				(errmsg("clustering \"%s.%s\" using index scan on \"%s\"",
 						get_namespace_name(RelationGetNamespace(OldHeap)),
@@ -948,6 +974,33 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex,
 
 			buf = indexScan->xs_cbuf;
 		}
+		else if (vaCluster != NULL)
+		{
+			ItemPointerData tid;
+			Page		page;
+			ItemId		lp;
+
+			if (!vaClusterNext(vaCluster, &tid))
+				break;
+
+			/*
+			 * We hold AccessExclusiveLock on the OldHeap since the tuples were
+			 * collected, so the line pointers cannot have changed
+			 */
+			vaBuffer = ReleaseAndReadBuffer(vaBuffer, OldHeap,
+											ItemPointerGetBlockNumber(&tid));
+			page = BufferGetPage(vaBuffer);
+			lp = PageGetItemId(page, ItemPointerGetOffsetNumber(&tid));
+			Assert(ItemIdIsNormal(lp));
+
+			vaTuple.t_data = (HeapTupleHeader) PageGetItem(page, lp);
+			vaTuple.t_len = ItemIdGetLength(lp);
+			vaTuple.t_self = tid;
+			vaTuple.t_tableOid = RelationGetRelid(OldHeap);
+
+			tuple = &vaTuple;
+			buf = vaBuffer;
+		}
 		else
 		{
 			tuple = heap_getnext(heapScan, ForwardScanDirection);
@@ -1037,6 +1090,12 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex,
 		index_endscan(indexScan);
 	if (heapScan != NULL)
 		heap_endscan(heapScan);
+	if (vaCluster != NULL)
+	{
+		if (BufferIsValid(vaBuffer))
+			ReleaseBuffer(vaBuffer);
+		vaEndCluster(vaCluster);
+	}
 
 	/*
 	 * In scan-and-sort mode, complete the sort, then read out all live tuples
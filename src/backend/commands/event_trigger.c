@@ -76,6 +76,7 @@ static event_trigger_support_data event_trigger_support[] = {
 	{"DOMAIN", true},
 	{"EXTENSION", true},
 	{"EVENT TRIGGER", false},
+	{"FEATUREFUN", true},
 	{"FOREIGN DATA WRAPPER", true},
 	{"FOREIGN TABLE", true},
 	{"FUNCTION", true},
@@ -992,6 +993,7 @@ EventTriggerSupportsObjectClass(ObjectClass objclass)
 		case OCLASS_USER_MAPPING:
 		case OCLASS_DEFACL:
 		case OCLASS_EXTENSION:
+		case OCLASS_ADAMCODEBOOK:
 			return true;
 
 		case MAX_OCLASS:
@@ -24,6 +24,7 @@
 #include "parser/parsetree.h"
 #include "rewrite/rewriteHandler.h"
 #include "tcop/tcopprot.h"
+#include "utils/adam_index_va.h"
 #include "utils/builtins.h"
 #include "utils/json.h"
 #include "utils/lsyscache.h"
@@ -80,7 +81,12 @@ static void show_sort_keys_common(PlanState *planstate,
 					  int nkeys, AttrNumber *keycols,
 					  List *ancestors, ExplainState *es);
 static void show_sort_info(SortState *sortstate, ExplainState *es);
+static void show_sort_browse_info(SortState *sortstate, List *ancestors,
+					  ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_va_info(BitmapIndexScanState *bisstate, ExplainState *es);
+static void show_similarityjoin_info(SimilarityJoinState *sjstate,
+						 ExplainState *es);
 static void show_instrumentation_count(const char *qlabel, int which,
 						   PlanState *planstate, ExplainState *es);
 static void show_foreignscan_info(ForeignScanState *fsstate, ExplainState *es);
@@ -861,6 +867,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			pname = "Hash";		/* "Join" gets added by jointype switch */
 			sname = "Hash Join";
 			break;
+		case T_SimilarityJoin:
+			pname = "Similarity";	/* "Join" gets added by jointype switch */
+			sname = "Similarity Join";
+			break;
 		case T_SeqScan:
 			pname = sname = "Seq Scan";
 			break;
@@ -1051,6 +1061,7 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_NestLoop:
 		case T_MergeJoin:
 		case T_HashJoin:
+		case T_SimilarityJoin:
 			{
 				const char *jointype;
 
@@ -1239,6 +1250,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_BitmapIndexScan:
 			show_scan_qual(((BitmapIndexScan *) plan)->indexqualorig,
 						   "Index Cond", planstate, ancestors, es);
+			/* ADAM */
+			if (es->analyze)
+				show_va_info((BitmapIndexScanState *) planstate, es);
 			break;
 		case T_BitmapHeapScan:
 			show_scan_qual(((BitmapHeapScan *) plan)->bitmapqualorig,
@@ -1328,6 +1342,18 @@ ExplainNode(PlanState *planstate, List *ancestors,
 				show_instrumentation_count("Rows Removed by Filter", 2,
 										   planstate, es);
 			break;
+		case T_SimilarityJoin:
+			show_upper_qual(((SimilarityJoin *) plan)->join.joinqual,
+							"Join Filter", planstate, ancestors, es);
+			if (((SimilarityJoin *) plan)->join.joinqual)
+				show_instrumentation_count("Rows Removed by Join Filter", 1,
+										   planstate, es);
+			show_upper_qual(plan->qual, "Filter", planstate, ancestors, es);
+			if (plan->qual)
+				show_instrumentation_count("Rows Removed by Filter", 2,
+										   planstate, es);
+			show_similarityjoin_info((SimilarityJoinState *) planstate, es);
+			break;
 		case T_Agg:
 		case T_Group:
 			show_upper_qual(plan->qual, "Filter", planstate, ancestors, es);
@@ -1337,6 +1363,7 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			break;
 		case T_Sort:
 			show_sort_keys((SortState *) planstate, ancestors, es);
+			show_sort_browse_info((SortState *) planstate, ancestors, es);
 			show_sort_info((SortState *) planstate, es);
 			break;
 		case T_MergeAppend:
@@ -1771,6 +1798,46 @@ show_sort_info(SortState *sortstate, ExplainState *es)
 	}
 }
 
+/*
+ * ADAM: show whether the sort browses the results of a VA search by distance,
+ * and in how many rounds (see nodeSort.c)
+ */
+static void
+show_sort_browse_info(SortState *sortstate, List *ancestors, ExplainState *es)
+{
+	PlanState  *parent = ancestors ? (PlanState *) linitial(ancestors) : NULL;
+	bool		bounded;
+
+	if (!sortstate->adamBrowse)
+		return;
+
+	/* a LIMIT makes it a bounded sort instead (see nodeLimit.c) */
+	if (es->analyze)
+		bounded = sortstate->bounded;
+	else
+		bounded = parent != NULL && IsA(parent, LimitState) &&
+			((Limit *) parent->plan)->limitCount != NULL;
+
+	if (bounded)
+		return;
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfoString(es->str, "Distance Browsing: on");
+		if (es->analyze)
+			appendStringInfo(es->str, "  Rounds: %d", sortstate->adamRounds);
+		appendStringInfoChar(es->str, '\n');
+	}
+	else
+	{
+		ExplainPropertyText("Distance Browsing", "on", es);
+		if (es->analyze)
+			ExplainPropertyInteger("Distance Browsing Rounds",
+								   sortstate->adamRounds, es);
+	}
+}
+
 /*
  * Show information on hash buckets/batches.
  */
@@ -1813,6 +1880,122 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 	}
 }
 
+/*
+ * ADAM: show the counters of the searches of a VA file
+ */
+static void
+show_va_info(BitmapIndexScanState *bisstate, ExplainState *es)
+{
+	VAScanInstrumentation *instr = bisstate->adamInstrument;
+	double		pruned;
+
+	if (instr == NULL || instr->nscans == 0)
+		return;
+
+	pruned = (instr->tuples > 0) ?
+		100.0 * (1.0 - instr->candidates / instr->tuples) : 0.0;
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyFloat("VA Searches", instr->nscans, 0, es);
+		ExplainPropertyFloat("VA Cached Searches", instr->cachedScans, 0, es);
+		ExplainPropertyFloat("VA Result Cache Hits", instr->resultCacheHits, 0, es);
+		ExplainPropertyFloat("VA Approximations", instr->tuples, 0, es);
+		ExplainPropertyFloat("VA Candidates", instr->candidates, 0, es);
+		ExplainPropertyFloat("VA Pruned Percent", pruned, 2, es);
+		ExplainPropertyFloat("VA Bound Computations", instr->boundComputations, 0, es);
+		ExplainPropertyFloat("VA Pages Read", instr->pages, 0, es);
+		ExplainPropertyFloat("VA Kth Upper Bound", instr->kthUpperBound, 6, es);
+		ExplainPropertyFloat("VA Bounds Time", instr->pass1Time, 3, es);
+		ExplainPropertyFloat("VA Candidates Time", instr->pass2Time, 3, es);
+		if (instr->approximateScans > 0)
+			ExplainPropertyFloat("VA Estimated Recall",
+								 instr->recallSum / instr->approximateScans, 3, es);
+	}
+	else
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str,
+						 "VA Candidates: %.0f of %.0f (%.2f%% pruned)  Bound Computations: %.0f\n",
+						 instr->candidates, instr->tuples, pruned,
+						 instr->boundComputations);
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str, "VA Pages Read: %.0f", instr->pages);
+		if (instr->cachedScans > 0)
+			appendStringInfo(es->str, "  Cached Searches: %.0f of %.0f",
+							 instr->cachedScans, instr->nscans);
+		if (instr->resultCacheHits > 0)
+			appendStringInfo(es->str, "  Result Cache Hits: %.0f of %.0f",
+							 instr->resultCacheHits, instr->nscans);
+		if (instr->kthUpperBound > 0)
+			appendStringInfo(es->str, "  Kth Upper Bound: %g",
+							 instr->kthUpperBound);
+		appendStringInfoChar(es->str, '\n');
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str, "VA Time: bounds=%.3f candidates=%.3f\n",
+						 instr->pass1Time, instr->pass2Time);
+		if (instr->approximateScans > 0)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str, "VA Estimated Recall: %.3f (%.0f of %.0f searches approximate)\n",
+							 instr->recallSum / instr->approximateScans,
+							 instr->approximateScans, instr->nscans);
+		}
+	}
+}
+
+/*
+ * ADAM: show the number of neighbours and the VA index of a similarity join,
+ * and for EXPLAIN ANALYZE its counters
+ */
+static void
+show_similarityjoin_info(SimilarityJoinState *sjstate, ExplainState *es)
+{
+	SimilarityJoin *plan = (SimilarityJoin *) sjstate->js.ps.plan;
+	char	   *indexname = NULL;
+
+	if (OidIsValid(plan->vaIndex))
+	{
+		indexname = get_rel_name(plan->vaIndex);
+		if (indexname == NULL)
+			elog(ERROR, "cache lookup failed for index %u", plan->vaIndex);
+	}
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyInteger("Neighbours", plan->k, es);
+		if (indexname)
+			ExplainPropertyText("VA Index", indexname, es);
+		if (es->analyze)
+		{
+			ExplainPropertyFloat("Chunks", sjstate->sj_Chunks, 0, es);
+			ExplainPropertyFloat("Compared Pairs", sjstate->sj_Pairs, 0, es);
+			if (indexname)
+				ExplainPropertyFloat("VA Candidates", sjstate->sj_Candidates,
+									 0, es);
+		}
+	}
+	else
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str, "Neighbours: %d", plan->k);
+		if (indexname)
+			appendStringInfo(es->str, "  VA Index: %s",
+							 quote_identifier(indexname));
+		appendStringInfoChar(es->str, '\n');
+		if (es->analyze)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str, "Chunks: %.0f  Compared Pairs: %.0f",
+							 sjstate->sj_Chunks, sjstate->sj_Pairs);
+			if (indexname)
+				appendStringInfo(es->str, "  VA Candidates: %.0f",
+								 sjstate->sj_Candidates);
+			appendStringInfoChar(es->str, '\n');
+		}
+	}
+}
+
 /*
  * If it's EXPLAIN ANALYZE, show instrumentation information for a plan node
  *
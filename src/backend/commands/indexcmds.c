@@ -17,6 +17,7 @@
 
 #include "access/htup_details.h"
 #include "access/reloptions.h"
+#include "access/transam.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
 #include "catalog/index.h"
@@ -718,6 +719,19 @@ DefineIndex(IndexStmt *stmt,
 	heap_close(rel, NoLock);
 	index_close(indexRelation, NoLock);
 
+	/*
+	 * ADAM: the VA build stores its marks in the pg_index row, a transactional
+	 * update that must be committed before the row can be updated in place.
+	 * Tuples inserted in between are added by validate_index() in phase 3.
+	 */
+	if (TransactionIdIsValid(GetTopTransactionIdIfAny()))
+	{
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+		StartTransactionCommand();
+		PushActiveSnapshot(GetTransactionSnapshot());
+	}
+
 	/*
 	 * Update the pg_index row to mark the index as ready for inserts. Once we
 	 * commit this transaction, any new transactions that open the table must
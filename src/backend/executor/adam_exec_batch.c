@@ -0,0 +1,283 @@
+/*
+ * ADAM - batch evaluation of distance functions
+ * name: adam_exec_batch
+ * description: evaluates batch distance functions in the scan nodes
+ *
+ * src/backend/executor/adam_exec_batch.c
+ *
+ *
+ *
+ *
+ * addendum: distance functions in batch form (see adam_retrieval_batch.c) appear
+ * in the projection of a scan as calls to calculateBatchDistance; if the query
+ * vector is the same for all tuples, the scan node buffers up to
+ * ADAM_BATCH_DISTANCE_SIZE tuples that pass the quals, calls the distance function
+ * once for all of them and then projects the buffered tuples one by one (see
+ * ExecScan); this is only done for sequential and bitmap heap scans, i.e. the
+ * sequential kNN search and the refinement of the candidates of the VA file
+ *
+ */
+#include "postgres.h"
+
+#include "executor/adam_exec_batch.h"
+
+#include "catalog/pg_proc.h"
+#include "executor/executor.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/var.h"
+#include "utils/adam_retrieval_batch.h"
+#include "utils/memutils.h"
+
+static Datum ExecEvalAdamBatchDistance(ExprState *expression, ExprContext *econtext,
+						  bool *isNull, ExprDoneCond *isDone);
+static bool replaceBatchDistances(ExprState **state, AdamBatchState *batch);
+
+
+/*
+ * sets up the batch evaluation for a scan node if its projection contains
+ * batch distance functions; must be called after the projection info has been
+ * assigned
+ */
+void
+ExecInitAdamBatch(ScanState *node, int eflags)
+{
+	EState		   *estate = node->ps.state;
+	ProjectionInfo *projInfo = node->ps.ps_ProjInfo;
+	AdamBatchState *batch;
+	ListCell	   *cell;
+	bool			found = false;
+
+	node->adamBatch = NULL;
+
+	//reading ahead does not work with backward scans, marks or re-checks of locked rows
+	if (!projInfo || (eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK | EXEC_FLAG_EXPLAIN_ONLY)))
+		return;
+
+	if (estate->es_rowMarks != NIL || estate->es_plannedstmt->commandType != CMD_SELECT)
+		return;
+
+	if (expression_returns_set((Node *) node->ps.plan->targetlist))
+		return;
+
+	batch = palloc0(sizeof(AdamBatchState));
+
+	foreach(cell, projInfo->pi_targetlist)
+	{
+		GenericExprState *gstate = (GenericExprState *) lfirst(cell);
+
+		found |= replaceBatchDistances(&gstate->arg, batch);
+	}
+
+	if (!found)
+	{
+		pfree(batch);
+		return;
+	}
+
+	batch->batchcxt = AllocSetContextCreate(CurrentMemoryContext,
+											"ADAM batch distance context",
+											ALLOCSET_DEFAULT_MINSIZE,
+											ALLOCSET_DEFAULT_INITSIZE,
+											ALLOCSET_DEFAULT_MAXSIZE);
+	batch->slot = ExecInitExtraTupleSlot(estate);
+	ExecSetSlotDescriptor(batch->slot, node->ss_ScanTupleSlot->tts_tupleDescriptor);
+	batch->tuples = palloc(sizeof(HeapTuple) * ADAM_BATCH_DISTANCE_SIZE);
+	batch->ntuples = 0;
+	batch->current = -1;
+	batch->done = false;
+
+	node->adamBatch = batch;
+}
+
+/*
+ * walks through the function calls of an expression and replaces calls of
+ * calculateBatchDistance, where the query and the additional parameters
+ * do not depend on the tuple
+ */
+static bool
+replaceBatchDistances(ExprState **state, AdamBatchState *batch)
+{
+	FuncExprState *fstate;
+	ListCell   *cell;
+	bool		found = false;
+
+	if (*state == NULL || !IsA(*state, FuncExprState))
+		return false;
+
+	fstate = (FuncExprState *) *state;
+
+	if (IsA(fstate->xprstate.expr, FuncExpr) &&
+		((FuncExpr *) fstate->xprstate.expr)->funcid == BATCH_DISTANCE_PROCOID)
+	{
+		FuncExpr   *expr = (FuncExpr *) fstate->xprstate.expr;
+		Node	   *procarg = (Node *) linitial(expr->args);
+		AdamBatchDistanceState *dstate;
+		bool		batchable = true;
+		int			i = 0;
+
+		if (list_length(expr->args) < 3 || !IsA(procarg, Const) || ((Const *) procarg)->constisnull)
+			return false;
+
+		foreach(cell, expr->args)
+		{
+			//the candidate (third argument) is the only one that may depend on the tuple
+			if (i != 2 && contain_var_clause((Node *) lfirst(cell)))
+				batchable = false;
+			i++;
+		}
+
+		if (!batchable)
+			return false;
+
+		dstate = palloc0(sizeof(AdamBatchDistanceState));
+		dstate->xprstate.type = T_ExprState;
+		dstate->xprstate.expr = fstate->xprstate.expr;
+		dstate->xprstate.evalfunc = ExecEvalAdamBatchDistance;
+		dstate->batch = batch;
+		fmgr_info(DatumGetObjectId(((Const *) procarg)->constvalue), &dstate->flinfo);
+		dstate->collation = expr->inputcollid;
+		dstate->query = (ExprState *) lsecond(fstate->args);
+		dstate->candidate = (ExprState *) lthird(fstate->args);
+		dstate->extras = list_copy_tail(fstate->args, 3);
+		dstate->candidates = palloc(sizeof(Datum) * ADAM_BATCH_DISTANCE_SIZE);
+		dstate->candidateNulls = palloc(sizeof(bool) * ADAM_BATCH_DISTANCE_SIZE);
+		dstate->results = palloc(sizeof(float8) * ADAM_BATCH_DISTANCE_SIZE);
+		dstate->resultNulls = palloc(sizeof(bool) * ADAM_BATCH_DISTANCE_SIZE);
+
+		batch->distances = lappend(batch->distances, dstate);
+		*state = (ExprState *) dstate;
+
+		return true;
+	}
+
+	//e.g. normalization or weighting of the distance
+	foreach(cell, fstate->args)
+	{
+		found |= replaceBatchDistances((ExprState **) &lfirst(cell), batch);
+	}
+
+	return found;
+}
+
+/*
+ * forgets about the buffered tuples, e.g. for a rescan
+ */
+void
+ExecAdamBatchReset(AdamBatchState *batch)
+{
+	ExecClearTuple(batch->slot);
+	MemoryContextReset(batch->batchcxt);
+
+	batch->ntuples = 0;
+	batch->current = -1;
+	batch->done = false;
+}
+
+/*
+ * buffers a tuple that passed the quals together with its candidate vectors
+ */
+void
+ExecAdamBatchAddTuple(AdamBatchState *batch, ExprContext *econtext, TupleTableSlot *slot)
+{
+	MemoryContext oldcxt;
+	ListCell   *cell;
+	int			n = batch->ntuples;
+
+	Assert(n < ADAM_BATCH_DISTANCE_SIZE);
+
+	foreach(cell, batch->distances)
+	{
+		AdamBatchDistanceState *dstate = (AdamBatchDistanceState *) lfirst(cell);
+		Datum		value;
+		bool		isNull;
+
+		oldcxt = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+		value = ExecEvalExpr(dstate->candidate, econtext, &isNull, NULL);
+
+		MemoryContextSwitchTo(batch->batchcxt);
+		dstate->candidateNulls[n] = isNull;
+		dstate->candidates[n] = isNull ? (Datum) 0 : PointerGetDatum(PG_DETOAST_DATUM_COPY(value));
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	oldcxt = MemoryContextSwitchTo(batch->batchcxt);
+	batch->tuples[n] = ExecCopySlotTuple(slot);
+	MemoryContextSwitchTo(oldcxt);
+
+	batch->ntuples++;
+}
+
+/*
+ * calls the batch distance functions for all buffered tuples
+ */
+void
+ExecAdamBatchCompute(AdamBatchState *batch, ExprContext *econtext)
+{
+	MemoryContext oldcxt;
+	ListCell   *cell;
+
+	oldcxt = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	foreach(cell, batch->distances)
+	{
+		AdamBatchDistanceState *dstate = (AdamBatchDistanceState *) lfirst(cell);
+		int			nextras = list_length(dstate->extras);
+		Datum	   *extras = palloc(sizeof(Datum) * (nextras + 1));
+		bool	   *extraNulls = palloc(sizeof(bool) * (nextras + 1));
+		Datum		query;
+		bool		queryNull;
+		ListCell   *ecell;
+		int			i = 0;
+
+		query = ExecEvalExpr(dstate->query, econtext, &queryNull, NULL);
+
+		foreach(ecell, dstate->extras)
+		{
+			extras[i] = ExecEvalExpr((ExprState *) lfirst(ecell), econtext, &extraNulls[i], NULL);
+			i++;
+		}
+
+		callBatchDistance(&dstate->flinfo, dstate->collation, query, queryNull,
+						  dstate->candidates, dstate->candidateNulls, batch->ntuples,
+						  extras, extraNulls, nextras,
+						  dstate->results, dstate->resultNulls);
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+	ResetExprContext(econtext);
+}
+
+/*
+ * advances to the next buffered tuple; returns NULL if all buffered tuples
+ * have been projected
+ */
+TupleTableSlot *
+ExecAdamBatchNextSlot(AdamBatchState *batch)
+{
+	if (batch->current + 1 >= batch->ntuples)
+		return NULL;
+
+	batch->current++;
+
+	return ExecStoreTuple(batch->tuples[batch->current], batch->slot, InvalidBuffer, false);
+}
+
+/*
+ * returns the distance of the tuple currently projected
+ */
+static Datum
+ExecEvalAdamBatchDistance(ExprState *expression, ExprContext *econtext,
+						  bool *isNull, ExprDoneCond *isDone)
+{
+	AdamBatchDistanceState *dstate = (AdamBatchDistanceState *) expression;
+	int			current = dstate->batch->current;
+
+	if (isDone)
+		*isDone = ExprSingleResult;
+
+	Assert(current >= 0 && current < dstate->batch->ntuples);
+
+	*isNull = dstate->resultNulls[current];
+
+	return Float8GetDatum(dstate->results[current]);
+}
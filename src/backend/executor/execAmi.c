@@ -40,6 +40,7 @@
 #include "executor/nodeResult.h"
 #include "executor/nodeSeqscan.h"
 #include "executor/nodeSetOp.h"
+#include "executor/nodeSimilarityjoin.h"
 #include "executor/nodeSort.h"
 #include "executor/nodeSubplan.h"
 #include "executor/nodeSubqueryscan.h"
@@ -209,6 +210,10 @@ ExecReScan(PlanState *node)
 			ExecReScanHashJoin((HashJoinState *) node);
 			break;
 
+		case T_SimilarityJoinState:
+			ExecReScanSimilarityJoin((SimilarityJoinState *) node);
+			break;
+
 		case T_MaterialState:
 			ExecReScanMaterial((MaterialState *) node);
 			break;
@@ -466,10 +471,13 @@ ExecSupportsBackwardScan(Plan *node)
 				TargetListSupportsBackwardScan(node->targetlist);
 
 		case T_Material:
-		case T_Sort:
 			/* these don't evaluate tlist */
 			return true;
 
+		case T_Sort:
+			/* ADAM: distance browsing forgets the tuples already returned */
+			return !ExecSortSupportsBrowsing((Sort *) node);
+
 		case T_LockRows:
 		case T_Limit:
 			/* these don't evaluate tlist */
@@ -103,6 +103,7 @@
 #include "executor/nodeResult.h"
 #include "executor/nodeSeqscan.h"
 #include "executor/nodeSetOp.h"
+#include "executor/nodeSimilarityjoin.h"
 #include "executor/nodeSort.h"
 #include "executor/nodeSubplan.h"
 #include "executor/nodeSubqueryscan.h"
@@ -262,6 +263,11 @@ ExecInitNode(Plan *node, EState *estate, int eflags)
 													estate, eflags);
 			break;
 
+		case T_SimilarityJoin:
+			result = (PlanState *) ExecInitSimilarityJoin((SimilarityJoin *) node,
+														  estate, eflags);
+			break;
+
 			/*
 			 * materialization nodes
 			 */
@@ -457,6 +463,10 @@ ExecProcNode(PlanState *node)
 			result = ExecHashJoin((HashJoinState *) node);
 			break;
 
+		case T_SimilarityJoinState:
+			result = ExecSimilarityJoin((SimilarityJoinState *) node);
+			break;
+
 			/*
 			 * materialization nodes
 			 */
@@ -693,6 +703,10 @@ ExecEndNode(PlanState *node)
 			ExecEndHashJoin((HashJoinState *) node);
 			break;
 
+		case T_SimilarityJoinState:
+			ExecEndSimilarityJoin((SimilarityJoinState *) node);
+			break;
+
 			/*
 			 * materialization nodes
 			 */
@@ -18,12 +18,16 @@
  */
 #include "postgres.h"
 
+#include "executor/adam_exec_batch.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "utils/memutils.h"
 
 
 static bool tlist_matches_tupdesc(PlanState *ps, List *tlist, Index varno, TupleDesc tupdesc);
+static TupleTableSlot *ExecAdamBatchScan(ScanState *node,
+				  ExecScanAccessMtd accessMtd,
+				  ExecScanRecheckMtd recheckMtd);
 
 
 /*
@@ -132,6 +136,12 @@ ExecScan(ScanState *node,
 		return ExecScanFetch(node, accessMtd, recheckMtd);
 	}
 
+	/*
+	 * ADAM: evaluate batch distance functions for several tuples at once
+	 */
+	if (node->adamBatch)
+		return ExecAdamBatchScan(node, accessMtd, recheckMtd);
+
 	/*
 	 * Check to see if we're still projecting out tuples from a previous scan
 	 * tuple (because there is a function-returning-set in the projection
@@ -229,6 +239,77 @@ ExecScan(ScanState *node,
 	}
 }
 
+/*
+ * ExecAdamBatchScan
+ *
+ * Variant of ExecScan for scans whose projection contains batch distance
+ * functions (see adam_exec_batch.c): the tuples passing the quals are
+ * buffered, the distances are computed for the whole buffer and then the
+ * buffered tuples are projected one after the other.
+ */
+static TupleTableSlot *
+ExecAdamBatchScan(ScanState *node,
+				  ExecScanAccessMtd accessMtd,
+				  ExecScanRecheckMtd recheckMtd)
+{
+	AdamBatchState *batch = node->adamBatch;
+	ExprContext *econtext = node->ps.ps_ExprContext;
+	List	   *qual = node->ps.qual;
+	ProjectionInfo *projInfo = node->ps.ps_ProjInfo;
+	TupleTableSlot *slot;
+	ExprDoneCond isDone;
+
+	ResetExprContext(econtext);
+
+	slot = ExecAdamBatchNextSlot(batch);
+
+	if (slot == NULL)
+	{
+		if (batch->done)
+			return ExecClearTuple(projInfo->pi_slot);
+
+		ExecAdamBatchReset(batch);
+
+		while (batch->ntuples < ADAM_BATCH_DISTANCE_SIZE)
+		{
+			TupleTableSlot *scanslot;
+
+			CHECK_FOR_INTERRUPTS();
+
+			scanslot = ExecScanFetch(node, accessMtd, recheckMtd);
+
+			if (TupIsNull(scanslot))
+			{
+				batch->done = true;
+				break;
+			}
+
+			econtext->ecxt_scantuple = scanslot;
+
+			if (!qual || ExecQual(qual, econtext, false))
+				ExecAdamBatchAddTuple(batch, econtext, scanslot);
+			else
+				InstrCountFiltered1(node, 1);
+
+			ResetExprContext(econtext);
+		}
+
+		if (batch->ntuples == 0)
+			return ExecClearTuple(projInfo->pi_slot);
+
+		ExecAdamBatchCompute(batch, econtext);
+
+		slot = ExecAdamBatchNextSlot(batch);
+	}
+
+	/*
+	 * the projection cannot return sets, see ExecInitAdamBatch
+	 */
+	econtext->ecxt_scantuple = slot;
+
+	return ExecProject(projInfo, &isDone);
+}
+
 /*
  * ExecAssignScanProjectionInfo
  *		Set up projection info for a scan node, if necessary.
@@ -337,6 +418,10 @@ ExecScanReScan(ScanState *node)
 	/* Stop projecting any tuples from SRFs in the targetlist */
 	node->ps.ps_TupFromTlist = false;
 
+	/* ADAM: forget about the tuples buffered for batch distances */
+	if (node->adamBatch)
+		ExecAdamBatchReset(node->adamBatch);
+
 	/* Rescan EvalPlanQual tuple if we're inside an EvalPlanQual recheck */
 	if (estate->es_epqScanDone != NULL)
 	{
@@ -31,6 +31,7 @@
 #include "executor/execdebug.h"
 #include "executor/nodeBitmapAnd.h"
 #include "miscadmin.h"
+#include "utils/adam_index_va.h"
 #include "utils/rel.h"
 
 
@@ -153,7 +154,9 @@ MultiExecBitmapAnd(BitmapAndState *node)
 					scanState->biss_result = result;
 
 					/* using a VA index */
-					scanState->adamScanClause = node->ps.plan->adamPlanClause;
+					if(!scanState->adamScanClause){
+						scanState->adamScanClause = copyObject(node->ps.plan->adamPlanClause);
+					}
 
 					if(scanState->adamScanClause){
 						AdamScanClause *adamScanClause = (AdamScanClause *) scanState->adamScanClause;
@@ -172,6 +175,16 @@ MultiExecBitmapAnd(BitmapAndState *node)
 						* to really make sure
 						*/
 						if(i != 0){
+							/*
+							* the tuples fulfilling the other WHERE clauses are known at this point;
+							* if there are only a few of them, it is cheaper to skip the VA file and
+							* calculate the exact distances for all of them
+							*/
+							if(vaChooseFilterStrategyForBitmap(scanState->biss_RelationDesc,
+									result, node->limit) == VA_FILTER_PRE){
+								continue;
+							}
+
 							adamScanClause->nn_limit = node->limit;
 						} else {
 							adamScanClause->nn_limit = -1;
@@ -36,12 +36,17 @@
 #include "postgres.h"
 
 #include "access/relscan.h"
+#include "executor/adam_exec_batch.h"
 #include "access/transam.h"
+#include "catalog/pg_am.h"
 #include "executor/execdebug.h"
 #include "executor/nodeBitmapHeapscan.h"
+#include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/bufmgr.h"
 #include "storage/predicate.h"
+#include "utils/adam_index_va.h"
+#include "utils/hsearch.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
@@ -50,6 +55,9 @@
 
 static TupleTableSlot *BitmapHeapNext(BitmapHeapScanState *node);
 static void bitgetpage(HeapScanDesc scan, TBMIterateResult *tbmres);
+static bool BitmapHeapPostFilterNext(BitmapHeapScanState *node);
+static void BitmapHeapRememberSeen(BitmapHeapScanState *node);
+static bool BitmapHeapTupleSeen(BitmapHeapScanState *node, ItemPointer tid);
 
 
 /* ----------------------------------------------------------------
@@ -101,6 +109,16 @@ BitmapHeapNext(BitmapHeapScanState *node)
 	 */
 	if (tbm == NULL)
 	{
+		/* ADAM: fetch more neighbours than requested, since some fail the quals */
+		if (node->adamPostFilter && node->adamSeen == NULL && node->adamLimit > 0)
+		{
+			BitmapIndexScanState *indexstate = (BitmapIndexScanState *) outerPlanState(node);
+			AdamScanClause *adamScanClause = (AdamScanClause *) indexstate->adamScanClause;
+
+			adamScanClause->nn_limit = (int) vaPostFilterLimit(node->adamLimit, 1.0,
+							indexstate->biss_RelationDesc->rd_rel->reltuples);
+		}
+
 		tbm = (TIDBitmap *) MultiExecProcNode(outerPlanState(node));
 
 		if (!tbm || !IsA(tbm, TIDBitmap))
@@ -260,6 +278,10 @@ BitmapHeapNext(BitmapHeapScanState *node)
 		scan->rs_ctup.t_len = ItemIdGetLength(lp);
 		ItemPointerSet(&scan->rs_ctup.t_self, tbmres->blockno, targoffset);
 
+		/* ADAM: skip the tuples already seen in a previous VA search */
+		if (node->adamSeen && BitmapHeapTupleSeen(node, &scan->rs_ctup.t_self))
+			continue;
+
 		pgstat_count_heap_fetch(scan->rs_rd);
 
 		/*
@@ -432,9 +454,166 @@ BitmapHeapRecheck(BitmapHeapScanState *node, TupleTableSlot *slot)
 TupleTableSlot *
 ExecBitmapHeapScan(BitmapHeapScanState *node)
 {
-	return ExecScan(&node->ss,
-					(ExecScanAccessMtd) BitmapHeapNext,
-					(ExecScanRecheckMtd) BitmapHeapRecheck);
+	TupleTableSlot *slot;
+
+	for (;;)
+	{
+		slot = ExecScan(&node->ss,
+						(ExecScanAccessMtd) BitmapHeapNext,
+						(ExecScanRecheckMtd) BitmapHeapRecheck);
+
+		if (!node->adamPostFilter)
+			return slot;
+
+		/* ADAM: count the tuples that passed the quals */
+		if (!TupIsNull(slot))
+		{
+			node->adamReturned++;
+			return slot;
+		}
+
+		/* ADAM: too few tuples passed the quals, search the VA file again */
+		if (!BitmapHeapPostFilterNext(node))
+			return slot;
+	}
+}
+
+/*
+ * BitmapHeapPostFilterNext -- ADAM: prepares another VA search when
+ * post-filtering
+ *
+ * If the quals reject too many of the neighbours returned by the VA file, the
+ * number of neighbours is increased according to the fraction of tuples that
+ * passed the quals and the VA file is searched again; the tuples of the
+ * previous searches are remembered, so that they are not returned twice.
+ * Returns false if no further search is necessary.
+ */
+static bool
+BitmapHeapPostFilterNext(BitmapHeapScanState *node)
+{
+	BitmapIndexScanState *indexstate = (BitmapIndexScanState *) outerPlanState(node);
+	AdamScanClause *adamScanClause = (AdamScanClause *) indexstate->adamScanClause;
+	double		ntuples = indexstate->biss_RelationDesc->rd_rel->reltuples;
+	double		limit;
+
+	/* all requested neighbours found, or all tuples have been fetched */
+	if (node->adamLimit <= 0 || node->adamReturned >= node->adamLimit ||
+		node->tbm == NULL || adamScanClause->nn_limit <= 0)
+		return false;
+
+	limit = vaPostFilterLimit(node->adamLimit,
+							  node->adamReturned / adamScanClause->nn_limit,
+							  ntuples);
+	limit = Max(limit, 2.0 * adamScanClause->nn_limit);
+
+	ExecBitmapHeapScanSearchAgain(node, (limit >= ntuples) ? -1 : (int) limit);
+
+	return true;
+}
+
+/*
+ * ExecBitmapHeapScanSearchAgain -- ADAM: searches the VA file again for
+ * nn_limit neighbours (or all tuples, if nn_limit is -1)
+ *
+ * The tuples returned by the previous searches are remembered and not
+ * returned again.  Used for post-filtering and distance browsing (see
+ * nodeSort.c).
+ */
+void
+ExecBitmapHeapScanSearchAgain(BitmapHeapScanState *node, int nn_limit)
+{
+	BitmapIndexScanState *indexstate = (BitmapIndexScanState *) outerPlanState(node);
+
+	((AdamScanClause *) indexstate->adamScanClause)->nn_limit = nn_limit;
+
+	/* the VA file has not been searched yet */
+	if (node->tbm == NULL)
+		return;
+
+	if (node->tbmiterator)
+		tbm_end_iterate(node->tbmiterator);
+	if (node->prefetch_iterator)
+		tbm_end_iterate(node->prefetch_iterator);
+
+	BitmapHeapRememberSeen(node);
+	tbm_free(node->tbm);
+
+	node->tbm = NULL;
+	node->tbmiterator = NULL;
+	node->tbmres = NULL;
+	node->prefetch_iterator = NULL;
+
+	heap_rescan(node->ss.ss_currentScanDesc, NULL);
+	ExecScanReScan(&node->ss);
+	ExecReScan((PlanState *) indexstate);
+}
+
+/*
+ * BitmapHeapRememberSeen -- ADAM: adds the TIDs of the current bitmap to the
+ * TIDs of the previous VA searches
+ *
+ * A TIDBitmap would become lossy for large searches and then hide tuples that
+ * have not been returned yet, so the TIDs are kept in a hash table.  A lossy
+ * page of the current bitmap has been read in full; it is remembered with
+ * offset 0, which stands for all tuples of the page.
+ */
+static void
+BitmapHeapRememberSeen(BitmapHeapScanState *node)
+{
+	TBMIterator *iterator;
+	TBMIterateResult *tbmres;
+	ItemPointerData tid;
+	int			i;
+
+	if (node->adamSeen == NULL)
+	{
+		HASHCTL		hash_ctl;
+
+		MemSet(&hash_ctl, 0, sizeof(hash_ctl));
+		hash_ctl.keysize = sizeof(ItemPointerData);
+		hash_ctl.entrysize = sizeof(ItemPointerData);
+		hash_ctl.hash = tag_hash;
+		hash_ctl.hcxt = node->ss.ps.state->es_query_cxt;
+
+		node->adamSeen = hash_create("ADAM seen tuples", 1024, &hash_ctl,
+									 HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
+	}
+
+	iterator = tbm_begin_iterate(node->tbm);
+
+	while ((tbmres = tbm_iterate(iterator)) != NULL)
+	{
+		if (tbmres->ntuples < 0)
+		{
+			ItemPointerSet(&tid, tbmres->blockno, InvalidOffsetNumber);
+			(void) hash_search(node->adamSeen, &tid, HASH_ENTER, NULL);
+			continue;
+		}
+
+		for (i = 0; i < tbmres->ntuples; i++)
+		{
+			ItemPointerSet(&tid, tbmres->blockno, tbmres->offsets[i]);
+			(void) hash_search(node->adamSeen, &tid, HASH_ENTER, NULL);
+		}
+	}
+
+	tbm_end_iterate(iterator);
+}
+
+/*
+ * BitmapHeapTupleSeen -- ADAM: has a previous VA search returned the tuple?
+ */
+static bool
+BitmapHeapTupleSeen(BitmapHeapScanState *node, ItemPointer tid)
+{
+	ItemPointerData page;
+
+	if (hash_search(node->adamSeen, tid, HASH_FIND, NULL) != NULL)
+		return true;
+
+	ItemPointerSet(&page, ItemPointerGetBlockNumber(tid), InvalidOffsetNumber);
+
+	return hash_search(node->adamSeen, &page, HASH_FIND, NULL) != NULL;
 }
 
 /* ----------------------------------------------------------------
@@ -458,6 +637,11 @@ ExecReScanBitmapHeapScan(BitmapHeapScanState *node)
 	node->tbmres = NULL;
 	node->prefetch_iterator = NULL;
 
+	if (node->adamSeen)
+		hash_destroy(node->adamSeen);
+	node->adamSeen = NULL;
+	node->adamReturned = 0;
+
 	ExecScanReScan(&node->ss);
 
 	/*
@@ -509,6 +693,8 @@ ExecEndBitmapHeapScan(BitmapHeapScanState *node)
 		tbm_end_iterate(node->prefetch_iterator);
 	if (node->tbm)
 		tbm_free(node->tbm);
+	if (node->adamSeen)
+		hash_destroy(node->adamSeen);
 
 	/*
 	 * close heap scan
@@ -555,6 +741,10 @@ ExecInitBitmapHeapScan(BitmapHeapScan *node, EState *estate, int eflags)
 	scanstate->prefetch_iterator = NULL;
 	scanstate->prefetch_pages = 0;
 	scanstate->prefetch_target = 0;
+	scanstate->adamPostFilter = false;
+	scanstate->adamLimit = 0;
+	scanstate->adamReturned = 0;
+	scanstate->adamSeen = NULL;
 
 	/*
 	 * Miscellaneous initialization
@@ -610,6 +800,7 @@ ExecInitBitmapHeapScan(BitmapHeapScan *node, EState *estate, int eflags)
 	 */
 	ExecAssignResultTypeFromTL(&scanstate->ss.ps);
 	ExecAssignScanProjectionInfo(&scanstate->ss);
+	ExecInitAdamBatch(&scanstate->ss, eflags);
 
 	/*
 	 * initialize child nodes
@@ -620,6 +811,22 @@ ExecInitBitmapHeapScan(BitmapHeapScan *node, EState *estate, int eflags)
 	 */
 	outerPlanState(scanstate) = ExecInitNode(outerPlan(node), estate, eflags);
 
+	/*
+	 * ADAM: if the VA file is used without the other WHERE clauses (i.e. there is
+	 * no index for them), its results have to be post-filtered by the quals
+	 */
+	if (node->scan.plan.adamPlanClause &&
+		((AdamQueryClause *) node->scan.plan.adamPlanClause)->extendedWhereClause &&
+		scanstate->ss.ps.qual != NIL &&
+		IsA(outerPlanState(scanstate), BitmapIndexScanState))
+	{
+		BitmapIndexScanState *indexstate = (BitmapIndexScanState *) outerPlanState(scanstate);
+
+		scanstate->adamPostFilter = indexstate->adamScanClause != NULL &&
+			indexstate->biss_RelationDesc != NULL &&
+			indexstate->biss_RelationDesc->rd_rel->relam == VA_AM_OID;
+	}
+
 	/*
 	 * all done.
 	 */
@@ -22,11 +22,14 @@
 #include "postgres.h"
 
 #include "access/relscan.h"
+#include "catalog/pg_am.h"
 #include "executor/execdebug.h"
 #include "executor/nodeBitmapIndexscan.h"
 #include "executor/nodeIndexscan.h"
 #include "miscadmin.h"
+#include "utils/adam_index_va.h"
 #include "utils/memutils.h"
+#include "utils/rel.h"
 
 
 /* ----------------------------------------------------------------
@@ -52,6 +55,8 @@ MultiExecBitmapIndexScan(BitmapIndexScanState *node)
 
 	/* ADAM */
 	scandesc->adamScanClause = node->adamScanClause;
+	scandesc->adamQueue = node->adamQueue;
+	scandesc->adamInstrument = node->adamInstrument;
 	
 	/*
 	 * If we have runtime keys and they've not already been set up, do it now.
@@ -317,9 +322,17 @@ ExecInitBitmapIndexScan(BitmapIndexScan *node, EState *estate, int eflags)
 					 indexstate->biss_ScanKeys, indexstate->biss_NumScanKeys,
 					 NULL, 0);
 
-	/* ADAM */
+	/*
+	 * ADAM: the limit and the TID check are changed while executing, so the
+	 * scan works on its own copy (the plan may be cached and executed again)
+	 */
 	if(node->scan.plan.adamPlanClause){
-		indexstate->adamScanClause = node->scan.plan.adamPlanClause;
+		indexstate->adamScanClause = copyObject(node->scan.plan.adamPlanClause);
+	}
+
+	/* ADAM: the VA file reports its counters to EXPLAIN ANALYZE */
+	if(estate->es_instrument && indexstate->biss_RelationDesc->rd_rel->relam == VA_AM_OID){
+		indexstate->adamInstrument = palloc0(sizeof(VAScanInstrumentation));
 	}
 
 	/*
@@ -31,6 +31,7 @@
 #include "executor/execdebug.h"
 #include "executor/nodeBitmapOr.h"
 #include "miscadmin.h"
+#include "utils/adam_index_va.h"
 #include "miscadmin.h"
 #include "utils/rel.h"
 
@@ -161,7 +162,9 @@ MultiExecBitmapOr(BitmapOrState *node)
 			if(scanState && scanState->biss_RelationDesc && 
 				scanState->biss_RelationDesc->rd_rel->relam == VA_AM_OID){
 					/* using a VA index */
-					scanState->adamScanClause = node->ps.plan->adamPlanClause;
+					if(!scanState->adamScanClause){
+						scanState->adamScanClause = copyObject(node->ps.plan->adamPlanClause);
+					}
 
 					if(scanState->adamScanClause){
 						AdamScanClause *adamScanClause = (AdamScanClause *) scanState->adamScanClause;
@@ -180,6 +183,16 @@ MultiExecBitmapOr(BitmapOrState *node)
 						* to really make sure
 						*/
 						if(i != 0){
+							/*
+							* the tuples fulfilling the other WHERE clauses are known at this point;
+							* if there are only a few of them, it is cheaper to skip the VA file and
+							* calculate the exact distances for all of them
+							*/
+							if(vaChooseFilterStrategyForBitmap(scanState->biss_RelationDesc,
+									result, node->limit) == VA_FILTER_PRE){
+								continue;
+							}
+
 							adamScanClause->nn_limit = node->limit;
 						} else {
 							adamScanClause->nn_limit = -1;
@@ -21,12 +21,20 @@
 
 #include "postgres.h"
 
+#include <limits.h>
+
 #include "executor/executor.h"
 #include "executor/nodeLimit.h"
 #include "nodes/nodeFuncs.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_proc.h"
+#include "utils/adam_utils_priorityqueue.h"
+#include "utils/rel.h"
 
 static void recompute_limits(LimitState *node);
 static void pass_down_bound(LimitState *node, PlanState *child_node);
+static void pass_down_adam_queue(PlanState *child_node, PriorityQueue *queue);
+static int	adam_neighbours(LimitState *node);
 
 
 /* ----------------------------------------------------------------
@@ -295,6 +303,13 @@ recompute_limits(LimitState *node)
 	/* Set state-machine state */
 	node->lstate = LIMIT_RESCAN;
 
+	/*
+	 * ADAM: the queues of the previous scan hold its neighbours; the ones of
+	 * this scan are created by pass_down_bound
+	 */
+	list_free_deep(node->adamQueues);
+	node->adamQueues = NIL;
+
 	/* Notify child node about limit, if useful */
 	pass_down_bound(node, outerPlanState(node));
 }
@@ -367,6 +382,9 @@ pass_down_bound(LimitState *node, PlanState *child_node)
 			pass_down_bound(node, outerPlanState(child_node));
 	} else if (IsA(child_node, BitmapHeapScanState))
 	{
+		/* needed for post-filtering the results of a VA search */
+		((BitmapHeapScanState *) child_node)->adamLimit = adam_neighbours(node);
+
 		/* pass down to single child */
 		pass_down_bound(node, outerPlanState(child_node));
 	} else if (IsA(child_node, BitmapOrState))
@@ -375,7 +393,7 @@ pass_down_bound(LimitState *node, PlanState *child_node)
 		
 		int i = 0;
 
-		borState->limit = node->count;
+		borState->limit = adam_neighbours(node);
 		
 		/* pass down to all children */
 		for (i = 0; i < borState->nplans; i++){
@@ -388,7 +406,7 @@ pass_down_bound(LimitState *node, PlanState *child_node)
 		
 		int i = 0;
 
-		banState->limit = node->count;
+		banState->limit = adam_neighbours(node);
 		
 		/* pass down to all children */
 		for (i = 0; i < banState->nplans; i++){
@@ -400,12 +418,30 @@ pass_down_bound(LimitState *node, PlanState *child_node)
 		BitmapIndexScanState *bisState = (BitmapIndexScanState *) child_node;
 		
 		if(bisState->adamScanClause){
-			((AdamScanClause *) bisState->adamScanClause)->nn_limit = node->count;
+			((AdamScanClause *) bisState->adamScanClause)->nn_limit = adam_neighbours(node);
 		}
 	} else if (IsA(child_node, AppendState)) {
 		AppendState * aState = (AppendState *) child_node;
-		pass_down_bound(node, *(aState->appendplans));
-		
+		PriorityQueue *queue = NULL;
+		int i;
+
+		/* 
+		 * partitioned table: each partition searches for the nearest neighbours, the sort above
+		 * the append merges them; the VA files of the partitions share one queue, so that
+		 * partitions that cannot contain any of the nearest neighbours are skipped
+		 */
+		if (adam_neighbours(node) > 0){
+			FmgrInfo cmp;
+
+			fmgr_info(BTFLOAT8CMPOID, &cmp);
+			queue = createQueue(adam_neighbours(node), &cmp);
+			node->adamQueues = lappend(node->adamQueues, queue);
+		}
+
+		for (i = 0; i < aState->as_nplans; i++){
+			pass_down_bound(node, aState->appendplans[i]);
+			pass_down_adam_queue(aState->appendplans[i], queue);
+		}
 	} else if (IsA(child_node, SubqueryScanState)) {
 		SubqueryScanState *sState = (SubqueryScanState *) child_node;
 		pass_down_bound(node, sState->subplan);
@@ -415,6 +451,65 @@ pass_down_bound(LimitState *node, PlanState *child_node)
 	}
 }
 
+/*
+ * ADAM: number of neighbours a VA search has to find, i.e. the tuples skipped
+ * by OFFSET and the ones returned; 0 if all tuples are needed
+ */
+static int
+adam_neighbours(LimitState *node)
+{
+	int64		tuples_needed = node->count + node->offset;
+
+	/* negative test checks for overflow in sum */
+	if (node->noCount || tuples_needed < 0 || tuples_needed > INT_MAX)
+		return 0;
+
+	return (int) tuples_needed;
+}
+
+/*
+ * ADAM: hands the queue shared by the partitions to the VA index scans of a
+ * partition; the scans post-filtering the VA results (see nodeBitmapHeapscan.c)
+ * must not use it, since their bounds may belong to tuples failing the quals
+ */
+static void
+pass_down_adam_queue(PlanState *child_node, PriorityQueue *queue)
+{
+	int i;
+
+	if(!child_node){
+		return;
+	}
+
+	if (IsA(child_node, BitmapHeapScanState))
+	{
+		if (!((BitmapHeapScanState *) child_node)->adamPostFilter)
+			pass_down_adam_queue(outerPlanState(child_node), queue);
+	}
+	else if (IsA(child_node, BitmapAndState))
+	{
+		BitmapAndState *banState = (BitmapAndState *) child_node;
+
+		for (i = 0; i < banState->nplans; i++)
+			pass_down_adam_queue(banState->bitmapplans[i], queue);
+	}
+	else if (IsA(child_node, BitmapOrState))
+	{
+		BitmapOrState *borState = (BitmapOrState *) child_node;
+
+		for (i = 0; i < borState->nplans; i++)
+			pass_down_adam_queue(borState->bitmapplans[i], queue);
+	}
+	else if (IsA(child_node, BitmapIndexScanState))
+	{
+		BitmapIndexScanState *bisState = (BitmapIndexScanState *) child_node;
+
+		if (bisState->biss_RelationDesc &&
+			bisState->biss_RelationDesc->rd_rel->relam == VA_AM_OID)
+			bisState->adamQueue = queue;
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitLimit
  *
@@ -439,6 +534,7 @@ ExecInitLimit(Limit *node, EState *estate, int eflags)
 	limitstate->ps.state = estate;
 
 	limitstate->lstate = LIMIT_INITIAL;
+	limitstate->adamQueues = NIL;
 
 	/*
 	 * Miscellaneous initialization
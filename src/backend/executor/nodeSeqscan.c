@@ -25,6 +25,7 @@
 #include "postgres.h"
 
 #include "access/relscan.h"
+#include "executor/adam_exec_batch.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSeqscan.h"
 #include "utils/rel.h"
@@ -207,6 +208,7 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	 */
 	ExecAssignResultTypeFromTL(&scanstate->ps);
 	ExecAssignScanProjectionInfo(scanstate);
+	ExecInitAdamBatch(scanstate, eflags);
 
 	return scanstate;
 }
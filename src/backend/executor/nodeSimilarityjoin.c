@@ -0,0 +1,896 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeSimilarityjoin.c
+ *	  routines to support similarity joins (ADAM)
+ *
+ * A similarity join replaces a nested loop over a LATERAL subquery that
+ * returns the k nearest neighbours of a feature of the outer tuple, e.g.
+ *
+ *	SELECT * FROM keyframes o, LATERAL (SELECT id FROM images
+ *		USING DISTANCE MINKOWSKI(2)(f, o.f) ORDER USING DISTANCE LIMIT 10) i;
+ *
+ * Instead of running the subquery once per outer tuple, the outer tuples are
+ * read in chunks fitting into work_mem and the inner plan (the subquery
+ * without ORDER BY and LIMIT) is run once per chunk.  Its tuples are compared
+ * in tiles of ADAM_JOIN_TILE_SIZE bytes with all outer tuples of the chunk,
+ * keeping the k nearest neighbours of every outer tuple in a heap, as done by
+ * feature_knn_join (see adam_retrieval_join.c).  If the inner plan scans a
+ * table with a VA index on the feature, only the tuples that may be among the
+ * neighbours of at least one outer tuple of the chunk are read.
+ *
+ * Vectors of float8 features without null values are compared by
+ * joinDistance, which stops as soon as the distance exceeds the current k-th
+ * neighbour; other features are compared by evaluating the distance
+ * expression of the subquery.
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeSimilarityjoin.c
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ *	 INTERFACE ROUTINES
+ *		ExecSimilarityJoin		 - process a similarity join
+ *		ExecInitSimilarityJoin	 - initialize the join
+ *		ExecEndSimilarityJoin	 - shut down the join
+ *		ExecReScanSimilarityJoin - rescan the join
+ */
+
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/genam.h"
+#include "access/htup_details.h"
+#include "catalog/pg_type.h"
+#include "executor/executor.h"
+#include "executor/nodeSimilarityjoin.h"
+#include "miscadmin.h"
+#include "utils/adam_data_feature.h"
+#include "utils/adam_index_marks.h"
+#include "utils/adam_index_va.h"
+#include "utils/adam_retrieval_join.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+
+
+/* as in calculateMinkowski */
+#define SIMILARITY_JOIN_EPSILON		0.001
+
+/* a neighbour of an outer tuple */
+typedef struct SimilarityJoinNeighbour
+{
+	float8		distance;
+	MinimalTuple tuple;			/* inner tuple */
+} SimilarityJoinNeighbour;
+
+/* an outer tuple of the chunk */
+typedef struct SimilarityJoinOuter
+{
+	MinimalTuple tuple;
+	feature    *feature;		/* float8 query vector, NULL if not regular */
+	int			nneighbours;
+	int			maxneighbours;	/* allocated length of neighbours */
+	SimilarityJoinNeighbour *neighbours;	/* heap, farthest on top */
+} SimilarityJoinOuter;
+
+struct SimilarityJoinChunk
+{
+	JoinNorm	joinNorm;
+	int			dimensions;		/* of the regular vectors of the chunk */
+	bool		allRegular;		/* are all outer vectors regular? */
+
+	/* outer tuples */
+	int			chunkSize;
+	int			nouter;
+	SimilarityJoinOuter *outer;
+
+	/* tile of inner tuples */
+	int			tileSize;
+	int			ninner;
+	float8	   *innerVectors;	/* only valid if innerRegular */
+	bool	   *innerRegular;
+	MinimalTuple *innerTuples;
+
+	/* position of the next neighbour to return */
+	int			curOuter;
+	int			curNeighbour;
+
+	MemoryContext chunkCtx;		/* outer tuples and their neighbours */
+	MemoryContext tileCtx;		/* inner tuples of the tile */
+};
+
+static void joinChunk(SimilarityJoinState *node);
+static void readOuterChunk(SimilarityJoinState *node);
+static void initChunk(SimilarityJoinState *node, feature *f);
+static bool isRegularFeature(SimilarityJoinChunk *chunk, feature *f);
+static void scanInner(SimilarityJoinState *node);
+static void scanInnerCandidates(SimilarityJoinState *node);
+static void addInnerCandidate(HeapTuple tuple, void *arg);
+static void addInnerTuple(SimilarityJoinState *node, TupleTableSlot *slot);
+static void compareTile(SimilarityJoinState *node);
+static void insertNeighbour(SimilarityJoinState *node, SimilarityJoinOuter *outer,
+				float8 distance, MinimalTuple tuple);
+static int	compareDistances(float8 x, float8 y);
+static int	compareNeighbours(const void *a, const void *b);
+static void resetChunk(SimilarityJoinState *node);
+
+
+/* ----------------------------------------------------------------
+ *		ExecSimilarityJoin
+ *
+ *		Returns the next neighbour of the current outer tuple that
+ *		satisfies the qualifications; the neighbours of an outer tuple
+ *		are returned in the order of their distance.  The next chunk is
+ *		joined when all neighbours of the current one have been returned.
+ * ----------------------------------------------------------------
+ */
+TupleTableSlot *
+ExecSimilarityJoin(SimilarityJoinState *node)
+{
+	SimilarityJoinChunk *chunk = node->sj_Chunk;
+	List	   *joinqual = node->js.joinqual;
+	List	   *otherqual = node->js.ps.qual;
+	ExprContext *econtext = node->js.ps.ps_ExprContext;
+
+	/*
+	 * Check to see if we're still projecting out tuples from a previous join
+	 * tuple (because there is a function-returning-set in the projection
+	 * expressions).  If so, try to project another one.
+	 */
+	if (node->js.ps.ps_TupFromTlist)
+	{
+		TupleTableSlot *result;
+		ExprDoneCond isDone;
+
+		result = ExecProject(node->js.ps.ps_ProjInfo, &isDone);
+		if (isDone == ExprMultipleResult)
+			return result;
+		/* Done with that source tuple... */
+		node->js.ps.ps_TupFromTlist = false;
+	}
+
+	/*
+	 * Reset per-tuple memory context to free any expression evaluation
+	 * storage allocated in the previous tuple cycle.
+	 */
+	ResetExprContext(econtext);
+
+	for (;;)
+	{
+		SimilarityJoinOuter *outer;
+		SimilarityJoinNeighbour *neighbour;
+
+		/* join the next chunk if all neighbours have been returned */
+		if (chunk->curOuter >= chunk->nouter)
+		{
+			if (node->sj_OuterDone)
+				return NULL;
+
+			joinChunk(node);
+			continue;
+		}
+
+		outer = &chunk->outer[chunk->curOuter];
+
+		if (chunk->curNeighbour >= outer->nneighbours)
+		{
+			chunk->curOuter++;
+			chunk->curNeighbour = 0;
+			continue;
+		}
+
+		neighbour = &outer->neighbours[chunk->curNeighbour++];
+
+		econtext->ecxt_outertuple =
+			ExecStoreMinimalTuple(outer->tuple, node->sj_OuterTupleSlot, false);
+		econtext->ecxt_innertuple =
+			ExecStoreMinimalTuple(neighbour->tuple, node->sj_InnerTupleSlot, false);
+
+		if (ExecQual(joinqual, econtext, false))
+		{
+			if (otherqual == NIL || ExecQual(otherqual, econtext, false))
+			{
+				/*
+				 * qualification was satisfied so we project and return the
+				 * slot containing the result tuple using ExecProject().
+				 */
+				TupleTableSlot *result;
+				ExprDoneCond isDone;
+
+				result = ExecProject(node->js.ps.ps_ProjInfo, &isDone);
+
+				if (isDone != ExprEndResult)
+				{
+					node->js.ps.ps_TupFromTlist =
+						(isDone == ExprMultipleResult);
+					return result;
+				}
+			}
+			else
+				InstrCountFiltered2(node, 1);
+		}
+		else
+			InstrCountFiltered1(node, 1);
+
+		/*
+		 * Tuple fails qual, so free per-tuple memory and try again.
+		 */
+		ResetExprContext(econtext);
+	}
+}
+
+/*
+ * joinChunk
+ *		Read the next chunk of outer tuples and find their neighbours.
+ */
+static void
+joinChunk(SimilarityJoinState *node)
+{
+	SimilarityJoinChunk *chunk = node->sj_Chunk;
+	int			i;
+
+	resetChunk(node);
+	readOuterChunk(node);
+
+	if (chunk->nouter == 0)
+		return;
+
+	node->sj_Chunks += 1;
+
+	if (node->sj_VAIndex != NULL && chunk->allRegular)
+		scanInnerCandidates(node);
+	else
+		scanInner(node);
+
+	if (chunk->ninner > 0)
+		compareTile(node);
+
+	for (i = 0; i < chunk->nouter; i++)
+	{
+		SimilarityJoinOuter *outer = &chunk->outer[i];
+
+		qsort(outer->neighbours, outer->nneighbours,
+			  sizeof(SimilarityJoinNeighbour), compareNeighbours);
+	}
+}
+
+/*
+ * readOuterChunk
+ *		Read outer tuples until the chunk is full or the outer plan is
+ *		exhausted.  Outer tuples with a null query vector have no neighbours,
+ *		since the distance is strict.
+ */
+static void
+readOuterChunk(SimilarityJoinState *node)
+{
+	SimilarityJoinChunk *chunk = node->sj_Chunk;
+	PlanState  *outerPlan = outerPlanState(node);
+	ExprContext *econtext = node->js.ps.ps_ExprContext;
+
+	while (chunk->nouter == 0 || chunk->nouter < chunk->chunkSize)
+	{
+		TupleTableSlot *slot = ExecProcNode(outerPlan);
+		SimilarityJoinOuter *outer;
+		MemoryContext oldcontext;
+		Datum		value;
+		bool		isnull;
+		feature    *f;
+
+		if (TupIsNull(slot))
+		{
+			node->sj_OuterDone = true;
+			break;
+		}
+
+		econtext->ecxt_outertuple = slot;
+		value = ExecEvalExprSwitchContext(node->sj_OuterFeature, econtext,
+										  &isnull, NULL);
+
+		if (isnull)
+		{
+			ResetExprContext(econtext);
+			continue;
+		}
+
+		oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+		f = (feature *) PG_DETOAST_DATUM(value);
+
+		if (chunk->nouter == 0)
+			initChunk(node, f);
+
+		MemoryContextSwitchTo(chunk->chunkCtx);
+
+		outer = &chunk->outer[chunk->nouter++];
+		outer->tuple = ExecCopySlotMinimalTuple(slot);
+		outer->feature = NULL;
+		outer->nneighbours = 0;
+		outer->maxneighbours = 0;
+		outer->neighbours = NULL;
+
+		if (isRegularFeature(chunk, f))
+		{
+			outer->feature = (feature *) palloc(VARSIZE(f));
+			memcpy(outer->feature, f, VARSIZE(f));
+		}
+		else
+			chunk->allRegular = false;
+
+		MemoryContextSwitchTo(oldcontext);
+		ResetExprContext(econtext);
+	}
+}
+
+/*
+ * initChunk
+ *		Size the chunk and the tile by the first query vector of the chunk;
+ *		the chunk is sized to fit into work_mem with the neighbours of its
+ *		outer tuples.
+ */
+static void
+initChunk(SimilarityJoinState *node, feature *f)
+{
+	SimilarityJoinChunk *chunk = node->sj_Chunk;
+	SimilarityJoin *plan = (SimilarityJoin *) node->js.ps.plan;
+	Plan	   *outerPlan = outerPlan(plan);
+	Plan	   *innerPlan = innerPlan(plan);
+	double		neighbours = Min((double) plan->k, Max(innerPlan->plan_rows, 1.0));
+	double		rowSize;
+	double		chunkSize;
+	MemoryContext oldcontext;
+
+	chunk->dimensions = ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data));
+	chunk->allRegular = true;
+
+	rowSize = MAXALIGN(sizeof(SimilarityJoinOuter)) + MAXALIGN(VARSIZE(f)) +
+		outerPlan->plan_width +
+		neighbours * (sizeof(SimilarityJoinNeighbour) + innerPlan->plan_width);
+
+	/* bounds and upper bound heap of every outer vector for the VA file */
+	if (node->sj_VAIndex != NULL)
+		rowSize += 2 * chunk->dimensions * MAX_MARKS * sizeof(float8) +
+			plan->k * sizeof(float8);
+
+	chunkSize = (work_mem * 1024.0) / rowSize;
+	chunkSize = Min(chunkSize, MaxAllocSize / sizeof(SimilarityJoinOuter));
+	if (node->sj_VAIndex != NULL)
+		chunkSize = Min(chunkSize, MaxAllocSize / (plan->k * sizeof(float8)));
+	chunk->chunkSize = (int) Max(chunkSize, 1.0);
+
+	chunk->tileSize = Max(1, ADAM_JOIN_TILE_SIZE /
+						  (Max(chunk->dimensions, 1) * sizeof(float8)));
+
+	oldcontext = MemoryContextSwitchTo(chunk->chunkCtx);
+	chunk->outer = (SimilarityJoinOuter *)
+		palloc(chunk->chunkSize * sizeof(SimilarityJoinOuter));
+	chunk->innerVectors = (float8 *)
+		palloc(chunk->tileSize * Max(chunk->dimensions, 1) * sizeof(float8));
+	chunk->innerRegular = (bool *) palloc(chunk->tileSize * sizeof(bool));
+	chunk->innerTuples = (MinimalTuple *)
+		palloc(chunk->tileSize * sizeof(MinimalTuple));
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * isRegularFeature
+ *		Can the feature be compared by joinDistance?  That is, is it a float8
+ *		feature without null values and with the dimensions of the chunk?
+ */
+static bool
+isRegularFeature(SimilarityJoinChunk *chunk, feature *f)
+{
+	return f->typid == FLOAT8OID && !ARR_HASNULL(&f->data) &&
+		ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data)) == chunk->dimensions;
+}
+
+/*
+ * scanInner
+ *		Run the inner plan and compare all its tuples with the chunk.
+ */
+static void
+scanInner(SimilarityJoinState *node)
+{
+	PlanState  *innerPlan = innerPlanState(node);
+
+	if (node->sj_InnerScanned)
+		ExecReScan(innerPlan);
+	node->sj_InnerScanned = true;
+
+	for (;;)
+	{
+		TupleTableSlot *slot = ExecProcNode(innerPlan);
+
+		if (TupIsNull(slot))
+			break;
+
+		addInnerTuple(node, slot);
+	}
+}
+
+/*
+ * scanInnerCandidates
+ *		Compare the tuples of the inner table that the VA index does not
+ *		exclude with the chunk.  The inner plan is a SeqScan without quals,
+ *		whose projection is applied to the candidates.
+ */
+static void
+scanInnerCandidates(SimilarityJoinState *node)
+{
+	SimilarityJoinChunk *chunk = node->sj_Chunk;
+	SimilarityJoin *plan = (SimilarityJoin *) node->js.ps.plan;
+	ScanState  *innerScan = (ScanState *) innerPlanState(node);
+	MemoryContext oldcontext;
+	feature   **queries;
+	TIDBitmap  *tbm;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(chunk->chunkCtx);
+
+	queries = (feature **) palloc(chunk->nouter * sizeof(feature *));
+	for (i = 0; i < chunk->nouter; i++)
+		queries[i] = chunk->outer[i].feature;
+
+	tbm = vaJoinCandidates(node->sj_VAIndex, queries, chunk->nouter, plan->k,
+						   0, plan->norm);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	scanJoinCandidates(innerScan->ss_currentRelation,
+					   node->js.ps.state->es_snapshot,
+					   tbm, addInnerCandidate, node);
+
+	tbm_free(tbm);
+}
+
+static void
+addInnerCandidate(HeapTuple tuple, void *arg)
+{
+	SimilarityJoinState *node = (SimilarityJoinState *) arg;
+	ScanState  *innerScan = (ScanState *) innerPlanState(node);
+	TupleTableSlot *slot = innerScan->ss_ScanTupleSlot;
+
+	ExecStoreTuple(tuple, slot, InvalidBuffer, false);
+
+	if (innerScan->ps.ps_ProjInfo)
+	{
+		ExprContext *econtext = innerScan->ps.ps_ExprContext;
+
+		ResetExprContext(econtext);
+		econtext->ecxt_scantuple = slot;
+		slot = ExecProject(innerScan->ps.ps_ProjInfo, NULL);
+	}
+
+	node->sj_Candidates += 1;
+	addInnerTuple(node, slot);
+
+	ExecClearTuple(innerScan->ss_ScanTupleSlot);
+}
+
+/*
+ * addInnerTuple
+ *		Add an inner tuple to the tile, comparing the tile with the chunk
+ *		once it is full.  Inner tuples with a null feature are never
+ *		neighbours.
+ */
+static void
+addInnerTuple(SimilarityJoinState *node, TupleTableSlot *slot)
+{
+	SimilarityJoinChunk *chunk = node->sj_Chunk;
+	SimilarityJoin *plan = (SimilarityJoin *) node->js.ps.plan;
+	MemoryContext oldcontext;
+	Datum		value;
+	bool		isnull;
+	feature    *f;
+	bool		regular;
+
+	value = slot_getattr(slot, plan->featureColumn, &isnull);
+
+	if (isnull)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(chunk->tileCtx);
+
+	f = (feature *) PG_DETOAST_DATUM(value);
+	regular = isRegularFeature(chunk, f);
+
+	if (regular)
+		memcpy(&chunk->innerVectors[chunk->ninner * chunk->dimensions],
+			   ARR_DATA_PTR(&f->data), chunk->dimensions * sizeof(float8));
+
+	chunk->innerRegular[chunk->ninner] = regular;
+	chunk->innerTuples[chunk->ninner] = ExecCopySlotMinimalTuple(slot);
+	chunk->ninner++;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (chunk->ninner == chunk->tileSize)
+		compareTile(node);
+}
+
+/*
+ * compareTile
+ *		Compare all outer tuples of the chunk with the inner tuples of the
+ *		tile.
+ */
+static void
+compareTile(SimilarityJoinState *node)
+{
+	SimilarityJoinChunk *chunk = node->sj_Chunk;
+	SimilarityJoin *plan = (SimilarityJoin *) node->js.ps.plan;
+	ExprContext *econtext = node->js.ps.ps_ExprContext;
+	int			i,
+				j;
+
+	for (i = 0; i < chunk->nouter; i++)
+	{
+		SimilarityJoinOuter *outer = &chunk->outer[i];
+		float8	   *x = NULL;
+
+		if (outer->feature != NULL)
+			x = (float8 *) ARR_DATA_PTR(&outer->feature->data);
+
+		for (j = 0; j < chunk->ninner; j++)
+		{
+			bool		full = (outer->nneighbours == plan->k);
+			float8		distance;
+
+			if (x != NULL && chunk->innerRegular[j])
+			{
+				float8		bound = get_float8_infinity();
+
+				if (full && !isnan(outer->neighbours[0].distance))
+					bound = outer->neighbours[0].distance;
+
+				distance = joinDistance(x,
+								&chunk->innerVectors[j * chunk->dimensions],
+										chunk->dimensions, chunk->joinNorm,
+										plan->norm, bound);
+			}
+			else
+			{
+				bool		isnull;
+
+				econtext->ecxt_outertuple =
+					ExecStoreMinimalTuple(outer->tuple,
+										  node->sj_OuterTupleSlot, false);
+				econtext->ecxt_innertuple =
+					ExecStoreMinimalTuple(chunk->innerTuples[j],
+										  node->sj_InnerTupleSlot, false);
+
+				distance = DatumGetFloat8(ExecEvalExprSwitchContext(node->sj_Distance,
+															econtext,
+															&isnull,
+															NULL));
+				ResetExprContext(econtext);
+
+				if (isnull)
+					continue;
+			}
+
+			node->sj_Pairs += 1;
+
+			if (!full ||
+				compareDistances(distance, outer->neighbours[0].distance) < 0)
+				insertNeighbour(node, outer, distance, chunk->innerTuples[j]);
+		}
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	ExecClearTuple(node->sj_OuterTupleSlot);
+	ExecClearTuple(node->sj_InnerTupleSlot);
+
+	chunk->ninner = 0;
+	MemoryContextReset(chunk->tileCtx);
+}
+
+/*
+ * insertNeighbour
+ *		Insert a copy of an inner tuple into the heap of the nearest
+ *		neighbours of an outer tuple (the farthest neighbour is on top).
+ *		The heap is enlarged as needed, since k may be much larger than the
+ *		number of inner tuples.
+ */
+static void
+insertNeighbour(SimilarityJoinState *node, SimilarityJoinOuter *outer,
+				float8 distance, MinimalTuple tuple)
+{
+	SimilarityJoin *plan = (SimilarityJoin *) node->js.ps.plan;
+	SimilarityJoinNeighbour *heap;
+	MemoryContext oldcontext;
+	MinimalTuple copy;
+	int			k = plan->k;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(node->sj_Chunk->chunkCtx);
+
+	copy = heap_copy_minimal_tuple(tuple);
+
+	if (outer->nneighbours < k)
+	{
+		if (outer->nneighbours == outer->maxneighbours)
+		{
+			outer->maxneighbours = Min(k, Max(8, 2 * outer->maxneighbours));
+
+			if (outer->neighbours == NULL)
+				outer->neighbours = (SimilarityJoinNeighbour *)
+					palloc(outer->maxneighbours * sizeof(SimilarityJoinNeighbour));
+			else
+				outer->neighbours = (SimilarityJoinNeighbour *)
+					repalloc(outer->neighbours,
+						outer->maxneighbours * sizeof(SimilarityJoinNeighbour));
+		}
+
+		heap = outer->neighbours;
+
+		/* sift up */
+		i = outer->nneighbours++;
+
+		while (i > 0 && compareDistances(heap[(i - 1) / 2].distance, distance) < 0)
+		{
+			heap[i] = heap[(i - 1) / 2];
+			i = (i - 1) / 2;
+		}
+	}
+	else
+	{
+		heap = outer->neighbours;
+
+		/* replace the farthest neighbour and sift down */
+		pfree(heap[0].tuple);
+
+		i = 0;
+
+		while (2 * i + 1 < k)
+		{
+			int			child = 2 * i + 1;
+
+			if (child + 1 < k &&
+				compareDistances(heap[child + 1].distance, heap[child].distance) > 0)
+				child++;
+
+			if (compareDistances(heap[child].distance, distance) <= 0)
+				break;
+
+			heap[i] = heap[child];
+			i = child;
+		}
+	}
+
+	heap[i].distance = distance;
+	heap[i].tuple = copy;
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * compareDistances
+ *		Order the distances as the float8 < operator does, i.e. NaN after
+ *		all other values.
+ */
+static int
+compareDistances(float8 x, float8 y)
+{
+	if (isnan(x))
+		return isnan(y) ? 0 : 1;
+	if (isnan(y))
+		return -1;
+
+	return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static int
+compareNeighbours(const void *a, const void *b)
+{
+	return compareDistances(((const SimilarityJoinNeighbour *) a)->distance,
+							((const SimilarityJoinNeighbour *) b)->distance);
+}
+
+/*
+ * resetChunk
+ *		Forget the outer tuples of the chunk and their neighbours.
+ */
+static void
+resetChunk(SimilarityJoinState *node)
+{
+	SimilarityJoinChunk *chunk = node->sj_Chunk;
+
+	ExecClearTuple(node->sj_OuterTupleSlot);
+	ExecClearTuple(node->sj_InnerTupleSlot);
+
+	chunk->nouter = 0;
+	chunk->ninner = 0;
+	chunk->curOuter = 0;
+	chunk->curNeighbour = 0;
+
+	MemoryContextReset(chunk->tileCtx);
+	MemoryContextReset(chunk->chunkCtx);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitSimilarityJoin
+ * ----------------------------------------------------------------
+ */
+SimilarityJoinState *
+ExecInitSimilarityJoin(SimilarityJoin *node, EState *estate, int eflags)
+{
+	SimilarityJoinState *sjstate;
+	SimilarityJoinChunk *chunk;
+
+	/* check for unsupported flags */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	sjstate = makeNode(SimilarityJoinState);
+	sjstate->js.ps.plan = (Plan *) node;
+	sjstate->js.ps.state = estate;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * create expression context for node
+	 */
+	ExecAssignExprContext(estate, &sjstate->js.ps);
+
+	/*
+	 * initialize child expressions
+	 */
+	sjstate->js.ps.targetlist = (List *)
+		ExecInitExpr((Expr *) node->join.plan.targetlist,
+					 (PlanState *) sjstate);
+	sjstate->js.ps.qual = (List *)
+		ExecInitExpr((Expr *) node->join.plan.qual,
+					 (PlanState *) sjstate);
+	sjstate->js.jointype = node->join.jointype;
+	sjstate->js.joinqual = (List *)
+		ExecInitExpr((Expr *) node->join.joinqual,
+					 (PlanState *) sjstate);
+	sjstate->sj_OuterFeature = ExecInitExpr(node->outerFeature,
+											(PlanState *) sjstate);
+	sjstate->sj_Distance = ExecInitExpr(node->distance,
+										(PlanState *) sjstate);
+
+	/*
+	 * initialize child nodes
+	 *
+	 * The inner plan is run once per chunk, so cheap rescans would be good.
+	 */
+	outerPlanState(sjstate) = ExecInitNode(outerPlan(node), estate, eflags);
+	innerPlanState(sjstate) = ExecInitNode(innerPlan(node), estate,
+										   eflags | EXEC_FLAG_REWIND);
+
+	/*
+	 * tuple table initialization
+	 */
+	ExecInitResultTupleSlot(estate, &sjstate->js.ps);
+
+	sjstate->sj_OuterTupleSlot = ExecInitExtraTupleSlot(estate);
+	ExecSetSlotDescriptor(sjstate->sj_OuterTupleSlot,
+						  ExecGetResultType(outerPlanState(sjstate)));
+	sjstate->sj_InnerTupleSlot = ExecInitExtraTupleSlot(estate);
+	ExecSetSlotDescriptor(sjstate->sj_InnerTupleSlot,
+						  ExecGetResultType(innerPlanState(sjstate)));
+
+	/*
+	 * initialize tuple type and projection info
+	 */
+	ExecAssignResultTypeFromTL(&sjstate->js.ps);
+	ExecAssignProjectionInfo(&sjstate->js.ps, NULL);
+
+	/*
+	 * the outer tuples of a chunk and their neighbours
+	 */
+	chunk = (SimilarityJoinChunk *) palloc0(sizeof(SimilarityJoinChunk));
+
+	if (node->norm - 1 < SIMILARITY_JOIN_EPSILON && node->norm > 0)
+		chunk->joinNorm = JOIN_NORM_L1;
+	else if (node->norm == 2.0)
+		chunk->joinNorm = JOIN_NORM_L2;
+	else
+		chunk->joinNorm = JOIN_NORM_LN;
+
+	chunk->chunkCtx = AllocSetContextCreate(CurrentMemoryContext,
+											"SimilarityJoin chunk",
+											ALLOCSET_DEFAULT_MINSIZE,
+											ALLOCSET_DEFAULT_INITSIZE,
+											ALLOCSET_DEFAULT_MAXSIZE);
+	chunk->tileCtx = AllocSetContextCreate(CurrentMemoryContext,
+										   "SimilarityJoin tile",
+										   ALLOCSET_DEFAULT_MINSIZE,
+										   ALLOCSET_DEFAULT_INITSIZE,
+										   ALLOCSET_DEFAULT_MAXSIZE);
+	sjstate->sj_Chunk = chunk;
+
+	sjstate->js.ps.ps_TupFromTlist = false;
+	sjstate->sj_OuterDone = false;
+	sjstate->sj_InnerScanned = false;
+
+	/*
+	 * If we are just doing EXPLAIN (ie, aren't going to run the plan), stop
+	 * here.  This allows an index-advisor plugin to EXPLAIN a plan containing
+	 * references to nonexistent indexes.
+	 */
+	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+		return sjstate;
+
+	/*
+	 * Open the VA index; the candidates are projected by the inner SeqScan,
+	 * unless it evaluates batch distance functions, which needs its own
+	 * buffering (see ExecAdamBatchScan).
+	 */
+	if (OidIsValid(node->vaIndex))
+	{
+		PlanState  *innerState = innerPlanState(sjstate);
+
+		if (!IsA(innerState, SeqScanState) || innerState->qual != NIL)
+			elog(ERROR, "similarity join with a VA index requires a sequential scan without quals");
+
+		if (((ScanState *) innerState)->adamBatch == NULL)
+			sjstate->sj_VAIndex = index_open(node->vaIndex, AccessShareLock);
+	}
+
+	return sjstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndSimilarityJoin
+ *
+ *		closes down scans and frees allocated storage
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndSimilarityJoin(SimilarityJoinState *node)
+{
+	/*
+	 * Free the exprcontext
+	 */
+	ExecFreeExprContext(&node->js.ps);
+
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->js.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->sj_OuterTupleSlot);
+	ExecClearTuple(node->sj_InnerTupleSlot);
+
+	MemoryContextDelete(node->sj_Chunk->chunkCtx);
+	MemoryContextDelete(node->sj_Chunk->tileCtx);
+
+	if (node->sj_VAIndex != NULL)
+		index_close(node->sj_VAIndex, AccessShareLock);
+
+	/*
+	 * close down subplans
+	 */
+	ExecEndNode(outerPlanState(node));
+	ExecEndNode(innerPlanState(node));
+}
+
+/* ----------------------------------------------------------------
+ *		ExecReScanSimilarityJoin
+ * ----------------------------------------------------------------
+ */
+void
+ExecReScanSimilarityJoin(SimilarityJoinState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	/*
+	 * If outerPlan->chgParam is not null then plan will be automatically
+	 * re-scanned by first ExecProcNode.  The inner plan is rescanned for
+	 * the next chunk anyway.
+	 */
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+
+	resetChunk(node);
+
+	node->js.ps.ps_TupFromTlist = false;
+	node->sj_OuterDone = false;
+}
@@ -15,11 +15,29 @@
 
 #include "postgres.h"
 
+#include <limits.h>
+#include <math.h>
+
+#include "access/htup_details.h"
+#include "catalog/pg_operator.h"
+#include "catalog/pg_proc.h"
 #include "executor/execdebug.h"
+#include "executor/nodeBitmapHeapscan.h"
 #include "executor/nodeSort.h"
 #include "miscadmin.h"
+#include "parser/parsetree.h"
+#include "utils/adam_retrieval_similarity.h"
+#include "utils/builtins.h"
+#include "utils/rel.h"
+#include "utils/syscache.h"
 #include "utils/tuplesort.h"
 
+/* ADAM: number of neighbours searched in the first round of distance browsing */
+#define ADAM_BROWSE_NEIGHBOURS	100
+
+static TupleTableSlot *ExecSortBrowse(SortState *node);
+static void ExecSortBrowseRound(SortState *node, TupleTableSlot *leftover);
+
 
 /* ----------------------------------------------------------------
  *		ExecSort
@@ -53,6 +71,10 @@ ExecSort(SortState *node)
 	dir = estate->es_direction;
 	tuplesortstate = (Tuplesortstate *) node->tuplesortstate;
 
+	/* ADAM: without a LIMIT, the neighbours are searched round by round */
+	if (node->adamBrowse && !node->bounded)
+		return ExecSortBrowse(node);
+
 	/*
 	 * If first time through, read all tuples from outer plan and pass them to
 	 * tuplesort.c. Subsequent calls just fetch tuples from tuplesort.
@@ -141,6 +163,221 @@ ExecSort(SortState *node)
 	return slot;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSortBrowse
+ *
+ *		ADAM: distance browsing, i.e. returns the tuples of a VA search
+ *		in the order of their distance without knowing how many of them
+ *		are needed (e.g. for FETCH on a cursor).
+ *
+ *		Every round searches the VA file for twice as many neighbours as
+ *		the round before; the tuples not returned by previous searches are
+ *		added to the tuples left over from the previous round and sorted.
+ *		The VA file reports the k-th smallest upper bound of the round:
+ *		every tuple with a smaller distance is among the candidates of
+ *		this or a previous round, so the sorted tuples are returned as
+ *		long as their distance does not exceed this bound.  Thus the costs
+ *		depend on the number of tuples fetched, not on the size of the
+ *		table.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecSortBrowse(SortState *node)
+{
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	TupleTableSlot *slot = node->ss.ps.ps_ResultTupleSlot;
+	Datum		distance;
+	bool		isnull;
+
+	for (;;)
+	{
+		if (node->sort_Done)
+		{
+			if (!tuplesort_gettupleslot((Tuplesortstate *) node->tuplesortstate,
+										true, slot))
+			{
+				/* all tuples have been returned */
+				if (node->adamLimit < 0)
+					return slot;
+			}
+			else
+			{
+				if (node->adamLimit < 0)
+					return slot;
+
+				distance = slot_getattr(slot, plannode->sortColIdx[0], &isnull);
+
+				if (!isnull && DatumGetFloat8(distance) <= node->adamThreshold)
+					return slot;
+			}
+		}
+
+		/* the remaining tuples (if any) are sorted again in the next round */
+		ExecSortBrowseRound(node, slot);
+	}
+}
+
+/*
+ * ADAM: performs the next round of distance browsing; leftover holds the
+ * first tuple of the previous round that has not been returned, if any
+ */
+static void
+ExecSortBrowseRound(SortState *node, TupleTableSlot *leftover)
+{
+	EState	   *estate = node->ss.ps.state;
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	PlanState  *outerNode = outerPlanState(node);
+	BitmapIndexScanState *indexstate = (BitmapIndexScanState *) outerPlanState(outerNode);
+	AdamScanClause *adamScanClause = (AdamScanClause *) indexstate->adamScanClause;
+	double		ntuples = indexstate->biss_RelationDesc->rd_rel->reltuples;
+	ScanDirection dir = estate->es_direction;
+	Tuplesortstate *previous = (Tuplesortstate *) node->tuplesortstate;
+	Tuplesortstate *tuplesortstate;
+	TupleTableSlot *slot;
+	int			limit;
+
+	estate->es_direction = ForwardScanDirection;
+
+	tuplesortstate = tuplesort_begin_heap(ExecGetResultType(outerNode),
+										  plannode->numCols,
+										  plannode->sortColIdx,
+										  plannode->sortOperators,
+										  plannode->collations,
+										  plannode->nullsFirst,
+										  work_mem,
+										  false);
+
+	/* tuples of the previous round that have not been returned */
+	if (previous != NULL)
+	{
+		if (!TupIsNull(leftover))
+		{
+			tuplesort_puttupleslot(tuplesortstate, leftover);
+
+			while (tuplesort_gettupleslot(previous, true, leftover))
+				tuplesort_puttupleslot(tuplesortstate, leftover);
+		}
+
+		/* the slot may point into the memory of the previous sort */
+		ExecClearTuple(leftover);
+		tuplesort_end(previous);
+		node->tuplesortstate = NULL;
+	}
+
+	/*
+	 * twice as many neighbours as in the previous round; all tuples if this
+	 * exceeds the size of the table or if the VA file did not report up to
+	 * which distance its search was complete
+	 */
+	if (node->adamLimit == 0)
+		limit = ADAM_BROWSE_NEIGHBOURS;
+	else if (node->adamThreshold < 0 || node->adamLimit > INT_MAX / 2)
+		limit = -1;
+	else
+		limit = 2 * node->adamLimit;
+
+	if (limit > 0 && ntuples > 0 && limit >= ntuples)
+		limit = -1;
+
+	adamScanClause->nn_browse = true;
+	adamScanClause->nn_threshold = -1;
+
+	if (previous != NULL)
+		ExecBitmapHeapScanSearchAgain((BitmapHeapScanState *) outerNode, limit);
+	else
+		adamScanClause->nn_limit = limit;
+
+	for (;;)
+	{
+		slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+			break;
+
+		tuplesort_puttupleslot(tuplesortstate, slot);
+	}
+
+	tuplesort_performsort(tuplesortstate);
+
+	estate->es_direction = dir;
+
+	node->tuplesortstate = (void *) tuplesortstate;
+	node->sort_Done = true;
+	node->bounded_Done = false;
+	node->adamThreshold = adamScanClause->nn_threshold;
+	node->adamRounds++;
+
+	/* the last round returns all remaining tuples */
+	if (limit < 0 || isinf(node->adamThreshold))
+		node->adamLimit = -1;
+	else
+		node->adamLimit = limit;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecSortSupportsBrowsing
+ *
+ *		ADAM: checks whether the sort orders the results of a VA search
+ *		by their Minkowski distance, so that the tuples can be returned
+ *		round by round (see ExecSortBrowse).
+ * ----------------------------------------------------------------
+ */
+bool
+ExecSortSupportsBrowsing(Sort *node)
+{
+	Plan	   *scan = outerPlan(node);
+	Plan	   *bitmapqual;
+	AdamPlanClause *adamPlanClause;
+	TargetEntry *tle;
+	FuncExpr   *distance;
+	HeapTuple	tuple;
+	Oid			relam;
+
+	if (node->numCols < 1 || scan == NULL || !IsA(scan, BitmapHeapScan))
+		return false;
+
+	bitmapqual = outerPlan(scan);
+	adamPlanClause = (AdamPlanClause *) scan->adamPlanClause;
+
+	if (bitmapqual == NULL || !IsA(bitmapqual, BitmapIndexScan) ||
+		adamPlanClause == NULL ||
+		adamPlanClause->nn_distance != ADAM_DISTANCE_MINKOWSKI)
+		return false;
+
+	/* ascending by the distance calculated in the scan */
+	if (node->sortOperators[0] != Float8LessOperator || node->nullsFirst[0])
+		return false;
+
+	tle = get_tle_by_resno(scan->targetlist, node->sortColIdx[0]);
+
+	if (tle == NULL || !IsA(tle->expr, FuncExpr))
+		return false;
+
+	distance = (FuncExpr *) tle->expr;
+
+	if (distance->funcid == BATCH_DISTANCE_PROCOID)
+	{
+		Const	   *proc = (Const *) linitial(distance->args);
+
+		if (!IsA(proc, Const) || proc->constisnull ||
+			DatumGetObjectId(proc->constvalue) != MINKOWSKI_PROCOID)
+			return false;
+	}
+	else if (distance->funcid != MINKOWSKI_PROCOID)
+		return false;
+
+	/* the bounds are only reported by the VA file */
+	tuple = SearchSysCache1(RELOID,
+				ObjectIdGetDatum(((BitmapIndexScan *) bitmapqual)->indexid));
+	if (!HeapTupleIsValid(tuple))
+		return false;
+
+	relam = ((Form_pg_class) GETSTRUCT(tuple))->relam;
+	ReleaseSysCache(tuple);
+
+	return relam == VA_AM_OID;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitSort
  *
@@ -176,6 +413,16 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 	sortstate->sort_Done = false;
 	sortstate->tuplesortstate = NULL;
 
+	/*
+	 * ADAM: distance browsing does not keep the tuples already returned, so
+	 * it is not possible if the sort output has to be accessed randomly
+	 */
+	sortstate->adamBrowse = !sortstate->randomAccess &&
+		ExecSortSupportsBrowsing(node);
+	sortstate->adamLimit = 0;
+	sortstate->adamThreshold = 0;
+	sortstate->adamRounds = 0;
+
 	/*
 	 * Miscellaneous initialization
 	 *
@@ -316,6 +563,9 @@ ExecReScanSort(SortState *node)
 		node->sort_Done = false;
 		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
 		node->tuplesortstate = NULL;
+		node->adamLimit = 0;
+		node->adamThreshold = 0;
+		node->adamRounds = 0;
 
 		/*
 		 * if chgParam of subnode is not null then plan will be re-scanned by
@@ -707,6 +707,33 @@ _copyHashJoin(const HashJoin *from)
 	return newnode;
 }
 
+/*
+ * _copySimilarityJoin
+ */
+static SimilarityJoin *
+_copySimilarityJoin(const SimilarityJoin *from)
+{
+	SimilarityJoin *newnode = makeNode(SimilarityJoin);
+
+	/*
+	 * copy node superclass fields
+	 */
+	CopyJoinFields((const Join *) from, (Join *) newnode);
+
+	/*
+	 * copy remainder of node
+	 */
+	COPY_SCALAR_FIELD(subqueryrelid);
+	COPY_NODE_FIELD(outerFeature);
+	COPY_NODE_FIELD(distance);
+	COPY_SCALAR_FIELD(featureColumn);
+	COPY_SCALAR_FIELD(k);
+	COPY_SCALAR_FIELD(norm);
+	COPY_SCALAR_FIELD(vaIndex);
+
+	return newnode;
+}
+
 
 /*
  * _copyMaterial
@@ -3809,10 +3836,14 @@ static AdamQueryClause *
 {
 	AdamQueryClause *newnode = makeNode(AdamQueryClause);
 
+	COPY_SCALAR_FIELD(nn_distance);
 	COPY_SCALAR_FIELD(nn_minkowski);
+	COPY_NODE_FIELD(nn_weights);
 	COPY_SCALAR_FIELD(nn_limit);
 	COPY_SCALAR_FIELD(check_tid);
 	COPY_SCALAR_FIELD(extendedWhereClause);
+	COPY_SCALAR_FIELD(nn_browse);
+	COPY_SCALAR_FIELD(nn_threshold);
 
 	return newnode;
 }
@@ -3822,10 +3853,14 @@ static AdamPlanClause *
 {
 	AdamPlanClause *newnode = makeNode(AdamPlanClause);
 
+	COPY_SCALAR_FIELD(nn_distance);
 	COPY_SCALAR_FIELD(nn_minkowski);
+	COPY_NODE_FIELD(nn_weights);
 	COPY_SCALAR_FIELD(nn_limit);
 	COPY_SCALAR_FIELD(check_tid);
 	COPY_SCALAR_FIELD(extendedWhereClause);
+	COPY_SCALAR_FIELD(nn_browse);
+	COPY_SCALAR_FIELD(nn_threshold);
 
 	return newnode;
 }
@@ -4039,6 +4074,9 @@ copyObject(const void *from)
 		case T_HashJoin:
 			retval = _copyHashJoin(from);
 			break;
+		case T_SimilarityJoin:
+			retval = _copySimilarityJoin(from);
+			break;
 		case T_Material:
 			retval = _copyMaterial(from);
 			break;
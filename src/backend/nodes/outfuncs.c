@@ -624,6 +624,22 @@ _outHashJoin(StringInfo str, const HashJoin *node)
 	WRITE_NODE_FIELD(hashclauses);
 }
 
+static void
+_outSimilarityJoin(StringInfo str, const SimilarityJoin *node)
+{
+	WRITE_NODE_TYPE("SIMILARITYJOIN");
+
+	_outJoinPlanInfo(str, (const Join *) node);
+
+	WRITE_UINT_FIELD(subqueryrelid);
+	WRITE_NODE_FIELD(outerFeature);
+	WRITE_NODE_FIELD(distance);
+	WRITE_INT_FIELD(featureColumn);
+	WRITE_INT_FIELD(k);
+	WRITE_FLOAT_FIELD(norm, "%g");
+	WRITE_OID_FIELD(vaIndex);
+}
+
 static void
 _outAgg(StringInfo str, const Agg *node)
 {
@@ -1663,6 +1679,17 @@ _outHashPath(StringInfo str, const HashPath *node)
 	WRITE_INT_FIELD(num_batches);
 }
 
+static void
+_outSimilarityJoinPath(StringInfo str, const SimilarityJoinPath *node)
+{
+	WRITE_NODE_TYPE("SIMILARITYJOINPATH");
+
+	_outPathInfo(str, (const Path *) node);
+
+	WRITE_NODE_FIELD(outerpath);
+	WRITE_BOOL_FIELD(useVA);
+}
+
 static void
 _outPlannerGlobal(StringInfo str, const PlannerGlobal *node)
 {
@@ -2807,6 +2834,9 @@ _outNode(StringInfo str, const void *obj)
 			case T_HashJoin:
 				_outHashJoin(str, obj);
 				break;
+			case T_SimilarityJoin:
+				_outSimilarityJoin(str, obj);
+				break;
 			case T_Agg:
 				_outAgg(str, obj);
 				break;
@@ -3027,6 +3057,9 @@ _outNode(StringInfo str, const void *obj)
 			case T_HashPath:
 				_outHashPath(str, obj);
 				break;
+			case T_SimilarityJoinPath:
+				_outSimilarityJoinPath(str, obj);
+				break;
 			case T_PlannerGlobal:
 				_outPlannerGlobal(str, obj);
 				break;
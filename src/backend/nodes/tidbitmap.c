@@ -167,6 +167,7 @@ static bool tbm_page_is_lossy(const TIDBitmap *tbm, BlockNumber pageno);
 static void tbm_mark_page_lossy(TIDBitmap *tbm, BlockNumber pageno);
 static void tbm_lossify(TIDBitmap *tbm);
 static int	tbm_comparator(const void *left, const void *right);
+static double tbm_page_ntuples(const PagetableEntry *page, double tuplesPerPage);
 
 
 /*
@@ -1028,38 +1029,83 @@ int
 	return tbm->nentries;
 }
 
+/*
+ * tbm_ntuples - estimate the number of tuples in the bitmap
+ *
+ * Exact pages are counted bit by bit; for lossy pages we do not know which
+ * tuples are set, so each of them is counted as tuplesPerPage tuples.
+ */
+double
+	tbm_ntuples(const TIDBitmap *tbm, double tuplesPerPage)
+{
+	HASH_SEQ_STATUS		status;
+	const PagetableEntry *page;
+	double				ntuples = 0;
+
+	if (tbm->nentries == 0)
+		return 0;
+
+	if (tbm->status == TBM_ONE_PAGE)
+		return tbm_page_ntuples(&tbm->entry1, tuplesPerPage);
+
+	hash_seq_init(&status, tbm->pagetable);
+	while ((page = (PagetableEntry *) hash_seq_search(&status)) != NULL)
+	{
+		ntuples += tbm_page_ntuples(page, tuplesPerPage);
+	}
+
+	return ntuples;
+}
+
+/*
+ * number of tuples (or lossy pages times tuplesPerPage) set in a page entry
+ */
+static double
+	tbm_page_ntuples(const PagetableEntry *page, double tuplesPerPage)
+{
+	int			nwords = page->ischunk ? WORDS_PER_CHUNK : WORDS_PER_PAGE;
+	int			nbits = 0;
+	int			wordnum;
+
+	for (wordnum = 0; wordnum < nwords; wordnum++){
+		bitmapword w = page->words[wordnum];
+
+		while (w != 0){
+			w &= w - 1;
+			nbits++;
+		}
+	}
+
+	return page->ischunk ? nbits * tuplesPerPage : nbits;
+}
+
+/*
+ * tbm_contains_tuple - is the tuple (possibly) contained in the bitmap?
+ *
+ * Tuples on lossy pages are always reported as contained.
+ */
 bool 
 	tbm_contains_tuple(TIDBitmap *tbm, const ItemPointer tid)
 {
 	BlockNumber			blk = ItemPointerGetBlockNumber(tid);
 	OffsetNumber		off = ItemPointerGetOffsetNumber(tid);
 
-	PagetableEntry	   *bpage;
+	const PagetableEntry *bpage;
 
 	if (tbm->nentries == 0)
 		return false;
 
+	if (tbm_page_is_lossy(tbm, blk))
+		return true;
+
 	bpage = tbm_find_pageentry(tbm, blk);
 
-	if(bpage == NULL){
+	if(bpage == NULL || off < 1 || off > MAX_TUPLES_PER_PAGE){
 		return false;
-	} else if (bpage->ischunk)	{
-		return true;
 	} else {
 		int wordnum = WORDNUM(off - 1);
 		int	bitnum = BITNUM(off - 1);
-		bitmapword tidword = 0;
-			
-		tidword |= ((bitmapword) 1 << bitnum);
-
-		for (wordnum = 0; wordnum < WORDS_PER_PAGE; wordnum++){
-			bitmapword currword = bpage->words[wordnum];
 
-			if ((currword & tidword) != 0){
-				return true;
-			}
-		}
+		return (bpage->words[wordnum] & ((bitmapword) 1 << bitnum)) != 0;
 	}
-
-	return false;
-}
\ No newline at end of file
+}
@@ -15,10 +15,17 @@
 
 #include "postgres.h"
 
+#include <limits.h>
 #include <math.h>
 
+#include "access/genam.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_class.h"
+#include "catalog/pg_operator.h"
+#include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
 #include "foreign/fdwapi.h"
+#include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #ifdef OPTIMIZER_DEBUG
 #include "nodes/print.h"
@@ -32,10 +39,12 @@
 #include "optimizer/planner.h"
 #include "optimizer/prep.h"
 #include "optimizer/restrictinfo.h"
+#include "optimizer/tlist.h"
 #include "optimizer/var.h"
 #include "parser/parse_clause.h"
 #include "parser/parsetree.h"
 #include "rewrite/rewriteManip.h"
+#include "utils/adam_index_va.h"
 #include "utils/lsyscache.h"
 
 
@@ -75,6 +84,11 @@ static List *accumulate_append_subpath(List *subpaths, Path *path);
 static void set_dummy_rel_pathlist(RelOptInfo *rel);
 static void set_subquery_pathlist(PlannerInfo *root, RelOptInfo *rel,
 					  Index rti, RangeTblEntry *rte);
+static void set_similarityjoin_info(PlannerInfo *root, RelOptInfo *rel,
+						RangeTblEntry *rte);
+static bool remove_similarity_qual(Query *subquery, FuncExpr *distance);
+static void find_similarityjoin_va_index(PlannerInfo *subroot, Plan *plan,
+							 Node *innerArg, SimilarityJoinInfo *info);
 static void set_function_pathlist(PlannerInfo *root, RelOptInfo *rel,
 					  RangeTblEntry *rte);
 static void set_values_pathlist(PlannerInfo *root, RelOptInfo *rel,
@@ -1240,6 +1254,10 @@ set_subquery_pathlist(PlannerInfo *root, RelOptInfo *rel,
 	/* Mark rel with estimated output rows, width, etc */
 	set_subquery_size_estimates(root, rel);
 
+	/* ADAM: a LATERAL kNN subquery may also be joined by a similarity join */
+	if (rte->lateral && rel->reloptkind == RELOPT_BASEREL)
+		set_similarityjoin_info(root, rel, rte);
+
 	/* Convert subquery pathkeys to outer representation */
 	pathkeys = convert_subquery_pathkeys(root, rel, subroot->query_pathkeys);
 
@@ -1250,6 +1268,245 @@ set_subquery_pathlist(PlannerInfo *root, RelOptInfo *rel,
 	set_cheapest(rel);
 }
 
+/*
+ * set_similarityjoin_info
+ *		ADAM: if the LATERAL subquery searches the k nearest neighbours of a
+ *		feature of the outer relations, plan it a second time without the
+ *		distance search, as inner side of a similarity join (see
+ *		SimilarityJoinInfo)
+ *
+ * The subquery must be a plain distance search as built by the parser for
+ * USING DISTANCE ... ORDER USING DISTANCE LIMIT k: its distance must be the
+ * Minkowski distance between a feature of its own relations and a query
+ * vector taken from the outer relations, which must not be referenced
+ * anywhere else.
+ */
+static void
+set_similarityjoin_info(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
+{
+	Query	   *subquery = rte->subquery;
+	SimilarityJoinInfo *info;
+	SortGroupClause *sortcl;
+	TargetEntry *tle;
+	FuncExpr   *distance;
+	Node	   *normArg;
+	Node	   *innerArg;
+	Node	   *outerArg;
+	Var		   *innerVar;
+	bool		innerFirst;
+	Const	   *limit;
+	double		norm;
+	int64		k;
+	PlannerInfo *subroot;
+	Plan	   *plan;
+
+	if (subquery->commandType != CMD_SELECT ||
+		subquery->hasAggs || subquery->hasWindowFuncs ||
+		subquery->hasSubLinks || subquery->hasForUpdate ||
+		subquery->cteList || subquery->rowMarks ||
+		subquery->groupClause || subquery->havingQual ||
+		subquery->windowClause || subquery->distinctClause ||
+		subquery->setOperations || subquery->limitOffset ||
+		list_length(subquery->sortClause) != 1)
+		return;
+
+	/* the number of neighbours must be known */
+	if (subquery->limitCount == NULL)
+		return;
+	limit = (Const *) eval_const_expressions(root, subquery->limitCount);
+	if (!IsA(limit, Const) || limit->constisnull ||
+		limit->consttype != INT8OID)
+		return;
+	k = DatumGetInt64(limit->constvalue);
+	if (k <= 0 || k > INT_MAX / 2)
+		return;
+
+	/* the subquery must be ordered by the Minkowski distance */
+	sortcl = (SortGroupClause *) linitial(subquery->sortClause);
+	if (sortcl->sortop != Float8LessOperator || sortcl->nulls_first)
+		return;
+
+	tle = get_sortgroupclause_tle(sortcl, subquery->targetList);
+	distance = (FuncExpr *) tle->expr;
+	if (!IsA(distance, FuncExpr) || distance->funcid != MINKOWSKI_PROCOID ||
+		list_length(distance->args) != 3)
+		return;
+
+	normArg = eval_const_expressions(root, (Node *) lthird(distance->args));
+	if (!IsA(normArg, Const) || ((Const *) normArg)->constisnull)
+		return;
+	norm = DatumGetFloat8(((Const *) normArg)->constvalue);
+	if (!(norm > 0))
+		return;
+
+	/* one feature comes from the subquery, the other from the outer rels */
+	innerFirst = !contain_vars_of_level((Node *) linitial(distance->args), 1);
+	innerArg = (Node *) (innerFirst ? linitial(distance->args) : lsecond(distance->args));
+	outerArg = (Node *) (innerFirst ? lsecond(distance->args) : linitial(distance->args));
+
+	if (contain_vars_of_level(innerArg, 1) ||
+		!contain_vars_of_level(innerArg, 0) ||
+		!contain_vars_of_level(outerArg, 1) ||
+		contain_vars_of_level(outerArg, 0) ||
+		contain_volatile_functions(innerArg) ||
+		contain_volatile_functions(outerArg))
+		return;
+
+	/*
+	 * Strip the distance search off a copy of the subquery: the column of the
+	 * distance returns the inner feature instead.  The outer rels must not be
+	 * referenced anymore.
+	 */
+	subquery = copyObject(subquery);
+	distance = (FuncExpr *) copyObject(distance);
+
+	if (!remove_similarity_qual(subquery, distance))
+		return;
+
+	tle = get_sortgroupclause_tle(sortcl, subquery->targetList);
+	tle->expr = (Expr *) copyObject(innerArg);
+	subquery->sortClause = NIL;
+	subquery->limitCount = NULL;
+	subquery->adamQueryClause = NULL;
+
+	if (contain_vars_of_level((Node *) subquery, 1) ||
+		contain_volatile_functions((Node *) subquery->targetList) ||
+		expression_returns_set((Node *) subquery->targetList))
+		return;
+
+	/* plan_params should not be in use in current query level */
+	Assert(root->plan_params == NIL);
+
+	plan = subquery_planner(root->glob, subquery, root, false, 0.0, &subroot);
+
+	if (root->plan_params != NIL || is_dummy_plan(plan))
+	{
+		root->plan_params = NIL;
+		return;
+	}
+
+	info = (SimilarityJoinInfo *) palloc0(sizeof(SimilarityJoinInfo));
+	info->plan = plan;
+	info->root = subroot;
+	info->featureColumn = tle->resno;
+	info->k = (int) k;
+	info->norm = norm;
+
+	/* the query vector is computed from the outer tuple */
+	info->outerFeature = (Expr *) copyObject(outerArg);
+	IncrementVarSublevelsUp((Node *) info->outerFeature, -1, 1);
+
+	/* and the inner feature is taken from the column of the distance */
+	innerVar = makeVar(rel->relid, info->featureColumn,
+					   exprType(innerArg), exprTypmod(innerArg),
+					   exprCollation(innerArg), 0);
+	if (innerFirst)
+		distance->args = list_make3(innerVar, info->outerFeature, normArg);
+	else
+		distance->args = list_make3(info->outerFeature, innerVar, normArg);
+	info->distance = (Expr *) distance;
+
+	find_similarityjoin_va_index(subroot, plan, innerArg, info);
+
+	rel->simjoin = info;
+}
+
+/*
+ * remove_similarity_qual
+ *		ADAM: remove the === clause of a distance search (see
+ *		adjustAdamWhereClause) from the WHERE clause of the subquery
+ *
+ * Returns false if there is no such clause on the features of the distance.
+ */
+static bool
+remove_similarity_qual(Query *subquery, FuncExpr *distance)
+{
+	Node	   *quals = subquery->jointree->quals;
+	List	   *features = list_make2(linitial(distance->args),
+									  lsecond(distance->args));
+	List	   *args;
+	ListCell   *lc;
+
+	if (quals == NULL)
+		return false;
+
+	if (and_clause(quals))
+		args = ((BoolExpr *) quals)->args;
+	else
+		args = list_make1(quals);
+
+	foreach(lc, args)
+	{
+		OpExpr	   *clause = (OpExpr *) lfirst(lc);
+
+		if (!IsA(clause, OpExpr) || clause->opno != FEATURE_DUMMY_EQ ||
+			!equal(clause->args, features))
+			continue;
+
+		args = list_delete_ptr(args, clause);
+
+		if (args == NIL)
+			subquery->jointree->quals = NULL;
+		else if (list_length(args) == 1)
+			subquery->jointree->quals = (Node *) linitial(args);
+		else
+			((BoolExpr *) quals)->args = args;
+
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * find_similarityjoin_va_index
+ *		ADAM: if the subquery scans a single table without quals and the
+ *		inner feature is a column with a VA index, a similarity join may read
+ *		only the candidates of that index (see vaJoinCandidates)
+ */
+static void
+find_similarityjoin_va_index(PlannerInfo *subroot, Plan *plan, Node *innerArg,
+							 SimilarityJoinInfo *info)
+{
+	Var		   *var = (Var *) innerArg;
+	RelOptInfo *rel;
+	ListCell   *lc;
+
+	if (!IsA(plan, SeqScan) || plan->qual != NIL || !IsA(var, Var) ||
+		var->varattno <= 0 || var->varno != ((SeqScan *) plan)->scanrelid)
+		return;
+
+	/* as in feature_knn_join, the VA bounds are not used for large norms */
+	if (info->norm >= 100)
+		return;
+
+	rel = find_base_rel(subroot, var->varno);
+
+	foreach(lc, rel->indexlist)
+	{
+		IndexOptInfo *index = (IndexOptInfo *) lfirst(lc);
+		Relation	indexRel;
+		bool		supported;
+
+		if (index->relam != VA_AM_OID || index->ncolumns != 1 ||
+			index->indexkeys[0] != var->varattno || index->indpred != NIL)
+			continue;
+
+		/* a VA file on projected features only bounds the Euclidean distance */
+		indexRel = index_open(index->indexoid, AccessShareLock);
+		supported = vaSupportsNorm(indexRel, info->norm);
+		index_close(indexRel, AccessShareLock);
+
+		if (supported)
+		{
+			info->vaIndex = index->indexoid;
+			info->vaPages = index->pages;
+			info->vaTuples = index->tuples;
+			return;
+		}
+	}
+}
+
 /*
  * set_function_pathlist
  *		Build the (single) access path for a function RTE
@@ -74,6 +74,7 @@
 #include <math.h>
 
 #include "access/htup_details.h"
+#include "catalog/pg_am.h"
 #include "executor/executor.h"
 #include "executor/nodeHash.h"
 #include "miscadmin.h"
@@ -89,6 +90,8 @@
 #include "parser/parsetree.h"
 #include "utils/lsyscache.h"
 #include "utils/selfuncs.h"
+#include "utils/adam_index_va.h"
+#include "utils/adam_retrieval_join.h"
 #include "utils/spccache.h"
 #include "utils/tuplesort.h"
 
@@ -133,6 +136,8 @@ static bool cost_qual_eval_walker(Node *node, cost_qual_eval_context *context);
 static void get_restriction_qual_cost(PlannerInfo *root, RelOptInfo *baserel,
 						  ParamPathInfo *param_info,
 						  QualCost *qpqual_cost);
+static bool adam_filter_cost(PlannerInfo *root, RelOptInfo *baserel,
+				 Path *bitmapqual, Cost *cost, double *tuples_fetched);
 static bool has_indexed_join_quals(NestPath *joinpath);
 static double approx_tuple_count(PlannerInfo *root, JoinPath *path,
 				   List *quals);
@@ -626,6 +631,7 @@ cost_bitmap_heap_scan(Path *path, PlannerInfo *root, RelOptInfo *baserel,
 	double		spc_seq_page_cost,
 				spc_random_page_cost;
 	double		T;
+	Cost		adamCost;
 
 	/* Should only be applied to base relations */
 	Assert(IsA(baserel, RelOptInfo));
@@ -716,12 +722,11 @@ cost_bitmap_heap_scan(Path *path, PlannerInfo *root, RelOptInfo *baserel,
 	 */
 	get_restriction_qual_cost(root, baserel, param_info, &qpqual_cost);
 
-	/* ADAM: increase cost for index then heap scan if there is an additional where clause (this would yield wrong results) */
-	if(root->parse->adamQueryClause && ((AdamQueryClause *) root->parse->adamQueryClause)->extendedWhereClause){
-		if(bitmapqual->pathtype == T_BitmapAnd){
-			startup_cost *= 0;
-			run_cost *= 0;
-		}
+	/* ADAM: distance search combined with other WHERE clauses, see adam_filter_cost */
+	if (adam_filter_cost(root, baserel, bitmapqual, &adamCost, &tuples_fetched))
+	{
+		startup_cost += adamCost - indexTotalCost;
+		run_cost = 0;
 	}
 
 	startup_cost += qpqual_cost.startup;
@@ -733,6 +738,111 @@ cost_bitmap_heap_scan(Path *path, PlannerInfo *root, RelOptInfo *baserel,
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * adam_filter_cost
+ *		ADAM: estimate the cost of a VA search combined with other WHERE clauses
+ *
+ * If the bitmap is a BitmapAnd/BitmapOr of a VA index and other indexes, the
+ * tuples fulfilling the other clauses are known before the VA file is scanned
+ * and the executor decides between pre-filtering and filtering in the VA file
+ * (see nodeBitmapAnd.c).  If the VA index is used alone, its results are
+ * post-filtered (see nodeBitmapHeapscan.c).  The returned cost covers the
+ * bitmap and the fetching of the candidates; *tuples_fetched is set to the
+ * number of candidates.  Returns false if the bitmap is not such a search.
+ */
+static bool
+adam_filter_cost(PlannerInfo *root, RelOptInfo *baserel,
+				 Path *bitmapqual, Cost *cost, double *tuples_fetched)
+{
+	IndexPath  *vapath = NULL;
+	List	   *bitmapquals = NIL;
+	Cost		othersCost = 0.0;
+	Cost		vaCost;
+	Selectivity selec;
+	double		limit;
+	double		nfiltered;
+	bool		filterKnown;
+	ListCell   *l;
+
+	if (!root->parse->adamQueryClause ||
+		!((AdamQueryClause *) root->parse->adamQueryClause)->extendedWhereClause)
+		return false;
+
+	if (IsA(bitmapqual, BitmapAndPath))
+		bitmapquals = ((BitmapAndPath *) bitmapqual)->bitmapquals;
+	else if (IsA(bitmapqual, BitmapOrPath))
+		bitmapquals = ((BitmapOrPath *) bitmapqual)->bitmapquals;
+	else if (IsA(bitmapqual, IndexPath))
+		vapath = (IndexPath *) bitmapqual;
+
+	/* the other clauses are estimated as in cost_bitmap_and_node/cost_bitmap_or_node */
+	selec = IsA(bitmapqual, BitmapAndPath) ? 1.0 : 0.0;
+	foreach(l, bitmapquals)
+	{
+		Path	   *subpath = (Path *) lfirst(l);
+		Cost		subCost;
+		Selectivity subselec;
+
+		if (IsA(subpath, IndexPath) &&
+			((IndexPath *) subpath)->indexinfo->relam == VA_AM_OID)
+		{
+			vapath = (IndexPath *) subpath;
+			continue;
+		}
+
+		cost_bitmap_tree_node(subpath, &subCost, &subselec);
+
+		if (IsA(bitmapqual, BitmapAndPath))
+			selec *= subselec;
+		else
+			selec += subselec;
+
+		othersCost += subCost + 100.0 * cpu_operator_cost;
+	}
+
+	/* no VA index, or one that vaCostEstimate considered useless */
+	if (vapath == NULL || vapath->indexinfo->relam != VA_AM_OID ||
+		vapath->indextotalcost >= disable_cost)
+		return false;
+
+	filterKnown = (bitmapquals != NIL);
+
+	if (!filterKnown)
+	{
+		List	   *otherclauses;
+
+		otherclauses = list_difference_ptr(baserel->baserestrictinfo,
+										   vapath->indexclauses);
+		selec = clauselist_selectivity(root, otherclauses, baserel->relid,
+									   JOIN_INNER, NULL);
+	}
+
+	selec = Min(selec, 1.0);
+	nfiltered = selec * vapath->indexinfo->tuples;
+	limit = (root->limit_tuples > 0) ? root->limit_tuples : vapath->indexinfo->tuples;
+
+	switch (vaChooseFilterStrategy(vapath->indexinfo->tuples,
+								   vapath->indexinfo->pages,
+								   nfiltered, limit, filterKnown, &vaCost))
+	{
+		case VA_FILTER_PRE:
+			*tuples_fetched = clamp_row_est(nfiltered);
+			break;
+		case VA_FILTER_INDEX:
+			*tuples_fetched = clamp_row_est(Min(limit, nfiltered));
+			break;
+		case VA_FILTER_POST:
+		default:
+			*tuples_fetched = clamp_row_est(vaPostFilterLimit(limit, selec,
+												vapath->indexinfo->tuples));
+			break;
+	}
+
+	*cost = othersCost + vaCost;
+
+	return true;
+}
+
 /*
  * cost_bitmap_tree_node
  *		Extract cost and selectivity from a bitmap tree node (index/and/or)
@@ -813,11 +923,6 @@ cost_bitmap_and_node(BitmapAndPath *path, PlannerInfo *root)
 			totalCost += 100.0 * cpu_operator_cost;
 	}
 
-	/* ADAM: lower cost of bitmap and */
-	if(root->parse->adamQueryClause && ((AdamQueryClause *) root->parse->adamQueryClause)->extendedWhereClause){
-		totalCost *= 0;
-	}
-
 	path->bitmapselectivity = selec;
 	path->path.rows = 0;		/* per above, not used */
 	path->path.startup_cost = totalCost;
@@ -2754,6 +2859,98 @@ final_cost_hashjoin(PlannerInfo *root, HashPath *path,
 	path->jpath.path.total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_similarityjoin
+ *	  ADAM: determines and returns the cost of joining the outer path with a
+ *	  LATERAL kNN subquery by a similarity join (see nodeSimilarityjoin.c).
+ *
+ * The outer tuples are processed in chunks that fit into work_mem together
+ * with their neighbours; the inner plan is run (without ORDER BY and LIMIT) once
+ * per chunk, or, if the subquery scans a table with a VA index, the candidates
+ * of all the outer vectors of the chunk are collected by a single VA scan.  The
+ * cheaper variant is remembered in path->useVA.
+ */
+void
+cost_similarityjoin(SimilarityJoinPath *path, PlannerInfo *root,
+					SpecialJoinInfo *sjinfo)
+{
+	Path	   *outer_path = path->outerpath;
+	SimilarityJoinInfo *info = path->innerrel->simjoin;
+	Plan	   *inner_plan = info->plan;
+	Cost		startup_cost = 0;
+	Cost		run_cost = 0;
+	Cost		pair_cost = ADAM_JOIN_PAIR_COST * cpu_operator_cost;
+	Cost		chunk_cost;
+	Cost		cpu_per_tuple;
+	QualCost	qual_cost;
+	double		outer_path_rows = outer_path->rows;
+	double		inner_plan_rows = inner_plan->plan_rows;
+	double		chunk_rows;
+	double		nchunks;
+	double		ntuples;
+
+	if (!enable_similarityjoin)
+		startup_cost += disable_cost;
+
+	/* estimate the number of outer tuples of a chunk */
+	chunk_rows = (double) work_mem * 1024.0 /
+		(outer_path->parent->width + (info->k + 1) * inner_plan->plan_width);
+	chunk_rows = Max(chunk_rows, 1.0);
+	nchunks = ceil(outer_path_rows / chunk_rows);
+	nchunks = Max(nchunks, 1.0);
+
+	/* run the inner plan once per chunk and compare all pairs */
+	chunk_cost = inner_plan->total_cost;
+	run_cost = nchunks * chunk_cost +
+		outer_path_rows * inner_plan_rows * pair_cost;
+	path->useVA = false;
+
+	if (OidIsValid(info->vaIndex))
+	{
+		double		ncandidates;
+		Cost		va_chunk_cost;
+		Cost		va_run_cost;
+
+		va_chunk_cost = vaJoinCost(info->vaTuples, info->vaPages,
+								   Min(chunk_rows, outer_path_rows), info->k,
+								   &ncandidates);
+		va_run_cost = nchunks * va_chunk_cost +
+			outer_path_rows * ncandidates * pair_cost;
+
+		if (va_run_cost < run_cost)
+		{
+			chunk_cost = va_chunk_cost;
+			run_cost = va_run_cost;
+			path->useVA = true;
+		}
+	}
+
+	/* the first tuple is returned after the first chunk */
+	startup_cost += outer_path->startup_cost + chunk_cost;
+	run_cost += outer_path->total_cost - outer_path->startup_cost;
+	run_cost -= chunk_cost;
+
+	/*
+	 * For each neighbour, we charge cpu_tuple_cost plus the cost of the
+	 * remaining restriction clauses of the join and of the subquery.  (As for
+	 * other plan nodes, evaluating the targetlist, i.e. the distance, is not
+	 * charged.)
+	 */
+	cost_qual_eval(&qual_cost, path->joinrestrictinfo, root);
+	startup_cost += qual_cost.startup;
+	cpu_per_tuple = cpu_tuple_cost + qual_cost.per_tuple;
+	cost_qual_eval(&qual_cost, path->innerrel->baserestrictinfo, root);
+	startup_cost += qual_cost.startup;
+	cpu_per_tuple += qual_cost.per_tuple;
+
+	ntuples = outer_path_rows * Min((double) info->k, inner_plan_rows);
+	run_cost += cpu_per_tuple * ntuples;
+
+	path->path.rows = path->path.parent->rows;
+	path->path.startup_cost = startup_cost;
+	path->path.total_cost = startup_cost + run_cost;
+}
+
 
 /*
  * cost_subplan
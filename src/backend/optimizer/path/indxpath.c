@@ -263,7 +263,7 @@ create_index_paths(PlannerInfo *root, RelOptInfo *rel)
 			int i = 0;
 
 			for(i = 0; i < INDEX_MAX_KEYS; i++){
-				if(rclauseset.indexclauses[i] && index->relam != VA_AM_OID){
+				if(rclauseset.indexclauses[i] && index->relam != VA_AM_OID && index->relam != LSH_AM_OID){
 					rclausectr++;
 				} else {
 					break;
@@ -300,7 +300,7 @@ create_index_paths(PlannerInfo *root, RelOptInfo *rel)
 		//however, the decision whether to use the index or not is (hacked) made
 		//using the cost estimate and not yet here; so at this moment we have
 		//to consider all the VA indices as being just 1
-		if(index->relam == VA_AM_OID && rel->baserestrictinfo
+		if((index->relam == VA_AM_OID || index->relam == LSH_AM_OID) && rel->baserestrictinfo
 			&& list_length(rel->baserestrictinfo) - 1 != rclausectr){
 			continue;
 		}
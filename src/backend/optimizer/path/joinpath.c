@@ -42,6 +42,14 @@ static void hash_inner_and_outer(PlannerInfo *root, RelOptInfo *joinrel,
 					 JoinType jointype, SpecialJoinInfo *sjinfo,
 					 SemiAntiJoinFactors *semifactors,
 					 Relids param_source_rels, Relids extra_lateral_rels);
+static void try_similarityjoin_path(PlannerInfo *root,
+						RelOptInfo *joinrel,
+						RelOptInfo *outerrel,
+						RelOptInfo *innerrel,
+						JoinType jointype,
+						SpecialJoinInfo *sjinfo,
+						Relids extra_lateral_rels,
+						List *restrict_clauses);
 static List *select_mergejoin_clauses(PlannerInfo *root,
 						 RelOptInfo *joinrel,
 						 RelOptInfo *outerrel,
@@ -259,6 +267,17 @@ add_paths_to_joinrel(PlannerInfo *root,
 							 restrictlist, jointype,
 							 sjinfo, &semifactors,
 							 param_source_rels, extra_lateral_rels);
+
+	/*
+	 * 5. ADAM: if the inner relation is a LATERAL kNN subquery, consider a
+	 * similarity join, which searches the neighbours of a whole chunk of
+	 * outer tuples at once instead of running the subquery for every outer
+	 * tuple.
+	 */
+	if (innerrel->simjoin)
+		try_similarityjoin_path(root, joinrel, outerrel, innerrel,
+								jointype, sjinfo, extra_lateral_rels,
+								restrictlist);
 }
 
 /*
@@ -339,6 +358,56 @@ try_nestloop_path(PlannerInfo *root,
 	}
 }
 
+/*
+ * try_similarityjoin_path
+ *	  ADAM: consider a similarity join of the outer relation with a LATERAL
+ *	  kNN subquery (see SimilarityJoinInfo); if it appears useful, push it
+ *	  into the joinrel's pathlist via add_path().
+ *
+ * As the outer tuples are read in chunks anyway, only the cheapest total
+ * path of the outer relation is considered, and only if it does not need
+ * any parameters itself.
+ */
+static void
+try_similarityjoin_path(PlannerInfo *root,
+						RelOptInfo *joinrel,
+						RelOptInfo *outerrel,
+						RelOptInfo *innerrel,
+						JoinType jointype,
+						SpecialJoinInfo *sjinfo,
+						Relids extra_lateral_rels,
+						List *restrict_clauses)
+{
+	Path	   *outer_path = outerrel->cheapest_total_path;
+	ListCell   *lc;
+
+	if (jointype != JOIN_INNER || sjinfo->jointype != JOIN_INNER ||
+		extra_lateral_rels != NULL)
+		return;
+
+	/* the subquery must refer to the outer relation only */
+	if (outer_path == NULL || outer_path->param_info != NULL ||
+		!bms_is_subset(innerrel->lateral_relids, outerrel->relids))
+		return;
+
+	/* whole-row Vars of the subquery cannot be built from the inner plan */
+	foreach(lc, innerrel->reltargetlist)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+
+		if (!IsA(var, Var) || var->varattno <= 0)
+			return;
+	}
+
+	add_path(joinrel, (Path *)
+			 create_similarityjoin_path(root,
+										joinrel,
+										sjinfo,
+										outer_path,
+										innerrel,
+										restrict_clauses));
+}
+
 /*
  * try_mergejoin_path
  *	  Consider a merge join path; if it appears useful, push it into
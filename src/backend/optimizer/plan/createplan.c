@@ -49,6 +49,8 @@ static bool use_physical_tlist(PlannerInfo *root, RelOptInfo *rel);
 static void disuse_physical_tlist(PlannerInfo *root, Plan *plan, Path *path);
 static Plan *create_gating_plan(PlannerInfo *root, Plan *plan, List *quals);
 static Plan *create_join_plan(PlannerInfo *root, JoinPath *best_path);
+static Plan *create_similarityjoin_plan(PlannerInfo *root,
+						   SimilarityJoinPath *best_path);
 static Plan *create_append_plan(PlannerInfo *root, AppendPath *best_path);
 static Plan *create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path);
 static Result *create_result_plan(PlannerInfo *root, ResultPath *best_path);
@@ -243,6 +245,10 @@ create_plan_recurse(PlannerInfo *root, Path *best_path)
 			plan = create_join_plan(root,
 									(JoinPath *) best_path);
 			break;
+		case T_SimilarityJoin:
+			plan = create_similarityjoin_plan(root,
+										(SimilarityJoinPath *) best_path);
+			break;
 		case T_Append:
 			plan = create_append_plan(root,
 									  (AppendPath *) best_path);
@@ -672,6 +678,65 @@ create_join_plan(PlannerInfo *root, JoinPath *best_path)
 	return plan;
 }
 
+/*
+ * create_similarityjoin_plan
+ *	  ADAM: Create a SimilarityJoin plan for 'best_path' and (recursively) a
+ *	  plan for its outer path.  The inner plan is the kNN subquery planned
+ *	  without ORDER BY and LIMIT by set_similarityjoin_info.
+ */
+static Plan *
+create_similarityjoin_plan(PlannerInfo *root, SimilarityJoinPath *best_path)
+{
+	SimilarityJoinInfo *info = best_path->innerrel->simjoin;
+	SimilarityJoin *join_plan = makeNode(SimilarityJoin);
+	Plan	   *plan = &join_plan->join.plan;
+	Plan	   *outer_plan;
+	List	   *joinclauses;
+	List	   *otherclauses;
+
+	best_path->outerpath->adamPathClause = best_path->path.adamPathClause;
+
+	outer_plan = create_plan_recurse(root, best_path->outerpath);
+
+	/* Sort qual clauses into best execution order */
+	joinclauses = order_qual_clauses(root, best_path->joinrestrictinfo);
+	otherclauses = order_qual_clauses(root,
+									  best_path->innerrel->baserestrictinfo);
+
+	/* Any pseudoconstant clauses are ignored here */
+	joinclauses = extract_actual_clauses(joinclauses, false);
+	otherclauses = extract_actual_clauses(otherclauses, false);
+
+	/* cost is copied below */
+	plan->targetlist = build_path_tlist(root, &best_path->path);
+	plan->qual = otherclauses;
+	plan->lefttree = outer_plan;
+	plan->righttree = info->plan;
+	join_plan->join.jointype = JOIN_INNER;
+	join_plan->join.joinqual = joinclauses;
+	join_plan->subqueryrelid = best_path->innerrel->relid;
+	join_plan->outerFeature = (Expr *) copyObject(info->outerFeature);
+	join_plan->distance = (Expr *) copyObject(info->distance);
+	join_plan->featureColumn = info->featureColumn;
+	join_plan->k = info->k;
+	join_plan->norm = info->norm;
+	join_plan->vaIndex = best_path->useVA ? info->vaIndex : InvalidOid;
+
+	copy_path_costsize(plan, &best_path->path);
+
+	/*
+	 * If there are any pseudoconstant clauses attached to this node, insert a
+	 * gating Result node that evaluates the pseudoconstants as one-time
+	 * quals.
+	 */
+	if (root->hasPseudoConstantQuals)
+		return create_gating_plan(root, plan,
+								  list_concat(list_copy(best_path->joinrestrictinfo),
+									best_path->innerrel->baserestrictinfo));
+
+	return plan;
+}
+
 /*
  * create_append_plan
  *	  Create an Append plan for 'best_path' and (recursively) plans
@@ -711,6 +776,8 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path)
 	{
 		Path	   *subpath = (Path *) lfirst(subpaths);
 
+		subpath->adamPathClause = best_path->path.adamPathClause;
+
 		subplans = lappend(subplans, create_plan_recurse(root, subpath));
 	}
 
@@ -782,6 +849,7 @@ create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path)
 		bool	   *nullsFirst;
 
 		/* Build the child plan */
+		subpath->adamPathClause = best_path->path.adamPathClause;
 		subplan = create_plan_recurse(root, subpath);
 
 		/* Compute sort column info, and adjust subplan's tlist as needed */
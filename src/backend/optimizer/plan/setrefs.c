@@ -68,6 +68,11 @@ typedef struct
 	int			rtoffset;
 } fix_upper_expr_context;
 
+typedef struct
+{
+	SimilarityJoin *sjplan;		/* ADAM: plan whose distance Vars to replace */
+} replace_distance_context;
+
 /*
  * Check if a Const node is a regclass value.  We accept plain OID too,
  * since a regclass Const will get folded to that type if it's an argument
@@ -98,6 +103,11 @@ static Node *fix_scan_expr(PlannerInfo *root, Node *node, int rtoffset);
 static Node *fix_scan_expr_mutator(Node *node, fix_scan_expr_context *context);
 static bool fix_scan_expr_walker(Node *node, fix_scan_expr_context *context);
 static void set_join_references(PlannerInfo *root, Join *join, int rtoffset);
+static Plan *set_similarityjoin_references(PlannerInfo *root,
+							  SimilarityJoin *plan,
+							  int rtoffset);
+static Node *replace_distance_mutator(Node *node,
+						 replace_distance_context *context);
 static void set_upper_references(PlannerInfo *root, Plan *plan, int rtoffset);
 static void set_dummy_tlist_references(Plan *plan, int rtoffset);
 static indexed_tlist *build_tlist_index(List *tlist);
@@ -584,6 +594,12 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			set_join_references(root, (Join *) plan, rtoffset);
 			break;
 
+		case T_SimilarityJoin:
+			/* Needs special treatment, see comments below */
+			return set_similarityjoin_references(root,
+												 (SimilarityJoin *) plan,
+												 rtoffset);
+
 		case T_Hash:
 		case T_Material:
 		case T_Sort:
@@ -1298,6 +1314,134 @@ set_join_references(PlannerInfo *root, Join *join, int rtoffset)
 	pfree(inner_itlist);
 }
 
+/*
+ * set_similarityjoin_references
+ *	  ADAM: Do set_plan_references processing on a SimilarityJoin
+ *
+ * The Vars of the subquery's distance column are replaced by the distance
+ * expression first, which compares the subquery's feature column (the
+ * distance column returns the feature in the inner plan) with the outer
+ * feature.  Then the expressions are fixed like those of other joins; the
+ * inner plan belongs to the subquery's PlannerInfo, so it is processed by
+ * set_plan_references like the subplan of a SubqueryScan.
+ */
+static Plan *
+set_similarityjoin_references(PlannerInfo *root,
+							  SimilarityJoin *plan,
+							  int rtoffset)
+{
+	Join	   *join = &plan->join;
+	Plan	   *inner_plan = join->plan.righttree;
+	RelOptInfo *rel;
+	replace_distance_context dcontext;
+	indexed_tlist *outer_itlist;
+	indexed_tlist *inner_itlist;
+	List	   *inner_tlist = NIL;
+	ListCell   *l;
+
+	/* Need to look up the subquery's RelOptInfo, since we need its subroot */
+	rel = find_base_rel(root, plan->subqueryrelid);
+	Assert(rel->simjoin != NULL && rel->simjoin->plan == inner_plan);
+
+	dcontext.sjplan = plan;
+	join->plan.targetlist = (List *)
+		replace_distance_mutator((Node *) join->plan.targetlist, &dcontext);
+	join->plan.qual = (List *)
+		replace_distance_mutator((Node *) join->plan.qual, &dcontext);
+	join->joinqual = (List *)
+		replace_distance_mutator((Node *) join->joinqual, &dcontext);
+
+	/* Vars of the subquery refer to the inner plan's output by column number */
+	foreach(l, inner_plan->targetlist)
+	{
+		TargetEntry *tle = (TargetEntry *) lfirst(l);
+		Var		   *var;
+
+		var = makeVar(plan->subqueryrelid,
+					  tle->resno,
+					  exprType((Node *) tle->expr),
+					  exprTypmod((Node *) tle->expr),
+					  exprCollation((Node *) tle->expr),
+					  0);
+		inner_tlist = lappend(inner_tlist,
+							  makeTargetEntry((Expr *) var,
+											  tle->resno,
+											  NULL,
+											  false));
+	}
+
+	outer_itlist = build_tlist_index(join->plan.lefttree->targetlist);
+	inner_itlist = build_tlist_index(inner_tlist);
+
+	join->plan.targetlist = fix_join_expr(root,
+										  join->plan.targetlist,
+										  outer_itlist,
+										  inner_itlist,
+										  (Index) 0,
+										  rtoffset);
+	join->plan.qual = fix_join_expr(root,
+									join->plan.qual,
+									outer_itlist,
+									inner_itlist,
+									(Index) 0,
+									rtoffset);
+	join->joinqual = fix_join_expr(root,
+								   join->joinqual,
+								   outer_itlist,
+								   inner_itlist,
+								   (Index) 0,
+								   rtoffset);
+	plan->outerFeature = (Expr *) fix_join_expr(root,
+												(List *) plan->outerFeature,
+												outer_itlist,
+												NULL,
+												(Index) 0,
+												rtoffset);
+	plan->distance = (Expr *) fix_join_expr(root,
+											(List *) plan->distance,
+											outer_itlist,
+											inner_itlist,
+											(Index) 0,
+											rtoffset);
+
+	pfree(outer_itlist);
+	pfree(inner_itlist);
+
+	/* Recurse into the outer plan and, with the subroot, the inner plan */
+	join->plan.lefttree = set_plan_refs(root, join->plan.lefttree, rtoffset);
+	join->plan.righttree = set_plan_references(rel->simjoin->root,
+											   inner_plan);
+
+	plan->subqueryrelid += rtoffset;
+
+	return (Plan *) plan;
+}
+
+/*
+ * replace_distance_mutator
+ *	  Replace the Vars of a SimilarityJoin's distance column by the distance
+ *	  expression.  The replacement itself is not searched, since it contains
+ *	  the same Var standing for the subquery's feature.
+ */
+static Node *
+replace_distance_mutator(Node *node, replace_distance_context *context)
+{
+	if (node == NULL)
+		return NULL;
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) node;
+
+		if (var->varno == context->sjplan->subqueryrelid &&
+			var->varattno == context->sjplan->featureColumn &&
+			var->varlevelsup == 0)
+			return copyObject(context->sjplan->distance);
+		return (Node *) copyObject(var);
+	}
+	return expression_tree_mutator(node, replace_distance_mutator,
+								   (void *) context);
+}
+
 /*
  * set_upper_references
  *	  Update the targetlist and quals of an upper-level plan node
@@ -2315,6 +2315,15 @@ finalize_plan(PlannerInfo *root, Plan *plan, Bitmapset *valid_params,
 							  &context);
 			break;
 
+		case T_SimilarityJoin:
+			finalize_primnode((Node *) ((Join *) plan)->joinqual,
+							  &context);
+			finalize_primnode((Node *) ((SimilarityJoin *) plan)->outerFeature,
+							  &context);
+			finalize_primnode((Node *) ((SimilarityJoin *) plan)->distance,
+							  &context);
+			break;
+
 		case T_Limit:
 			finalize_primnode(((Limit *) plan)->limitOffset,
 							  &context);
@@ -2378,6 +2387,14 @@ finalize_plan(PlannerInfo *root, Plan *plan, Bitmapset *valid_params,
 		child_params = bms_difference(child_params, nestloop_params);
 		bms_free(nestloop_params);
 	}
+	else if (IsA(plan, SimilarityJoin))
+	{
+		/*
+		 * As for a SubqueryScan, the inner plan of a similarity join was
+		 * finalized by the inner invocation of subquery_planner.
+		 */
+		child_params = bms_copy(plan->righttree->extParam);
+	}
 	else
 	{
 		/* easy case */
@@ -1999,6 +1999,43 @@ create_hashjoin_path(PlannerInfo *root,
 	return pathnode;
 }
 
+/*
+ * create_similarityjoin_path
+ *	  ADAM: creates a pathnode corresponding to a similarity join between the
+ *	  outer path and a LATERAL kNN subquery (see SimilarityJoinInfo).
+ *
+ * 'joinrel' is the join relation
+ * 'sjinfo' is extra info about the join for selectivity estimation
+ * 'outer_path' is the cheapest outer path
+ * 'innerrel' is the LATERAL kNN subquery
+ * 'restrict_clauses' are the RestrictInfo nodes to apply at the join
+ */
+SimilarityJoinPath *
+create_similarityjoin_path(PlannerInfo *root,
+						   RelOptInfo *joinrel,
+						   SpecialJoinInfo *sjinfo,
+						   Path *outer_path,
+						   RelOptInfo *innerrel,
+						   List *restrict_clauses)
+{
+	SimilarityJoinPath *pathnode = makeNode(SimilarityJoinPath);
+
+	pathnode->path.pathtype = T_SimilarityJoin;
+	pathnode->path.parent = joinrel;
+	/* the subquery is parameterized by the outer relation only */
+	pathnode->path.param_info = NULL;
+	/* the neighbours of an outer tuple are returned together, in outer order */
+	pathnode->path.pathkeys = outer_path->pathkeys;
+	pathnode->outerpath = outer_path;
+	pathnode->innerrel = innerrel;
+	pathnode->joinrestrictinfo = restrict_clauses;
+	/* cost_similarityjoin will fill in pathnode->useVA */
+
+	cost_similarityjoin(pathnode, root, sjinfo);
+
+	return pathnode;
+}
+
 /*
  * reparameterize_path
  *		Attempt to modify a Path to have greater parameterization
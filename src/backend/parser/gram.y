@@ -2345,11 +2345,42 @@ CreateAdamFunctionStmt:
 					n->fstmt.parameters = list_concat(list_make2(p1, p2), $9);
 
 					n->fstmt.returnType = $12;
-					n->funtype =  SystemTypeName("d");
+					n->funtype =  SystemTypeName("distance");
 					n->fstmt.options = $13;
 					n->fstmt.withClause = $14;
 					$$ = (Node *)n;
 				}
+				| CREATE opt_or_replace DISTANCE func_name '(' AdamFeature ',' AdamFeature '[' ']' OptAdditionalFuncArgs ')'
+			RETURNS Numeric '[' ']' createfunc_opt_list opt_definition
+				{
+					/* batch form: query vector, array of candidates, returns array of distances */
+					CreateAdamFunctionStmt *n = makeNode(CreateAdamFunctionStmt);
+					FunctionParameter *p1 = makeNode(FunctionParameter);
+					FunctionParameter *p2 = makeNode(FunctionParameter);
+
+					n->fstmt.replace = $2;
+					n->fstmt.funcname = $4;
+					
+					p1->name = NULL;
+					p1->argType = $6;
+					p1->mode = FUNC_PARAM_IN;
+					p1->defexpr = NULL;
+
+					p2->name = NULL;
+					p2->argType = $8;
+					p2->argType->arrayBounds = list_make1(makeInteger(-1));
+					p2->mode = FUNC_PARAM_IN;
+					p2->defexpr = NULL;
+
+					n->fstmt.parameters = list_concat(list_make2(p1, p2), $11);
+
+					n->fstmt.returnType = $14;
+					n->fstmt.returnType->arrayBounds = list_make1(makeInteger(-1));
+					n->funtype =  SystemTypeName("distance");
+					n->fstmt.options = $17;
+					n->fstmt.withClause = $18;
+					$$ = (Node *)n;
+				}
 				| CREATE opt_or_replace NORMALIZATION func_name '(' Numeric OptAdditionalFuncArgs ')'
 			RETURNS Numeric createfunc_opt_list opt_definition
 				{
@@ -222,8 +222,8 @@ coerce_type(ParseState *pstate, Node *node,
 		}
 	}
 	
-	// ADAM FUNCTIONS
-	if (targetTypeId == FEATURE && (type_is_array(inputTypeId) || inputTypeId == UNKNOWNOID) && ccontext == COERCION_EXPLICIT){
+	// ADAM FUNCTIONS; literals are read by the input function of the feature below
+	if (targetTypeId == FEATURE && type_is_array(inputTypeId) && ccontext == COERCION_EXPLICIT){
 		return coerce_type(pstate, node,
 			ANYARRAYOID, FEATURE, targetTypeMod,
 			COERCION_EXPLICIT, cformat, location);
@@ -38,6 +38,8 @@
 #include "storage/procsignal.h"
 #include "storage/sinvaladt.h"
 #include "storage/spin.h"
+#include "utils/adam_index_va_cache.h"
+#include "utils/adam_index_va_results.h"
 
 
 shmem_startup_hook_type shmem_startup_hook = NULL;
@@ -127,6 +129,8 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 		size = add_size(size, BTreeShmemSize());
 		size = add_size(size, SyncScanShmemSize());
 		size = add_size(size, AsyncShmemSize());
+		size = add_size(size, VACacheShmemSize());
+		size = add_size(size, VAResultCacheShmemSize());
 #ifdef EXEC_BACKEND
 		size = add_size(size, ShmemBackendArraySize());
 #endif
@@ -236,6 +240,8 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 	BTreeShmemInit();
 	SyncScanShmemInit();
 	AsyncShmemInit();
+	VACacheShmemInit();
+	VAResultCacheShmemInit();
 
 #ifdef EXEC_BACKEND
 
@@ -0,0 +1,300 @@
+/*
+ * ADAM - feature compression
+ * name: adam_data_compression
+ * description: float-aware compression of TOASTed features
+ *
+ * src/backend/utils/adt/adam_data_compression.c
+ *
+ *
+ *
+ *
+ * addendum: the generic compression of TOAST (pglz) hardly compresses the
+ * values of a feature, but has to be undone on every read; features with
+ * float8 or float4 values are therefore compressed by TOAST with their own
+ * method (if feature_compression is 'float'):
+ *
+ * every value is xor-ed with the value before; for features whose neighbouring
+ * values are similar, sign, exponent and the leading bits of the mantissa
+ * cancel out, as do the trailing bytes of values with a short mantissa (e.g.
+ * converted float4 values); per value, a control byte holds the number of
+ * leading and trailing zero bytes of the xor-ed value, followed by the bytes
+ * in between
+ *
+ * the compressed datum is a compressed varlena (with TOAST_FEATURE_COMPRESSION
+ * in the raw size), followed by a FeatureCompressionHeader, the bytes of the
+ * feature up to its values (typid and array header), the encoded values and
+ * the bytes of the feature after its values
+ *
+ * as the values are decoded in order, the distance functions read them while
+ * computing the distance (see featureInitDecoder) instead of decompressing the
+ * feature first
+ *
+ */
+#include "postgres.h"
+
+#include "utils/adam_data_compression.h"
+
+#include "catalog/pg_type.h"
+#include "utils/adam_data_feature.h"
+#include "utils/array.h"
+
+int			feature_compression = FEATURE_COMPRESSION_FLOAT;
+
+typedef struct FeatureCompressionHeader {
+	int32		prefix;			/* bytes of the feature before the values */
+	int32		nwords;			/* number of values */
+	int32		wordsize;		/* 8 for float8, 4 for float4 values */
+	int32		suffix;			/* bytes of the feature after the values */
+} FeatureCompressionHeader;
+
+/* size of the header of a compressed varlena (including the raw size) */
+#define FEATURE_COMPRESSED_HDRSZ	(VARHDRSZ + sizeof(uint32))
+
+#define FEATURE_COMPRESSED_DATA(value) \
+	((unsigned char *) (value) + FEATURE_COMPRESSED_HDRSZ + sizeof(FeatureCompressionHeader))
+
+static void getHeader(struct varlena *value, FeatureCompressionHeader *header);
+static uint64 decodeWord(FeatureDecoder *decoder);
+static uint64 readWord(const char *data, int wordsize);
+static void writeWord(char *data, uint64 word, int wordsize);
+
+
+/*
+ * compresses a feature with float8 or float4 values; returns NULL if the feature
+ * cannot be compressed by this method or if nothing is saved
+ */
+struct varlena *
+	featureCompress(struct varlena *value)
+{
+	feature	   *f = (feature *) value;
+	FeatureCompressionHeader header;
+	struct varlena *result;
+	unsigned char *out;
+	char	   *data;
+	uint64		previous = 0;
+	int32		rawsize;
+	Size		size;
+	int			i;
+
+	//compressed or external features are not expected here
+	if(VARATT_IS_EXTENDED(value)){
+		return NULL;
+	}
+
+	if(ARR_HASNULL(&f->data)){
+		return NULL;
+	}
+
+	if(f->typid == FLOAT8OID){
+		header.wordsize = sizeof(float8);
+	} else if(f->typid == FLOAT4OID){
+		header.wordsize = sizeof(float4);
+	} else {
+		return NULL;
+	}
+
+	rawsize = VARSIZE(value) - VARHDRSZ;
+	data = ARR_DATA_PTR(&f->data);
+
+	header.prefix = data - VARDATA(value);
+	header.nwords = ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data));
+	header.suffix = rawsize - header.prefix - header.nwords * header.wordsize;
+
+	if(header.suffix < 0){
+		return NULL;
+	}
+
+	//in the worst case, every value needs a control byte more
+	size = FEATURE_COMPRESSED_HDRSZ + sizeof(FeatureCompressionHeader) + header.prefix + header.suffix
+		+ (Size) header.nwords * (header.wordsize + 1);
+
+	result = (struct varlena *) palloc(size);
+
+	memcpy((char *) result + FEATURE_COMPRESSED_HDRSZ, &header, sizeof(FeatureCompressionHeader));
+
+	out = FEATURE_COMPRESSED_DATA(result);
+	memcpy(out, VARDATA(value), header.prefix);
+	out += header.prefix;
+
+	for(i = 0; i < header.nwords; i++){
+		uint64 word = readWord(data + i * header.wordsize, header.wordsize);
+		uint64 delta = word ^ previous;
+		int leading = 0;
+		int trailing = 0;
+		int k;
+
+		while(leading < header.wordsize && ((delta >> (8 * (header.wordsize - 1 - leading))) & 0xFF) == 0){
+			leading++;
+		}
+
+		while(trailing < header.wordsize - leading && ((delta >> (8 * trailing)) & 0xFF) == 0){
+			trailing++;
+		}
+
+		*out++ = (unsigned char) ((leading << 4) | trailing);
+
+		for(k = trailing; k < header.wordsize - leading; k++){
+			*out++ = (unsigned char) ((delta >> (8 * k)) & 0xFF);
+		}
+
+		previous = word;
+	}
+
+	memcpy(out, data + header.nwords * header.wordsize, header.suffix);
+	out += header.suffix;
+
+	size = out - (unsigned char *) result;
+
+	//as for pglz, more than 2 bytes have to be saved (see toast_compress_datum)
+	if(size >= VARSIZE(value) - VARHDRSZ - 2){
+		pfree(result);
+		return NULL;
+	}
+
+	SET_VARSIZE_COMPRESSED(result, size);
+	((varattrib_4b *) result)->va_compressed.va_rawsize = (uint32) rawsize | (TOAST_FEATURE_COMPRESSION << 30);
+
+	return result;
+}
+
+/*
+ * returns the uncompressed feature of a feature compressed by featureCompress
+ */
+struct varlena *
+	featureDecompress(struct varlena *value)
+{
+	FeatureCompressionHeader header;
+	FeatureDecoder decoder;
+	struct varlena *result;
+	char	   *out;
+	int			i;
+
+	getHeader(value, &header);
+
+	result = (struct varlena *) palloc(VARRAWSIZE_4B_C(value) + VARHDRSZ);
+	SET_VARSIZE(result, VARRAWSIZE_4B_C(value) + VARHDRSZ);
+
+	out = VARDATA(result);
+	memcpy(out, FEATURE_COMPRESSED_DATA(value), header.prefix);
+	out += header.prefix;
+
+	featureInitDecoder(&decoder, value);
+
+	for(i = 0; i < header.nwords; i++){
+		writeWord(out, decodeWord(&decoder), header.wordsize);
+		out += header.wordsize;
+	}
+
+	memcpy(out, decoder.pos, header.suffix);
+
+	return result;
+}
+
+/*
+ * checks whether a (not external) datum has been compressed by featureCompress
+ */
+bool
+	featureIsCompressed(struct varlena *value)
+{
+	return VARATT_IS_COMPRESSED(value) && VARCOMPRESSMETHOD_4B_C(value) == TOAST_FEATURE_COMPRESSION;
+}
+
+/*
+ * prepares reading the values of a compressed feature
+ */
+void
+	featureInitDecoder(FeatureDecoder *decoder, struct varlena *value)
+{
+	FeatureCompressionHeader header;
+
+	getHeader(value, &header);
+
+	decoder->pos = FEATURE_COMPRESSED_DATA(value) + header.prefix;
+	decoder->wordsize = header.wordsize;
+	decoder->n = header.nwords;
+	decoder->previous = 0;
+}
+
+/*
+ * returns the next value of a compressed feature
+ */
+float8
+	featureDecoderNext(FeatureDecoder *decoder)
+{
+	uint64		word = decodeWord(decoder);
+
+	if(decoder->wordsize == sizeof(float8)){
+		float8 result;
+
+		memcpy(&result, &word, sizeof(float8));
+		return result;
+	} else {
+		uint32 shortWord = (uint32) word;
+		float4 result;
+
+		memcpy(&result, &shortWord, sizeof(float4));
+		return result;
+	}
+}
+
+
+/*
+ * the compressed datum is not necessarily aligned, thus the header is copied
+ */
+static void
+	getHeader(struct varlena *value, FeatureCompressionHeader *header)
+{
+	memcpy(header, (char *) value + FEATURE_COMPRESSED_HDRSZ, sizeof(FeatureCompressionHeader));
+}
+
+/*
+ * undoes the xor with the value before for the next value
+ */
+static uint64
+	decodeWord(FeatureDecoder *decoder)
+{
+	const unsigned char *pos = decoder->pos;
+	int			leading = *pos >> 4;
+	int			trailing = *pos & 0x0F;
+	uint64		delta = 0;
+	int			k;
+
+	pos++;
+
+	for(k = trailing; k < decoder->wordsize - leading; k++){
+		delta |= ((uint64) *pos++) << (8 * k);
+	}
+
+	decoder->previous ^= delta;
+	decoder->pos = pos;
+
+	return decoder->previous;
+}
+
+static uint64
+	readWord(const char *data, int wordsize)
+{
+	if(wordsize == sizeof(uint64)){
+		uint64 word;
+
+		memcpy(&word, data, sizeof(uint64));
+		return word;
+	} else {
+		uint32 word;
+
+		memcpy(&word, data, sizeof(uint32));
+		return word;
+	}
+}
+
+static void
+	writeWord(char *data, uint64 word, int wordsize)
+{
+	if(wordsize == sizeof(uint64)){
+		memcpy(data, &word, sizeof(uint64));
+	} else {
+		uint32 shortWord = (uint32) word;
+
+		memcpy(data, &shortWord, sizeof(uint32));
+	}
+}
@@ -18,6 +18,7 @@
 
 #include "utils/adam_data_feature.h"
 
+#include "access/hash.h"
 #include "access/htup_details.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_proc.h"
@@ -25,15 +26,25 @@
 #include "libpq/pqformat.h"
 #include "parser/parse_type.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
+#include "utils/sortsupport.h"
 #include "utils/syscache.h"
 #include "utils/typcache.h"
 
 #include <assert.h>
+#include <math.h>
 
 #define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
 
 static bool checkEqual(FunctionCallInfo fcinfo, feature *f1, feature *f2);
+static bool featureIsPlain(feature *f);
+static bool featuresComparable(feature *f1, feature *f2);
+static bool featureDecodeForComparison(feature **f1, feature **f2);
+static int featureCompare(feature *f1, feature *f2, FunctionCallInfo fcinfo);
+static int compareElements(feature *f1, feature *f2);
+static int feature_fastcmp(Datum x, Datum y, SortSupport ssup);
+static feature *quantize(feature *f, char *storage, float8 scale, float8 offset);
 static Datum compare(feature *f1, feature *f2, FunctionCallInfo fcinfo, Datum (*fpointer)(FunctionCallInfo));
 
 
@@ -173,6 +184,11 @@ Datum
 
 	f =  (feature *) PG_GETARG_POINTER(0);
 
+	//half precision floats and int8 codes are displayed with their values
+	if(f->typid == FEATURE_FLOAT16 || f->typid == FEATURE_INT8){
+		f = featureToFloat8(f);
+	}
+
 	typid =  f->typid;
 	typidarr = get_array_type(typid);
 
@@ -191,6 +207,70 @@ Datum
 }
 
 
+/*
+*  binary in function for feature data; the binary format is the one of the array
+*  of its values, which names the element type
+*/
+Datum
+	feature_recv(PG_FUNCTION_ARGS)
+{
+	StringInfo	buf = (StringInfo) PG_GETARG_POINTER(0);
+	StringInfoData header;
+	Oid			typid,
+		typidarr,
+		typreceive,
+		typioparam;
+	Datum		result;
+	feature	   *f;
+
+	//the element type follows the number of dimensions and the flags of the array
+	header = *buf;
+	pq_getmsgint(&header, 4);
+	pq_getmsgint(&header, 4);
+	typid = (Oid) pq_getmsgint(&header, sizeof(Oid));
+
+	typidarr = get_array_type(typid);
+
+	if(!OidIsValid(typidarr)){
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+			errmsg("invalid element type %u of a feature", typid)));
+	}
+
+	getTypeBinaryInputInfo(typidarr, &typreceive, &typioparam);
+	result = OidReceiveFunctionCall(typreceive, buf, typioparam, -1);
+
+	f = (feature *) palloc(VARHDRSZ + sizeof(int32) + VARSIZE_ANY(DatumGetPointer(result)));
+	SET_VARSIZE(f, VARHDRSZ + sizeof(int32) + VARSIZE_ANY(DatumGetPointer(result)));
+
+	f->typid = typid;
+	memcpy(&f->data, DatumGetPointer(result), VARSIZE_ANY(DatumGetPointer(result)));
+
+	PG_RETURN_POINTER(f);
+}
+
+/*
+*  binary out function for feature data; quantized features are sent with their values
+*/
+Datum
+	feature_send(PG_FUNCTION_ARGS)
+{
+	feature	   *f;
+	Oid			typsend;
+	bool		typisvarlena;
+
+	f =  (feature *) PG_DETOAST_DATUM(PG_GETARG_DATUM(0));
+
+	if(f->typid == FEATURE_FLOAT16 || f->typid == FEATURE_INT8){
+		f = featureToFloat8(f);
+	}
+
+	getTypeBinaryOutputInfo(get_array_type(f->typid), &typsend, &typisvarlena);
+
+	PG_RETURN_BYTEA_P(OidSendFunctionCall(typsend, PointerGetDatum(&f->data)));
+}
+
+
 /*
 * casts a feature to an array
 */
@@ -200,6 +280,12 @@ Datum
 	feature	   *f;
 
 	f =  (feature *) PG_DETOAST_DATUM(PG_GETARG_DATUM(0));
+
+	//the codes of quantized features are no array elements of their own
+	if(f->typid == FEATURE_FLOAT16 || f->typid == FEATURE_INT8){
+		f = featureToFloat8(f);
+	}
+
 	PG_RETURN_POINTER(&(f->data));
 }
 
@@ -298,6 +384,284 @@ char *
 }
 
 
+/*
+* quantizes a feature, i.e. stores it as float8, float4 or float16 (storage given
+* as text); for the int8 storage the scale and offset have to be given (see
+* feature_quantize_scaled)
+*/
+Datum
+	feature_quantize(PG_FUNCTION_ARGS)
+{
+	feature		*f = (feature *) PG_GETARG_VARLENA_P(0);
+	char		*storage = text_to_cstring(PG_GETARG_TEXT_PP(1));
+
+	if(pg_strcasecmp(storage, "int8") == 0){
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			errmsg("the int8 storage needs a scale and an offset"),
+			errhint("Use feature_quantize(feature, 'int8', scale, offset) with the same scale and offset for all features of a column.")));
+	}
+
+	PG_RETURN_POINTER(quantize(f, storage, 1.0, 0.0));
+}
+
+/*
+* quantizes a feature with a scale and an offset, i.e. code = (value - offset) / scale;
+* the features of a column should all be quantized with the same scale and offset,
+* only then the distances can be computed on the codes
+*/
+Datum
+	feature_quantize_scaled(PG_FUNCTION_ARGS)
+{
+	feature		*f = (feature *) PG_GETARG_VARLENA_P(0);
+	char		*storage = text_to_cstring(PG_GETARG_TEXT_PP(1));
+	float8		scale = PG_GETARG_FLOAT8(2);
+	float8		offset = PG_GETARG_FLOAT8(3);
+
+	if(!(scale > 0) || isinf(scale) || isnan(offset) || isinf(offset)){
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			errmsg("the scale has to be positive and the offset finite")));
+	}
+
+	PG_RETURN_POINTER(quantize(f, storage, scale, offset));
+}
+
+/*
+* converts a quantized feature back to a float8 feature
+*/
+Datum
+	feature_dequantize(PG_FUNCTION_ARGS)
+{
+	feature		*f = (feature *) PG_GETARG_VARLENA_P(0);
+
+	PG_RETURN_POINTER(featureToFloat8(f));
+}
+
+/*
+* creates the feature in the storage given
+*/
+static feature *
+	quantize(feature *f, char *storage, float8 scale, float8 offset)
+{
+	FeatureReader	reader;
+	feature		*result;
+	ArrayType	*arr;
+	Datum		*values;
+	int32		typid;
+	Size		size;
+	int			i;
+
+	if(pg_strcasecmp(storage, "float8") == 0){
+		return featureToFloat8(f);
+	} else if(pg_strcasecmp(storage, "float4") == 0){
+		typid = FLOAT4OID;
+	} else if(pg_strcasecmp(storage, "float16") == 0){
+		typid = FEATURE_FLOAT16;
+	} else if(pg_strcasecmp(storage, "int8") == 0){
+		typid = FEATURE_INT8;
+	} else {
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			errmsg("unknown feature storage \"%s\"", storage),
+			errhint("Use float8, float4, float16 or int8.")));
+	}
+
+	featureInitReader(&reader, f);
+
+	values = palloc(Max(reader.n, 1) * sizeof(Datum));
+
+	for(i = 0; i < reader.n; i++){
+		float8 value = featureReaderGet(&reader, i);
+
+		switch(typid){
+			case FLOAT4OID:
+				values[i] = Float4GetDatum((float4) value);
+				break;
+			case FEATURE_FLOAT16:
+				values[i] = Int16GetDatum((int16) float8ToHalf(value));
+				break;
+			default:
+				value = rint((value - offset) / scale);
+				values[i] = CharGetDatum((char) (int8) Max(-127.0, Min(127.0, value)));
+				break;
+		}
+	}
+
+	switch(typid){
+		case FLOAT4OID:
+			arr = construct_array(values, reader.n, FLOAT4OID, sizeof(float4), FLOAT4PASSBYVAL, 'i');
+			break;
+		case FEATURE_FLOAT16:
+			arr = construct_array(values, reader.n, INT2OID, sizeof(int16), true, 's');
+			break;
+		default:
+			arr = construct_array(values, reader.n, CHAROID, 1, true, 'c');
+			break;
+	}
+
+	size = VARHDRSZ + sizeof(int32) + VARSIZE(arr);
+	if(typid == FEATURE_INT8){
+		size = VARHDRSZ + sizeof(int32) + MAXALIGN(VARSIZE(arr)) + sizeof(FeatureQuantization);
+	}
+
+	result = (feature *) palloc0(size);
+	SET_VARSIZE(result, size);
+	result->typid = typid;
+	memcpy(&result->data, arr, VARSIZE(arr));
+
+	if(typid == FEATURE_INT8){
+		FEATURE_QUANTIZATION(result)->scale = scale;
+		FEATURE_QUANTIZATION(result)->offset = offset;
+	}
+
+	pfree(values);
+	pfree(arr);
+
+	return result;
+}
+
+/*
+* checks whether the feature is stored in a compact form, i.e. quantized or as float4
+*/
+bool
+	featureIsCompact(feature *f)
+{
+	return f->typid == FLOAT4OID || f->typid == FEATURE_FLOAT16 || f->typid == FEATURE_INT8;
+}
+
+/*
+* prepares reading the values of a float8 or compact feature; features containing
+* null values cannot be read
+*/
+void
+	featureInitReader(FeatureReader *reader, feature *f)
+{
+	if(f->typid != FLOAT8OID && !featureIsCompact(f)){
+		ereport(ERROR,
+			(errcode(ERRCODE_DATATYPE_MISMATCH),
+			errmsg("features can only be quantized and compared if they are numeric")));
+	}
+
+	if(ARR_HASNULL(&f->data)){
+		ereport(ERROR,
+			(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			errmsg("features containing null values cannot be quantized or compared with quantized features")));
+	}
+
+	reader->storage = f->typid;
+	reader->data = ARR_DATA_PTR(&f->data);
+	reader->n = ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data));
+	reader->scale = 1.0;
+	reader->offset = 0.0;
+
+	if(f->typid == FEATURE_INT8){
+		reader->scale = FEATURE_QUANTIZATION(f)->scale;
+		reader->offset = FEATURE_QUANTIZATION(f)->offset;
+	}
+}
+
+/*
+* returns the feature as float8 feature; features stored as float8 or with values
+* of other types are returned unchanged
+*/
+feature *
+	featureToFloat8(feature *f)
+{
+	FeatureReader	reader;
+	ArrayType	*arr;
+	Datum		*values;
+	feature		*result;
+	int			i;
+
+	if(!featureIsCompact(f)){
+		return f;
+	}
+
+	featureInitReader(&reader, f);
+
+	values = palloc(Max(reader.n, 1) * sizeof(Datum));
+	for(i = 0; i < reader.n; i++){
+		values[i] = Float8GetDatum(featureReaderGet(&reader, i));
+	}
+
+	arr = construct_array(values, reader.n, FLOAT8OID, sizeof(float8), FLOAT8PASSBYVAL, 'd');
+
+	result = (feature *) palloc(VARHDRSZ + sizeof(int32) + VARSIZE(arr));
+	SET_VARSIZE(result, VARHDRSZ + sizeof(int32) + VARSIZE(arr));
+	result->typid = FLOAT8OID;
+	memcpy(&result->data, arr, VARSIZE(arr));
+
+	pfree(values);
+	pfree(arr);
+
+	return result;
+}
+
+/*
+* converts an IEEE 754 half precision float to float8
+*/
+float8
+	halfToFloat8(uint16 h)
+{
+	int		sign = (h >> 15) & 0x1;
+	int		exponent = (h >> 10) & 0x1f;
+	int		mantissa = h & 0x3ff;
+	float8	value;
+
+	if(exponent == 0){
+		value = ldexp((float8) mantissa, -24);
+	} else if(exponent == 31){
+		value = mantissa ? get_float8_nan() : get_float8_infinity();
+	} else {
+		value = ldexp((float8) (mantissa | 0x400), exponent - 25);
+	}
+
+	return sign ? -value : value;
+}
+
+/*
+* converts a float8 to an IEEE 754 half precision float (rounding to nearest)
+*/
+uint16
+	float8ToHalf(float8 value)
+{
+	uint16	sign = 0;
+	int		exponent;
+	float8	mantissa;
+	int		bits;
+
+	if(isnan(value)){
+		return 0x7e00;
+	}
+
+	if(value < 0 || (value == 0 && signbit(value))){
+		sign = 0x8000;
+		value = -value;
+	}
+
+	if(value >= 65520.0){
+		//too large, i.e. infinity
+		return sign | 0x7c00;
+	}
+
+	if(value < ldexp(1.0, -14)){
+		//subnormal numbers (and zero)
+		return sign | (uint16) rint(ldexp(value, 24));
+	}
+
+	mantissa = frexp(value, &exponent);		//value = mantissa * 2^exponent, 0.5 <= mantissa < 1
+	bits = (int) rint(ldexp(mantissa, 11));	//11 significant bits
+
+	if(bits == 2048){
+		bits = 1024;
+		exponent++;
+	}
+
+	return sign | (uint16) (((exponent + 14) << 10) | (bits & 0x3ff));
+}
+
+
 /*
 * checks whether the features are equal
 */
@@ -323,13 +687,33 @@ Datum
 }
 
 /*
-* checks whether two features are equal
+* checks whether two features are equal; features of the same storage without
+* nulls are compared directly (memcmp and a native loop for the values equal
+* with a different bit pattern, i.e. -0 and 0 or NaNs), the others as arrays
 */
 static bool 
 	checkEqual(FunctionCallInfo fcinfo, feature *f1, feature *f2)
 {
 	bool		result;
 
+	featureDecodeForComparison(&f1, &f2);
+
+	if(featuresComparable(f1, f2)){
+		int ndims = ARR_NDIM(&f1->data);
+
+		if(ndims != ARR_NDIM(&f2->data)
+			|| memcmp(ARR_DIMS(&f1->data), ARR_DIMS(&f2->data), 2 * ndims * sizeof(int)) != 0){
+			return false;
+		}
+
+		if(memcmp(ARR_DATA_PTR(&f1->data), ARR_DATA_PTR(&f2->data),
+			ArrayGetNItems(ndims, ARR_DIMS(&f1->data)) * (ARR_ELEMTYPE(&f1->data) == FLOAT8OID ? sizeof(float8) : sizeof(float4))) == 0){
+			return true;
+		}
+
+		return compareElements(f1, f2) == 0;
+	}
+
 	fcinfo->arg[0] = PointerGetDatum(&f1->data);
 	fcinfo->arg[1] = PointerGetDatum(&f2->data);
 
@@ -340,6 +724,134 @@ static bool
 	return result;
 }
 
+/*
+* checks whether the values of a feature can be read directly, i.e. whether it
+* is stored as float8 or float4 array without nulls
+*/
+static bool
+	featureIsPlain(feature *f)
+{
+	Oid elemtype = ARR_ELEMTYPE(&f->data);
+
+	return (elemtype == FLOAT8OID || elemtype == FLOAT4OID) && !ARR_HASNULL(&f->data);
+}
+
+static bool
+	featuresComparable(feature *f1, feature *f2)
+{
+	return featureIsPlain(f1) && featureIsPlain(f2) && ARR_ELEMTYPE(&f1->data) == ARR_ELEMTYPE(&f2->data);
+}
+
+/*
+* features are compared by their values, not by their storage: quantized features
+* are decoded (the codes of int8 features depend on scale and offset, float16 codes
+* do not sort as integers) and a float4 feature compared with a float8 feature is
+* converted to float8; returns whether a feature has been decoded
+*/
+static bool
+	featureDecodeForComparison(feature **f1, feature **f2)
+{
+	bool decoded = false;
+
+	if((*f1)->typid == FEATURE_FLOAT16 || (*f1)->typid == FEATURE_INT8){
+		*f1 = featureToFloat8(*f1);
+		decoded = true;
+	}
+
+	if((*f2)->typid == FEATURE_FLOAT16 || (*f2)->typid == FEATURE_INT8){
+		*f2 = featureToFloat8(*f2);
+		decoded = true;
+	}
+
+	//only checked after decoding, a float4 feature may be compared with a decoded one
+	if((*f1)->typid == FLOAT4OID && featureIsPlain(*f1) && featureIsPlain(*f2) && ARR_ELEMTYPE(&(*f2)->data) == FLOAT8OID){
+		*f1 = featureToFloat8(*f1);
+		decoded = true;
+	} else if((*f2)->typid == FLOAT4OID && featureIsPlain(*f2) && featureIsPlain(*f1) && ARR_ELEMTYPE(&(*f1)->data) == FLOAT8OID){
+		*f2 = featureToFloat8(*f2);
+		decoded = true;
+	}
+
+	return decoded;
+}
+
+/*
+* compares the values of two comparable features as btarraycmp does: the common
+* values are compared (NaNs are equal and larger than any other value), then the
+* number of values and the dimensionality
+*/
+static int
+	compareElements(feature *f1, feature *f2)
+{
+	int n1 = ArrayGetNItems(ARR_NDIM(&f1->data), ARR_DIMS(&f1->data));
+	int n2 = ArrayGetNItems(ARR_NDIM(&f2->data), ARR_DIMS(&f2->data));
+	int n = MIN(n1, n2);
+	bool isFloat8 = (ARR_ELEMTYPE(&f1->data) == FLOAT8OID);
+	int i;
+
+	for(i = 0; i < n; i++){
+		float8 a = isFloat8 ? ((float8 *) ARR_DATA_PTR(&f1->data))[i] : ((float4 *) ARR_DATA_PTR(&f1->data))[i];
+		float8 b = isFloat8 ? ((float8 *) ARR_DATA_PTR(&f2->data))[i] : ((float4 *) ARR_DATA_PTR(&f2->data))[i];
+
+		if(isnan(a)){
+			if(!isnan(b)){
+				return 1;
+			}
+		} else if(isnan(b)){
+			return -1;
+		} else if(a != b){
+			return (a > b) ? 1 : -1;
+		}
+	}
+
+	if(n1 != n2){
+		return (n1 < n2) ? -1 : 1;
+	}
+
+	if(ARR_NDIM(&f1->data) != ARR_NDIM(&f2->data)){
+		return (ARR_NDIM(&f1->data) < ARR_NDIM(&f2->data)) ? -1 : 1;
+	}
+
+	//the lower bounds follow the dimensions
+	for(i = 0; i < 2 * ARR_NDIM(&f1->data); i++){
+		if(ARR_DIMS(&f1->data)[i] != ARR_DIMS(&f2->data)[i]){
+			return (ARR_DIMS(&f1->data)[i] < ARR_DIMS(&f2->data)[i]) ? -1 : 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+* compares two features, directly if possible, otherwise as arrays
+*/
+static int
+	featureCompare(feature *f1, feature *f2, FunctionCallInfo fcinfo)
+{
+	feature *d1 = f1;
+	feature *d2 = f2;
+	int result;
+
+	//called for every comparison of a sort, so the decoded features are freed
+	featureDecodeForComparison(&d1, &d2);
+
+	if(featuresComparable(d1, d2)){
+		result = compareElements(d1, d2);
+	} else {
+		result = DatumGetInt32(compare(d1, d2, fcinfo, &btarraycmp));
+	}
+
+	if(d1 != f1){
+		pfree(d1);
+	}
+
+	if(d2 != f2){
+		pfree(d2);
+	}
+
+	return result;
+}
+
 /*
 * checks whether a < b,
 * where a is first feature argument, b second feature argument
@@ -350,7 +862,7 @@ Datum
 	feature   *f1 = (feature *) PG_GETARG_VARLENA_P(0);
 	feature   *f2 = (feature *) PG_GETARG_VARLENA_P(1);
 
-	PG_RETURN_DATUM(compare(f1, f2, fcinfo, &array_lt));
+	PG_RETURN_BOOL(featureCompare(f1, f2, fcinfo) < 0);
 }
 
 /*
@@ -364,7 +876,7 @@ Datum
 	feature   *f2 = (feature *) PG_GETARG_VARLENA_P(1);
 
 
-	PG_RETURN_DATUM(compare(f1, f2, fcinfo, &array_gt));
+	PG_RETURN_BOOL(featureCompare(f1, f2, fcinfo) > 0);
 }
 
 /*
@@ -377,7 +889,7 @@ Datum
 	feature   *f1 = (feature *) PG_GETARG_VARLENA_P(0);
 	feature   *f2 = (feature *) PG_GETARG_VARLENA_P(1);
 
-	PG_RETURN_DATUM(compare(f1, f2, fcinfo, &array_le));
+	PG_RETURN_BOOL(featureCompare(f1, f2, fcinfo) <= 0);
 }
 
 /*
@@ -390,7 +902,7 @@ Datum
 	feature   *f1 = (feature *) PG_GETARG_VARLENA_P(0);
 	feature   *f2 = (feature *) PG_GETARG_VARLENA_P(1);
 
-	PG_RETURN_DATUM(compare(f1, f2, fcinfo, &array_ge));
+	PG_RETURN_BOOL(featureCompare(f1, f2, fcinfo) >= 0);
 }
 
 /*
@@ -402,7 +914,50 @@ Datum
 	feature   *f1 = (feature *) PG_GETARG_VARLENA_P(0);
 	feature   *f2 = (feature *) PG_GETARG_VARLENA_P(1);
 
-	PG_RETURN_DATUM(compare(f1, f2, fcinfo, &btarraycmp));
+	PG_RETURN_INT32(featureCompare(f1, f2, fcinfo));
+}
+
+/*
+* sort support for features: the comparator compares plain features directly and
+* calls feature_cmp for all others
+*/
+Datum
+	feature_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+	FmgrInfo   *cmpFunc = (FmgrInfo *) MemoryContextAlloc(ssup->ssup_cxt, sizeof(FmgrInfo));
+
+	fmgr_info_cxt(F_FEATURE_CMP, cmpFunc, ssup->ssup_cxt);
+
+	ssup->ssup_extra = cmpFunc;
+	ssup->comparator = feature_fastcmp;
+
+	PG_RETURN_VOID();
+}
+
+static int
+	feature_fastcmp(Datum x, Datum y, SortSupport ssup)
+{
+	feature   *f1 = (feature *) PG_DETOAST_DATUM(x);
+	feature   *f2 = (feature *) PG_DETOAST_DATUM(y);
+	int			result;
+
+	if(featuresComparable(f1, f2)){
+		result = compareElements(f1, f2);
+	} else {
+		result = DatumGetInt32(FunctionCall2Coll((FmgrInfo *) ssup->ssup_extra, InvalidOid, x, y));
+	}
+
+	//avoid leaking memory when handed toasted input
+	if((Pointer) f1 != DatumGetPointer(x)){
+		pfree(f1);
+	}
+
+	if((Pointer) f2 != DatumGetPointer(y)){
+		pfree(f2);
+	}
+
+	return result;
 }
 
 /*
@@ -419,13 +974,52 @@ Datum
 }
 
 /*
-* calculates the hash for a feature
+* calculates the hash for a feature; plain features are hashed as one block of
+* float8 values (as they are compared, see featureDecodeForComparison), where -0
+* and NaNs are normalized first (as they are equal to 0 and to all NaNs,
+* respectively)
 */
 Datum
 	feature_hash(PG_FUNCTION_ARGS)
 {
 	feature   *f = (feature *) PG_GETARG_VARLENA_P(0);
-	void *     ptr = palloc(VARSIZE_ANY_EXHDR(f) - sizeof(int32));
+	void *     ptr;
+
+	if(f->typid == FEATURE_FLOAT16 || f->typid == FEATURE_INT8 || (f->typid == FLOAT4OID && featureIsPlain(f))){
+		f = featureToFloat8(f);
+	}
+
+	if(featureIsPlain(f)){
+		int n = ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data));
+		Size size = n * sizeof(float8);
+		char *data = ARR_DATA_PTR(&f->data);
+		char *normalized = NULL;
+		Datum result;
+		int i;
+
+		for(i = 0; i < n; i++){
+			float8 value = ((float8 *) data)[i];
+
+			if(value == 0 || isnan(value)){
+				if(!normalized){
+					normalized = palloc(size);
+					memcpy(normalized, data, size);
+				}
+
+				((float8 *) normalized)[i] = (value == 0) ? 0.0 : get_float8_nan();
+			}
+		}
+
+		result = hash_any((unsigned char *) (normalized ? normalized : data), size);
+
+		if(normalized){
+			pfree(normalized);
+		}
+
+		return result;
+	}
+
+	ptr = palloc(VARSIZE_ANY_EXHDR(f) - sizeof(int32));
 
 	memcpy(ptr, &f->data, VARSIZE_ANY_EXHDR(f) - sizeof(int32));
 
@@ -452,7 +1046,7 @@ Datum
 Datum
 	feature_min(PG_FUNCTION_ARGS)
 {
-		feature   *f1 = (feature *) PG_GETARG_VARLENA_P(1);
+		feature   *f1 = featureToFloat8((feature *) PG_GETARG_VARLENA_P(1));
 	ArrayType *a;
 
 	ArrayIterator f1_it;
@@ -543,7 +1137,7 @@ Datum
 Datum
 	feature_max(PG_FUNCTION_ARGS)
 {
-	feature   *f1 = (feature *) PG_GETARG_VARLENA_P(1);
+	feature   *f1 = featureToFloat8((feature *) PG_GETARG_VARLENA_P(1));
 	ArrayType *a;
 
 	ArrayIterator f1_it;
@@ -0,0 +1,1393 @@
+/*
+ * ADAM - indexing functions
+ * name: adam_index_lsh
+ * description: functions for locality-sensitive hashing index
+ * the code is based on descriptions from:
+ *  Charikar, M. (2002) : Similarity Estimation Techniques from Rounding Algorithms (random hyperplanes for cosine similarity)
+ *  Indyk, P. and Motwani, R. (1998) : Approximate Nearest Neighbors: Towards Removing the Curse of Dimensionality (bit sampling for Hamming distance)
+ *  Lv, Q. et al. (2007) : Multi-Probe LSH: Efficient Indexing for High-Dimensional Similarity Search
+ *
+ * src/backend/utils/adt/adam_index_lsh.c
+ *
+ *
+ *
+ *
+ *
+ * addendum: the structure of this code is based on the VA-file code
+ * (see adam_index_va.c)
+ *
+ * note: as the hash index, LSH indexes are not WAL-logged; after a crash, or on
+ * a standby server, the index must be rebuilt with REINDEX (a warning is given
+ * when an index of a logged table is built); the index of an unlogged table is
+ * reset to an empty index at restart
+ *
+ */
+
+#include "postgres.h"
+
+#include <math.h>
+
+#include "utils/adam_index_lsh.h"
+
+#include "utils/adam_data_feature.h"
+
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "access/genam.h"
+#include "access/heapam_xlog.h"
+#include "access/reloptions.h"
+#include "access/relscan.h"
+#include "catalog/index.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
+#include "commands/vacuum.h"
+#include "nodes/parsenodes.h"
+#include "nodes/tidbitmap.h"
+#include "optimizer/cost.h"
+#include "optimizer/plancat.h"
+#include "storage/bufmgr.h"
+#include "storage/indexfsm.h"
+#include "storage/lmgr.h"
+#include "storage/smgr.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/selfuncs.h"
+#include "utils/syscache.h"
+
+#define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
+#define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
+
+/*
+ * LSH page functions
+ */
+#define getOpaque(page)				( (Opaque) PageGetSpecialPointer(page) )
+#define getMaxOffset(page)			( getOpaque(page)->maxoff )
+#define isMeta(page)				( getOpaque(page)->flags & LSH_META)
+#define isDirectory(page)			( getOpaque(page)->flags & LSH_DIRECTORY)
+#define isBucket(page)				( getOpaque(page)->flags & LSH_BUCKET)
+#define getData(page)				(  (Tuple*)PageGetContents(page) )
+#define getDirectory(page)			(  (BlockNumber*)PageGetContents(page) )
+
+#define LSH_META					(1<<0)
+#define LSH_DIRECTORY				(1<<1)
+#define LSH_BUCKET					(1<<2)
+
+#define LSH_METAPAGE_BLKNO  		(0)
+#define LSH_DIRECTORY_BLKNO			(1)
+
+/*
+ * LSH options (i.e. given at creation time) and state (i.e. read from the
+ * meta page and cached in rd_amcache)
+ */
+typedef struct LSHOptions {
+	int32				vl_len_;					/* varlena header (do not touch directly!) */
+	int32				nTables;
+	int32				nBits;
+	int32				nProbes;
+	int32				familyOffset;
+} LSHOptions;
+
+typedef struct StateOptions {
+	LSHFamily			family;
+	int32				nTables;
+	int32				nBits;
+	int32				nProbes;
+	int32				dimensions;
+	uint32				nBuckets;
+	uint32				seed;
+	float8			   *hyperplanes;			/* [nTables][nBits][dimensions], cosine only */
+	int32			   *samples;				/* [nTables][nBits], hamming only */
+} StateOptions;
+
+/*
+ * LSH storage
+ *
+ * block 0 is the meta page, followed by the directory pages holding the
+ * head of the page chain of each bucket (nTables x nBuckets); all other
+ * pages belong to the chain of a bucket
+ */
+typedef struct OpaqueData {
+	OffsetNumber	maxoff;
+	uint16			flags;
+	uint16			table;
+	BlockNumber		next;
+} OpaqueData;
+typedef OpaqueData *Opaque;
+
+typedef struct MetaPageData {
+	uint32					magickNumber;
+	uint32					seed;
+	uint16					family;
+	uint16					nTables;
+	uint16					nBits;
+	uint16					nDirectoryPages;
+	int32					dimensions;
+	uint32					nBuckets;
+} MetaPageData;
+
+typedef struct Tuple {
+	uint32				code;
+	ItemPointerData		heapPtr;
+} Tuple;
+
+#define GetMeta(p)		((MetaPageData *) PageGetContents(p))
+#define DirectoryEntriesPerPage \
+	((BLCKSZ - MAXALIGN(SizeOfPageHeaderData) - MAXALIGN(sizeof(OpaqueData))) / sizeof(BlockNumber))
+#define TuplesPerPage \
+	((BLCKSZ - MAXALIGN(SizeOfPageHeaderData) - MAXALIGN(sizeof(OpaqueData))) / sizeof(Tuple))
+#define GetFreePageSpace(page) \
+	(BLCKSZ - MAXALIGN(SizeOfPageHeaderData) \
+	- getMaxOffset(page) * sizeof(Tuple) \
+	- MAXALIGN(sizeof(OpaqueData)))
+
+
+/*
+ * LSH scan
+ */
+typedef struct ScanOpaqueData{
+	StateOptions   *state;
+} ScanOpaqueData;
+typedef ScanOpaqueData *ScanOpaque;
+
+typedef struct BuildState{
+	MemoryContext	tmpCtx;
+	double			indtuples;
+} BuildState;
+
+
+/*
+ * LSH management functions
+ */
+static StateOptions* getState(Relation index);
+static StateOptions* setDimensions(Relation index, int32 dimensions);
+static void insertTuple(Relation index, Datum *values, bool *isnull, ItemPointer heapPtr);
+static void buildCallback(Relation index, HeapTuple htup, Datum *values, bool *isnull, bool tupleIsAlive, void *state);
+static void addToBucket(Relation index, StateOptions *state, int table, uint32 code, ItemPointer heapPtr);
+static int64 scanBucket(Relation index, StateOptions *state, int table, uint32 code, bool allCodes, TIDBitmap *tbm);
+static bool lshSupportsDistance(LSHFamily family, AdamScanClause *adamOptions);
+static LSHOptions* getRelopts(Oid indexOid);
+static uint32 getNumberOfBuckets(double tuples, int nBits);
+static Buffer newBuffer(Relation index);
+static void initBuffer(Buffer b, uint16 f, uint16 table);
+static void initPage(Page page, uint16 f, uint16 table, Size pageSize);
+static void initMetaPage(Page page, LSHOptions *opts, uint32 nBuckets);
+static void initDirectoryPage(Page page);
+
+
+/*
+ * LSH specific functions for calculations
+ */
+static float8* getFeatureValues(Datum d, int32 *dimensions);
+static uint32 hashFeature(StateOptions *state, int table, float8 *values, float8 *margins);
+static void getProbeOrder(StateOptions *state, float8 *margins, int *order);
+
+
+/*
+ * enabler/disabler
+ */
+bool enable_lshscan = true;
+
+
+/*
+ *  Prepare for an index scan.
+ *
+ *  see vaBeginScan
+ */
+Datum
+lshBeginScan(PG_FUNCTION_ARGS)
+{
+	Relation    rel = (Relation)PG_GETARG_POINTER(0);
+	int         keysz = PG_GETARG_INT32(1);
+	int			norderbys = PG_GETARG_INT32(2);
+	IndexScanDesc scan;
+
+	scan = RelationGetIndexScan(rel, keysz, norderbys);
+
+	PG_RETURN_POINTER(scan);
+}
+
+
+
+/*
+ * Start or restart an index scan, possibly with new scan keys.
+ *
+ * see vaReScan
+ */
+Datum
+lshReScan(PG_FUNCTION_ARGS)
+{
+	IndexScanDesc scan = (IndexScanDesc)PG_GETARG_POINTER(0);
+	ScanKey     keys = (ScanKey)PG_GETARG_POINTER(1);
+
+	ScanOpaque so = (ScanOpaque)scan->opaque;
+
+	if (so == NULL) {
+		so = (ScanOpaque)palloc(sizeof(ScanOpaqueData));
+		scan->opaque = so;
+	}
+
+	so->state = getState(scan->indexRelation);
+
+	if (keys && scan->numberOfKeys > 0)	{
+		memmove(scan->keyData, keys, scan->numberOfKeys * sizeof(ScanKeyData));
+	}
+
+	PG_RETURN_VOID();
+}
+
+
+
+/*
+ * End a scan and release resources.
+ *
+ * see vaEndScan
+ */
+Datum
+lshEndScan(PG_FUNCTION_ARGS)
+{
+	IndexScanDesc scan = (IndexScanDesc)PG_GETARG_POINTER(0);
+	ScanOpaque so = (ScanOpaque)scan->opaque;
+
+	if (so){
+		pfree(so);
+	}
+	scan->opaque = NULL;
+
+	PG_RETURN_VOID();
+}
+
+
+
+/*
+ * Fetch all candidate tuples and add them to the caller-supplied TIDBitmap.
+ *
+ * If the scan is part of a nearest neighbour query (i.e. a limit was passed
+ * down), only the buckets the query vector hashes to are read in every table,
+ * plus the buckets of the nProbes most likely neighbouring codes (multi-probe).
+ * The probing is extended as long as less candidates than requested have been
+ * found. The candidates are exact w.r.t. the === operator; the distance is
+ * calculated on the heap tuples only.
+ *
+ * Otherwise all tuples (of the first table) are returned.
+ */
+Datum
+lshGetBitmap(PG_FUNCTION_ARGS)
+{
+	IndexScanDesc 			scan = (IndexScanDesc)PG_GETARG_POINTER(0);
+	TIDBitmap  				*tbm = (TIDBitmap *)PG_GETARG_POINTER(1);
+
+	AdamScanClause			*adamOptions = (AdamScanClause *)scan->adamScanClause;
+	ScanOpaque				so = (ScanOpaque)scan->opaque;
+	StateOptions			*state;
+
+	int64					ntids = 0;
+
+	float8					*query;
+	int32					dimensions;
+
+	uint32					*codes;
+	int						*orders;
+	float8					*margins;
+
+	int						table;
+	int						probe;
+	int						nProbes;
+
+	MemoryContext			oldCtx;
+	MemoryContext			ctx;
+
+	/* the cached state may have been rebuilt since the scan started */
+	state = so->state = getState(scan->indexRelation);
+
+	if (scan->numberOfKeys == 0 || !adamOptions || adamOptions->nn_limit <= 0 || state->dimensions == 0
+		|| !lshSupportsDistance(state->family, adamOptions)){
+		/* no nearest neighbour search (the planner disables the index for other distances), return all tuples */
+		uint32 bucket;
+
+		for (bucket = 0; bucket < state->nBuckets; bucket++){
+			ntids += scanBucket(scan->indexRelation, state, 0, bucket, true, tbm);
+		}
+
+		PG_RETURN_INT64(ntids);
+	}
+
+	ctx = AllocSetContextCreate(CurrentMemoryContext, "LSH search temporary context",
+		ALLOCSET_DEFAULT_MINSIZE, ALLOCSET_DEFAULT_INITSIZE, ALLOCSET_DEFAULT_MAXSIZE);
+	oldCtx = MemoryContextSwitchTo(ctx);
+
+	query = getFeatureValues(scan->keyData[0].sk_argument, &dimensions);
+
+	if (dimensions != state->dimensions){
+		ereport(ERROR,
+			(errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+			errmsg("query vector has %d dimensions, but LSH index \"%s\" has %d dimensions",
+				dimensions, RelationGetRelationName(scan->indexRelation), state->dimensions)));
+	}
+
+	/* hash query in all tables and determine probing sequence */
+	codes = palloc(state->nTables * sizeof(uint32));
+	orders = palloc(state->nTables * state->nBits * sizeof(int));
+	margins = palloc(state->nBits * sizeof(float8));
+
+	for (table = 0; table < state->nTables; table++){
+		codes[table] = hashFeature(state, table, query, margins);
+		getProbeOrder(state, margins, &orders[table * state->nBits]);
+	}
+
+	/* probe 0 is the bucket of the query itself, probe i flips the i-th most uncertain bit */
+	nProbes = MIN(state->nProbes, state->nBits);
+
+	for (probe = 0; probe <= state->nBits; probe++){
+		/* a tuple is found in several tables, so only distinct tuples are counted */
+		if (probe > nProbes && tbm_ntuples(tbm, 1) >= adamOptions->nn_limit){
+			break;
+		}
+
+		for (table = 0; table < state->nTables; table++){
+			uint32 code = codes[table];
+
+			if (probe > 0){
+				code ^= ((uint32) 1) << orders[table * state->nBits + probe - 1];
+			}
+
+			scanBucket(scan->indexRelation, state, table, code, false, tbm);
+		}
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextDelete(ctx);
+
+	PG_RETURN_INT64((int64) tbm_ntuples(tbm, 1));
+}
+
+
+
+/*
+ * Build new index.
+ *
+ * see vaBuild
+ */
+Datum
+lshBuild(PG_FUNCTION_ARGS)
+{
+	Relation    heap = (Relation)PG_GETARG_POINTER(0);
+	Relation    index = (Relation)PG_GETARG_POINTER(1);
+	IndexInfo  *indexInfo = (IndexInfo *)PG_GETARG_POINTER(2);
+	IndexBuildResult *result;
+	double      reltuples;
+	BuildState	buildstate;
+
+	LSHOptions	*opts = (LSHOptions *)index->rd_options;
+
+	Buffer		metaBuffer;
+	uint16		nDirectoryPages;
+	int			i;
+
+	BlockNumber	heapPages;
+	double		heapTuples;
+	double		allvisfrac;
+
+	ListCell	*index_field;
+
+	if (RelationGetNumberOfBlocks(index) != 0){
+		elog(ERROR, "index \"%s\" already contains data",
+			RelationGetRelationName(index));
+	}
+
+	foreach(index_field, indexInfo->ii_Expressions){
+		FieldSelect *field = (FieldSelect *)lfirst(index_field);
+
+		if (field->resulttype != FEATURE){
+			ereport(ERROR,
+				(errcode(ERRCODE_CANNOT_COERCE),
+				errmsg("LSH indexing is only supported for features data types"),
+				errhint("Please use other indexing methods or change the data type to FEATURE.")));
+
+		}
+	}
+
+	if (RelationNeedsWAL(index)){
+		ereport(WARNING,
+			(errmsg("LSH indexes are not WAL-logged"),
+			errdetail("The index must be rebuilt with REINDEX after a crash.")));
+	}
+
+	/* initialize the meta page, the buckets are chosen for the current relation */
+	estimate_rel_size(heap, NULL, &heapPages, &heapTuples, &allvisfrac);
+
+	metaBuffer = newBuffer(index);
+	Assert(BufferGetBlockNumber(metaBuffer) == LSH_METAPAGE_BLKNO);
+
+	START_CRIT_SECTION();
+	initMetaPage(BufferGetPage(metaBuffer), opts,
+		getNumberOfBuckets(heapTuples, opts ? opts->nBits : LSH_DEFAULT_BITS));
+	nDirectoryPages = GetMeta(BufferGetPage(metaBuffer))->nDirectoryPages;
+	MarkBufferDirty(metaBuffer);
+	END_CRIT_SECTION();
+	UnlockReleaseBuffer(metaBuffer);
+
+	/* initialize the directory pages, all buckets are empty */
+	for (i = 0; i < nDirectoryPages; i++){
+		Buffer buffer = newBuffer(index);
+
+		Assert(BufferGetBlockNumber(buffer) == LSH_DIRECTORY_BLKNO + i);
+
+		START_CRIT_SECTION();
+		initDirectoryPage(BufferGetPage(buffer));
+		MarkBufferDirty(buffer);
+		END_CRIT_SECTION();
+		UnlockReleaseBuffer(buffer);
+	}
+
+	buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+		"LSH build temporary context",
+		ALLOCSET_DEFAULT_MINSIZE, ALLOCSET_DEFAULT_INITSIZE, ALLOCSET_DEFAULT_MAXSIZE);
+	buildstate.indtuples = 0;
+
+	reltuples = IndexBuildHeapScan(heap, index, indexInfo, true,
+		buildCallback, (void *)&buildstate);
+
+	MemoryContextDelete(buildstate.tmpCtx);
+
+	result = (IndexBuildResult *)palloc(sizeof(IndexBuildResult));
+	result->heap_tuples = reltuples;
+	result->index_tuples = buildstate.indtuples;
+
+	PG_RETURN_POINTER(result);
+}
+
+
+
+/*
+ * Build an empty index, and write it to the initialization fork (INIT_FORKNUM) of the given relation.
+ *
+ * see vaBuildEmpty
+ */
+Datum
+lshBuildEmpty(PG_FUNCTION_ARGS)
+{
+	Relation	index = (Relation)PG_GETARG_POINTER(0);
+	Page		page;
+	BlockNumber	blkno;
+	uint16		nDirectoryPages;
+
+	/* the empty index has a single bucket per table */
+	page = (Page) palloc(BLCKSZ);
+	initMetaPage(page, (LSHOptions *)index->rd_options, 1);
+	nDirectoryPages = GetMeta(page)->nDirectoryPages;
+
+	/* write the pages, the initialization fork is WAL-logged (see spgbuildempty) */
+	for (blkno = LSH_METAPAGE_BLKNO; blkno <= nDirectoryPages; blkno++){
+		if (blkno != LSH_METAPAGE_BLKNO){
+			initDirectoryPage(page);
+		}
+
+		PageSetChecksumInplace(page, blkno);
+		smgrwrite(index->rd_smgr, INIT_FORKNUM, blkno, (char *) page, true);
+		if (XLogIsNeeded()){
+			log_newpage(&index->rd_smgr->smgr_rnode.node, INIT_FORKNUM, blkno, page);
+		}
+	}
+
+	/* the writes did not go through shared buffers, see spgbuildempty */
+	smgrimmedsync(index->rd_smgr, INIT_FORKNUM);
+
+	PG_RETURN_VOID();
+}
+
+
+
+/*
+ * Insert a new tuple into an existing index.
+ *
+ * see vaInsert
+ */
+Datum
+lshInsert(PG_FUNCTION_ARGS)
+{
+	Relation    index = (Relation)PG_GETARG_POINTER(0);
+	Datum      *values = (Datum *)PG_GETARG_POINTER(1);
+	bool       *isnull = (bool *)PG_GETARG_POINTER(2);
+	ItemPointer ht_ctid = (ItemPointer)PG_GETARG_POINTER(3);
+
+	MemoryContext 	oldCtx;
+	MemoryContext 	insertCtx;
+
+	insertCtx = AllocSetContextCreate(CurrentMemoryContext,
+		"LSH insert temporary context",
+		ALLOCSET_DEFAULT_MINSIZE,
+		ALLOCSET_DEFAULT_INITSIZE,
+		ALLOCSET_DEFAULT_MAXSIZE);
+
+	oldCtx = MemoryContextSwitchTo(insertCtx);
+
+	insertTuple(index, values, isnull, ht_ctid);
+
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextDelete(insertCtx);
+
+	PG_RETURN_BOOL(false);
+}
+
+
+
+/*
+ * Mark current scan position.
+ */
+Datum
+lshMarkPos(PG_FUNCTION_ARGS)
+{
+	elog(ERROR, "LSH does not support mark/restore");
+	PG_RETURN_VOID();
+}
+
+
+
+/*
+ * Restore the scan to the most recently marked position.
+ */
+Datum
+lshRestorePos(PG_FUNCTION_ARGS)
+{
+	elog(ERROR, "LSH does not support mark/restore");
+	PG_RETURN_VOID();
+}
+
+
+
+/*
+ * Estimate the costs of an index scan
+ *
+ * see vaCostEstimate; only the buckets of the query (and the probed
+ * neighbouring buckets) are read, so the costs are scaled accordingly; the
+ * number of buckets is estimated from the tuples of the index as in lshBuild,
+ * the index itself is not read
+ */
+Datum
+lshCostEstimate(PG_FUNCTION_ARGS)
+{
+	PlannerInfo *root = (PlannerInfo *)PG_GETARG_POINTER(0);
+	IndexPath  *path = (IndexPath *)PG_GETARG_POINTER(1);
+	Cost	   *indexStartupCost = (Cost *)PG_GETARG_POINTER(3);
+	Cost	   *indexTotalCost = (Cost *)PG_GETARG_POINTER(4);
+	Selectivity *indexSelectivity = (Selectivity *)PG_GETARG_POINTER(5);
+	double	   *indexCorrelation = (double *)PG_GETARG_POINTER(6);
+
+	AdamQueryClause *adamOptions = (AdamQueryClause *) root->parse->adamQueryClause;
+
+	LSHOptions *opts;
+	LSHFamily	family = LSH_FAMILY_COSINE;
+	int			nBits = LSH_DEFAULT_BITS;
+	int			nProbes = LSH_DEFAULT_PROBES;
+	double		fraction;
+
+	bool disableCost = false;
+
+	vafilecostestimate(fcinfo);
+
+	opts = getRelopts(path->indexinfo->indexoid);
+	if (opts){
+		char *familyName = GET_STRING_RELOPTION(opts, familyOffset);
+
+		if (familyName && pg_strcasecmp(familyName, "hamming") == 0){
+			family = LSH_FAMILY_HAMMING;
+		}
+
+		nBits = opts->nBits;
+		nProbes = opts->nProbes;
+	}
+
+	fraction = (double) (1 + nProbes) / getNumberOfBuckets(path->indexinfo->tuples, nBits);
+
+	/* the hash family only finds the neighbours of its own distance */
+	if (!adamOptions || !lshSupportsDistance(family, adamOptions)){
+		disableCost = true;
+	}
+
+	/* the index is read in nTables passes over a few buckets each */
+	if (fraction < 1.0){
+		*indexTotalCost = *indexStartupCost + (*indexTotalCost - *indexStartupCost) * fraction;
+	}
+
+	/* index is only useful for nearest neighbour queries */
+	if (root->limit_tuples <= 0 || (root->limit_tuples > 500 && root->limit_tuples / path->indexinfo->tuples > 0.1)){
+		disableCost = true;
+	}
+
+	/* if offset used, then LSH is not useful */
+	if (root->parse->limitOffset){
+		disableCost = true;
+	}
+
+	if (!enable_lshscan){
+		disableCost = true;
+	}
+
+	/* do maximum costs if index is not useful */
+	if (disableCost){
+		*indexStartupCost = disable_cost + 1;
+		*indexTotalCost = disable_cost + 1;
+		*indexSelectivity = disable_cost + 1;
+		*indexCorrelation = disable_cost + 1;
+	}
+
+	PG_RETURN_VOID();
+}
+
+
+
+/*
+ * Delete tuple(s) from the index.
+ *
+ * see vaBulkDelete; the bucket pages are compacted, but empty pages are
+ * kept in the chain of their bucket
+ */
+Datum
+lshBulkDelete(PG_FUNCTION_ARGS)
+{
+	IndexVacuumInfo 		*info = (IndexVacuumInfo *)PG_GETARG_POINTER(0);
+	IndexBulkDeleteResult 	*stats = (IndexBulkDeleteResult *)PG_GETARG_POINTER(1);
+	IndexBulkDeleteCallback callback = (IndexBulkDeleteCallback)PG_GETARG_POINTER(2);
+	void       				*callback_state = (void *)PG_GETARG_POINTER(3);
+	Relation    			index = info->index;
+	BlockNumber             blkno,
+		npages;
+	bool					needLock;
+	Buffer					buffer;
+	Page            		page;
+
+	if (stats == NULL)
+		stats = (IndexBulkDeleteResult *)palloc0(sizeof(IndexBulkDeleteResult));
+
+	needLock = !RELATION_IS_LOCAL(index);
+
+	if (needLock)
+		LockRelation(index, ExclusiveLock);
+	npages = RelationGetNumberOfBlocks(index);
+	if (needLock)
+		UnlockRelation(index, ExclusiveLock);
+
+	for (blkno = LSH_DIRECTORY_BLKNO; blkno < npages; blkno++)
+	{
+		buffer = ReadBufferExtended(index, MAIN_FORKNUM, blkno, RBM_NORMAL, info->strategy);
+
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+
+		if (!PageIsNew(page) && isBucket(page)){
+			Tuple	*itup = getData(page);
+			Tuple	*itupEnd = itup + getMaxOffset(page);
+			Tuple	*itupPtr = itup;
+			bool	 countTuples = (getOpaque(page)->table == 0);
+
+			START_CRIT_SECTION();
+			while (itup < itupEnd){
+				if (callback(&itup->heapPtr, callback_state)){
+					if (countTuples)
+						stats->tuples_removed += 1;
+					getOpaque(page)->maxoff--;
+				}
+				else {
+					if (itupPtr != itup){
+						memcpy(itupPtr, itup, sizeof(Tuple));
+					}
+					if (countTuples)
+						stats->num_index_tuples++;
+					itupPtr++;
+				}
+
+				itup++;
+			}
+
+			if (itupPtr != itup){
+				MarkBufferDirty(buffer);
+			}
+			END_CRIT_SECTION();
+		}
+
+		UnlockReleaseBuffer(buffer);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	PG_RETURN_POINTER(stats);
+}
+
+
+
+/*
+ * Clean up after a VACUUM operation (zero or more ambulkdelete calls).
+ *
+ * see vaVacuumCleanup
+ */
+Datum
+lshVacuumCleanup(PG_FUNCTION_ARGS)
+{
+	IndexVacuumInfo *info = (IndexVacuumInfo *)PG_GETARG_POINTER(0);
+	IndexBulkDeleteResult *stats = (IndexBulkDeleteResult *)PG_GETARG_POINTER(1);
+	Relation    index = info->index;
+	bool        needLock;
+	BlockNumber npages,
+		blkno;
+
+	if (info->analyze_only)
+		PG_RETURN_POINTER(stats);
+
+	if (stats == NULL)
+		stats = (IndexBulkDeleteResult *)palloc0(sizeof(IndexBulkDeleteResult));
+
+	needLock = !RELATION_IS_LOCAL(index);
+
+	if (needLock)
+		LockRelation(index, ExclusiveLock);
+	npages = RelationGetNumberOfBlocks(index);
+	if (needLock)
+		UnlockRelation(index, ExclusiveLock);
+
+	stats->num_index_tuples = 0;
+	for (blkno = LSH_DIRECTORY_BLKNO; blkno < npages; blkno++){
+		Buffer      buffer;
+		Page        page;
+
+		vacuum_delay_point();
+
+		buffer = ReadBufferExtended(index, MAIN_FORKNUM, blkno, RBM_NORMAL, info->strategy);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		page = (Page)BufferGetPage(buffer);
+
+		/* every heap tuple is stored once per table, count the first one only */
+		if (!PageIsNew(page) && isBucket(page) && getOpaque(page)->table == 0) {
+			stats->num_index_tuples += getMaxOffset(page);
+		}
+
+		UnlockReleaseBuffer(buffer);
+	}
+
+	stats->estimated_count = false;
+	stats->num_pages = npages;
+
+	PG_RETURN_POINTER(stats);
+}
+
+
+
+/*
+ * Parse and validate the reloptions array for an index.
+ *
+ * see vaGetOptions
+ */
+Datum
+lshGetOptions(PG_FUNCTION_ARGS)
+{
+	Datum       		reloptions = PG_GETARG_DATUM(0);
+	bool        		validate = PG_GETARG_BOOL(1);
+	relopt_value 		*options;
+
+	int			numoptions = -1;
+	LSHOptions		*rdopts;
+	relopt_parse_elt 	tab[4];
+
+	tab[0].optname = "lshtables";
+	tab[0].opttype = RELOPT_TYPE_INT;
+	tab[0].offset = offsetof(LSHOptions, nTables);
+	tab[1].optname = "lshbits";
+	tab[1].opttype = RELOPT_TYPE_INT;
+	tab[1].offset = offsetof(LSHOptions, nBits);
+	tab[2].optname = "lshprobes";
+	tab[2].opttype = RELOPT_TYPE_INT;
+	tab[2].offset = offsetof(LSHOptions, nProbes);
+	tab[3].optname = "lshfamily";
+	tab[3].opttype = RELOPT_TYPE_STRING;
+	tab[3].offset = offsetof(LSHOptions, familyOffset);
+
+	options = parseRelOptions(reloptions, validate, RELOPT_KIND_LSH, &numoptions);
+	rdopts = allocateReloptStruct(sizeof(LSHOptions), options, numoptions);
+	fillRelOptions((void *)rdopts, sizeof(LSHOptions), options, numoptions, validate, tab, 4);
+
+	PG_RETURN_BYTEA_P(rdopts);
+}
+
+/*
+ * validates the hash family given in the reloptions
+ */
+void
+lshValidateFamilyOption(char *value)
+{
+	if (value == NULL ||
+		(pg_strcasecmp(value, "cosine") != 0 && pg_strcasecmp(value, "hamming") != 0)){
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			errmsg("invalid value for \"lshfamily\" option"),
+			errdetail("Valid values are \"cosine\" and \"hamming\".")));
+	}
+}
+
+
+/*
+ * returns the LSH state of the index (i.e. parameters and hash functions);
+ * the state is computed from the meta page and cached in rd_amcache
+ */
+static StateOptions*
+getState(Relation index)
+{
+	StateOptions	*state = (StateOptions *)index->rd_amcache;
+	LSHOptions		*opts = (LSHOptions *)index->rd_options;
+
+	/* the dimensionality is only known after the first tuple has been inserted */
+	if (!state || state->dimensions == 0){
+		Buffer				buffer;
+		MetaPageData		meta;
+		Size				size;
+		unsigned short		xseed[3];
+		int					i;
+
+		buffer = ReadBuffer(index, LSH_METAPAGE_BLKNO);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+
+		if (!isMeta(BufferGetPage(buffer)) || GetMeta(BufferGetPage(buffer))->magickNumber != LSH_MAGICK_NUMBER){
+			ereport(ERROR,
+				(errcode(ERRCODE_INDEX_CORRUPTED),
+				errmsg("index \"%s\" contains corrupted content", RelationGetRelationName(index)),
+				errhint("Please REINDEX it.")));
+		}
+
+		memcpy(&meta, GetMeta(BufferGetPage(buffer)), sizeof(MetaPageData));
+		UnlockReleaseBuffer(buffer);
+
+		if (index->rd_amcache){
+			pfree(index->rd_amcache);
+			index->rd_amcache = NULL;
+		}
+
+		/* one chunk only, so that the relcache can free it at once */
+		size = MAXALIGN(sizeof(StateOptions));
+		if (meta.family == LSH_FAMILY_COSINE){
+			size += meta.nTables * meta.nBits * meta.dimensions * sizeof(float8);
+		}
+		else {
+			size += meta.nTables * meta.nBits * sizeof(int32);
+		}
+
+		state = MemoryContextAllocZero(index->rd_indexcxt, size);
+		state->family = meta.family;
+		state->nTables = meta.nTables;
+		state->nBits = meta.nBits;
+		state->nProbes = opts ? opts->nProbes : LSH_DEFAULT_PROBES;
+		state->dimensions = meta.dimensions;
+		state->nBuckets = meta.nBuckets;
+		state->seed = meta.seed;
+
+		/* the hash functions are derived from the seed, so that all backends agree */
+		xseed[0] = 0x330E;
+		xseed[1] = (unsigned short) (meta.seed & 0xFFFF);
+		xseed[2] = (unsigned short) (meta.seed >> 16);
+
+		if (state->family == LSH_FAMILY_COSINE){
+			/* random hyperplanes with normally distributed components (Box-Muller) */
+			state->hyperplanes = (float8 *) (((char *) state) + MAXALIGN(sizeof(StateOptions)));
+
+			for (i = 0; i < state->nTables * state->nBits * state->dimensions; i++){
+				float8 u1 = MAX(pg_erand48(xseed), 1e-300);
+				float8 u2 = pg_erand48(xseed);
+
+				state->hyperplanes[i] = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+			}
+		}
+		else if (state->dimensions > 0){
+			/* sampled dimensions */
+			state->samples = (int32 *) (((char *) state) + MAXALIGN(sizeof(StateOptions)));
+
+			for (i = 0; i < state->nTables * state->nBits; i++){
+				state->samples[i] = MIN((int32) (pg_erand48(xseed) * state->dimensions), state->dimensions - 1);
+			}
+		}
+
+		index->rd_amcache = (void*)state;
+	}
+
+	return state;
+}
+
+/*
+ * sets the dimensionality of the index when the first tuple is inserted
+ */
+static StateOptions*
+setDimensions(Relation index, int32 dimensions)
+{
+	Buffer			buffer;
+	MetaPageData	*meta;
+
+	buffer = ReadBuffer(index, LSH_METAPAGE_BLKNO);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+	meta = GetMeta(BufferGetPage(buffer));
+
+	if (meta->dimensions == 0){
+		START_CRIT_SECTION();
+		meta->dimensions = dimensions;
+		MarkBufferDirty(buffer);
+		END_CRIT_SECTION();
+	}
+
+	UnlockReleaseBuffer(buffer);
+
+	return getState(index);
+}
+
+/*
+ * hashes a feature into all tables of the index
+ */
+static void
+insertTuple(Relation index, Datum *values, bool *isnull, ItemPointer heapPtr)
+{
+	StateOptions	*state = getState(index);
+	float8			*f;
+	int32			dimensions;
+	int				table;
+
+	if (isnull[0]){
+		/* nulls are never returned for the === operator */
+		return;
+	}
+
+	f = getFeatureValues(values[0], &dimensions);
+
+	if (state->dimensions == 0){
+		state = setDimensions(index, dimensions);
+	}
+
+	/* bit sampling samples bits, other values would share the bit of 1 */
+	if (state->family == LSH_FAMILY_HAMMING){
+		int32 dim;
+
+		for (dim = 0; dim < dimensions; dim++){
+			if (f[dim] != 0 && f[dim] != 1){
+				ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					errmsg("LSH index \"%s\" with family hamming only supports binary features",
+						RelationGetRelationName(index)),
+					errdetail("Dimension %d has value %g.", dim + 1, f[dim]),
+					errhint("Use the family cosine or a VA index for other features.")));
+			}
+		}
+	}
+
+	if (dimensions != state->dimensions){
+		ereport(ERROR,
+			(errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+			errmsg("feature has %d dimensions, but LSH index \"%s\" has %d dimensions",
+				dimensions, RelationGetRelationName(index), state->dimensions),
+			errhint("All features in an LSH index must have the same number of dimensions.")));
+	}
+
+	for (table = 0; table < state->nTables; table++){
+		addToBucket(index, state, table, hashFeature(state, table, f, NULL), heapPtr);
+	}
+}
+
+/*
+ * callback function after building index
+ */
+static void
+buildCallback(Relation index, HeapTuple htup, Datum *values,
+bool *isnull, bool tupleIsAlive, void *state)
+{
+	BuildState	*buildstate = (BuildState*)state;
+	MemoryContext	oldCtx;
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	insertTuple(index, values, isnull, &htup->t_self);
+
+	if (!isnull[0]){
+		buildstate->indtuples += 1;
+	}
+
+	CHECK_FOR_INTERRUPTS();
+
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextReset(buildstate->tmpCtx);
+}
+
+/*
+ * adds an entry to the head page of the bucket; if the head page is full,
+ * a new head page is prepended to the chain of the bucket
+ */
+static void
+addToBucket(Relation index, StateOptions *state, int table, uint32 code, ItemPointer heapPtr)
+{
+	uint32			bucket = table * state->nBuckets + code % state->nBuckets;
+	BlockNumber		dirBlkno = LSH_DIRECTORY_BLKNO + bucket / DirectoryEntriesPerPage;
+	int				dirSlot = bucket % DirectoryEntriesPerPage;
+
+	Buffer			dirBuffer;
+	Buffer			buffer = InvalidBuffer;
+	BlockNumber		head;
+	Page			page;
+	Tuple			*itup;
+
+	/* the directory page is locked while changing the chain */
+	dirBuffer = ReadBuffer(index, dirBlkno);
+	LockBuffer(dirBuffer, BUFFER_LOCK_EXCLUSIVE);
+
+	head = getDirectory(BufferGetPage(dirBuffer))[dirSlot];
+
+	if (head != InvalidBlockNumber){
+		buffer = ReadBuffer(index, head);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+		if (GetFreePageSpace(BufferGetPage(buffer)) < sizeof(Tuple)){
+			UnlockReleaseBuffer(buffer);
+			buffer = InvalidBuffer;
+		}
+	}
+
+	if (buffer == InvalidBuffer){
+		buffer = newBuffer(index);
+
+		START_CRIT_SECTION();
+		initBuffer(buffer, LSH_BUCKET, table);
+		getOpaque(BufferGetPage(buffer))->next = head;
+		getDirectory(BufferGetPage(dirBuffer))[dirSlot] = BufferGetBlockNumber(buffer);
+		MarkBufferDirty(dirBuffer);
+		END_CRIT_SECTION();
+	}
+
+	page = BufferGetPage(buffer);
+
+	START_CRIT_SECTION();
+	itup = getData(page) + getMaxOffset(page);
+	itup->code = code;
+	itup->heapPtr = *heapPtr;
+	getOpaque(page)->maxoff++;
+	MarkBufferDirty(buffer);
+	END_CRIT_SECTION();
+
+	UnlockReleaseBuffer(buffer);
+	UnlockReleaseBuffer(dirBuffer);
+}
+
+/*
+ * checks whether the hash family of the index matches the distance of the
+ * query: random hyperplanes for the cosine distance, bit sampling for the
+ * Hamming distance; all other distances would get wrong neighbours
+ */
+static bool
+lshSupportsDistance(LSHFamily family, AdamScanClause *adamOptions)
+{
+	if (adamOptions->nn_weights){
+		return false;
+	}
+
+	switch (family){
+		case LSH_FAMILY_COSINE:
+			return adamOptions->nn_distance == ADAM_DISTANCE_COSINE;
+		case LSH_FAMILY_HAMMING:
+			return adamOptions->nn_distance == ADAM_DISTANCE_HAMMING;
+		default:
+			return false;
+	}
+}
+
+/*
+ * adds all entries of the bucket with the given code to the bitmap; if allCodes
+ * is set, code denotes the bucket and all entries in the bucket are added
+ */
+static int64
+scanBucket(Relation index, StateOptions *state, int table, uint32 code, bool allCodes, TIDBitmap *tbm)
+{
+	uint32			bucket = table * state->nBuckets + code % state->nBuckets;
+	BlockNumber		blkno;
+	Buffer			buffer;
+	int64			ntids = 0;
+
+	buffer = ReadBuffer(index, LSH_DIRECTORY_BLKNO + bucket / DirectoryEntriesPerPage);
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	blkno = getDirectory(BufferGetPage(buffer))[bucket % DirectoryEntriesPerPage];
+	UnlockReleaseBuffer(buffer);
+
+	while (blkno != InvalidBlockNumber){
+		Page	page;
+		Tuple	*itup;
+		Tuple	*itupEnd;
+
+		buffer = ReadBuffer(index, blkno);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buffer);
+
+		itup = getData(page);
+		itupEnd = itup + getMaxOffset(page);
+
+		for (; itup < itupEnd; itup++){
+			if (allCodes || itup->code == code){
+				tbm_add_tuples(tbm, &itup->heapPtr, 1, false);
+				ntids++;
+			}
+		}
+
+		blkno = getOpaque(page)->next;
+		UnlockReleaseBuffer(buffer);
+	}
+
+	return ntids;
+}
+
+/*
+ * Allocate a new page (either by recycling, or by extending the index file)
+ * The returned buffer is already pinned and exclusive-locked
+ * Caller is responsible for initializing the page by calling initBuffer
+ *
+ * see newBuffer of VA-file
+ */
+static Buffer
+newBuffer(Relation index)
+{
+	Buffer      buffer;
+	bool        needLock;
+
+	/* First, try to get a page from FSM */
+	for (;;){
+		BlockNumber blkno = GetFreeIndexPage(index);
+
+		if (blkno == InvalidBlockNumber)
+			break;
+
+		buffer = ReadBuffer(index, blkno);
+
+		if (ConditionalLockBuffer(buffer)){
+			Page        page = BufferGetPage(buffer);
+
+			if (PageIsNew(page))
+				return buffer;  /* OK to use, if never initialized */
+
+			LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+		}
+
+		/* Can't use it, so release buffer and try again */
+		ReleaseBuffer(buffer);
+	}
+
+	/* Must extend the file */
+	needLock = !RELATION_IS_LOCAL(index);
+	if (needLock)
+		LockRelation(index, ExclusiveLock);
+
+	buffer = ReadBuffer(index, P_NEW);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+	if (needLock)
+		UnlockRelation(index, ExclusiveLock);
+
+	return buffer;
+}
+
+/*
+ * initializes the buffer
+ */
+static void
+initBuffer(Buffer b, uint16 f, uint16 table)
+{
+	initPage(BufferGetPage(b), f, table, BufferGetPageSize(b));
+}
+
+/*
+ * initializes the content of a page
+ */
+static void
+initPage(Page page, uint16 f, uint16 table, Size pageSize)
+{
+	Opaque opaque;
+
+	PageInit(page, pageSize, sizeof(OpaqueData));
+
+	opaque = getOpaque(page);
+	memset(opaque, 0, sizeof(OpaqueData));
+	opaque->maxoff = 0;
+	opaque->flags = f;
+	opaque->table = table;
+	opaque->next = InvalidBlockNumber;
+}
+
+/*
+ * initializes the meta page of an index with the given number of buckets
+ * per table
+ */
+static void
+initMetaPage(Page page, LSHOptions *opts, uint32 nBuckets)
+{
+	MetaPageData	*meta;
+	char			*family = NULL;
+
+	initPage(page, LSH_META, 0, BLCKSZ);
+	meta = GetMeta(page);
+	memset(meta, 0, sizeof(MetaPageData));
+
+	meta->magickNumber = LSH_MAGICK_NUMBER;
+	meta->seed = (uint32) random();
+	meta->family = LSH_FAMILY_COSINE;
+	meta->nTables = LSH_DEFAULT_TABLES;
+	meta->nBits = LSH_DEFAULT_BITS;
+
+	if (opts){
+		family = GET_STRING_RELOPTION(opts, familyOffset);
+
+		if (family && pg_strcasecmp(family, "hamming") == 0){
+			meta->family = LSH_FAMILY_HAMMING;
+		}
+
+		meta->nTables = opts->nTables;
+		meta->nBits = opts->nBits;
+	}
+
+	meta->nBuckets = nBuckets;
+	meta->nDirectoryPages = (meta->nTables * nBuckets + DirectoryEntriesPerPage - 1) / DirectoryEntriesPerPage;
+	meta->dimensions = 0;
+}
+
+/*
+ * initializes a directory page, all buckets are empty
+ */
+static void
+initDirectoryPage(Page page)
+{
+	initPage(page, LSH_DIRECTORY, 0, BLCKSZ);
+	memset(getDirectory(page), 0xFF, DirectoryEntriesPerPage * sizeof(BlockNumber));
+}
+
+/*
+ * returns the number of buckets per table for a relation of the given size,
+ * such that a bucket fills about half a page
+ */
+static uint32
+getNumberOfBuckets(double tuples, int nBits)
+{
+	uint32		nBuckets = 1;
+
+	while (nBuckets < LSH_MAX_BUCKETS && nBuckets < tuples / (TuplesPerPage / 2)){
+		nBuckets <<= 1;
+	}
+
+	/* there is no sense in having more buckets than codes */
+	if (nBits < 32){
+		nBuckets = MIN(nBuckets, ((uint32) 1) << nBits);
+	}
+
+	return nBuckets;
+}
+
+/*
+ * returns the reloptions of the index from the catalog (see getRelopts of
+ * the VA file), NULL if the index has been built without options
+ */
+static LSHOptions*
+getRelopts(Oid indexOid)
+{
+	HeapTuple	tuple;
+	Datum		reloptions;
+	bool		isnull;
+	LSHOptions	*opts = NULL;
+
+	tuple = SearchSysCache1(RELOID, ObjectIdGetDatum(indexOid));
+	if (!HeapTupleIsValid(tuple)){
+		elog(ERROR, "cache lookup failed for index %u", indexOid);
+	}
+
+	reloptions = SysCacheGetAttr(RELOID, tuple, Anum_pg_class_reloptions, &isnull);
+	if (!isnull){
+		opts = (LSHOptions *) index_reloptions(LSHOPTIONS, reloptions, false);
+	}
+
+	ReleaseSysCache(tuple);
+
+	return opts;
+}
+
+
+
+/*
+ * returns the values of a feature
+ */
+static float8*
+getFeatureValues(Datum d, int32 *dimensions)
+{
+	feature *f = featureToFloat8((feature *)PG_DETOAST_DATUM(d));
+
+	if (ARR_HASNULL(&f->data)){
+		ereport(ERROR,
+			(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			errmsg("LSH indexing is not supported for features containing null values")));
+	}
+
+	*dimensions = ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data));
+
+	return (float8 *)ARR_DATA_PTR(&f->data);
+}
+
+/*
+ * computes the hash code of a feature in the given table; if margins is given,
+ * it is filled with the confidence of every bit (the smaller, the more likely
+ * a near neighbour falls on the other side)
+ */
+static uint32
+hashFeature(StateOptions *state, int table, float8 *values, float8 *margins)
+{
+	uint32	code = 0;
+	int		bit;
+	int		dim;
+
+	for (bit = 0; bit < state->nBits; bit++){
+		bool	set;
+
+		if (state->family == LSH_FAMILY_COSINE){
+			float8	*h = &state->hyperplanes[(table * state->nBits + bit) * state->dimensions];
+			float8	dot = 0;
+
+			for (dim = 0; dim < state->dimensions; dim++){
+				dot += h[dim] * values[dim];
+			}
+
+			set = (dot >= 0);
+
+			if (margins){
+				margins[bit] = fabs(dot);
+			}
+		}
+		else {
+			set = (values[state->samples[table * state->nBits + bit]] != 0);
+
+			/* all bits are equally likely to flip */
+			if (margins){
+				margins[bit] = 0;
+			}
+		}
+
+		if (set){
+			code |= ((uint32) 1) << bit;
+		}
+	}
+
+	return code;
+}
+
+/*
+ * sorts the bits by increasing margin, i.e. determines the order in which
+ * bits are flipped for multi-probing (Lv et al., 2007, Section 4.2)
+ */
+static void
+getProbeOrder(StateOptions *state, float8 *margins, int *order)
+{
+	int i, j;
+
+	/* insertion sort, there are at most 32 bits */
+	for (i = 0; i < state->nBits; i++){
+		int bit = i;
+
+		for (j = i; j > 0 && margins[order[j - 1]] > margins[bit]; j--){
+			order[j] = order[j - 1];
+		}
+
+		order[j] = bit;
+	}
+}
@@ -13,12 +13,22 @@
 * 
 * 
 *
+* addendum:
+* the values of each dimension are fed into a mergeable quantile sketch (in the
+* style of Karnin, Lang and Liberty, 2016): a hierarchy of compactors, where a
+* full compactor is sorted and every other of its values is moved to the next
+* level with twice the weight; the memory needed per dimension is about
+* 3 * MARKS_SKETCH_K values, independent of the number of rows; thus, the marks
+* may be built from a large sample or from all rows of the table (see
+* va_marks_sample_size)
+*
 */
 #include "postgres.h"
 
 #include "utils/adam_index_marks.h"
 
 #include "utils/adam_data_feature.h"
+#include "utils/adam_index_projection.h"
 
 #include <math.h>
 #include "access/heapam.h"
@@ -28,6 +38,7 @@
 #include "catalog/pg_type.h"
 #include "executor/executor.h"
 #include "commands/vacuum.h"
+#include "miscadmin.h"
 #include "nodes/execnodes.h"
 #include "parser/parse_node.h"
 #include "utils/array.h"
@@ -41,74 +52,84 @@
 
 #define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
 
-//equidistant funcs
-static Datum equiDistantMarks(Relation rel, IndexInfo *indexInfo);
-static void getEquidistantMarks(int dimensions, feature *min, feature *max, Datum **marks);
-
-//equifrequent funcs
-static Datum equiFrequentMarks(Relation rel, IndexInfo *indexInfo);
-static void getEquifrequentMarks(int numRowsUsed, int dimensions, feature *min, feature *max, int *frequencies, Datum **marks);
-static void getFrequencies(HeapTuple *rows, double numRows,  TupleTableSlot *slot, IndexInfo *indexInfo, List *predicate, EState *estate, 
-	ExprContext *econtext, int dimensions, 	feature *min, feature *max,	int **frequencies, int* data_ctr);
+//capacity of the top compactor of the quantile sketches
+#define MARKS_SKETCH_K			256
+#define MARKS_SKETCH_LEVELS		64
 
-//min-max-funcs
-static void getMinMax(HeapTuple *rows, double numRows, TupleTableSlot *slot, IndexInfo *indexInfo, List *predicate, EState *estate, ExprContext *econtext,
-	feature **min, feature **max, int *data_ctr);
-static Datum getMinMaxResult(FunctionCallInfoData *infoData, Datum trans_result, bool firstRun, feature *f);
+int va_marks_sample_size = N_SAMPLES;
 
-static void getSampledRows(Relation rel, HeapTuple **rows, double *totalRowsReturned);
+/*
+* quantile sketch of one dimension; the values of level h have weight 2^h
+*/
+typedef struct QuantileSketch {
+	float8	   *levels[MARKS_SKETCH_LEVELS];
+	int			sizes[MARKS_SKETCH_LEVELS];
+	int			allocated[MARKS_SKETCH_LEVELS];
+	int			capacities[MARKS_SKETCH_LEVELS];
+	bool		odd[MARKS_SKETCH_LEVELS];	//alternates the values kept when compacting
+	int			numLevels;
+	float8		min;
+	float8		max;
+} QuantileSketch;
+
+typedef struct WeightedValue {
+	float8		value;
+	double		weight;
+} WeightedValue;
+
+typedef struct MarksBuildState {
+	int				dimensions;		//-1 as long as no feature has been seen
+	bool			quantiles;		//false if only min and max are needed
+	QuantileSketch *sketches;
+	double			nrows;
+	MemoryContext	tmpCtx;
+	VAProjection	projectionMethod;
+	int				components;
+	ArrayType	   *projection;		//the features are projected before they are added (if not NULL)
+} MarksBuildState;
+
+//marks funcs
+static void getEquidistantMarks(MarksBuildState *state, Datum **marks);
+static void getEquifrequentMarks(MarksBuildState *state, Datum **marks);
+
+//data funcs
+static void addSampledRows(Relation rel, IndexInfo *indexInfo, MarksBuildState *state, bool addRows);
+static void learnProjection(MarksBuildState *state, HeapTuple *rows, int nrows, IndexInfo *indexInfo, TupleTableSlot *slot, EState *estate, List *predicate);
+static void marksBuildCallback(Relation index, HeapTuple htup, Datum *values, bool *isnull, bool tupleIsAlive, void *state);
+static void addFeature(MarksBuildState *state, Datum value);
+
+//sketch funcs
+static void sketchInit(QuantileSketch *sketch);
+static void sketchInsert(QuantileSketch *sketch, float8 value);
+static void sketchAppend(QuantileSketch *sketch, int level, float8 value);
+static void sketchCompress(QuantileSketch *sketch);
+static void sketchSetCapacities(QuantileSketch *sketch);
+static void sketchQuantiles(QuantileSketch *sketch, int n, float8 *result);
+static int compareFloat8(const void *a, const void *b);
+static int compareWeightedValues(const void *a, const void *b);
 
 /*
 * calculates the marks given a relation and a indexInfo struct;
 * the choice which strategy is chosen to calculate the marks depends on the entry in ii_MarksStrategy
 * (see parsenodes.h for all options)
-*/
-Datum
-	calculateMarks(Relation rel, IndexInfo *indexInfo)
-{
-	switch(indexInfo->ii_MarksStrategy){
-	case VA_MARKS_EQUIDISTANT:
-		return equiDistantMarks(rel, indexInfo);
-	case VA_MARKS_EQUIFREQUENT:
-	default:
-		return equiFrequentMarks(rel, indexInfo);
-	}
-
-	return BoolGetDatum(false);
-}
-
-/*
-* even distribution of marks
-* this only works for uniformly distributed data! with skewed data, a great portion of the data points will
-* fall into the same slice; hence, a lot of points will have the same approximation and, thus, the filtering
-* will not be as efficient
 *
-* (Weber, 2000, Section 5.2.2)
+* the rows are either sampled (va_marks_sample_size rows) or, if va_marks_sample_size
+* is 0, all rows of the table are read
+*
+* with a projection (see adam_index_projection.c), the projection is learned from
+* the sampled rows and returned in projection; the marks are those of the projected
+* features
 */
-static Datum 
-	equiDistantMarks(Relation rel, IndexInfo *indexInfo)
+Datum
+	calculateMarks(Relation heap, Relation index, IndexInfo *indexInfo, VAProjection projectionMethod, int components, ArrayType **projection)
 {
-	TupleTableSlot *slot;
-	EState *estate;
-	ExprContext *econtext;
-	List       *predicate;
-
-	int dimensions;
-
-	feature *min, *max;
-	Datum *marks;
+	MarksBuildState state;
 
-	ArrayType *arr_marks;
+	Datum	   *marks;
+	ArrayType  *arr_marks;
 
-	HeapTuple *rows;
-	double totalRows;
-	int data_ctr;
-
-	int		arr_dims[2] = {-1, MAX_MARKS};
-	int		arr_lbs[2]  = {0, 0};
-    
-    int dim1;
-    int dim2;
+	int			arr_dims[2] = {-1, MAX_MARKS};
+	int			arr_lbs[2]  = {0, 0};
 
 	MemoryContext old_ctx;
 	MemoryContext ctx;
@@ -118,144 +139,151 @@ static Datum
 		ALLOCSET_DEFAULT_MINSIZE, ALLOCSET_DEFAULT_INITSIZE, ALLOCSET_DEFAULT_MAXSIZE);
 	old_ctx = MemoryContextSwitchTo(ctx);
 
-	slot = MakeSingleTupleTableSlot(RelationGetDescr(rel));
-
-	estate = CreateExecutorState();
-	econtext = GetPerTupleExprContext(estate);
-	econtext->ecxt_scantuple = slot;
-	predicate = (List *) ExecPrepareExpr((Expr *) indexInfo->ii_Predicate, estate);
+	state.dimensions = -1;
+	state.quantiles = (indexInfo->ii_MarksStrategy != VA_MARKS_EQUIDISTANT);
+	state.sketches = NULL;
+	state.nrows = 0;
+	state.tmpCtx = AllocSetContextCreate(ctx, "Marks build tuple context",
+		ALLOCSET_DEFAULT_MINSIZE, ALLOCSET_DEFAULT_INITSIZE, ALLOCSET_DEFAULT_MAXSIZE);
+	state.projectionMethod = projectionMethod;
+	state.components = components;
+	state.projection = NULL;
 
-	getSampledRows(rel, &rows, &totalRows);
+	if(va_marks_sample_size > 0){
+		addSampledRows(heap, indexInfo, &state, true);
+	} else {
+		//the projection is learned from a sample nevertheless
+		if(projectionMethod != VA_PROJECTION_NONE){
+			addSampledRows(heap, indexInfo, &state, false);
+		}
 
-	//get min/max values for each dimension
-	getMinMax(rows, totalRows, slot, indexInfo, predicate, estate, econtext, &min, &max, &data_ctr);
+		IndexBuildHeapScan(heap, index, indexInfo, true, marksBuildCallback, (void *) &state);
+	}
 
-	//now we know what the minimum number of dimensions is
-    dim1 = ArrayGetNItems(ARR_NDIM(&min->data), ARR_DIMS(&min->data));
-    dim2 = ArrayGetNItems(ARR_NDIM(&max->data), ARR_DIMS(&max->data));
+	if(state.nrows == 0){
+		ereport(ERROR, (errmsg("not enough sample data for VA indexing available")));
+	}
 
-	dimensions = MIN(dim1, dim2);
-	arr_dims[0] = dimensions;
+	arr_dims[0] = state.dimensions;
 
-	//using the min/max values get the marks
-	getEquidistantMarks(dimensions, min, max, &marks);
+	switch(indexInfo->ii_MarksStrategy){
+	case VA_MARKS_EQUIDISTANT:
+		getEquidistantMarks(&state, &marks);
+		break;
+	case VA_MARKS_EQUIFREQUENT:
+	default:
+		getEquifrequentMarks(&state, &marks);
+		break;
+	}
 
-	//these may have been pointing to the now-gone estate
-	indexInfo->ii_ExpressionsState = NIL;
-	indexInfo->ii_PredicateState = NIL;
-	
-	ExecDropSingleTupleTableSlot(slot);
-	FreeExecutorState(estate);
 	MemoryContextSwitchTo(old_ctx);
 
 	//create array out of Datum*
 	arr_marks = construct_md_array(marks, NULL, 2, arr_dims, arr_lbs, FLOAT8OID, sizeof(float8), FLOAT8PASSBYVAL, 'd');
 
-	MemoryContextResetAndDeleteChildren(ctx);
+	if(projection){
+		*projection = NULL;
+
+		if(state.projection){
+			*projection = (ArrayType *) palloc(VARSIZE(state.projection));
+			memcpy(*projection, state.projection, VARSIZE(state.projection));
+		}
+	}
+
 	MemoryContextDelete(ctx);
 
 	PG_RETURN_ARRAYTYPE_P(arr_marks);
 }
 
-
+/*
+* even distribution of marks
+* this only works for uniformly distributed data! with skewed data, a great portion of the data points will
+* fall into the same slice; hence, a lot of points will have the same approximation and, thus, the filtering
+* will not be as efficient
+*
+* (Weber, 2000, Section 5.2.2)
+*/
 static void 
-	getEquidistantMarks(int dimensions, feature *min, feature *max, Datum **marks)
+	getEquidistantMarks(MarksBuildState *state, Datum **marks)
 {
-	ArrayIterator min_it = array_create_iterator(&min->data, 0);
-	Datum		min_val;
-	bool		min_isnull;
-
-	ArrayIterator max_it = array_create_iterator(&max->data, 0);
-	Datum		max_val;
-	bool		max_isnull;
-
-	Datum		scale_precision_dat;
-	Datum		truncate_dat;
-
 	int			dim_ctr = 0;
 	int			mark_ctr = 0;
 
-	Datum max_sub_min;
-	Datum mark_ctr_dat;
-	Datum partitions_dat = DirectFunctionCall1(i4tod, Int32GetDatum(MAX_PARTITIONS));
+	Datum *result = palloc(sizeof(Datum) * state->dimensions * MAX_MARKS);
 
-	Datum *result;
-	
-	scale_precision_dat = Int32GetDatum(NUM_SCALE_PRECISION);
-	truncate_dat = Int32GetDatum(NUM_TRUNCATE);
-    
-	result = palloc(sizeof(Datum) * dimensions * MAX_MARKS);
-	
-	while(array_iterate(min_it, &min_val, &min_isnull) && array_iterate(max_it, &max_val, &max_isnull)){
-		result[dim_ctr * MAX_MARKS + 0] = min_val;
-		result[dim_ctr * MAX_MARKS + MAX_PARTITIONS] = max_val;
+	for(dim_ctr = 0; dim_ctr < state->dimensions; dim_ctr++){
+		float8 min_val = state->sketches[dim_ctr].min;
+		float8 max_val = state->sketches[dim_ctr].max;
 
-		max_sub_min = DirectFunctionCall2(float8mi, max_val, min_val);
+		result[dim_ctr * MAX_MARKS + 0] = Float8GetDatum(min_val);
+		result[dim_ctr * MAX_MARKS + MAX_PARTITIONS] = Float8GetDatum(max_val);
 
 		for(mark_ctr = 1; mark_ctr < MAX_PARTITIONS; mark_ctr++){
-			mark_ctr_dat = DirectFunctionCall1(i4tod, Int32GetDatum(mark_ctr));
-
 			result[dim_ctr * MAX_MARKS + mark_ctr] = 
-				DirectFunctionCall2(float8pl,
-				min_val,
-				DirectFunctionCall2(float8mul,
-				max_sub_min,
-				DirectFunctionCall2(float8div, mark_ctr_dat, partitions_dat)));
+				Float8GetDatum(min_val + (max_val - min_val) * ((float8) mark_ctr / (float8) MAX_PARTITIONS));
 		}
-
-		dim_ctr++;
 	}
 
-	array_free_iterator(min_it);
-	array_free_iterator(max_it);
-
 	*marks = result;
 }
 
+/*
+* distribution aware marks
+* partitioning points are chosen such that each slice contains about the same number of points,
+* i.e. the marks are the quantiles of the values of each dimension
+*
+* (Weber, 2000, Section 5.2.2)
+*/
+static void 
+	getEquifrequentMarks(MarksBuildState *state, Datum **marks)
+{
+	int			dim_ctr = 0;
+	int			mark_ctr = 0;
+
+	float8		quantiles[MAX_MARKS];
+
+	Datum *result = palloc(sizeof(Datum) * state->dimensions * MAX_MARKS);
+
+	for(dim_ctr = 0; dim_ctr < state->dimensions; dim_ctr++){
+		QuantileSketch *sketch = &state->sketches[dim_ctr];
 
+		sketchQuantiles(sketch, MAX_PARTITIONS, quantiles);
+
+		result[dim_ctr * MAX_MARKS + 0] = Float8GetDatum(sketch->min);
+		result[dim_ctr * MAX_MARKS + MAX_PARTITIONS] = Float8GetDatum(sketch->max);
+
+		for(mark_ctr = 1; mark_ctr < MAX_PARTITIONS; mark_ctr++){
+			result[dim_ctr * MAX_MARKS + mark_ctr] = Float8GetDatum(quantiles[mark_ctr]);
+		}
+	}
 
+	*marks = result;
+}
 
 
 /*
-* distribution aware marks
-* partitioning poitns are chosen such that each slice contains about the same number of points
-*
-* (Weber, 2000, Section 5.2.2)
+* adds va_marks_sample_size sampled rows to the sketches (if addRows) after learning
+* the projection from them
 */
-static Datum 
-	equiFrequentMarks(Relation rel, IndexInfo *indexInfo)
+static void 
+	addSampledRows(Relation rel, IndexInfo *indexInfo, MarksBuildState *state, bool addRows)
 {
 	TupleTableSlot *slot;
 	EState *estate;
 	ExprContext *econtext;
 	List	   *predicate;
 
-	int dimensions;
-
-	feature *min, *max;
-	int *frequencies;
-	Datum *marks;
-
-	ArrayType *arr_marks;
-		
 	HeapTuple *rows;
-	double totalRows = 0;
-	int data_ctr1 = 0;
-	int data_ctr2 = 0;
+	double returnedRows;
+	int sampleSize;
 
-	int		arr_dims[2] = {-1, MAX_MARKS};
-	int		arr_lbs[2] = {0, 0};
-    
-    int     dim1;
-    int     dim2;
+	double totRows;			//total in relation (unimportant here)
+	double totDeadRows;		//total in relation (unimportant here)
 
-	MemoryContext old_ctx;
-	MemoryContext ctx;
+	Datum		f_value;
+	bool		f_isnull;
 
-	//switch memory context
-	ctx = AllocSetContextCreate(CurrentMemoryContext, "Marks build temporary context",
-		ALLOCSET_DEFAULT_MINSIZE, ALLOCSET_DEFAULT_INITSIZE, ALLOCSET_DEFAULT_MAXSIZE);
-	old_ctx = MemoryContextSwitchTo(ctx);
+	int i = 0;
 
 	slot = MakeSingleTupleTableSlot(RelationGetDescr(rel));
 
@@ -266,22 +294,37 @@ static Datum
 	predicate = (List *) ExecPrepareExpr((Expr *) indexInfo->ii_Predicate, estate);
 
 	//retrieve sample data
-	getSampledRows(rel, &rows, &totalRows);
+	sampleSize = (va_marks_sample_size > 0) ? va_marks_sample_size : N_SAMPLES;
+	rows = palloc(sizeof(HeapTuple) * sampleSize);
+	returnedRows = acquire_sample_rows_outside_analyze(rel, DEBUG1, rows, sampleSize, &totRows, &totDeadRows);
+	
+	if(returnedRows < MIN_SAMPLES){
+		ereport(ERROR,
+		(errcode(ERRCODE_INTERNAL_ERROR),
+		errmsg("too few sample data to create marks")));
+	}
 
-	//get min/max values for each dimension
-	getMinMax(rows, totalRows, slot, indexInfo, predicate, estate, econtext, &min, &max, &data_ctr1);
+	if(state->projectionMethod != VA_PROJECTION_NONE){
+		learnProjection(state, rows, returnedRows, indexInfo, slot, estate, predicate);
+	}
 
-	//now we know what the minimum number of dimensions is
-    dim1 = ArrayGetNItems(ARR_NDIM(&min->data), ARR_DIMS(&min->data));
-    dim2 = ArrayGetNItems(ARR_NDIM(&max->data), ARR_DIMS(&max->data));
-	dimensions = MIN(dim1, dim2);
-	arr_dims[0] = dimensions;
+	for(i = 0; addRows && i < returnedRows; i++){
+		ResetExprContext(econtext);
+		ExecStoreTuple(rows[i], slot, InvalidBuffer, false);
 
-	//calculate the frequencies using the min and max values
-	getFrequencies(rows, totalRows, slot, indexInfo, predicate, estate, econtext, dimensions, min, max, &frequencies, &data_ctr2);
-	
-	//using the frequencies and min/max values get the marks
-	getEquifrequentMarks(data_ctr1, dimensions, min, max, frequencies, &marks);
+		if (predicate != NIL){
+			if (!ExecQual(predicate, econtext, false))
+				continue;
+		}
+
+		FormIndexDatum(indexInfo, slot, estate, &f_value, &f_isnull);
+
+		if(!f_isnull){
+			addFeature(state, f_value);
+		}
+	}
+
+	pfree(rows);
 
 	//these may have been pointing to the now-gone estate
 	indexInfo->ii_ExpressionsState = NIL;
@@ -289,58 +332,36 @@ static Datum
 
 	ExecDropSingleTupleTableSlot(slot);
 	FreeExecutorState(estate);
-	MemoryContextSwitchTo(old_ctx);
-		
-	//create array out of Datum*
-	arr_marks = construct_md_array(marks, NULL, 2, arr_dims, arr_lbs, FLOAT8OID, sizeof(float8), FLOAT8PASSBYVAL, 'd');
-
-	MemoryContextDelete(ctx);
-
-	PG_RETURN_ARRAYTYPE_P(arr_marks);
 }
 
-
 /*
-* returns the frequency array
+* learns the projection from (at most VA_PROJECTION_SAMPLES of) the sampled rows;
+* the features are kept in memory, thus their number is also limited by
+* maintenance_work_mem
 */
-static void 
-	getFrequencies(HeapTuple *rows, double numRows, 
-	TupleTableSlot *slot, IndexInfo *indexInfo, List *predicate, EState *estate, ExprContext *econtext, 
-	int dimensions, feature *min, feature *max,	int **frequencies, int *data_ctr)
+static void
+	learnProjection(MarksBuildState *state, HeapTuple *rows, int nrows, IndexInfo *indexInfo, TupleTableSlot *slot, EState *estate, List *predicate)
 {
-	Datum			f_value;
-	bool			f_isnull;
-
-	ArrayIterator	min_it;
-	Datum			min_val;
-	bool			min_isnull;
-
-	ArrayIterator	max_it;
-	Datum			max_val;
-	bool			max_isnull;
-
-	ArrayIterator	dim_it;
-	Datum			dim_val;
-	bool			dim_isnull;
-
-	int				dim_ctr = 0;
-	int				cell = 0;
-	Datum			cell_dat;
-
-	int				i = 0;
-
-	Datum nfreq_dat = DirectFunctionCall1(i4tod, Int32GetDatum(SAMPLING_FREQUENCY));
+	ExprContext *econtext = GetPerTupleExprContext(estate);
+	MemoryContext old_ctx;
 
-	int *result = palloc(sizeof(int) * dimensions * SAMPLING_FREQUENCY);
-	memset(result, 0, sizeof(int) * dimensions * SAMPLING_FREQUENCY);
+	float8	   *sample = NULL;
+	int			dimensions = -1;
+	int			maxSamples = VA_PROJECTION_SAMPLES;
+	int			n = 0;
+	int			i;
 
-	/* get samples that are used for equi frequent partitioning */
-	for(i = 0; i < numRows; i++){
-		dim_ctr = 0;
+	Datum		f_value;
+	bool		f_isnull;
 
-		min_it = array_create_iterator(&min->data, 0);
-		max_it = array_create_iterator(&max->data, 0);
+	for(i = 0; i < nrows && n < maxSamples; i++){
+		feature *f;
+		ArrayIterator it;
+		Datum value;
+		bool isnull;
+		int dim = 0;
 
+		ResetExprContext(econtext);
 		ExecStoreTuple(rows[i], slot, InvalidBuffer, false);
 
 		if (predicate != NIL){
@@ -348,242 +369,286 @@ static void
 				continue;
 		}
 
-		FormIndexDatum(indexInfo, slot,  estate, &f_value,  &f_isnull);
+		FormIndexDatum(indexInfo, slot, estate, &f_value, &f_isnull);
 
-		if(!f_isnull){
-			feature *f = (feature *) DatumGetPointer(PG_DETOAST_DATUM(f_value));
-			dim_it = array_create_iterator(&f->data, 0);	
-
-			while(array_iterate(min_it, &min_val, &min_isnull) 
-				&& array_iterate(max_it, &max_val, &max_isnull) 
-				&& array_iterate(dim_it, &dim_val, &dim_isnull)){
-
-				if (isnan(DatumGetFloat8(max_val)) || isnan(DatumGetFloat8(min_val))){
-					ereport(ERROR,
-						(errcode(ERRCODE_INTERNAL_ERROR),
-						errmsg("vector contains NaN")));
-				}
-
-				if (DatumGetFloat8(max_val) - DatumGetFloat8(min_val) == 0){
-					cell = 0;
-				} else {
-					cell_dat = DirectFunctionCall2(float8mul,
-						nfreq_dat,
-						DirectFunctionCall2(float8div,
-						DirectFunctionCall2(float8mi, dim_val, min_val),
-						DirectFunctionCall2(float8mi, max_val, min_val)));
-
-					cell = DatumGetInt32(DirectFunctionCall1(dtoi4, cell_dat));
-				}
-
-                    
-
-					if(cell <   0)					cell = 0;
-					if(cell >= SAMPLING_FREQUENCY)  cell = SAMPLING_FREQUENCY - 1;
-
-					result[dim_ctr * SAMPLING_FREQUENCY + cell]++; 
-					
-					dim_ctr++;
+		if(f_isnull){
+			continue;
+		}
+
+		old_ctx = MemoryContextSwitchTo(state->tmpCtx);
+		f = featureToFloat8((feature *) DatumGetPointer(PG_DETOAST_DATUM(f_value)));
+		MemoryContextSwitchTo(old_ctx);
+
+		//the number of dimensions is the one of the first feature
+		if(dimensions < 0){
+			dimensions = ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data));
+			maxSamples = MIN(maxSamples, Max(maintenance_work_mem * 1024L / (Max(dimensions, 1) * sizeof(float8)), 1));
+			sample = palloc0((Size) maxSamples * Max(dimensions, 1) * sizeof(float8));
+		}
+
+		it = array_create_iterator(&f->data, 0);
+
+		while(dim < dimensions && array_iterate(it, &value, &isnull)){
+			if(!isnull){
+				sample[(Size) n * dimensions + dim] = DatumGetFloat8(value);
 			}
 
-			
-			(*data_ctr)++;
+			dim++;
 		}
+
+		array_free_iterator(it);
+		n++;
+
+		MemoryContextReset(state->tmpCtx);
 	}
 
-	array_free_iterator(min_it);
-	array_free_iterator(max_it);
-	array_free_iterator(dim_it);
+	if(n == 0){
+		ereport(ERROR, (errmsg("not enough sample data for VA indexing available")));
+	}
+
+	state->projection = vaLearnProjection(sample, n, dimensions, state->projectionMethod, state->components);
 
-	*frequencies = result;
+	pfree(sample);
 }
 
 /*
-* given the frequency vector, the min and max values, it calculates the marks
+* per-tuple callback of the scan over all rows of the table
 */
-static void 
-	getEquifrequentMarks(int numRowsUsed, int dimensions, feature *min, feature *max, int *frequencies, Datum **marks)
+static void
+	marksBuildCallback(Relation index, HeapTuple htup, Datum *values, bool *isnull, bool tupleIsAlive, void *state)
 {
-	ArrayIterator min_it = array_create_iterator(&min->data, 0);
-	Datum		min_val;
-	bool		min_isnull;
+	if(!isnull[0]){
+		addFeature((MarksBuildState *) state, values[0]);
+	}
+}
 
-	ArrayIterator max_it = array_create_iterator(&max->data, 0);
-	Datum		max_val;
-	bool		max_isnull;
+/*
+* adds the values of a feature to the sketches; the number of dimensions is the minimum
+* number of dimensions of all features
+*/
+static void
+	addFeature(MarksBuildState *state, Datum value)
+{
+	MemoryContext old_ctx = MemoryContextSwitchTo(state->tmpCtx);
 
-	int dim_ctr = 0;
-	int mark_ctr = 0;
+	feature *f = featureToFloat8((feature *) DatumGetPointer(PG_DETOAST_DATUM(value)));
+	float8 *values;
+	int dimensions;
+	int i;
 
-	int sum = 0;
+	if(state->projection){
+		f = vaProjectFeature(state->projection, f, false);
+	}
 
-	int k = 0;
-	Datum k_dat;
+	values = (float8 *) ARR_DATA_PTR(&f->data);
+	dimensions = ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data));
 
-	Datum nfreq_dat;
-	
-	Datum truncate_dat;
-	Datum scale_precision_dat;
-	
-	Datum *result;
+	MemoryContextSwitchTo(old_ctx);
 
-	scale_precision_dat = Int32GetDatum(NUM_SCALE_PRECISION);
-	truncate_dat = Int32GetDatum(NUM_TRUNCATE);
+	if(state->dimensions < 0){
+		state->dimensions = dimensions;
+		state->sketches = (QuantileSketch *) palloc(dimensions * sizeof(QuantileSketch));
 
-	nfreq_dat = DirectFunctionCall1(i4tod, Int32GetDatum(SAMPLING_FREQUENCY));
-	result = palloc(sizeof(Datum) * dimensions * (MAX_PARTITIONS + 1));
+		for(i = 0; i < dimensions; i++){
+			sketchInit(&state->sketches[i]);
+		}
+	} else {
+		state->dimensions = MIN(state->dimensions, dimensions);
+	}
 
-	while(array_iterate(min_it, &min_val, &min_isnull) && array_iterate(max_it, &max_val, &max_isnull)){
-		sum = 0;
-		k = 0;
-		result[dim_ctr * MAX_MARKS + 0] = min_val;
-		result[dim_ctr * MAX_MARKS + MAX_PARTITIONS] = max_val;
-		for(mark_ctr = 1; mark_ctr < MAX_PARTITIONS; mark_ctr++){
-			int n = (mark_ctr * numRowsUsed) / MAX_PARTITIONS;
-			
-			while(sum < n){
-				sum = sum + frequencies[dim_ctr * SAMPLING_FREQUENCY + k];
-				k++;
-			}
+	for(i = 0; i < state->dimensions; i++){
+		QuantileSketch *sketch = &state->sketches[i];
 
-			k_dat = DirectFunctionCall1(i4tod, Int32GetDatum(k));
-			result[dim_ctr * MAX_MARKS + mark_ctr] = 
-				DirectFunctionCall2(float8pl,
-				min_val,
-				DirectFunctionCall2(float8mul,
-				k_dat,
-				DirectFunctionCall2(float8div,
-				DirectFunctionCall2(float8mi, max_val, min_val),
-				nfreq_dat)));
-        }
-		dim_ctr++;
+		if (isnan(values[i])){
+			ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				errmsg("vector contains NaN")));
+		}
+
+		if(state->nrows == 0 || values[i] < sketch->min){
+			sketch->min = values[i];
+		}
+
+		if(state->nrows == 0 || values[i] > sketch->max){
+			sketch->max = values[i];
+		}
+
+		if(state->quantiles){
+			sketchInsert(sketch, values[i]);
+		}
 	}
-	array_free_iterator(min_it);
-	array_free_iterator(max_it);
 
-	*marks = result;
+	state->nrows++;
+
+	MemoryContextReset(state->tmpCtx);
 }
 
 
-/*
-* returns the minimum value and the maximum value for each dimension of the feature vector
-* see MIN/MAX operation of feature
-*/
 static void
-	getMinMax(HeapTuple *rows, double numRows, 
-	TupleTableSlot *slot, IndexInfo *indexInfo, List *predicate, EState *estate, ExprContext *econtext,
-	feature **min, feature **max, int *data_ctr)
+	sketchInit(QuantileSketch *sketch)
 {
-	FmgrInfo minFunc;
-	FmgrInfo maxFunc;
+	memset(sketch, 0, sizeof(QuantileSketch));
+	sketch->numLevels = 1;
+	sketchSetCapacities(sketch);
+}
 
-	FunctionCallInfoData minInfoData;
-	FunctionCallInfoData maxInfoData;
+static void
+	sketchInsert(QuantileSketch *sketch, float8 value)
+{
+	sketchAppend(sketch, 0, value);
 
-	Datum min_result = PointerGetDatum(NULL);
-	Datum max_result = PointerGetDatum(NULL);
+	if(sketch->sizes[0] >= sketch->capacities[0]){
+		sketchCompress(sketch);
+	}
+}
 
-	bool firstRun = true;
+static void
+	sketchAppend(QuantileSketch *sketch, int level, float8 value)
+{
+	if(sketch->sizes[level] >= sketch->allocated[level]){
+		if(sketch->allocated[level] == 0){
+			sketch->allocated[level] = 16;
+			sketch->levels[level] = (float8 *) palloc(sketch->allocated[level] * sizeof(float8));
+		} else {
+			sketch->allocated[level] *= 2;
+			sketch->levels[level] = (float8 *) repalloc(sketch->levels[level], sketch->allocated[level] * sizeof(float8));
+		}
+	}
 
-	Datum		f_value;
-	bool		f_isnull;
+	sketch->levels[level][sketch->sizes[level]++] = value;
+}
 
-	int i = 0;
+/*
+* the capacity of the levels decreases geometrically (by 2/3) from the top level
+* downwards, but is at least 2
+*/
+static void
+	sketchSetCapacities(QuantileSketch *sketch)
+{
+	int level;
 
-	fmgr_info(FEATURE_MIN, &minFunc);
-	fmgr_info(FEATURE_MAX, &maxFunc);
+	for(level = 0; level < sketch->numLevels; level++){
+		int capacity = (int) ceil(MARKS_SKETCH_K * pow(2.0 / 3.0, sketch->numLevels - level - 1));
 
-	InitFunctionCallInfoData(minInfoData, &minFunc, 2, InvalidOid, NULL, NULL);
-	InitFunctionCallInfoData(maxInfoData, &maxFunc, 2, InvalidOid, NULL, NULL);
+		sketch->capacities[level] = (capacity > 2) ? capacity : 2;
+	}
+}
+
+/*
+* compacts the full levels: the values are sorted and every other value is moved
+* to the next level (alternating between the even and the odd positions for keeping
+* the error unbiased); a value left over of an odd number of values stays on the level
+*/
+static void
+	sketchCompress(QuantileSketch *sketch)
+{
+	int level;
 
-	for(i = 0; i < numRows; i++){
-		HeapTuple	heapTuple = rows[i];
+	for(level = 0; level < sketch->numLevels; level++){
+		float8 *values;
+		int n;
+		int i;
 
-		if(!heapTuple){
+		if(sketch->sizes[level] < sketch->capacities[level]){
 			continue;
 		}
 
-		ResetExprContext(econtext);
-		ExecStoreTuple(heapTuple, slot, InvalidBuffer, false);
+		if(level + 1 == sketch->numLevels){
+			if(sketch->numLevels == MARKS_SKETCH_LEVELS){
+				elog(ERROR, "too many rows for building the marks");
+			}
 
-		if (predicate != NIL){
-			if (!ExecQual(predicate, econtext, false))
-				continue;
+			sketch->numLevels++;
+			sketchSetCapacities(sketch);
 		}
 
-		FormIndexDatum(indexInfo, slot, estate, &f_value, &f_isnull);
+		values = sketch->levels[level];
+		n = sketch->sizes[level];
 
-		if(!f_isnull){
-			feature *f = (feature *) DatumGetPointer(PG_DETOAST_DATUM(f_value));
+		qsort(values, n, sizeof(float8), compareFloat8);
 
-			min_result = getMinMaxResult(&minInfoData, min_result, firstRun, f);
-			max_result = getMinMaxResult(&maxInfoData, max_result, firstRun, f);
+		//an odd number of values leaves out the largest one
+		for(i = sketch->odd[level] ? 1 : 0; i < n - (n % 2); i += 2){
+			sketchAppend(sketch, level + 1, values[i]);
+		}
 
-			(*data_ctr)++;
+		sketch->odd[level] = !sketch->odd[level];
 
-			firstRun = false;
+		if(n % 2 == 1){
+			values[0] = values[n - 1];
+			sketch->sizes[level] = 1;
+		} else {
+			sketch->sizes[level] = 0;
 		}
 	}
-
-	if(!firstRun){
-		min_result = DirectFunctionCall1(feature_minmax_end, min_result);
-		max_result = DirectFunctionCall1(feature_minmax_end, max_result);
-	} else {
-		ereport(ERROR, (errmsg("not enough sample data for VA indexing available")));
-	}
-
-	*min = (feature *) DatumGetPointer(min_result);
-	*max = (feature *) DatumGetPointer(max_result);
 }
 
-
 /*
-* fills the min_max function call array correctly and does function call;
-* returns result of function call
+* computes the n-quantiles of the sketch, i.e. result[i] is the value with rank i / n
+* (for 0 < i < n)
 */
-static Datum 
-	getMinMaxResult(FunctionCallInfoData *infoData, Datum trans_result, bool firstRun, feature *f)
+static void
+	sketchQuantiles(QuantileSketch *sketch, int n, float8 *result)
 {
-	infoData->arg[0] = trans_result;
-	infoData->arg[1] = PointerGetDatum(f);
+	WeightedValue *items;
+	double total = 0;
+	double weight = 0;
+	int nitems = 0;
+	int level, i, j;
+
+	for(level = 0; level < sketch->numLevels; level++){
+		nitems += sketch->sizes[level];
+	}
 
-	if(firstRun){
-		infoData->argnull[0] = true;
-	} else {
-		infoData->argnull[0] = false;
+	items = (WeightedValue *) palloc((nitems + 1) * sizeof(WeightedValue));
+	nitems = 0;
+
+	for(level = 0; level < sketch->numLevels; level++){
+		for(i = 0; i < sketch->sizes[level]; i++){
+			items[nitems].value = sketch->levels[level][i];
+			items[nitems].weight = ldexp(1.0, level);
+			total += items[nitems].weight;
+			nitems++;
+		}
 	}
 
-	infoData->argnull[1] = false;
-	infoData->isnull = false;
+	qsort(items, nitems, sizeof(WeightedValue), compareWeightedValues);
 
-	return FunctionCallInvoke(&*infoData);
-}
+	j = 0;
+	for(i = 1; i < n; i++){
+		double rank = total * i / n;
 
-/*
-* get sampled rows
-*/
-static void 
-	getSampledRows(Relation rel, HeapTuple **rows, double *totalRowsReturned)
-{
-	HeapTuple *results;
-	double returnedRows;
+		while(j < nitems - 1 && weight + items[j].weight < rank){
+			weight += items[j].weight;
+			j++;
+		}
 
-	double totRows;			//total in relation (unimportant here)
-	double totDeadRows;		//total in relation (unimportant here)
+		result[i] = (nitems > 0) ? items[j].value : sketch->min;
 
-	//retrieve sample data
-	results = palloc(sizeof(HeapTuple) * N_SAMPLES);
-	returnedRows = acquire_sample_rows(rel, DEBUG1, results, N_SAMPLES, &totRows, &totDeadRows);
-	
-	if(returnedRows < 256){
-		ereport(ERROR,
-		(errcode(ERRCODE_INTERNAL_ERROR),
-		errmsg("too few sample data to create marks")));
+		//the marks have to be within the range of the values
+		if(result[i] < sketch->min){
+			result[i] = sketch->min;
+		}
+
+		if(result[i] > sketch->max){
+			result[i] = sketch->max;
+		}
 	}
 
-	(*rows) = results;
-	(*totalRowsReturned) = returnedRows;
+	pfree(items);
 }
 
+static int
+	compareFloat8(const void *a, const void *b)
+{
+	float8 x = *((const float8 *) a);
+	float8 y = *((const float8 *) b);
+
+	return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
 
-	
\ No newline at end of file
+static int
+	compareWeightedValues(const void *a, const void *b)
+{
+	return compareFloat8(&((const WeightedValue *) a)->value, &((const WeightedValue *) b)->value);
+}
@@ -0,0 +1,481 @@
+/*
+ * ADAM - index projection
+ * name: adam_index_projection
+ * description: projections reducing the dimensions of the VA approximations
+ *
+ * src/backend/utils/adt/adam_index_projection.c
+ *
+ *
+ *
+ *
+ * addendum: with many dimensions, the bounds of the VA approximations become
+ * loose and hardly any tuple is filtered; with the option vaprojection, the
+ * features are projected onto the first m components (vacomponents) of an
+ * orthonormal basis before they are approximated, i.e. y = V (x - mean), and the
+ * norm of the residual r = |x - mean - V^T y| is approximated as an additional
+ * dimension
+ *
+ * as the projection is orthogonal, |x - q|^2 = |y_x - y_q|^2 + |res_x - res_q|^2
+ * and (r_x - r_q)^2 <= |res_x - res_q|^2 <= (r_x + r_q)^2; thus, the bounds of the
+ * euclidean distance of the projected features (with the residual as last value,
+ * negated for the upper bounds) bound the euclidean distance of the features
+ * (see vaPrecomputeBounds); the exact distances are still calculated on the
+ * features themselves
+ *
+ * the basis is either learned from the rows sampled for the marks (pca: the
+ * principal components, computed by a few iterations of the subspace iteration
+ * followed by a Rayleigh-Ritz step, cf. Halko, Martinsson and Tropp, 2011) or
+ * random (random: an orthonormalized gaussian matrix); it is stored with the
+ * index (pg_index.projection) as an array of m + 1 rows, the mean followed by
+ * the components
+ *
+ */
+#include "postgres.h"
+
+#include "utils/adam_index_projection.h"
+
+#include <math.h>
+
+#include "catalog/pg_type.h"
+#include "miscadmin.h"
+
+#define JACOBI_SWEEPS	50
+
+static float8 *getCenteredValues(feature *f, float8 *mean, int dimensions);
+static void fillGaussian(float8 *v, int n, unsigned short *xseed);
+static void orthonormalize(float8 *v, int rows, int dimensions, unsigned short *xseed);
+static void projectSample(float8 *sample, int n, int dimensions, float8 *v, int components, float8 *w);
+static void jacobiEigen(float8 *a, int n, float8 *e);
+
+
+/*
+ * validates the projection given in the reloptions
+ */
+void
+	vaValidateProjectionOption(char *value)
+{
+	if(value == NULL ||
+		(pg_strcasecmp(value, "none") != 0 && pg_strcasecmp(value, "pca") != 0 && pg_strcasecmp(value, "random") != 0)){
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			errmsg("invalid value for \"vaprojection\" option"),
+			errdetail("Valid values are \"none\", \"pca\" and \"random\".")));
+	}
+}
+
+VAProjection
+	vaGetProjectionMethod(const char *value)
+{
+	if(value && pg_strcasecmp(value, "pca") == 0){
+		return VA_PROJECTION_PCA;
+	} else if(value && pg_strcasecmp(value, "random") == 0){
+		return VA_PROJECTION_RANDOM;
+	}
+
+	return VA_PROJECTION_NONE;
+}
+
+/*
+ * learns the projection from the sampled features (n x dimensions, row by row);
+ * the sample is centered in place
+ */
+ArrayType *
+	vaLearnProjection(float8 *sample, int n, int dimensions, VAProjection method, int components)
+{
+	float8	   *mean = palloc0(dimensions * sizeof(float8));
+	float8	   *v = palloc(components * dimensions * sizeof(float8));
+	Datum	   *values;
+	ArrayType  *result;
+	unsigned short xseed[3];
+
+	int			arr_dims[2];
+	int			arr_lbs[2] = {1, 1};
+	int			r, c, i;
+
+	if(components >= dimensions){
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			errmsg("vacomponents must be smaller than the number of dimensions (%d)", dimensions)));
+	}
+
+	xseed[0] = 0x330E;
+	xseed[1] = (unsigned short) (random() & 0xFFFF);
+	xseed[2] = (unsigned short) (random() & 0xFFFF);
+
+	for(r = 0; r < n; r++){
+		for(i = 0; i < dimensions; i++){
+			mean[i] += sample[r * dimensions + i];
+		}
+	}
+
+	for(i = 0; i < dimensions; i++){
+		mean[i] /= Max(n, 1);
+	}
+
+	for(r = 0; r < n; r++){
+		for(i = 0; i < dimensions; i++){
+			sample[r * dimensions + i] -= mean[i];
+		}
+	}
+
+	fillGaussian(v, components * dimensions, xseed);
+	orthonormalize(v, components, dimensions, xseed);
+
+	if(method == VA_PROJECTION_PCA && n > 0){
+		float8 *w = palloc(n * components * sizeof(float8));
+		float8 *b = palloc(components * components * sizeof(float8));
+		float8 *e = palloc(components * components * sizeof(float8));
+		float8 *rotated = palloc0(components * dimensions * sizeof(float8));
+		int *order = palloc(components * sizeof(int));
+		int k;
+
+		//subspace iteration: V = orth((X V^T)^T X)
+		for(k = 0; k < VA_PROJECTION_ITERATIONS; k++){
+			CHECK_FOR_INTERRUPTS();
+
+			projectSample(sample, n, dimensions, v, components, w);
+
+			memset(v, 0, components * dimensions * sizeof(float8));
+
+			for(r = 0; r < n; r++){
+				for(c = 0; c < components; c++){
+					float8 wc = w[r * components + c];
+
+					for(i = 0; i < dimensions; i++){
+						v[c * dimensions + i] += wc * sample[r * dimensions + i];
+					}
+				}
+			}
+
+			orthonormalize(v, components, dimensions, xseed);
+		}
+
+		//Rayleigh-Ritz: the principal axes within the subspace, by decreasing variance
+		projectSample(sample, n, dimensions, v, components, w);
+
+		for(c = 0; c < components; c++){
+			for(k = 0; k < components; k++){
+				float8 sum = 0;
+
+				for(r = 0; r < n; r++){
+					sum += w[r * components + c] * w[r * components + k];
+				}
+
+				b[c * components + k] = sum;
+			}
+		}
+
+		jacobiEigen(b, components, e);
+
+		for(c = 0; c < components; c++){
+			order[c] = c;
+		}
+
+		for(c = 1; c < components; c++){
+			int current = order[c];
+
+			for(k = c; k > 0 && b[order[k - 1] * components + order[k - 1]] < b[current * components + current]; k--){
+				order[k] = order[k - 1];
+			}
+
+			order[k] = current;
+		}
+
+		for(c = 0; c < components; c++){
+			for(k = 0; k < components; k++){
+				float8 factor = e[k * components + order[c]];
+
+				for(i = 0; i < dimensions; i++){
+					rotated[c * dimensions + i] += factor * v[k * dimensions + i];
+				}
+			}
+		}
+
+		pfree(v);
+		v = rotated;
+
+		pfree(w);
+		pfree(b);
+		pfree(e);
+		pfree(order);
+	}
+
+	values = palloc((components + 1) * dimensions * sizeof(Datum));
+
+	for(i = 0; i < dimensions; i++){
+		values[i] = Float8GetDatum(mean[i]);
+	}
+
+	for(i = 0; i < components * dimensions; i++){
+		values[dimensions + i] = Float8GetDatum(v[i]);
+	}
+
+	arr_dims[0] = components + 1;
+	arr_dims[1] = dimensions;
+
+	result = construct_md_array(values, NULL, 2, arr_dims, arr_lbs, FLOAT8OID, sizeof(float8), FLOAT8PASSBYVAL, 'd');
+
+	pfree(values);
+	pfree(mean);
+	pfree(v);
+
+	return result;
+}
+
+/*
+ * projects a feature, returning a float8 feature of the components followed by
+ * the norm of the residual (negated for the upper bounds of a query)
+ */
+feature *
+	vaProjectFeature(ArrayType *projection, feature *f, bool negateResidual)
+{
+	int			components = ARR_DIMS(projection)[0] - 1;
+	int			dimensions = ARR_DIMS(projection)[1];
+	float8	   *basis = (float8 *) ARR_DATA_PTR(projection);
+	float8	   *x = getCenteredValues(f, basis, dimensions);
+	Datum	   *values = palloc((components + 1) * sizeof(Datum));
+	float8		squared = 0;
+	float8		projected = 0;
+	float8		residual;
+	ArrayType  *arr;
+	feature	   *result;
+	int			c, i;
+
+	for(i = 0; i < dimensions; i++){
+		squared += x[i] * x[i];
+	}
+
+	for(c = 0; c < components; c++){
+		float8 *component = basis + (c + 1) * dimensions;
+		float8 y = 0;
+
+		for(i = 0; i < dimensions; i++){
+			y += component[i] * x[i];
+		}
+
+		projected += y * y;
+		values[c] = Float8GetDatum(y);
+	}
+
+	residual = sqrt(Max(squared - projected, 0.0));
+	values[components] = Float8GetDatum(negateResidual ? -residual : residual);
+
+	arr = construct_array(values, components + 1, FLOAT8OID, sizeof(float8), FLOAT8PASSBYVAL, 'd');
+
+	result = (feature *) palloc(VARHDRSZ + sizeof(int32) + VARSIZE(arr));
+	SET_VARSIZE(result, VARHDRSZ + sizeof(int32) + VARSIZE(arr));
+	result->typid = FLOAT8OID;
+	memcpy(&result->data, arr, VARSIZE(arr));
+
+	pfree(x);
+	pfree(values);
+	pfree(arr);
+
+	return result;
+}
+
+
+/*
+ * returns the first values of a feature minus the mean; missing and null values
+ * are taken as 0
+ */
+static float8 *
+	getCenteredValues(feature *f, float8 *mean, int dimensions)
+{
+	float8		   *values = palloc0(dimensions * sizeof(float8));
+	ArrayIterator	it;
+	Datum			value;
+	bool			isnull;
+	int				i = 0;
+
+	f = featureToFloat8(f);
+	it = array_create_iterator(&f->data, 0);
+
+	while(i < dimensions && array_iterate(it, &value, &isnull)){
+		if(!isnull){
+			values[i] = DatumGetFloat8(value);
+		}
+
+		i++;
+	}
+
+	array_free_iterator(it);
+
+	for(i = 0; i < dimensions; i++){
+		values[i] -= mean[i];
+	}
+
+	return values;
+}
+
+/*
+ * normally distributed values (Box-Muller)
+ */
+static void
+	fillGaussian(float8 *v, int n, unsigned short *xseed)
+{
+	int i;
+
+	for(i = 0; i < n; i++){
+		float8 u1 = Max(pg_erand48(xseed), 1e-300);
+		float8 u2 = pg_erand48(xseed);
+
+		v[i] = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+	}
+}
+
+/*
+ * orthonormalizes the rows of v (modified Gram-Schmidt); a row depending on the
+ * rows before is replaced by a random one
+ */
+static void
+	orthonormalize(float8 *v, int rows, int dimensions, unsigned short *xseed)
+{
+	int r, k, i;
+
+	for(r = 0; r < rows; r++){
+		float8 *row = v + r * dimensions;
+		int attempts;
+
+		for(attempts = 0; attempts < 3; attempts++){
+			float8 before = 0;
+			float8 norm = 0;
+
+			for(i = 0; i < dimensions; i++){
+				before += row[i] * row[i];
+			}
+
+			for(k = 0; k < r; k++){
+				float8 *other = v + k * dimensions;
+				float8 dot = 0;
+
+				for(i = 0; i < dimensions; i++){
+					dot += row[i] * other[i];
+				}
+
+				for(i = 0; i < dimensions; i++){
+					row[i] -= dot * other[i];
+				}
+			}
+
+			for(i = 0; i < dimensions; i++){
+				norm += row[i] * row[i];
+			}
+
+			if(norm > 1e-20 * before && norm > 0){
+				norm = sqrt(norm);
+
+				for(i = 0; i < dimensions; i++){
+					row[i] /= norm;
+				}
+
+				break;
+			}
+
+			fillGaussian(row, dimensions, xseed);
+		}
+	}
+}
+
+/*
+ * w = X V^T, i.e. the components of the sampled features (n x components)
+ */
+static void
+	projectSample(float8 *sample, int n, int dimensions, float8 *v, int components, float8 *w)
+{
+	int r, c, i;
+
+	for(r = 0; r < n; r++){
+		float8 *x = sample + r * dimensions;
+
+		for(c = 0; c < components; c++){
+			float8 *component = v + c * dimensions;
+			float8 sum = 0;
+
+			for(i = 0; i < dimensions; i++){
+				sum += component[i] * x[i];
+			}
+
+			w[r * components + c] = sum;
+		}
+	}
+}
+
+/*
+ * eigenvalues (on the diagonal of a) and eigenvectors (columns of e) of the
+ * symmetric matrix a (n x n) by the cyclic Jacobi method
+ */
+static void
+	jacobiEigen(float8 *a, int n, float8 *e)
+{
+	int sweep, p, q, k;
+
+	for(p = 0; p < n; p++){
+		for(q = 0; q < n; q++){
+			e[p * n + q] = (p == q) ? 1 : 0;
+		}
+	}
+
+	for(sweep = 0; sweep < JACOBI_SWEEPS; sweep++){
+		float8 off = 0;
+		float8 diagonal = 0;
+
+		for(p = 0; p < n; p++){
+			diagonal += a[p * n + p] * a[p * n + p];
+
+			for(q = p + 1; q < n; q++){
+				off += a[p * n + q] * a[p * n + q];
+			}
+		}
+
+		if(off <= 1e-24 * diagonal){
+			break;
+		}
+
+		for(p = 0; p < n; p++){
+			for(q = p + 1; q < n; q++){
+				float8 apq = a[p * n + q];
+				float8 theta, t, c, s;
+
+				if(apq == 0){
+					continue;
+				}
+
+				theta = (a[q * n + q] - a[p * n + p]) / (2 * apq);
+
+				if(fabs(theta) > 1e150){
+					t = 1 / (2 * theta);
+				} else {
+					t = ((theta >= 0) ? 1 : -1) / (fabs(theta) + sqrt(theta * theta + 1));
+				}
+
+				c = 1 / sqrt(t * t + 1);
+				s = t * c;
+
+				for(k = 0; k < n; k++){
+					float8 akp = a[k * n + p];
+					float8 akq = a[k * n + q];
+
+					a[k * n + p] = c * akp - s * akq;
+					a[k * n + q] = s * akp + c * akq;
+				}
+
+				for(k = 0; k < n; k++){
+					float8 apk = a[p * n + k];
+					float8 aqk = a[q * n + k];
+
+					a[p * n + k] = c * apk - s * aqk;
+					a[q * n + k] = s * apk + c * aqk;
+				}
+
+				for(k = 0; k < n; k++){
+					float8 ekp = e[k * n + p];
+					float8 ekq = e[k * n + q];
+
+					e[k * n + p] = c * ekp - s * ekq;
+					e[k * n + q] = s * ekp + c * ekq;
+				}
+			}
+		}
+	}
+}
@@ -22,6 +22,8 @@
 
 #include "postgres.h"
 
+#include <math.h>
+
 #include "utils/adam_index_va.h"
 
 
@@ -29,22 +31,33 @@
 #include "parser/adam_data_parse_featurefunction.h"
 #include "utils/adam_data_feature.h"
 #include "utils/adam_index_marks.h"
+#include "utils/adam_index_projection.h"
+#include "utils/adam_index_va_cache.h"
+#include "utils/adam_index_va_results.h"
 #include "utils/adam_retrieval_minkowski.h"
+#include "utils/adam_retrieval_similarity.h"
 #include "utils/adam_utils_bitstring.h"
 #include "utils/adam_utils_priorityqueue.h"
 
 #include "fmgr.h"
 #include "miscadmin.h"
+#include "access/genam.h"
+#include "access/heapam.h"
 #include "access/htup.h"
 #include "access/reloptions.h"
 #include "access/relscan.h"
 #include "catalog/index.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_attribute.h"
+#include "catalog/pg_operator.h"
 #include "catalog/pg_proc.h"
 #include "catalog/storage.h"
 #include "commands/vacuum.h"
+#include "executor/executor.h"
 #include "nodes/tidbitmap.h"
 #include "optimizer/cost.h"
+#include "pgstat.h"
+#include "portability/instr_time.h"
 #include "postmaster/autovacuum.h"
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
@@ -55,11 +68,24 @@
 #include "utils/syscache.h"
 #include "utils/lsyscache.h"
 #include "utils/selfuncs.h"
+#include "utils/timestamp.h"
+#include "utils/tqual.h"
+#include "utils/tuplesort.h"
 #include "utils/typcache.h"
 
 #define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
 #define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
 
+/* values per cell in the bounds of the cosine distance (dot product, min. and max. squared length) */
+#define VA_COSINE_STRIDE 3
+
+/* costs (in multiples of cpu_operator_cost) of computing the bounds of an approximation and an exact distance */
+#define VA_BOUND_COST 10
+#define VA_DISTANCE_COST 50
+
+/* factor by which the number of neighbours is increased when post-filtering */
+#define VA_POSTFILTER_OVERFETCH 1.5
+
 /*
  * VA File page functions
  */
@@ -83,6 +109,8 @@
 typedef struct FileOptions {
 	int32				vl_len_;					/* varlena header (do not touch directly!) */
 	int32				indexMarks;
+	int32				components;
+	int32				projectionOffset;			/* offset of the projection method (vaprojection) */
 } FileOptions;
 
 typedef struct StateOptions {
@@ -91,6 +119,7 @@ typedef struct StateOptions {
 	ArrayType		   *marks;
 	int32				dimensions;
 	int32				partitions;
+	ArrayType		   *projection;					/* NULL if the features are approximated as they are */
 } StateOptions;
 
 /*
@@ -106,12 +135,13 @@ typedef OpaqueData *Opaque;
 typedef BlockNumber FreeBlockNumberArray[MAXALIGN_DOWN(
 	BLCKSZ - SizeOfPageHeaderData - MAXALIGN(sizeof(OpaqueData)) -
 	/* header of MetaPageData struct */
-	MAXALIGN(sizeof(uint16)* 2 + sizeof(uint32)+sizeof(FileOptions))
+	MAXALIGN(sizeof(uint16)* 2 + sizeof(uint32)+sizeof(TimestampTz)+sizeof(FileOptions))
 	) / sizeof(BlockNumber)];
 
 typedef struct MetaPageData {
 	uint32					magickNumber;
 	uint32					nChanges;
+	TimestampTz				buildTime;
 	uint16					nStart;
 	uint16					nEnd;
 	FreeBlockNumberArray	notFullPage;
@@ -147,6 +177,66 @@ typedef struct BuildState{
 	Page			currentPage;
 } BuildState;
 
+/*
+ * runs through the approximations of a VA file either page by page or, if the
+ * VA file is in the VA cache, all at once
+ */
+typedef struct VAIterator{
+	Relation				index;
+	StateOptions		   *state;
+	BufferAccessStrategy	bas;
+	BlockNumber				blkno;
+	BlockNumber				npages;
+	Buffer					buffer;			/* page currently returned */
+	BlockNumber				pagesRead;
+	VACacheEntry		   *cached;
+	Size					cachedPos;		/* bytes of the cache entry returned */
+} VAIterator;
+
+/*
+ * candidates of an approximate search, collected in the second pass and only
+ * added to the bitmap afterwards (see vaAddApproximateCandidates)
+ */
+typedef struct VACandidate{
+	ItemPointerData			heapPtr;
+	float8					l_bound;
+	float8					u_bound;
+} VACandidate;
+
+typedef struct VACandidateList{
+	VACandidate			   *items;
+	int						n;
+	int						size;
+} VACandidateList;
+
+/*
+ * unweighted Minkowski bounds of the last query of the backend; relevance feedback
+ * queries the same index again and again with the query point moved in a few
+ * dimensions or with other weights, so only the bounds of the dimensions in which
+ * the query point changed are computed again (see vaPrecomputeBounds)
+ */
+typedef struct VABoundsCache{
+	Oid						indexOid;
+	Oid						relfilenode;
+	MinkowskiNorm			norm;
+	int						dimensions;
+	int						partitions;
+	float8				   *query;
+	float8				   *l_bounds;
+	float8				   *u_bounds;
+} VABoundsCache;
+
+static VABoundsCache *vaBoundsCache = NULL;
+
+/*
+ * tuples of a table clustered on a VA file, in the order of the z-order curve
+ * over the cells of their approximations (see vaBeginCluster); the tuples are
+ * sorted by a bytea key, so that the sort may spill to disk
+ */
+struct VAClusterState{
+	Tuplesortstate		   *sortstate;
+};
+
 
 
 /*
@@ -156,23 +246,36 @@ static Tuple* formTuple(StateOptions *state, ItemPointer iptr, Datum *values, bo
 static void buildCallback(Relation index, HeapTuple htup, Datum *values, bool *isnull, bool tupleIsAlive, void *state);
 static bool addItemToBlock(Relation index, StateOptions *state, Tuple *itup, BlockNumber blkno);
 static void initStateOptions(StateOptions *state, Relation index, ArrayType *marks);
+static VAProjection getProjectionMethod(FileOptions *opts);
 static bool addItem(StateOptions *state, Page p, Tuple *t);
 static Buffer newBuffer(Relation index);
 static void initBuffer(Buffer b, uint16 f);
 static void initPage(Page page, uint16 f, uint16 maxoff, Size pageSize);
 static void initMetabuffer(Buffer b, Relation index);
+static void vaBeginIterate(VAIterator *it, Relation index, StateOptions *state, BlockNumber npages, BufferAccessStrategy bas, VACacheEntry *cached);
+static bool vaIterate(VAIterator *it, Tuple **itup, Tuple **itupEnd);
+static void vaEndIterate(VAIterator *it);
+static VACacheEntry *vaLoadCache(Relation index, StateOptions *state, uint32 nChanges, BufferAccessStrategy bas);
+static Relation vaOpenIndex(Oid indexId);
 
 
 /*
  * VA File specific functions for calculations
  */
-static float8 get_bound(BitStringElement *vector, float8* bounds, int32 dimensions, int32 partitions, MinkowskiNorm norm);
+static float8 get_bound(BitStringElement *vector, float8* bounds, int32 dimensions, int32 partitions, MinkowskiNorm norm, AdamDistanceType distance, bool upper);
+static float8 get_similarity_bound(BitStringElement *apx, float8* bounds, int32 dimensions, int32 partitions, AdamDistanceType distance, bool upper);
 static void set_bitstring(feature *f, ArrayType *marks, BitStringElement *result);
 
-static float8* precompute_differences_ubound(Datum *f, ArrayType *marks, MinkowskiNorm norm);
-static float8* precompute_differences_lbound(Datum *f, ArrayType *marks, MinkowskiNorm norm);
+static float8* precompute_differences_ubound(Datum *f, ArrayType *marks, MinkowskiNorm norm, AdamDistanceType distance);
+static float8* precompute_differences_lbound(Datum *f, ArrayType *marks, MinkowskiNorm norm, AdamDistanceType distance);
+static float8* precompute_similarity_bounds(feature *f, ArrayType *marks, AdamDistanceType distance, bool upper);
 static float8* precompute_differences_lbound_lnorm(feature *f, ArrayType *marks, MinkowskiNorm norm);
 static float8* precompute_differences_ubound_lnorm(feature *f, ArrayType *marks, MinkowskiNorm norm);
+static void precompute_dimension_bounds(float8 value, float8 *marks, int partitions, MinkowskiNorm norm, float8 *l_bounds, float8 *u_bounds);
+static void vaPrecomputeBounds(Relation index, StateOptions *state, Datum *query, AdamScanClause *adamOptions, float8 **l_bounds, float8 **u_bounds);
+static float8 *getQueryValues(feature *f, int dimensions);
+static float8 *getWeights(Node *weights, int dimensions);
+static bool vaValidWeights(Node *weights);
 
 
 /*
@@ -180,6 +283,13 @@ static float8* precompute_differences_ubound_lnorm(feature *f, ArrayType *marks,
  */
 bool enable_vascan = true;
 
+/*
+ * approximate search: the candidates are restricted to the ones needed for
+ * reaching the recall target and/or to at most va_max_candidates (0 = no limit)
+ */
+double va_recall_target = 1.0;
+int va_max_candidates = 0;
+
 /*
  *  Prepare for an index scan.
  *
@@ -251,6 +361,12 @@ vaReScan(PG_FUNCTION_ARGS)
 
 	if (keys && scan->numberOfKeys > 0)	{
 		memmove(scan->keyData, keys, scan->numberOfKeys * sizeof(ScanKeyData));
+
+		//the bounds are computed on the float8 values of the query
+		if (!(scan->keyData->sk_flags & SK_ISNULL)){
+			scan->keyData->sk_argument = PointerGetDatum(
+				featureToFloat8((feature *)PG_DETOAST_DATUM(scan->keyData->sk_argument)));
+		}
 	}
 
 	PG_RETURN_VOID();
@@ -304,8 +420,19 @@ vaEndScan(PG_FUNCTION_ARGS)
  * The amgetbitmap function need only be provided if the access method supports "bitmap" index scans.
  * If it doesn't, the amgetbitmap field in its pg_am row must be set to zero.
  */
+static bool vaSupportsDistance(AdamScanClause *adamOptions, bool projected);
 static Datum bitmapSingleSearch(IndexScanDesc scan, TIDBitmap *tbm);
 static Datum bitmapMultiSearch(IndexScanDesc scan, TIDBitmap *tbm);
+static PriorityQueue *getQueue(IndexScanDesc scan, int numResults, FmgrInfo *cmp);
+static bool skipPartition(IndexScanDesc scan, PriorityQueue *q, float8 *l_bounds, int dimensions, int partitions, MinkowskiNorm norm, AdamDistanceType distance);
+static void vaAddInstrumentation(VAScanInstrumentation *instr, PriorityQueue *q, int64 ntuples, int64 ncandidates, int64 nbounds,
+	BlockNumber npages, bool cached, instr_time *starttime, instr_time *pass1time);
+static bool vaIsApproximate(PriorityQueue *q);
+static void vaJoinHeapInsert(float8 *heap, int *size, int k, float8 value);
+static Datum formClusterKey(bytea *key, BitStringElement *apx, int dimensions, int bits, ItemPointer heapPtr);
+static void addCandidate(VACandidateList *list, ItemPointer heapPtr, float8 l_bound, float8 u_bound);
+static int compareCandidates(const void *a, const void *b);
+static int64 vaAddApproximateCandidates(TIDBitmap *tbm, VACandidateList *list, int numResults, float8 kthUpperBound, double *recall);
 
 Datum
 vaGetBitmap(PG_FUNCTION_ARGS)
@@ -314,13 +441,233 @@ vaGetBitmap(PG_FUNCTION_ARGS)
 	TIDBitmap  				*tbm = (TIDBitmap *)PG_GETARG_POINTER(1);
 
 	AdamScanClause			*adamOptions = (AdamScanClause *)scan->adamScanClause;
+	Datum					ntids;
+
+	pgstat_count_index_scan(scan->indexRelation);
 
 	if (adamOptions->check_tid && adamOptions->nn_limit > 0 && !tbm_is_empty(tbm)){
-		return bitmapMultiSearch(scan, tbm);
+		ntids = bitmapMultiSearch(scan, tbm);
 	}
 	else {
-		return bitmapSingleSearch(scan, tbm);
+		ntids = bitmapSingleSearch(scan, tbm);
+	}
+
+	pgstat_count_va_candidates(scan->indexRelation, DatumGetInt64(ntids));
+
+	return ntids;
+}
+
+/*
+ * adds the counters of a search to the instrumentation shown by EXPLAIN ANALYZE;
+ * the first pass computes the bounds of all approximations, the second pass
+ * collects the candidates
+ */
+static void
+vaAddInstrumentation(VAScanInstrumentation *instr, PriorityQueue *q, int64 ntuples, int64 ncandidates, int64 nbounds,
+	BlockNumber npages, bool cached, instr_time *starttime, instr_time *pass1time)
+{
+	instr_time				endtime;
+	instr_time				duration;
+
+	INSTR_TIME_SET_CURRENT(endtime);
+
+	instr->nscans++;
+	instr->tuples += ntuples;
+	instr->candidates += ncandidates;
+	instr->boundComputations += nbounds;
+	instr->pages += npages;
+
+	if (cached){
+		instr->cachedScans++;
+	}
+
+	//the upper bound of the k-th neighbour is the largest one in a full queue
+	if (q && q->currentSize == q->maxSize && q->currentSize > 0){
+		instr->kthUpperBound = DatumGetFloat8(*getMaximumElement(q));
+	}
+
+	duration = *pass1time;
+	INSTR_TIME_SUBTRACT(duration, *starttime);
+	instr->pass1Time += INSTR_TIME_GET_MILLISEC(duration);
+
+	duration = endtime;
+	INSTR_TIME_SUBTRACT(duration, *pass1time);
+	instr->pass2Time += INSTR_TIME_GET_MILLISEC(duration);
+}
+
+/*
+ * checks whether the search may be approximate; as long as the queue is not full
+ * all tuples are candidates anyway
+ */
+static bool
+vaIsApproximate(PriorityQueue *q)
+{
+	return (va_recall_target < 1.0 || va_max_candidates > 0) && q && q->currentSize == q->maxSize;
+}
+
+static void
+addCandidate(VACandidateList *list, ItemPointer heapPtr, float8 l_bound, float8 u_bound)
+{
+	if (list->n >= list->size){
+		list->size = (list->size > 0) ? list->size * 2 : 1024;
+		list->items = (list->items) ?
+			(VACandidate *) repalloc(list->items, list->size * sizeof(VACandidate)) :
+			(VACandidate *) palloc(list->size * sizeof(VACandidate));
+	}
+
+	list->items[list->n].heapPtr = *heapPtr;
+	list->items[list->n].l_bound = l_bound;
+	list->items[list->n].u_bound = u_bound;
+	list->n++;
+}
+
+static int
+compareCandidates(const void *a, const void *b)
+{
+	float8 x = ((const VACandidate *) a)->l_bound;
+	float8 y = ((const VACandidate *) b)->l_bound;
+
+	return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+/*
+ * adds the candidates with the lowest lower bounds to the bitmap, as many as
+ * needed for reaching va_recall_target, but at most va_max_candidates (and at
+ * least the requested number of neighbours); returns the number of candidates added
+ *
+ * the recall is estimated by assuming that the exact distance of a candidate is
+ * uniformly distributed between its bounds; it then is among the neighbours with
+ * probability p = (kthUpperBound - l_bound) / (u_bound - l_bound), since the
+ * distance of the k-th neighbour is at most kthUpperBound; the estimated recall
+ * is the share of the sum of p of all candidates covered by the added candidates
+ */
+static int64
+vaAddApproximateCandidates(TIDBitmap *tbm, VACandidateList *list, int numResults, float8 kthUpperBound, double *recall)
+{
+	float8 *probabilities;
+	float8 total = 0, covered = 0;
+	int limit = list->n;
+	int i;
+
+	if (list->n == 0){
+		*recall = 1.0;
+		return 0;
+	}
+
+	qsort(list->items, list->n, sizeof(VACandidate), compareCandidates);
+
+	probabilities = (float8 *) palloc(list->n * sizeof(float8));
+
+	for (i = 0; i < list->n; i++){
+		VACandidate *c = &list->items[i];
+
+		if (c->u_bound <= kthUpperBound || c->u_bound - c->l_bound < EPSILON){
+			probabilities[i] = 1.0;
+		} else {
+			probabilities[i] = MAX(0.0, MIN(1.0, (kthUpperBound - c->l_bound) / (c->u_bound - c->l_bound)));
+		}
+
+		total += probabilities[i];
+	}
+
+	if (va_max_candidates > 0){
+		limit = MIN(limit, MAX(numResults, va_max_candidates));
+	}
+
+	for (i = 0; i < limit; i++){
+		//enough candidates for the recall target
+		if (i >= numResults && va_recall_target < 1.0 && covered >= va_recall_target * total){
+			break;
+		}
+
+		tbm_add_tuples(tbm, &list->items[i].heapPtr, 1, false);
+		covered += probabilities[i];
+	}
+
+	*recall = (total > 0) ? covered / total : 1.0;
+
+	pfree(probabilities);
+
+	return i;
+}
+
+/*
+ * checks whether bounds can be computed for the distance used in the query
+ */
+static bool
+vaSupportsDistance(AdamScanClause *adamOptions, bool projected)
+{
+	//the bounds in the projected space only hold for the Euclidean distance
+	if (projected){
+		return adamOptions->nn_distance == ADAM_DISTANCE_MINKOWSKI && !adamOptions->nn_weights
+			&& fabs(adamOptions->nn_minkowski - 2) < EPSILON;
+	}
+
+	switch (adamOptions->nn_distance){
+		case ADAM_DISTANCE_MINKOWSKI:
+			//the weighted maximum norm is not computed by calculateWeightedMinkowski
+			if (adamOptions->nn_weights){
+				return adamOptions->nn_minkowski > 0 && adamOptions->nn_minkowski < 100
+					&& vaValidWeights(adamOptions->nn_weights);
+			}
+
+			return (adamOptions->nn_minkowski > 0 && adamOptions->nn_minkowski < 100)
+				|| adamOptions->nn_minkowski == MINKOWSKI_MAX_NORM;
+		case ADAM_DISTANCE_COSINE:
+		case ADAM_DISTANCE_INNER_PRODUCT:
+		case ADAM_DISTANCE_HAMMING:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * returns the queue of the nearest neighbours; if the table is partitioned, the
+ * scans of all partitions share one queue (see pass_down_bound in nodeLimit.c), so
+ * that the bounds of the neighbours found in one partition are used in the others
+ */
+static PriorityQueue *
+getQueue(IndexScanDesc scan, int numResults, FmgrInfo *cmp)
+{
+	if (scan->adamQueue && scan->adamQueue->maxSize == numResults){
+		return scan->adamQueue;
+	}
+
+	return createQueue(numResults, cmp);
+}
+
+/*
+ * checks whether the whole VA file can be skipped, because even the lowest bound
+ * any approximation can have (i.e. the lowest bound in each dimension) is larger
+ * than the upper bounds of the neighbours found in other partitions; this is only
+ * possible for Minkowski distances, where the bounds are independent per dimension
+ */
+static bool
+skipPartition(IndexScanDesc scan, PriorityQueue *q, float8 *l_bounds, int dimensions, int partitions, MinkowskiNorm norm, AdamDistanceType distance)
+{
+	int dim, i;
+	float8 bound = 0;
+
+	if (q != scan->adamQueue || q->currentSize < q->maxSize || distance != ADAM_DISTANCE_MINKOWSKI){
+		return false;
+	}
+
+	for (dim = 0; dim < dimensions; dim++){
+		float8 dim_bound = l_bounds[dim * partitions];
+
+		for (i = 1; i < partitions; i++){
+			dim_bound = MIN(dim_bound, l_bounds[dim * partitions + i]);
+		}
+
+		if (norm == MINKOWSKI_MAX_NORM){
+			bound = MAX(bound, dim_bound);
+		} else {
+			bound += dim_bound;
+		}
 	}
+
+	return !insertIntoQueueCheck(q, Float8GetDatum(bound));
 }
 
 /*
@@ -350,6 +697,7 @@ bitmapSingleSearch(IndexScanDesc scan, TIDBitmap *tbm)
 
 	int						numResults = 0;
 	MinkowskiNorm           norm = 0;
+	AdamDistanceType		distance;
 
 	Buffer					meta_buffer;
 	MetaPageData		   *meta_data;
@@ -367,6 +715,27 @@ bitmapSingleSearch(IndexScanDesc scan, TIDBitmap *tbm)
 	PriorityQueue		   *q = NULL;
 	ScanKey					skey;
 
+	VAIterator				it;
+	VACacheEntry		   *cached = NULL;
+	uint32					nChanges;
+	Tuple				   *itup;
+	Tuple				   *itupEnd;
+
+	VAScanInstrumentation  *instr = scan->adamInstrument;
+	instr_time				starttime;
+	instr_time				pass1time;
+	int64					ntuples = 0;
+	int64					nbounds = 0;
+	BlockNumber				npagesRead = 0;
+
+	bool					approximate = false;
+	float8					kthUpperBound = 0;
+	VACandidateList			candidateList = {NULL, 0, 0};
+	double					recall = 1.0;
+
+	bool					useResultCache = false;
+	VACandidateList			resultList = {NULL, 0, 0};
+
 	fmgr_info(BTFLOAT8CMPOID, &numeric_cmp_fmgr);
 
 	skey = scan->keyData;
@@ -375,18 +744,24 @@ bitmapSingleSearch(IndexScanDesc scan, TIDBitmap *tbm)
 	//error in cost function!
 	numResults = adamOptions->nn_limit;
 	norm = adamOptions->nn_minkowski;
+	distance = adamOptions->nn_distance;
 
 	if (numResults > 0){
-		q = createQueue(numResults, &numeric_cmp_fmgr);
+		q = getQueue(scan, numResults, &numeric_cmp_fmgr);
 	}
 	else {
 		//q is not created, thus we still do an index scan, but a very costly one (we add each tuple)!
 	}
 
-	if (norm < 0 || norm > 100){
+	//distance browsing (see nodeSort.c): all tuples are returned unless the queue is filled
+	if (adamOptions->nn_browse){
+		adamOptions->nn_threshold = get_float8_infinity();
+	}
+
+	if (!vaSupportsDistance(adamOptions, so->state.projection != NULL)){
 		ereport(ERROR,
 			(errcode(ERRCODE_INTERNAL_ERROR),
-			errmsg("VA indexing can only be used with Minkowski distances; the cost function estimator, however, did not take this into consideration"),
+			errmsg("VA indexing can only be used with Minkowski, cosine, inner product or hamming distances; the cost function estimator, however, did not take this into consideration"),
 			errhint("Force the use of other indices or sequential scan.")));
 	}
 
@@ -397,23 +772,35 @@ bitmapSingleSearch(IndexScanDesc scan, TIDBitmap *tbm)
 		return (Datum)0;
 	}
 
-	//calculate lower bounds
-	if (numResults > 0){
-		l_bounds = precompute_differences_lbound(
-			&skey->sk_argument,
-			so->state.marks,
-			norm);
+	//the same search may have been done before on the unchanged index
+	if (q && scan->adamQueue == NULL && !adamOptions->nn_browse && !adamOptions->nn_weights && vaResultCacheEnabled()){
+		if (vaResultCacheLookup(scan, numResults, adamOptions, vaGetChanges(scan->indexRelation), tbm, &ntids)){
+			if (instr){
+				instr->nscans++;
+				instr->resultCacheHits++;
+				instr->candidates += ntids;
+			}
+
+			pfree(q);
+			PG_RETURN_INT64(ntids);
+		}
 
-		//calculate upper bounds
-		u_bounds = precompute_differences_ubound(
-			&skey->sk_argument,
-			so->state.marks,
-			norm);
+		useResultCache = true;
+	}
+
+	//calculate lower and upper bounds
+	if (numResults > 0){
+		vaPrecomputeBounds(scan->indexRelation, &so->state, &skey->sk_argument, adamOptions, &l_bounds, &u_bounds);
 	}
 
 	f = (feature *)DatumGetPointer(skey->sk_argument);
 	dimensions = MIN(so->state.dimensions, ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data)));
 
+	//partitioned tables: no tuple of this partition can be closer than the neighbours found so far
+	if (q && skipPartition(scan, q, l_bounds, dimensions, so->state.partitions, norm, distance)){
+		PG_RETURN_INT64(0);
+	}
+
 	bas = GetAccessStrategy(BAS_BULKREAD);
 
 	if (!RELATION_IS_LOCAL(scan->indexRelation)){ LockRelation(scan->indexRelation, ShareLock); }
@@ -443,99 +830,155 @@ bitmapSingleSearch(IndexScanDesc scan, TIDBitmap *tbm)
 			errhint("Please REINDEX it.")));
 	}
 
+	nChanges = meta_data->nChanges;
+
 	UnlockReleaseBuffer(meta_buffer);
 
-	for (blkno = VA_HEAD_BLKNO; blkno < npages; blkno++){
-		Buffer 			buffer;
-		Page			page;
+	//read the approximations from the VA cache if possible
+	cached = vaCacheLookup(scan->indexRelation, nChanges);
 
-		buffer = ReadBufferExtended(scan->indexRelation, MAIN_FORKNUM, blkno, RBM_NORMAL, bas);
+	if (!cached && va_cache_autoload && vaCacheEnabled()){
+		cached = vaLoadCache(scan->indexRelation, &so->state, nChanges, bas);
+	}
 
-		if (blkno + 1 < npages)
-			PrefetchBuffer(scan->indexRelation, MAIN_FORKNUM, blkno + 1);
+	if (instr){
+		INSTR_TIME_SET_CURRENT(starttime);
+	}
 
-		LockBuffer(buffer, BUFFER_LOCK_SHARE);
-		page = BufferGetPage(buffer);
+	vaBeginIterate(&it, scan->indexRelation, &so->state, npages, bas, cached);
+	while (vaIterate(&it, &itup, &itupEnd)){
+		while (itup < itupEnd){
+			//strategy as in (Weber, 2000, Program 5.6), implementation of VAF-NOA
+			if (q){
+				//calculate the lower bound
+				l_bound = get_bound(itup->apx, l_bounds, dimensions,
+					so->state.partitions, norm, distance, false);
+				nbounds++;
+
+				if (insertIntoQueueCheck(q, Float8GetDatum(l_bound))){
+					//calculate the upper bound
+					u_bound = get_bound(itup->apx, u_bounds, dimensions,
+						so->state.partitions, norm, distance, true);
+					nbounds++;
+
+					if (insertIntoQueue(q, Float8GetDatum(l_bound), Float8GetDatum(u_bound))){
+						//tbm_add_tuples(tbm, &itup->heapPtr, 1, false);
+						//ntids++;
+					}
+				}
+			}
 
-		if (!isDeleted(page)){
-			Tuple	 *itup = getData(page);
-			Tuple   *itupEnd = (Tuple*)(((char*)itup) + so->state.sizeOfTuple * getMaxOffset(page));
+			//if q not created, i.e. we have no limit; our cost-function should have
+			//caught this case, now we have a rather costly sequential search
+			//(at least more expensive than just doing a sequential search)!
+			if (!q){
+				tbm_add_tuples(tbm, &itup->heapPtr, 1, false);
+				ntids++;
+			}
+
+			ntuples++;
+			itup = (Tuple*)(((char*)itup) + so->state.sizeOfTuple);
+		}
+	}
+
+	npagesRead += it.pagesRead;
+
+	if (instr){
+		INSTR_TIME_SET_CURRENT(pass1time);
+	}
+
+	if (q){
+		approximate = vaIsApproximate(q);
+		if (approximate){
+			kthUpperBound = DatumGetFloat8(*getMaximumElement(q));
+		}
+
+		//every tuple closer than the k-th upper bound is among the candidates
+		if (adamOptions->nn_browse && q->currentSize >= q->maxSize){
+			adamOptions->nn_threshold = DatumGetFloat8(*getMaximumElement(q));
+		}
 
+		vaBeginIterate(&it, scan->indexRelation, &so->state, npages, bas, cached);
+		while (vaIterate(&it, &itup, &itupEnd)){
 			while (itup < itupEnd){
 				//strategy as in (Weber, 2000, Program 5.6), implementation of VAF-NOA
-				if (q){
-					//calculate the lower bound
-					l_bound = get_bound(itup->apx, l_bounds, dimensions,
-						so->state.partitions, norm);
-
-					if (insertIntoQueueCheck(q, Float8GetDatum(l_bound))){
-						//calculate the upper bound
+				//calculate the lower bound
+				l_bound = get_bound(itup->apx, l_bounds, dimensions,
+					so->state.partitions, norm, distance, false);
+				nbounds++;
+
+				if (insertIntoQueueCheck(q, Float8GetDatum(l_bound))){
+					if (approximate){
+						//the upper bound is needed for estimating the recall
 						u_bound = get_bound(itup->apx, u_bounds, dimensions,
-							so->state.partitions, norm);
+							so->state.partitions, norm, distance, true);
+						nbounds++;
+
+						addCandidate(&candidateList, &itup->heapPtr, l_bound, u_bound);
+					} else {
+						tbm_add_tuples(tbm, &itup->heapPtr, 1, false);
+						ntids++;
 
-						if (insertIntoQueue(q, Float8GetDatum(l_bound), Float8GetDatum(u_bound))){
-							//tbm_add_tuples(tbm, &itup->heapPtr, 1, false);
-							//ntids++;
+						//too many candidates to be worth caching
+						if (useResultCache && ntids > VA_RESULT_CACHE_MAX_TIDS){
+							useResultCache = false;
 						}
-					}
-				}
 
-				//if q not created, i.e. we have no limit; our cost-function should have
-				//caught this case, now we have a rather costly sequential search
-				//(at least more expensive than just doing a sequential search)!
-				if (!q){
-					tbm_add_tuples(tbm, &itup->heapPtr, 1, false);
-					ntids++;
+						if (useResultCache){
+							addCandidate(&resultList, &itup->heapPtr, l_bound, l_bound);
+						}
+					}
 				}
 
 				itup = (Tuple*)(((char*)itup) + so->state.sizeOfTuple);
 			}
 		}
 
-		UnlockReleaseBuffer(buffer);
-		CHECK_FOR_INTERRUPTS();
-	}
+		npagesRead += it.pagesRead;
 
-	if (q){
-		for (blkno = VA_HEAD_BLKNO; blkno < npages; blkno++){
-			Buffer 			buffer;
-			Page			page;
+		if (approximate){
+			ntids = vaAddApproximateCandidates(tbm, &candidateList, numResults, kthUpperBound, &recall);
+		}
+	}
 
-			buffer = ReadBufferExtended(scan->indexRelation, MAIN_FORKNUM, blkno, RBM_NORMAL, bas);
+	if (instr){
+		vaAddInstrumentation(instr, q, ntuples, ntids, nbounds, npagesRead, cached != NULL, &starttime, &pass1time);
 
-			if (blkno + 1 < npages)
-				PrefetchBuffer(scan->indexRelation, MAIN_FORKNUM, blkno + 1);
+		if (approximate){
+			instr->approximateScans++;
+			instr->recallSum += recall;
+		}
+	}
 
-			LockBuffer(buffer, BUFFER_LOCK_SHARE);
-			page = BufferGetPage(buffer);
+	if (useResultCache && ntids <= VA_RESULT_CACHE_MAX_TIDS){
+		VACandidateList		   *results = approximate ? &candidateList : &resultList;
+		ItemPointer				tids = (ItemPointer) palloc((ntids + 1) * sizeof(ItemPointerData));
+		int						i;
 
-			if (!isDeleted(page)){
-				Tuple	 *itup = getData(page);
-				Tuple   *itupEnd = (Tuple*)(((char*)itup) + so->state.sizeOfTuple * getMaxOffset(page));
+		//the approximate candidates are sorted, the added ones come first
+		for (i = 0; i < ntids; i++){
+			tids[i] = results->items[i].heapPtr;
+		}
 
-				while (itup < itupEnd){
-					//strategy as in (Weber, 2000, Program 5.6), implementation of VAF-NOA
-					//calculate the lower bound
-					l_bound = get_bound(itup->apx, l_bounds, dimensions,
-						so->state.partitions, norm);
+		vaResultCacheStore(scan, numResults, adamOptions, nChanges, tids, (int) ntids);
+		pfree(tids);
+	}
 
-					if (insertIntoQueueCheck(q, Float8GetDatum(l_bound))){
-						tbm_add_tuples(tbm, &itup->heapPtr, 1, false);
-						ntids++;
-					}
+	if (candidateList.items){
+		pfree(candidateList.items);
+	}
 
-					itup = (Tuple*)(((char*)itup) + so->state.sizeOfTuple);
-				}
-			}
+	if (resultList.items){
+		pfree(resultList.items);
+	}
 
-			UnlockReleaseBuffer(buffer);
-			CHECK_FOR_INTERRUPTS();
-		}
+	if (cached){
+		vaCacheRelease(cached);
 	}
 
 	FreeAccessStrategy(bas);
 
-	if (q){
+	if (q && q != scan->adamQueue){
 		pfree(q);
 	}
 
@@ -573,6 +1016,7 @@ bitmapMultiSearch(IndexScanDesc scan, TIDBitmap *tbm)
 
 	int						numResults = 0;
 	MinkowskiNorm			norm = 0;
+	AdamDistanceType		distance;
 
 	Buffer					meta_buffer;
 	MetaPageData		   *meta_data;
@@ -590,27 +1034,39 @@ bitmapMultiSearch(IndexScanDesc scan, TIDBitmap *tbm)
 	PriorityQueue		   *q = NULL;
 	ScanKey					skey;
 
+	VAIterator				it;
+	VACacheEntry		   *cached = NULL;
+	uint32					nChanges;
+	Tuple				   *itup;
+	Tuple				   *itupEnd;
+
+	VAScanInstrumentation  *instr = scan->adamInstrument;
+	instr_time				starttime;
+	instr_time				pass1time;
+	int64					ntuples = 0;
+	int64					nbounds = 0;
+	BlockNumber				npagesRead = 0;
+
+	bool					approximate = false;
+	float8					kthUpperBound = 0;
+	VACandidateList			candidateList = {NULL, 0, 0};
+	double					recall = 1.0;
+	TIDBitmap			   *candidates;
+
 	fmgr_info(BTFLOAT8CMPOID, &numeric_cmp_fmgr);
 
 	skey = scan->keyData;
 
-	//if limit is not set, then this index function should not have been chosen!
-	//error in cost function!
-	//numResults = adamOptions->nn_limit;
-	numResults = MAX(adamOptions->nn_limit, tbm_nentries(tbm));
+	//the queue only has to hold the requested neighbours, the tuples not fulfilling
+	//the other WHERE clauses are never inserted
+	numResults = adamOptions->nn_limit;
 	norm = adamOptions->nn_minkowski;
+	distance = adamOptions->nn_distance;
 
-	if (numResults > 0){
-		q = createQueue(numResults, &numeric_cmp_fmgr);
-	}
-	else {
-		//q is not created, thus we still do an index scan, but a very costly one (we add each tuple)!
-	}
-
-	if (norm < 0 || norm > 100){
+	if (!vaSupportsDistance(adamOptions, so->state.projection != NULL)){
 		ereport(ERROR,
 			(errcode(ERRCODE_INTERNAL_ERROR),
-			errmsg("VA indexing can only be used with Minkowski distances; the cost function estimator, however, did not take this into consideration"),
+			errmsg("VA indexing can only be used with Minkowski, cosine, inner product or hamming distances; the cost function estimator, however, did not take this into consideration"),
 			errhint("Force the use of other indices or sequential scan.")));
 	}
 
@@ -621,23 +1077,25 @@ bitmapMultiSearch(IndexScanDesc scan, TIDBitmap *tbm)
 		return (Datum)0;
 	}
 
-	if (numResults > 0){
-		//calculate lower bounds
-		l_bounds = precompute_differences_lbound(
-			&skey->sk_argument,
-			so->state.marks,
-			norm);
-
-		//calculate upper bounds
-		u_bounds = precompute_differences_ubound(
-			&skey->sk_argument,
-			so->state.marks,
-			norm);
+	//without a limit all the tuples fulfilling the other WHERE clauses are
+	//candidates, i.e. the bitmap is returned unchanged
+	if (numResults <= 0){
+		PG_RETURN_INT64((int64) tbm_ntuples(tbm, 1));
 	}
 
+	q = getQueue(scan, numResults, &numeric_cmp_fmgr);
+
+	//calculate lower and upper bounds
+	vaPrecomputeBounds(scan->indexRelation, &so->state, &skey->sk_argument, adamOptions, &l_bounds, &u_bounds);
+
 	f = (feature *)DatumGetPointer(skey->sk_argument);
 	dimensions = MIN(so->state.dimensions, ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data)));
 
+	//partitioned tables: no tuple of this partition can be closer than the neighbours found so far
+	if (q && skipPartition(scan, q, l_bounds, dimensions, so->state.partitions, norm, distance)){
+		PG_RETURN_INT64(0);
+	}
+
 	bas = GetAccessStrategy(BAS_BULKREAD);
 
 	if (!RELATION_IS_LOCAL(scan->indexRelation)){ LockRelation(scan->indexRelation, ShareLock); }
@@ -667,111 +1125,896 @@ bitmapMultiSearch(IndexScanDesc scan, TIDBitmap *tbm)
 			errhint("Please REINDEX it.")));
 	}
 
+	nChanges = meta_data->nChanges;
+
 	UnlockReleaseBuffer(meta_buffer);
 
-	for (blkno = VA_HEAD_BLKNO; blkno < npages; blkno++){
-		Buffer 			buffer;
-		Page			page;
+	//read the approximations from the VA cache if possible
+	cached = vaCacheLookup(scan->indexRelation, nChanges);
 
-		buffer = ReadBufferExtended(scan->indexRelation, MAIN_FORKNUM, blkno, RBM_NORMAL, bas);
+	if (!cached && va_cache_autoload && vaCacheEnabled()){
+		cached = vaLoadCache(scan->indexRelation, &so->state, nChanges, bas);
+	}
 
-		if (blkno + 1 < npages)
-			PrefetchBuffer(scan->indexRelation, MAIN_FORKNUM, blkno + 1);
+	if (instr){
+		INSTR_TIME_SET_CURRENT(starttime);
+	}
 
-		LockBuffer(buffer, BUFFER_LOCK_SHARE);
-		page = BufferGetPage(buffer);
+	vaBeginIterate(&it, scan->indexRelation, &so->state, npages, bas, cached);
+	while (vaIterate(&it, &itup, &itupEnd)){
+		while (itup < itupEnd){
+			if (tbm_contains_tuple(tbm, &itup->heapPtr)){
+				//strategy as in (Weber, 2000, Program 5.6), implementation of VAF-NOA
 
-		if (!isDeleted(page)){
-			Tuple	 *itup = getData(page);
-			Tuple   *itupEnd = (Tuple*)(((char*)itup) + so->state.sizeOfTuple * getMaxOffset(page));
+				//calculate the lower bound
+				l_bound = get_bound(itup->apx, l_bounds, dimensions,
+					so->state.partitions, norm, distance, false);
+				nbounds++;
 
-			while (itup < itupEnd){
-				if (tbm_contains_tuple(tbm, &itup->heapPtr)){
-					//strategy as in (Weber, 2000, Program 5.6), implementation of VAF-NOA
-					if (q){
-						//calculate the lower bound
-						l_bound = get_bound(itup->apx, l_bounds, dimensions,
-							so->state.partitions, norm);
-
-						if (insertIntoQueueCheck(q, Float8GetDatum(l_bound))){
-
-							//calculate the upper bound
-							u_bound = get_bound(itup->apx, u_bounds, dimensions,
-								so->state.partitions, norm);
-
-							if (insertIntoQueue(q, Float8GetDatum(l_bound), Float8GetDatum(u_bound))){
-								//tbm_add_tuples(tbm, &itup->heapPtr, 1, false);
-								//ntids++;
-							}
-						}
-					}
+				if (insertIntoQueueCheck(q, Float8GetDatum(l_bound))){
 
-					//if q not created, i.e. we have no limit; our cost-function should have
-					//caught this case, now we have a very costly search
-					//(at least more expensive than just doing a sequential search)!
-					if (!q){
-						tbm_add_tuples(tbm, &itup->heapPtr, 1, false);
+					//calculate the upper bound
+					u_bound = get_bound(itup->apx, u_bounds, dimensions,
+						so->state.partitions, norm, distance, true);
+					nbounds++;
+
+					insertIntoQueue(q, Float8GetDatum(l_bound), Float8GetDatum(u_bound));
+				}
+			}
+
+			ntuples++;
+			itup = (Tuple*)(((char*)itup) + so->state.sizeOfTuple);
+		}
+	}
+
+	npagesRead += it.pagesRead;
+
+	if (instr){
+		INSTR_TIME_SET_CURRENT(pass1time);
+	}
+
+	//the candidates are collected separately, since the bitmap is still needed for
+	//checking the tuples; in the end only the candidates are left in the bitmap
+	candidates = tbm_create(work_mem * 1024L);
+
+	approximate = vaIsApproximate(q);
+	if (approximate){
+		kthUpperBound = DatumGetFloat8(*getMaximumElement(q));
+	}
+
+	vaBeginIterate(&it, scan->indexRelation, &so->state, npages, bas, cached);
+	while (vaIterate(&it, &itup, &itupEnd)){
+		while (itup < itupEnd){
+			if (tbm_contains_tuple(tbm, &itup->heapPtr)){
+				//strategy as in (Weber, 2000, Program 5.6), implementation of VAF-NOA
+
+				//calculate the lower bound
+				l_bound = get_bound(itup->apx, l_bounds, dimensions,
+					so->state.partitions, norm, distance, false);
+				nbounds++;
+
+				if (insertIntoQueueCheck(q, Float8GetDatum(l_bound))){
+					if (approximate){
+						//the upper bound is needed for estimating the recall
+						u_bound = get_bound(itup->apx, u_bounds, dimensions,
+							so->state.partitions, norm, distance, true);
+						nbounds++;
+
+						addCandidate(&candidateList, &itup->heapPtr, l_bound, u_bound);
+					} else {
+						tbm_add_tuples(candidates, &itup->heapPtr, 1, false);
 						ntids++;
 					}
 				}
 
-				itup = (Tuple*)(((char*)itup) + so->state.sizeOfTuple);
 			}
+
+			itup = (Tuple*)(((char*)itup) + so->state.sizeOfTuple);
 		}
+	}
 
-		UnlockReleaseBuffer(buffer);
-		CHECK_FOR_INTERRUPTS();
+	npagesRead += it.pagesRead;
+
+	if (approximate){
+		ntids = vaAddApproximateCandidates(candidates, &candidateList, numResults, kthUpperBound, &recall);
 	}
 
-	if (q){
-		for (blkno = VA_HEAD_BLKNO; blkno < npages; blkno++){
-			Buffer 			buffer;
-			Page			page;
+	if (instr){
+		vaAddInstrumentation(instr, q, ntuples, ntids, nbounds, npagesRead, cached != NULL, &starttime, &pass1time);
 
-			buffer = ReadBufferExtended(scan->indexRelation, MAIN_FORKNUM, blkno, RBM_NORMAL, bas);
+		if (approximate){
+			instr->approximateScans++;
+			instr->recallSum += recall;
+		}
+	}
 
-			if (blkno + 1 < npages)
-				PrefetchBuffer(scan->indexRelation, MAIN_FORKNUM, blkno + 1);
+	if (candidateList.items){
+		pfree(candidateList.items);
+	}
 
-			LockBuffer(buffer, BUFFER_LOCK_SHARE);
-			page = BufferGetPage(buffer);
+	if (cached){
+		vaCacheRelease(cached);
+	}
 
-			if (!isDeleted(page)){
-				Tuple	 *itup = getData(page);
-				Tuple   *itupEnd = (Tuple*)(((char*)itup) + so->state.sizeOfTuple * getMaxOffset(page));
+	FreeAccessStrategy(bas);
 
-				while (itup < itupEnd){
-					if (tbm_contains_tuple(tbm, &itup->heapPtr)){
-						//strategy as in (Weber, 2000, Program 5.6), implementation of VAF-NOA
+	tbm_intersect(tbm, candidates);
+	tbm_free(candidates);
 
-						//calculate the lower bound
-						l_bound = get_bound(itup->apx, l_bounds, dimensions,
-							so->state.partitions, norm);
+	if (q != scan->adamQueue){
+		pfree(q);
+	}
 
-						if (insertIntoQueueCheck(q, Float8GetDatum(l_bound))){
-							tbm_add_tuples(tbm, &itup->heapPtr, 1, false);
-							ntids++;
-						}
+	PG_RETURN_INT64(ntids);
+}
+
+
+/*
+ * collects the candidates of a similarity join (see adam_retrieval_join.c) for a
+ * block of query vectors with a single scan of the VA file per pass, i.e. the
+ * pages are read once for all the queries instead of once per query
+ *
+ * kNN-join (k > 0): the first pass determines the k-th smallest upper bound of
+ * each query, the second pass adds the approximations whose lower bound does not
+ * exceed it for at least one query; epsilon-join (k = 0): the approximations whose
+ * lower bound does not exceed epsilon for at least one query are added in a
+ * single pass
+ */
+TIDBitmap *
+vaJoinCandidates(Relation index, feature **queries, int nqueries, int k, float8 epsilon, MinkowskiNorm norm)
+{
+	StateOptions			state;
+	BufferAccessStrategy	bas;
+	BlockNumber				npages;
+	VACacheEntry		   *cached;
+	VAIterator				it;
+	Tuple				   *itup;
+	Tuple				   *itupEnd;
+
+	TIDBitmap			   *tbm;
+	float8				  **l_bounds;
+	float8				  **u_bounds;
+	float8				   *thresholds;
+	float8				   *heaps;
+	int					   *heapSizes;
+	int						dimensions;
+	int						q;
+
+	initStateOptions(&state, index, NULL);
+	dimensions = state.dimensions;
+
+	l_bounds = (float8 **) palloc(nqueries * sizeof(float8 *));
+	u_bounds = (float8 **) palloc(nqueries * sizeof(float8 *));
+	thresholds = (float8 *) palloc(nqueries * sizeof(float8));
+
+	for (q = 0; q < nqueries; q++){
+		Datum query = PointerGetDatum(queries[q]);
+
+		dimensions = MIN(dimensions, ArrayGetNItems(ARR_NDIM(&queries[q]->data), ARR_DIMS(&queries[q]->data)));
+
+		//the upper bounds of the residual are those of the negated residual of the query
+		if (state.projection){
+			Datum projected = PointerGetDatum(vaProjectFeature(state.projection, queries[q], false));
+			Datum negated = PointerGetDatum(vaProjectFeature(state.projection, queries[q], true));
+
+			dimensions = state.dimensions;
+
+			l_bounds[q] = precompute_differences_lbound(&projected, state.marks, norm, ADAM_DISTANCE_MINKOWSKI);
+			u_bounds[q] = (k > 0) ? precompute_differences_ubound(&negated, state.marks, norm, ADAM_DISTANCE_MINKOWSKI) : NULL;
+			thresholds[q] = epsilon;
+			continue;
+		}
+
+		l_bounds[q] = precompute_differences_lbound(&query, state.marks, norm, ADAM_DISTANCE_MINKOWSKI);
+		u_bounds[q] = (k > 0) ? precompute_differences_ubound(&query, state.marks, norm, ADAM_DISTANCE_MINKOWSKI) : NULL;
+		thresholds[q] = epsilon;
+	}
+
+	bas = GetAccessStrategy(BAS_BULKREAD);
+
+	if (!RELATION_IS_LOCAL(index)){ LockRelation(index, ShareLock); }
+	npages = RelationGetNumberOfBlocks(index);
+	if (!RELATION_IS_LOCAL(index)){ UnlockRelation(index, ShareLock); }
+
+	cached = vaCacheLookup(index, vaGetChanges(index));
+
+	//first pass: k-th smallest upper bound of each query
+	if (k > 0){
+		heaps = (float8 *) palloc(nqueries * k * sizeof(float8));
+		heapSizes = (int *) palloc0(nqueries * sizeof(int));
+
+		vaBeginIterate(&it, index, &state, npages, bas, cached);
+		while (vaIterate(&it, &itup, &itupEnd)){
+			while (itup < itupEnd){
+				for (q = 0; q < nqueries; q++){
+					float8 *heap = &heaps[q * k];
+					float8 l_bound = get_bound(itup->apx, l_bounds[q], dimensions,
+						state.partitions, norm, ADAM_DISTANCE_MINKOWSKI, false);
+
+					if (heapSizes[q] < k || l_bound < heap[0]){
+						float8 u_bound = get_bound(itup->apx, u_bounds[q], dimensions,
+							state.partitions, norm, ADAM_DISTANCE_MINKOWSKI, true);
+
+						vaJoinHeapInsert(heap, &heapSizes[q], k, u_bound);
+					}
+				}
+
+				itup = (Tuple*)(((char*)itup) + state.sizeOfTuple);
+			}
+		}
+
+		for (q = 0; q < nqueries; q++){
+			thresholds[q] = (heapSizes[q] == k) ? heaps[q * k] : get_float8_infinity();
+		}
+
+		pfree(heaps);
+		pfree(heapSizes);
+	}
+
+	//second pass: approximations that may be within the threshold of a query
+	tbm = tbm_create(work_mem * 1024L);
+
+	vaBeginIterate(&it, index, &state, npages, bas, cached);
+	while (vaIterate(&it, &itup, &itupEnd)){
+		while (itup < itupEnd){
+			for (q = 0; q < nqueries; q++){
+				float8 l_bound = get_bound(itup->apx, l_bounds[q], dimensions,
+					state.partitions, norm, ADAM_DISTANCE_MINKOWSKI, false);
+
+				if (l_bound <= thresholds[q]){
+					tbm_add_tuples(tbm, &itup->heapPtr, 1, false);
+					break;
+				}
+			}
+
+			itup = (Tuple*)(((char*)itup) + state.sizeOfTuple);
+		}
+	}
+
+	if (cached){
+		vaCacheRelease(cached);
+	}
+
+	FreeAccessStrategy(bas);
+
+	for (q = 0; q < nqueries; q++){
+		pfree(l_bounds[q]);
+
+		if (u_bounds[q]){
+			pfree(u_bounds[q]);
+		}
+	}
+
+	pfree(l_bounds);
+	pfree(u_bounds);
+	pfree(thresholds);
+
+	return tbm;
+}
+
+/*
+ * orders the tuples of a table for CLUSTER on a VA file (see copy_heap_data): the
+ * tuples are sorted along a z-order curve over the cells of their approximations,
+ * i.e. tuples with similar features end up on nearby pages and the candidates of
+ * a search are read from mostly contiguous pages; as the VA file is rebuilt after
+ * clustering, its approximations follow the same order
+ *
+ * all tuples are returned (see vaClusterNext), dead tuples and tuples without a
+ * feature at the end; the features of dead tuples are not read, as their toasted
+ * values may already be gone
+ */
+VAClusterState *
+vaBeginCluster(Relation heap, Relation index, TransactionId OldestXmin)
+{
+	VAClusterState		   *cstate = palloc0(sizeof(VAClusterState));
+	StateOptions			state;
+	IndexInfo			   *indexInfo;
+	EState				   *estate;
+	ExprContext			   *econtext;
+	TupleTableSlot		   *slot;
+	HeapScanDesc			scan;
+	HeapTuple				tuple;
+	Datum					values[INDEX_MAX_KEYS];
+	bool					isnull[INDEX_MAX_KEYS];
+	BitStringElement	   *apx;
+	bytea				   *key;
+	int						bits = 0;
+
+	initStateOptions(&state, index, NULL);
+
+	//bits of the cell numbers that are interleaved
+	while (bits < 8 * (int) sizeof(BitStringElement) && (1 << bits) < state.partitions){
+		bits++;
+	}
+
+	apx = palloc(MAX(state.dimensions, 1) * sizeof(BitStringElement));
+	key = palloc(VARHDRSZ + 1 + (state.dimensions * bits + 7) / 8 + 6);
+
+	cstate->sortstate = tuplesort_begin_datum(BYTEAOID, ByteaLessOperator, InvalidOid, false,
+		maintenance_work_mem, false);
+
+	indexInfo = BuildIndexInfo(index);
+	estate = CreateExecutorState();
+	econtext = GetPerTupleExprContext(estate);
+	slot = MakeSingleTupleTableSlot(RelationGetDescr(heap));
+	econtext->ecxt_scantuple = slot;
+
+	scan = heap_beginscan(heap, SnapshotAny, 0, (ScanKey) NULL);
+
+	while ((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL){
+		bool isdead;
+		bool hasApx = false;
+
+		CHECK_FOR_INTERRUPTS();
+
+		LockBuffer(scan->rs_cbuf, BUFFER_LOCK_SHARE);
+		isdead = (HeapTupleSatisfiesVacuum(tuple->t_data, OldestXmin, scan->rs_cbuf) == HEAPTUPLE_DEAD);
+		LockBuffer(scan->rs_cbuf, BUFFER_LOCK_UNLOCK);
+
+		if (!isdead){
+			ResetExprContext(econtext);
+			ExecStoreTuple(tuple, slot, InvalidBuffer, false);
+			FormIndexDatum(indexInfo, slot, estate, values, isnull);
+
+			if (!isnull[0]){
+				MemoryContext oldCtx = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+				feature *f = featureToFloat8((feature *) PG_DETOAST_DATUM(values[0]));
+
+				if (state.projection){
+					f = vaProjectFeature(state.projection, f, false);
+				}
+
+				set_bitstring(f, state.marks, apx);
+				hasApx = true;
+
+				MemoryContextSwitchTo(oldCtx);
+			}
+		}
+
+		tuplesort_putdatum(cstate->sortstate,
+			formClusterKey(key, hasApx ? apx : NULL, state.dimensions, bits, &tuple->t_self), false);
+	}
+
+	heap_endscan(scan);
+
+	ExecDropSingleTupleTableSlot(slot);
+	FreeExecutorState(estate);
+
+	pfree(apx);
+	pfree(key);
+
+	tuplesort_performsort(cstate->sortstate);
+
+	return cstate;
+}
+
+/*
+ * returns the next tuple in the order of vaBeginCluster
+ */
+bool
+vaClusterNext(VAClusterState *cstate, ItemPointer heapPtr)
+{
+	Datum	datum;
+	bool	isnull;
+	bytea	*key;
+	uint8	*tid;
+
+	if (!tuplesort_getdatum(cstate->sortstate, true, &datum, &isnull)){
+		return false;
+	}
+
+	key = DatumGetByteaP(datum);
+	tid = (uint8 *) VARDATA(key) + VARSIZE(key) - VARHDRSZ - 6;
+
+	ItemPointerSet(heapPtr,
+		((BlockNumber) tid[0] << 24) | ((BlockNumber) tid[1] << 16) | ((BlockNumber) tid[2] << 8) | tid[3],
+		(OffsetNumber) ((tid[4] << 8) | tid[5]));
+
+	pfree(key);
+
+	return true;
+}
+
+void
+vaEndCluster(VAClusterState *cstate)
+{
+	tuplesort_end(cstate->sortstate);
+	pfree(cstate);
+}
+
+/*
+ * builds the sort key of a tuple: tuples without an approximation (dead tuples
+ * or null features) come last, then the bits of the cells are interleaved from
+ * the most significant bit of all dimensions down, so that the byte order of the
+ * keys is the z-order of the approximations (the dimension whose cells differ in
+ * the most significant bit decides); tuples in the same cell keep their order in
+ * the table, as the TID is appended
+ */
+static Datum
+formClusterKey(bytea *key, BitStringElement *apx, int dimensions, int bits, ItemPointer heapPtr)
+{
+	Size		len = 1 + (dimensions * bits + 7) / 8 + 6;
+	uint8	   *data = (uint8 *) VARDATA(key);
+	uint8	   *tid = data + len - 6;
+	BlockNumber	blkno = ItemPointerGetBlockNumber(heapPtr);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(heapPtr);
+	int			pos = 0;
+	int			b, d;
+
+	SET_VARSIZE(key, VARHDRSZ + len);
+	memset(data, 0, len);
+
+	data[0] = (apx == NULL);
+
+	if (apx){
+		for (b = bits - 1; b >= 0; b--){
+			for (d = 0; d < dimensions; d++, pos++){
+				if ((apx[d] >> b) & 1){
+					data[1 + pos / 8] |= 0x80 >> (pos % 8);
+				}
+			}
+		}
+	}
+
+	tid[0] = (uint8) (blkno >> 24);
+	tid[1] = (uint8) (blkno >> 16);
+	tid[2] = (uint8) (blkno >> 8);
+	tid[3] = (uint8) blkno;
+	tid[4] = (uint8) (offnum >> 8);
+	tid[5] = (uint8) offnum;
+
+	return PointerGetDatum(key);
+}
+
+/*
+ * inserts a value into a max-heap keeping the k smallest values
+ */
+static void
+vaJoinHeapInsert(float8 *heap, int *size, int k, float8 value)
+{
+	int i;
+
+	if (*size < k){
+		//sift up
+		i = (*size)++;
+
+		while (i > 0 && heap[(i - 1) / 2] < value){
+			heap[i] = heap[(i - 1) / 2];
+			i = (i - 1) / 2;
+		}
+
+		heap[i] = value;
+	}
+	else if (value < heap[0]){
+		//replace the largest value and sift down
+		i = 0;
+
+		while (2 * i + 1 < k){
+			int child = 2 * i + 1;
+
+			if (child + 1 < k && heap[child + 1] > heap[child]){
+				child++;
+			}
+
+			if (heap[child] <= value){
+				break;
+			}
+
+			heap[i] = heap[child];
+			i = child;
+		}
+
+		heap[i] = value;
+	}
+}
+
+/*
+ * starts running through the approximations of the VA file; if an entry of the
+ * VA cache is given, the approximations are taken from there
+ */
+static void
+vaBeginIterate(VAIterator *it, Relation index, StateOptions *state, BlockNumber npages, BufferAccessStrategy bas, VACacheEntry *cached)
+{
+	it->index = index;
+	it->state = state;
+	it->bas = bas;
+	it->blkno = VA_HEAD_BLKNO;
+	it->npages = npages;
+	it->buffer = InvalidBuffer;
+	it->pagesRead = 0;
+	it->cached = cached;
+	it->cachedPos = 0;
+}
+
+/*
+ * returns the next chunk of approximations in [itup, itupEnd), i.e. the tuples of
+ * the next page that is not deleted or of the next chunk of the VA cache entry; the
+ * page returned before is released
+ */
+static bool
+vaIterate(VAIterator *it, Tuple **itup, Tuple **itupEnd)
+{
+	if (it->cached){
+		/* the entry is returned in chunks of a page, so that the scan can be cancelled */
+		Size chunk = MAX(BLCKSZ / it->state->sizeOfTuple, 1) * it->state->sizeOfTuple;
+
+		if (it->cachedPos > 0){
+			CHECK_FOR_INTERRUPTS();
+		}
+
+		if (it->cachedPos >= vaCacheLength(it->cached)){
+			return false;
+		}
+
+		chunk = MIN(chunk, vaCacheLength(it->cached) - it->cachedPos);
+
+		*itup = (Tuple*) (vaCacheData(it->cached) + it->cachedPos);
+		*itupEnd = (Tuple*)(((char*)*itup) + chunk);
+		it->cachedPos += chunk;
+
+		return true;
+	}
+
+	if (BufferIsValid(it->buffer)){
+		UnlockReleaseBuffer(it->buffer);
+		it->buffer = InvalidBuffer;
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	while (it->blkno < it->npages){
+		Buffer 			buffer;
+		Page			page;
+
+		buffer = ReadBufferExtended(it->index, MAIN_FORKNUM, it->blkno, RBM_NORMAL, it->bas);
+		it->pagesRead++;
+
+		if (it->blkno + 1 < it->npages)
+			PrefetchBuffer(it->index, MAIN_FORKNUM, it->blkno + 1);
+
+		it->blkno++;
+
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buffer);
+
+		if (!isDeleted(page)){
+			it->buffer = buffer;
+			*itup = getData(page);
+			*itupEnd = (Tuple*)(((char*)*itup) + it->state->sizeOfTuple * getMaxOffset(page));
+
+			return true;
+		}
+
+		UnlockReleaseBuffer(buffer);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	return false;
+}
+
+/*
+ * releases the page of an iteration that is stopped before its end
+ */
+static void
+vaEndIterate(VAIterator *it)
+{
+	if (BufferIsValid(it->buffer)){
+		UnlockReleaseBuffer(it->buffer);
+		it->buffer = InvalidBuffer;
+	}
+}
+
+/*
+ * returns the number of changes stored in the meta page of the VA file, i.e. the
+ * number of tuples inserted and removed since the VA file has been built
+ */
+uint32
+vaGetChanges(Relation index)
+{
+	Buffer			meta_buffer;
+	uint32			nChanges;
+
+	meta_buffer = ReadBuffer(index, VA_METAPAGE_BLKNO);
+	LockBuffer(meta_buffer, BUFFER_LOCK_SHARE);
+	nChanges = GetMeta(BufferGetPage(meta_buffer))->nChanges;
+	UnlockReleaseBuffer(meta_buffer);
+
+	return nChanges;
+}
+
+/*
+ * copies the approximations of the VA file into the VA cache; returns the pinned
+ * entry or NULL if the VA file does not fit into the cache or has been changed
+ * while copying it (nChanges is the number of changes the caller has seen)
+ */
+static VACacheEntry *
+vaLoadCache(Relation index, StateOptions *state, uint32 nChanges, BufferAccessStrategy bas)
+{
+	VACacheEntry		   *entry;
+	VAIterator				it;
+	BlockNumber				npages;
+	Tuple				   *itup;
+	Tuple				   *itupEnd;
+	Size					len = 0;
+	Size					pos = 0;
+	bool					complete = true;
+	char				   *data;
+
+	if (!RELATION_IS_LOCAL(index)){ LockRelation(index, ShareLock); }
+	npages = RelationGetNumberOfBlocks(index);
+	if (!RELATION_IS_LOCAL(index)){ UnlockRelation(index, ShareLock); }
+
+	//first pass: size of the approximations without page headers
+	vaBeginIterate(&it, index, state, npages, bas, NULL);
+	while (vaIterate(&it, &itup, &itupEnd)){
+		len += ((char*)itupEnd) - ((char*)itup);
+	}
+
+	entry = vaCacheReserve(index, nChanges, len);
+
+	if (!entry){
+		return NULL;
+	}
+
+	//second pass: copy the approximations
+	data = vaCacheData(entry);
+
+	vaBeginIterate(&it, index, state, npages, bas, NULL);
+	while (vaIterate(&it, &itup, &itupEnd)){
+		Size n = ((char*)itupEnd) - ((char*)itup);
+
+		if (pos + n > len){
+			complete = false;
+			vaEndIterate(&it);
+			break;
+		}
+
+		memcpy(data + pos, itup, n);
+		pos += n;
+	}
+
+	//the VA file must not have been changed in the meantime
+	if (!complete || pos != len || vaGetChanges(index) != nChanges){
+		vaCacheRelease(entry);
+		return NULL;
+	}
+
+	vaCacheFinish(entry);
+
+	return entry;
+}
+
+/*
+ * loads the VA file into the VA cache (see adam_index_va_cache.c) and returns
+ * the number of tuples cached
+ */
+Datum
+va_prewarm(PG_FUNCTION_ARGS)
+{
+	Relation				index = vaOpenIndex(PG_GETARG_OID(0));
+	StateOptions			state;
+	BufferAccessStrategy	bas;
+	VACacheEntry		   *entry;
+	uint32					nChanges;
+	int64					ntuples = 0;
+
+	if (!vaCacheEnabled()){
+		ereport(ERROR,
+			(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+			errmsg("the VA cache is disabled"),
+			errhint("Set va_cache_size in postgresql.conf and restart the server.")));
+	}
+
+	initStateOptions(&state, index, NULL);
+	nChanges = vaGetChanges(index);
+
+	entry = vaCacheLookup(index, nChanges);
+
+	if (!entry){
+		bas = GetAccessStrategy(BAS_BULKREAD);
+		entry = vaLoadCache(index, &state, nChanges, bas);
+		FreeAccessStrategy(bas);
+	}
+
+	if (entry){
+		ntuples = vaCacheLength(entry) / state.sizeOfTuple;
+		vaCacheRelease(entry);
+	}
+	else {
+		ereport(WARNING,
+			(errmsg("index \"%s\" could not be loaded into the VA cache", RelationGetRelationName(index)),
+			errhint("The index is either being changed or loaded by another session, or va_cache_size is too small.")));
+	}
+
+	index_close(index, AccessShareLock);
+
+	PG_RETURN_INT64(ntuples);
+}
+
+/*
+ * returns the strategy the marks of the VA file have been built with (see VAIndexMarks)
+ */
+int
+vaGetMarksStrategy(Relation index)
+{
+	StateOptions			state;
+
+	initStateOptions(&state, index, NULL);
+
+	return state.opts->indexMarks;
+}
+
+/*
+ * checks whether the bounds of the VA file hold for the Minkowski distance with the
+ * given norm (see vaSupportsDistance)
+ */
+bool
+vaSupportsNorm(Relation index, MinkowskiNorm norm)
+{
+	StateOptions			state;
+
+	initStateOptions(&state, index, NULL);
+
+	if (state.projection){
+		return fabs(norm - 2) < EPSILON;
+	}
+
+	return true;
+}
+
+/*
+ * measures how unevenly the approximations are spread over the cells of the marks;
+ * for every dimension the share of the tuples that would have to move to another
+ * cell to populate all cells evenly is computed, normalized to [0, 1] and averaged
+ * over the dimensions; for equifrequent marks this is close to 0 right after
+ * building the VA file and grows if the data drifts away from the marks (e.g.
+ * new values fall into the outermost cells); equidistant marks are only balanced
+ * for uniformly distributed data
+ */
+double
+vaCellImbalance(Relation index)
+{
+	StateOptions			state;
+	BufferAccessStrategy	bas;
+	VAIterator				it;
+	VACacheEntry		   *cached;
+	BlockNumber				npages;
+	Tuple				   *itup;
+	Tuple				   *itupEnd;
+	int64				   *counts;
+	int64					ntuples = 0;
+	int						cells;
+	int						dim, cell;
+	double					expected;
+	double					imbalance = 0;
+
+	initStateOptions(&state, index, NULL);
+
+	cells = state.partitions - 1;
+
+	if (cells <= 1 || state.dimensions <= 0){
+		return 0;
+	}
+
+	counts = palloc0(sizeof(int64) * state.dimensions * cells);
+
+	if (!RELATION_IS_LOCAL(index)){ LockRelation(index, ShareLock); }
+	npages = RelationGetNumberOfBlocks(index);
+	if (!RELATION_IS_LOCAL(index)){ UnlockRelation(index, ShareLock); }
+
+	bas = GetAccessStrategy(BAS_BULKREAD);
+	cached = vaCacheLookup(index, vaGetChanges(index));
+
+	vaBeginIterate(&it, index, &state, npages, bas, cached);
+	while (vaIterate(&it, &itup, &itupEnd)){
+		while (itup < itupEnd){
+			for (dim = 0; dim < state.dimensions; dim++){
+				cell = MIN(GET_WORD(itup->apx, dim), cells - 1);
+				counts[dim * cells + cell]++;
+			}
+
+			ntuples++;
+			itup = (Tuple*)(((char*)itup) + state.sizeOfTuple);
+		}
+	}
+
+	if (cached){
+		vaCacheRelease(cached);
+	}
+
+	FreeAccessStrategy(bas);
+
+	if (ntuples == 0){
+		pfree(counts);
+		return 0;
+	}
+
+	expected = ((double) ntuples) / cells;
+
+	for (dim = 0; dim < state.dimensions; dim++){
+		double deviation = 0;
+
+		for (cell = 0; cell < cells; cell++){
+			deviation += fabs(counts[dim * cells + cell] - expected);
+		}
+
+		//at most all the tuples but the ones of one cell are misplaced
+		imbalance += deviation / (2.0 * ntuples * (1.0 - 1.0 / cells));
+	}
+
+	pfree(counts);
+
+	return imbalance / state.dimensions;
+}
+
+/*
+ * opens the VA index given for the SQL-callable functions
+ */
+static Relation
+vaOpenIndex(Oid indexId)
+{
+	Relation				index;
+
+	index = index_open(indexId, AccessShareLock);
+
+	if (index->rd_rel->relam != VA_AM_OID){
+		ereport(ERROR,
+			(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+			errmsg("\"%s\" is not a VA index", RelationGetRelationName(index))));
+	}
+
+	return index;
+}
+
+/*
+ * returns the number of tuples inserted and removed since the VA file has been built
+ */
+Datum
+va_changes(PG_FUNCTION_ARGS)
+{
+	Relation				index = vaOpenIndex(PG_GETARG_OID(0));
+	uint32					nChanges;
+
+	nChanges = vaGetChanges(index);
+
+	index_close(index, AccessShareLock);
+
+	PG_RETURN_INT64((int64) nChanges);
+}
+
+/*
+ * returns the time the VA file has been built at
+ */
+Datum
+va_build_time(PG_FUNCTION_ARGS)
+{
+	Relation				index = vaOpenIndex(PG_GETARG_OID(0));
+	Buffer					meta_buffer;
+	TimestampTz				buildTime;
 
-					}
+	meta_buffer = ReadBuffer(index, VA_METAPAGE_BLKNO);
+	LockBuffer(meta_buffer, BUFFER_LOCK_SHARE);
+	buildTime = GetMeta(BufferGetPage(meta_buffer))->buildTime;
+	UnlockReleaseBuffer(meta_buffer);
 
-					itup = (Tuple*)(((char*)itup) + so->state.sizeOfTuple);
-				}
-			}
+	index_close(index, AccessShareLock);
 
-			UnlockReleaseBuffer(buffer);
-			CHECK_FOR_INTERRUPTS();
-		}
-	}
+	PG_RETURN_TIMESTAMPTZ(buildTime);
+}
 
+/*
+ * SQL-callable version of vaCellImbalance
+ */
+Datum
+va_imbalance(PG_FUNCTION_ARGS)
+{
+	Relation				index = vaOpenIndex(PG_GETARG_OID(0));
+	double					imbalance;
 
-	FreeAccessStrategy(bas);
+	imbalance = vaCellImbalance(index);
 
-	if (q){
-		pfree(q);
-	}
+	index_close(index, AccessShareLock);
 
-	PG_RETURN_INT64(ntids);
+	PG_RETURN_FLOAT8(imbalance);
 }
 
 
@@ -805,6 +2048,8 @@ vaBuild(PG_FUNCTION_ARGS)
 	Buffer		MetaBuffer;
 
 	Datum	marks;
+	ArrayType  *projection;
+	FileOptions *opts;
 
 	ListCell	*index_field;
 
@@ -828,8 +2073,15 @@ vaBuild(PG_FUNCTION_ARGS)
 	/* initialize the meta page */
 	MetaBuffer = newBuffer(index);
 
-	marks = calculateMarks(heap, indexInfo);
-	UpdateIndexAddMarks(index->rd_id, marks);
+	opts = (FileOptions *) index->rd_options;
+
+	if (opts){
+		marks = calculateMarks(heap, index, indexInfo, getProjectionMethod(opts), opts->components, &projection);
+	} else {
+		marks = calculateMarks(heap, index, indexInfo, VA_PROJECTION_NONE, 0, &projection);
+	}
+
+	UpdateIndexAddMarks(index->rd_id, marks, PointerGetDatum(projection));
 
 	START_CRIT_SECTION();
 	initMetabuffer(MetaBuffer, index);
@@ -838,6 +2090,7 @@ vaBuild(PG_FUNCTION_ARGS)
 	UnlockReleaseBuffer(MetaBuffer);
 
 	initStateOptions(&buildstate.blstate, index, DatumGetArrayTypeP(marks));
+	buildstate.blstate.projection = projection;
 
 	buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
 		"VA build temporary context",
@@ -947,6 +2200,12 @@ vaInsert(PG_FUNCTION_ARGS)
 
 
 		if (addItemToBlock(index, &blstate, itup, blkno)){
+			/*
+			 * the change counter validates the cached VA files (see vaLoadCache),
+			 * so no increment may get lost between concurrent inserts
+			 */
+			LockBuffer(metaBuffer, BUFFER_LOCK_UNLOCK);
+			LockBuffer(metaBuffer, BUFFER_LOCK_EXCLUSIVE);
 			START_CRIT_SECTION();
 			metaData->nChanges++;
 			END_CRIT_SECTION();
@@ -975,7 +2234,7 @@ vaInsert(PG_FUNCTION_ARGS)
 
 		Assert(blkno != InvalidBlockNumber);
 		if (addItemToBlock(index, &blstate, itup, blkno)) {
-			LockBuffer(metaBuffer, BUFFER_LOCK_EXCLUSIVE);
+			/* the meta page is still locked exclusively */
 			START_CRIT_SECTION();
 			metaData->nChanges++;
 			END_CRIT_SECTION();
@@ -995,6 +2254,7 @@ vaInsert(PG_FUNCTION_ARGS)
 	addItem(&blstate, BufferGetPage(buffer), itup);
 
 	START_CRIT_SECTION();
+	metaData->nChanges++;
 	metaData->nStart = 0;
 	metaData->nEnd = 1;
 	metaData->notFullPage[0] = BufferGetBlockNumber(buffer);
@@ -1102,7 +2362,7 @@ vaCostEstimate(PG_FUNCTION_ARGS)
 	Selectivity *indexSelectivity = (Selectivity *)PG_GETARG_POINTER(5);
 	double	   *indexCorrelation = (double *)PG_GETARG_POINTER(6);
 
-	//AdamQueryClause *adamOptions = (AdamQueryClause *) root->parse->adamQueryClause;
+	AdamQueryClause *adamOptions = (AdamQueryClause *) root->parse->adamQueryClause;
 
 	FileOptions* relopts = getRelopts(path->indexinfo->indexoid);
 
@@ -1120,12 +2380,12 @@ vaCostEstimate(PG_FUNCTION_ARGS)
 		disableCost = true;
 	}
 
-	/* if offset used, then VA is not useful */
-	if (root->parse->limitOffset){
+	if (!enable_vascan){
 		disableCost = true;
 	}
 
-	if (!enable_vascan){
+	/* no bounds can be computed for user-defined distances */
+	if (adamOptions && !vaSupportsDistance(adamOptions, getProjectionMethod(relopts) != VA_PROJECTION_NONE)){
 		disableCost = true;
 	}
 
@@ -1142,6 +2402,140 @@ vaCostEstimate(PG_FUNCTION_ARGS)
 	PG_RETURN_VOID();
 }
 
+/*
+ * costs of fetching n tuples from the heap and calculating their exact distance
+ */
+static Cost
+vaRefineCost(double n)
+{
+	return n * (random_page_cost + cpu_tuple_cost + VA_DISTANCE_COST * cpu_operator_cost);
+}
+
+/*
+ * chooses how to combine a distance search with other WHERE clauses, where
+ * ntuples and pages describe the VA file, nfiltered is the (estimated) number of tuples
+ * fulfilling the other WHERE clauses and limit the number of requested neighbours;
+ * if the tuples fulfilling the other WHERE clauses are not known before the VA
+ * file is scanned (i.e. there is no other index for them), only post-filtering
+ * is possible
+ */
+VAFilterStrategy
+vaChooseFilterStrategy(double ntuples, BlockNumber pages, double nfiltered, double limit, bool filterKnown, Cost *cost)
+{
+	Cost pre_cost, index_cost, post_cost;
+	Cost scan_cost = pages * seq_page_cost + ntuples * cpu_index_tuple_cost;
+
+	if(ntuples < 1){
+		ntuples = 1;
+	}
+
+	nfiltered = MAX(0, MIN(nfiltered, ntuples));
+
+	if(limit <= 0){
+		limit = ntuples;
+	}
+
+	if(!filterKnown){
+		post_cost = scan_cost + ntuples * VA_BOUND_COST * cpu_operator_cost
+			+ vaRefineCost(vaPostFilterLimit(limit, nfiltered / ntuples, ntuples));
+
+		if(cost){
+			*cost = post_cost;
+		}
+
+		return VA_FILTER_POST;
+	}
+
+	pre_cost = vaRefineCost(nfiltered);
+	index_cost = scan_cost + nfiltered * VA_BOUND_COST * cpu_operator_cost
+		+ vaRefineCost(MIN(limit, nfiltered));
+
+	if(pre_cost <= index_cost){
+		if(cost){
+			*cost = pre_cost;
+		}
+		return VA_FILTER_PRE;
+	}
+
+	if(cost){
+		*cost = index_cost;
+	}
+
+	return VA_FILTER_INDEX;
+}
+
+/*
+ * costs of vaJoinCandidates for nqueries queries of a kNN-join, where ntuples and
+ * pages describe the VA file; the number of candidates to refine is returned in
+ * ncandidates (only the neighbours, as for a single query)
+ */
+Cost
+vaJoinCost(double ntuples, BlockNumber pages, double nqueries, int k, double *ncandidates)
+{
+	Cost scan_cost;
+	double ncand;
+
+	if(ntuples < 1){
+		ntuples = 1;
+	}
+
+	scan_cost = pages * seq_page_cost + ntuples * cpu_index_tuple_cost
+		+ ntuples * nqueries * VA_BOUND_COST * cpu_operator_cost;
+	ncand = MIN(ntuples, nqueries * k);
+
+	if(ncandidates){
+		*ncandidates = ncand;
+	}
+
+	/* two passes over the VA file, the candidates are fetched in heap order */
+	return 2 * scan_cost + ncand * (random_page_cost + cpu_tuple_cost);
+}
+
+/*
+ * number of neighbours to retrieve from the VA file, so that after post-filtering with
+ * a WHERE clause of the given selectivity (probably) still limit tuples are left
+ */
+double
+vaPostFilterLimit(double limit, double selectivity, double ntuples)
+{
+	double result;
+
+	if(ntuples < 1){
+		ntuples = 1;
+	}
+
+	if(selectivity < 1.0 / ntuples){
+		selectivity = 1.0 / ntuples;
+	}
+
+	result = ceil(limit / MIN(selectivity, 1.0) * VA_POSTFILTER_OVERFETCH);
+
+	return MIN(MAX(result, limit), ntuples);
+}
+
+/*
+ * chooses at runtime between pre-filtering and filtering in the VA file, given the
+ * bitmap of the tuples fulfilling the other WHERE clauses (see nodeBitmapAnd.c)
+ */
+VAFilterStrategy
+vaChooseFilterStrategyForBitmap(Relation index, TIDBitmap *filter, int limit)
+{
+	Relation heap;
+	double tuplesPerPage = 1;
+
+	heap = RelationIdGetRelation(index->rd_index->indrelid);
+
+	if(RelationIsValid(heap)){
+		if(heap->rd_rel->relpages > 0){
+			tuplesPerPage = heap->rd_rel->reltuples / heap->rd_rel->relpages;
+		}
+		RelationClose(heap);
+	}
+
+	return vaChooseFilterStrategy(index->rd_rel->reltuples, index->rd_rel->relpages,
+		tbm_ntuples(filter, MAX(tuplesPerPage, 1)), limit, true, NULL);
+}
+
 /*
  *  checks the relopts to get the minkowski distance
  *  and use this information for cost calculation
@@ -1431,17 +2825,23 @@ vaGetOptions(PG_FUNCTION_ARGS)
 
 	int			numoptions = -1;
 	FileOptions		*rdopts;
-	relopt_parse_elt 	tab[1];
+	relopt_parse_elt 	tab[3];
 
 	/* we store the information about what kind of index it is in the relopts
 	 only becuase of the cost calculation */
 	tab[0].optname = "vamarks";
 	tab[0].opttype = RELOPT_TYPE_INT;
 	tab[0].offset = offsetof(FileOptions, indexMarks);
+	tab[1].optname = "vacomponents";
+	tab[1].opttype = RELOPT_TYPE_INT;
+	tab[1].offset = offsetof(FileOptions, components);
+	tab[2].optname = "vaprojection";
+	tab[2].opttype = RELOPT_TYPE_STRING;
+	tab[2].offset = offsetof(FileOptions, projectionOffset);
 
 	options = parseRelOptions(reloptions, validate, RELOPT_KIND_VA, &numoptions);
 	rdopts = allocateReloptStruct(sizeof(FileOptions), options, numoptions);
-	fillRelOptions((void *)rdopts, sizeof(FileOptions), options, numoptions, validate, tab, 1);
+	fillRelOptions((void *)rdopts, sizeof(FileOptions), options, numoptions, validate, tab, 3);
 
 	PG_RETURN_BYTEA_P(rdopts);
 }
@@ -1490,11 +2890,24 @@ initStateOptions(StateOptions *state, Relation index, ArrayType *tmp_marks)
 
 	state->opts = (FileOptions*)index->rd_amcache;
 
+	state->projection = NULL;
+
 	if (tmp_marks){
 		state->marks = tmp_marks;
 	}
 	else {
 		state->marks = RelationGetMarks(index);
+
+		if (getProjectionMethod(state->opts) != VA_PROJECTION_NONE){
+			state->projection = RelationGetProjection(index);
+
+			if (state->projection == NULL){
+				ereport(ERROR,
+					(errcode(ERRCODE_INDEX_CORRUPTED),
+					errmsg("index \"%s\" has no projection", RelationGetRelationName(index)),
+					errhint("Please REINDEX it.")));
+			}
+		}
 	}
 
 	if (state->marks == NULL){
@@ -1514,6 +2927,19 @@ initStateOptions(StateOptions *state, Relation index, ArrayType *tmp_marks)
 	state->sizeOfTuple = sizeof(Tuple)+(state->dimensions) * sizeof(BitStringElement);
 }
 
+/*
+ * returns the projection of the features given at the creation of the index
+ */
+static VAProjection
+getProjectionMethod(FileOptions *opts)
+{
+	if (opts == NULL){
+		return VA_PROJECTION_NONE;
+	}
+
+	return vaGetProjectionMethod(GET_STRING_RELOPTION(opts, projectionOffset));
+}
+
 /*
  * forms a VA tuple to store in index
  */
@@ -1525,7 +2951,12 @@ formTuple(StateOptions *state, ItemPointer iptr, Datum *values, bool *isnull)
 	res->heapPtr = *iptr;
 
 	if (!(*isnull)){
-		feature		*f = (feature *)PG_DETOAST_DATUM(values[0]);
+		feature		*f = featureToFloat8((feature *)PG_DETOAST_DATUM(values[0]));
+
+		if (state->projection){
+			f = vaProjectFeature(state->projection, f, false);
+		}
+
 		set_bitstring(f, state->marks, res->apx);
 	}
 
@@ -1717,6 +3148,7 @@ initMetabuffer(Buffer b, Relation index)
 	memset(metadata, 0, sizeof(MetaPageData));
 	metadata->magickNumber = VA_MAGICK_NUMBER;
 	metadata->nChanges = 0;
+	metadata->buildTime = GetCurrentTimestamp();
 }
 
 
@@ -1728,11 +3160,14 @@ initMetabuffer(Buffer b, Relation index)
  * (Weber, 2000, Section 5.5.4)
  */
 static float8*
-precompute_differences_lbound(Datum *query, ArrayType *marks, MinkowskiNorm norm)
+precompute_differences_lbound(Datum *query, ArrayType *marks, MinkowskiNorm norm, AdamDistanceType distance)
 {
 	feature *f = (feature *)DatumGetPointer(*query);
 
-	if (norm == MINKOWSKI_MAX_NORM){
+	if (distance != ADAM_DISTANCE_MINKOWSKI){
+		return precompute_similarity_bounds(f, marks, distance, false);
+	}
+	else if (norm == MINKOWSKI_MAX_NORM){
 		return precompute_differences_lbound_lnorm(f, marks, 1);
 	}
 	else {
@@ -1741,11 +3176,14 @@ precompute_differences_lbound(Datum *query, ArrayType *marks, MinkowskiNorm norm
 }
 
 static float8*
-precompute_differences_ubound(Datum *query, ArrayType *marks, MinkowskiNorm norm)
+precompute_differences_ubound(Datum *query, ArrayType *marks, MinkowskiNorm norm, AdamDistanceType distance)
 {
 	feature *f = (feature *)DatumGetPointer(*query);
 
-	if (norm == MINKOWSKI_MAX_NORM){
+	if (distance != ADAM_DISTANCE_MINKOWSKI){
+		return precompute_similarity_bounds(f, marks, distance, true);
+	}
+	else if (norm == MINKOWSKI_MAX_NORM){
 		return precompute_differences_ubound_lnorm(f, marks, 1);
 	}
 	else {
@@ -1755,197 +3193,441 @@ precompute_differences_ubound(Datum *query, ArrayType *marks, MinkowskiNorm norm
 
 
 static float8*
-precompute_differences_lbound_lnorm(feature *f, ArrayType *marks_full, MinkowskiNorm norm)
+precompute_differences_lbound_lnorm(feature *f, ArrayType *marks, MinkowskiNorm norm)
 {
-	int typlen = sizeof(float8);
-	bool typbyval = FLOAT8PASSBYVAL;
-	char typalign = 'd';
+	int			dimensions = MIN(ARR_DIMS(marks)[0], ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data)));
+	int			partitions = ARR_DIMS(marks)[1];
+	float8	   *values = getQueryValues(f, dimensions);
+	float8	   *results = palloc(Max(dimensions, 1) * partitions * sizeof(float8));
+	int			dim;
+
+	for (dim = 0; dim < dimensions; dim++){
+		precompute_dimension_bounds(values[dim], (float8 *) ARR_DATA_PTR(marks) + dim * partitions, partitions, norm,
+			results + dim * partitions, NULL);
+	}
 
-	char	   *m_ptr;
-	char	   *mp1_ptr;
+	pfree(values);
 
-	bool		f_lt_m;
-	bool		f_gt_mp1;
+	return results;
+}
 
-	int			i,
-		j = 0,
-		i_max;
+static float8*
+precompute_differences_ubound_lnorm(feature *f, ArrayType *marks, MinkowskiNorm norm)
+{
+	int			dimensions = MIN(ARR_DIMS(marks)[0], ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data)));
+	int			partitions = ARR_DIMS(marks)[1];
+	float8	   *values = getQueryValues(f, dimensions);
+	float8	   *results = palloc(Max(dimensions, 1) * partitions * sizeof(float8));
+	int			dim;
+
+	for (dim = 0; dim < dimensions; dim++){
+		precompute_dimension_bounds(values[dim], (float8 *) ARR_DATA_PTR(marks) + dim * partitions, partitions, norm,
+			NULL, results + dim * partitions);
+	}
 
-	ArrayIterator f_it = array_create_iterator(&f->data, 0);
-	Datum		f_val;
-	bool		f_isnull;
-	float8		f_f8;
+	pfree(values);
 
-	ArrayIterator mfull_it = array_create_iterator(marks_full, 1);
-	Datum		mfull_val;
-	bool		mfull_isnull;
-	float8		mfull_f8;
+	return results;
+}
+
+/*
+ * Determines the lower and the upper bounds of |x - value|^norm of the cells
+ * [m_i, m_(i+1)] of one dimension; the last cell holds the values of the cell
+ * before, since the marks span the indexed data. Either of the bounds may be
+ * NULL.
+ *
+ * (Weber, 2000, Section 5.5.4)
+ */
+static void
+precompute_dimension_bounds(float8 value, float8 *marks, int partitions, MinkowskiNorm norm, float8 *l_bounds, float8 *u_bounds)
+{
+	int i;
+
+	for (i = 0; i < partitions - 1; i++){
+		float8 m = marks[i];
+		float8 mp1 = marks[i + 1];
+
+		if (l_bounds){
+			if (value < m){
+				l_bounds[i] = pow(m - value, norm);
+			}
+			else if (value > mp1){
+				l_bounds[i] = pow(value - mp1, norm);
+			}
+			else {
+				l_bounds[i] = 0;
+			}
+		}
 
-	ArrayIterator mfull2_it = array_create_iterator(marks_full, 1);
-	Datum		mfull2_val;
-	bool		mfull2_isnull;
-	float8		mfull2_f8;
+		if (u_bounds){
+			if (value <= (m + mp1) / 2){
+				u_bounds[i] = pow(mp1 - value, norm);
+			}
+			else {
+				u_bounds[i] = pow(value - m, norm);
+			}
+		}
+	}
 
-	ArrayType	*marks;
+	if (partitions > 1){
+		if (l_bounds){
+			l_bounds[partitions - 1] = l_bounds[partitions - 2];
+		}
 
-	Datum		num_norm;
-	float8		*results;
+		if (u_bounds){
+			u_bounds[partitions - 1] = u_bounds[partitions - 2];
+		}
+	}
+}
 
-	//too much space allocated here
-	results = palloc(ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data)) *
-		(ArrayGetNItems(ARR_NDIM(marks_full), ARR_DIMS(marks_full)) + 1) * sizeof(float8));
+/*
+ * Computes the lower and the upper bounds of the query for the scan. The
+ * Minkowski bounds are taken from the bounds of the last query of the backend
+ * (vaBoundsCache), computing only the dimensions in which the query point
+ * differs; the weights of a weighted Minkowski distance are applied to copies
+ * of the unweighted bounds, since sum(w_i * |x_i - q_i|^p) is bounded by the
+ * weighted bounds of the dimensions.
+ *
+ * With a projection, the bounds are those of the projected query; the residual
+ * (the last dimension) is bounded from above by the sum of the residual norms,
+ * i.e. by the bounds of the negated residual of the query.
+ */
+static void
+vaPrecomputeBounds(Relation index, StateOptions *state, Datum *query, AdamScanClause *adamOptions, float8 **l_bounds, float8 **u_bounds)
+{
+	feature		   *f = (feature *)DatumGetPointer(*query);
+	MinkowskiNorm	norm = adamOptions->nn_minkowski;
+	VABoundsCache  *cache = vaBoundsCache;
+	int				dimensions;
+	int				partitions = state->partitions;
+	float8		   *marks = (float8 *) ARR_DATA_PTR(state->marks);
+	float8		   *values;
+	int				dim, i;
+
+	if (adamOptions->nn_distance != ADAM_DISTANCE_MINKOWSKI){
+		*l_bounds = precompute_differences_lbound(query, state->marks, norm, adamOptions->nn_distance);
+		*u_bounds = precompute_differences_ubound(query, state->marks, norm, adamOptions->nn_distance);
+		return;
+	}
 
-	while (array_iterate(mfull2_it, &mfull2_val, &mfull2_isnull)){
-		mfull2_f8 = DatumGetFloat8(mfull2_val);
+	if (state->projection){
+		f = vaProjectFeature(state->projection, f, false);
 	}
 
-	while (array_iterate(f_it, &f_val, &f_isnull) && array_iterate(mfull_it, &mfull_val, &mfull_isnull)){
-		marks = DatumGetArrayTypeP(mfull_val);
+	dimensions = MIN(state->dimensions, ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data)));
+	values = getQueryValues(f, dimensions);
 
-		f_f8 = DatumGetFloat8(f_val);
-		mfull_f8 = DatumGetFloat8(mfull_val);
+	if (cache == NULL || cache->indexOid != RelationGetRelid(index) || cache->relfilenode != index->rd_node.relNode
+		|| cache->norm != norm || cache->dimensions != dimensions || cache->partitions != partitions){
 
-		/* set mark pointer to start */
-		m_ptr = ARR_DATA_PTR(marks);
+		if (cache){
+			vaBoundsCache = NULL;
+			pfree(cache->query);
+			pfree(cache->l_bounds);
+			pfree(cache->u_bounds);
+			pfree(cache);
+		}
 
-		mp1_ptr = ARR_DATA_PTR(marks);
-		mp1_ptr = att_addlength_pointer(mp1_ptr, typlen, mp1_ptr);
-		mp1_ptr = (char *)att_align_nominal(mp1_ptr, typalign);
+		cache = MemoryContextAllocZero(TopMemoryContext, sizeof(VABoundsCache));
+		cache->indexOid = RelationGetRelid(index);
+		cache->relfilenode = index->rd_node.relNode;
+		cache->norm = norm;
+		cache->dimensions = dimensions;
+		cache->partitions = partitions;
+		cache->query = MemoryContextAlloc(TopMemoryContext, Max(dimensions, 1) * sizeof(float8));
+		cache->l_bounds = MemoryContextAlloc(TopMemoryContext, Max(dimensions, 1) * partitions * sizeof(float8));
+		cache->u_bounds = MemoryContextAlloc(TopMemoryContext, Max(dimensions, 1) * partitions * sizeof(float8));
+
+		//no dimension has been computed yet (NaN differs from every value)
+		for (dim = 0; dim < dimensions; dim++){
+			cache->query[dim] = get_float8_nan();
+		}
 
-		i_max = ArrayGetNItems(ARR_NDIM(marks), ARR_DIMS(marks));
+		vaBoundsCache = cache;
+	}
 
-		for (i = 0; i < i_max - 1; i++){
-			float8		m_f8;
-			float8		mp1_f8;
+	for (dim = 0; dim < dimensions; dim++){
+		if (cache->query[dim] == values[dim]){
+			continue;
+		}
 
-			/* get mark */
-			m_f8 = DatumGetFloat8(fetch_att(m_ptr, typbyval, typlen));
-			mp1_f8 = DatumGetFloat8(fetch_att(mp1_ptr, typbyval, typlen));
+		precompute_dimension_bounds(values[dim], marks + dim * partitions, partitions,
+			(norm == MINKOWSKI_MAX_NORM) ? 1 : norm,
+			cache->l_bounds + dim * partitions, cache->u_bounds + dim * partitions);
 
-			if (f_f8 < m_f8){
-				results[j * i_max + i] = DatumGetFloat8(
-					DirectFunctionCall2(dpow,
-					Float8GetDatum(m_f8 - f_f8),
-					Float8GetDatum(norm)));
-			}
-			else if (f_f8 > mp1_f8) {
-				results[j * i_max + i] = DatumGetFloat8(
-					DirectFunctionCall2(dpow,
-					Float8GetDatum(f_f8 - mp1_f8),
-					Float8GetDatum(norm)));
-			}
-			else {
-				results[j * i_max + i] = DatumGetFloat8(DirectFunctionCall1(i4tod, Int32GetDatum(0)));
-			}
-			/* set mark pointer for next round */
-			m_ptr = att_addlength_pointer(m_ptr, typlen, m_ptr);
-			m_ptr = (char *)att_align_nominal(m_ptr, typalign);
+		cache->query[dim] = values[dim];
+	}
+
+	*l_bounds = palloc(Max(dimensions, 1) * partitions * sizeof(float8));
+	*u_bounds = palloc(Max(dimensions, 1) * partitions * sizeof(float8));
+	memcpy(*l_bounds, cache->l_bounds, dimensions * partitions * sizeof(float8));
+	memcpy(*u_bounds, cache->u_bounds, dimensions * partitions * sizeof(float8));
+
+	if (state->projection && dimensions > 0){
+		dim = dimensions - 1;
+		precompute_dimension_bounds(-values[dim], marks + dim * partitions, partitions, norm,
+			NULL, *u_bounds + dim * partitions);
+	}
+
+	if (adamOptions->nn_weights){
+		float8 *weights = getWeights(adamOptions->nn_weights, dimensions);
 
-			mp1_ptr = att_addlength_pointer(mp1_ptr, typlen, mp1_ptr);
-			mp1_ptr = (char *)att_align_nominal(mp1_ptr, typalign);
+		for (dim = 0; dim < dimensions; dim++){
+			for (i = 0; i < partitions; i++){
+				(*l_bounds)[dim * partitions + i] *= weights[dim];
+				(*u_bounds)[dim * partitions + i] *= weights[dim];
+			}
 		}
-		results[j * i_max + i_max - 1] = results[j * i_max - 2];
 
-		j++;
+		pfree(weights);
 	}
 
-	array_free_iterator(f_it);
-	array_free_iterator(mfull_it);
-	return results;
+	pfree(values);
 }
 
-static float8*
-precompute_differences_ubound_lnorm(feature *f, ArrayType *marks_full, MinkowskiNorm norm)
+/*
+ * returns the first values of the (float8) query; null values are taken as 0
+ */
+static float8 *
+getQueryValues(feature *f, int dimensions)
 {
-	int typlen = sizeof(float8);
-	bool typbyval = FLOAT8PASSBYVAL;
-	char typalign = 'd';
+	float8		   *values = palloc0(Max(dimensions, 1) * sizeof(float8));
+	ArrayIterator	it;
+	Datum			value;
+	bool			isnull;
+	int				dim = 0;
+
+	if (!ARR_HASNULL(&f->data)){
+		memcpy(values, ARR_DATA_PTR(&f->data), dimensions * sizeof(float8));
+		return values;
+	}
+
+	it = array_create_iterator(&f->data, 0);
+
+	while (dim < dimensions && array_iterate(it, &value, &isnull)){
+		if (!isnull){
+			values[dim] = DatumGetFloat8(value);
+		}
 
-	char	   *m_ptr;
-	char	   *mp1_ptr;
+		dim++;
+	}
 
-	bool		f_lt_b;
+	array_free_iterator(it);
 
-	int			i,
-		j = 0,
-		i_max;
+	return values;
+}
 
-	ArrayIterator f_it = array_create_iterator(&f->data, 0);
-	Datum		f_val;
-	bool		f_isnull;
+/*
+ * returns the weights of the dimensions; as in calculateWeightedMinkowski,
+ * dimensions without (or with a null) weight do not contribute to the distance
+ */
+static float8 *
+getWeights(Node *weights, int dimensions)
+{
+	ArrayType	   *array = DatumGetArrayTypeP(((Const *) weights)->constvalue);
+	float8		   *result = palloc0(Max(dimensions, 1) * sizeof(float8));
+	Datum		   *elements;
+	bool		   *nulls;
+	int				nelements;
+	int				dim;
+
+	deconstruct_array(array, FLOAT8OID, sizeof(float8), FLOAT8PASSBYVAL, 'd', &elements, &nulls, &nelements);
+
+	for (dim = 0; dim < Min(dimensions, nelements); dim++){
+		if (!nulls[dim]){
+			result[dim] = DatumGetFloat8(elements[dim]);
+		}
+	}
+
+	return result;
+}
+
+/*
+ * checks whether bounds can be computed with the weights, i.e. whether they
+ * are constant and not negative
+ */
+static bool
+vaValidWeights(Node *weights)
+{
+	Const		   *c = (Const *) weights;
+	ArrayType	   *array;
+	Datum		   *elements;
+	bool		   *nulls;
+	int				nelements;
+	int				i;
+
+	if (!IsA(weights, Const) || c->constisnull || c->consttype != FLOAT8ARRAYOID){
+		return false;
+	}
 
-	ArrayIterator mfull_it = array_create_iterator(marks_full, 1);
-	Datum		mfull_val;
-	bool		mfull_isnull;
+	array = DatumGetArrayTypeP(c->constvalue);
+	deconstruct_array(array, FLOAT8OID, sizeof(float8), FLOAT8PASSBYVAL, 'd', &elements, &nulls, &nelements);
 
-	ArrayType	*marks;
+	for (i = 0; i < nelements; i++){
+		if (!nulls[i] && !(DatumGetFloat8(elements[i]) >= 0)){
+			return false;
+		}
+	}
+
+	return true;
+}
 
-	Datum		num_norm;
-	Datum		num_two = DirectFunctionCall1(i4tod, Int32GetDatum(2));
 
-	//too much space allocated here
-	float8		*results = palloc(ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data)) *
-		(ArrayGetNItems(ARR_NDIM(marks_full), ARR_DIMS(marks_full)) + 1) * sizeof(float8));
 
-	num_norm = DirectFunctionCall1(i4tod, Int32GetDatum(norm));
 
-	while (array_iterate(f_it, &f_val, &f_isnull) && array_iterate(mfull_it, &mfull_val, &mfull_isnull)){
-		marks = DatumGetArrayTypeP(mfull_val);
+/*
+ * Determines bounds on the cosine, inner product and hamming distances.
+ *
+ * As for the Minkowski distances, the bounds are computed per dimension and
+ * per cell [m_i, m_(i+1)] of the marks, so that only a look-up is necessary
+ * per tuple. For the inner product and the hamming distance the per-dimension
+ * values can be added up; for the cosine distance the bounds of the dot
+ * product and of the squared length of the vector are stored (VA_COSINE_STRIDE
+ * values per cell) and combined in get_similarity_bound, the length of the
+ * query is stored after the last cell.
+ *
+ * As in the Minkowski case, the marks are assumed to span the indexed data.
+ */
+static float8*
+precompute_similarity_bounds(feature *f, ArrayType *marks, AdamDistanceType distance, bool upper)
+{
+	int			dimensions = ARR_DIMS(marks)[0];
+	int			partitions = ARR_DIMS(marks)[1];
+	int			stride = (distance == ADAM_DISTANCE_COSINE) ? VA_COSINE_STRIDE : 1;
 
-		/* set mark pointer to start */
-		m_ptr = ARR_DATA_PTR(marks);
-		mp1_ptr = ARR_DATA_PTR(marks);
+	float8	   *m = (float8 *) ARR_DATA_PTR(marks);
+	float8	   *q = (float8 *) ARR_DATA_PTR(&f->data);
+	float8	   *results;
 
-		mp1_ptr = att_addlength_pointer(mp1_ptr, typlen, mp1_ptr);
-		mp1_ptr = (char *)att_align_nominal(mp1_ptr, typalign);
+	int			i, j;
 
-		i_max = ArrayGetNItems(ARR_NDIM(marks), ARR_DIMS(marks));
+	if (ARR_HASNULL(&f->data)){
+		ereport(ERROR,
+			(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			errmsg("the query vector must not contain null values")));
+	}
 
-		for (i = 0; i < i_max - 1; i++){
-			Datum		m_val;
-			Datum		mp1_val;
-			Datum		b_val;
+	dimensions = MIN(dimensions, ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data)));
 
-			/* get mark */
-			m_val = fetch_att(m_ptr, typbyval, typlen);
-			mp1_val = fetch_att(mp1_ptr, typbyval, typlen);
+	results = palloc0((dimensions * partitions * stride + 1) * sizeof(float8));
 
-			b_val = DirectFunctionCall2(float8div, DirectFunctionCall2(float8pl, m_val, mp1_val), num_two);
+	for (j = 0; j < dimensions; j++){
+		for (i = 0; i < partitions; i++){
+			float8 lo = m[j * partitions + i];
+			float8 hi = m[j * partitions + MIN(i + 1, partitions - 1)];
+			float8 *result = &results[(j * partitions + i) * stride];
 
-			f_lt_b = DatumGetBool(DirectFunctionCall2(float8le, f_val, b_val));
+			float8 prod_lo = MIN(q[j] * lo, q[j] * hi);
+			float8 prod_hi = MAX(q[j] * lo, q[j] * hi);
 
-			if (f_lt_b){
-				results[j * i_max + i] = DatumGetFloat8(
-					DirectFunctionCall2(dpow,
-					DirectFunctionCall2(float8mi, mp1_val, f_val),
-					num_norm));
-			}
-			else {
-				results[j * i_max + i] = DatumGetFloat8(
-					DirectFunctionCall2(dpow,
-					DirectFunctionCall2(float8mi, f_val, m_val),
-					num_norm));
+			switch (distance){
+				case ADAM_DISTANCE_INNER_PRODUCT:
+					//the distance is the negative dot product
+					result[0] = upper ? -prod_lo : -prod_hi;
+					break;
+				case ADAM_DISTANCE_HAMMING:
+					if (upper){
+						result[0] = (lo == hi && q[j] == lo) ? 0 : 1;
+					}
+					else {
+						result[0] = (q[j] < lo || q[j] > hi) ? 1 : 0;
+					}
+					break;
+				case ADAM_DISTANCE_COSINE:
+					result[0] = upper ? prod_lo : prod_hi;
+					result[1] = (lo <= 0 && hi >= 0) ? 0 : MIN(lo * lo, hi * hi);
+					result[2] = MAX(lo * lo, hi * hi);
+					break;
+				default:
+					elog(ERROR, "unrecognized distance: %d", (int) distance);
 			}
+		}
+	}
+
+	if (distance == ADAM_DISTANCE_COSINE){
+		results[dimensions * partitions * stride] = sqrt(similaritySquaredNorm(q, dimensions));
+	}
+
+	return results;
+}
+
+/*
+ * Determines the single bound using the values calculated in precompute_similarity_bounds.
+ */
+static float8
+get_similarity_bound(BitStringElement *apx, float8* bounds, int32 dimensions, int32 partitions, AdamDistanceType distance, bool upper)
+{
+	int dim = 0;		/* dimensions */
+	int apx_dim = 0;	/* approximation of dimension */
+
+	float8 dot = 0;
+	float8 norm_lo = 0;
+	float8 norm_hi = 0;
+	float8 query_norm;
+	float8 cosine;
 
-			/* set mark pointer for next round */
-			m_ptr = att_addlength_pointer(m_ptr, typlen, m_ptr);
-			m_ptr = (char *)att_align_nominal(m_ptr, typalign);
+	if (distance != ADAM_DISTANCE_COSINE){
+		float8 result = 0;
 
-			mp1_ptr = att_addlength_pointer(mp1_ptr, typlen, mp1_ptr);
-			mp1_ptr = (char *)att_align_nominal(mp1_ptr, typalign);
+		for (dim = 0; dim < dimensions; dim++){
+			apx_dim = MIN(GET_WORD(apx, dim), partitions - 1);
+			result += bounds[dim * partitions + apx_dim];
 		}
-		results[j * i_max + i_max - 1] = results[j * i_max - 2];
 
-		j++;
+		return result;
 	}
 
-	array_free_iterator(f_it);
-	array_free_iterator(mfull_it);
+	for (dim = 0; dim < dimensions; dim++){
+		float8 *cell;
 
-	return results;
-}
+		apx_dim = MIN(GET_WORD(apx, dim), partitions - 1);
+		cell = &bounds[(dim * partitions + apx_dim) * VA_COSINE_STRIDE];
+
+		dot += cell[0];
+		norm_lo += cell[1];
+		norm_hi += cell[2];
+	}
+
+	query_norm = bounds[dimensions * partitions * VA_COSINE_STRIDE];
+
+	//vectors without length have a distance of 1
+	if (query_norm <= 0){
+		return 1;
+	}
+
+	if (!upper){
+		//largest possible cosine, i.e. lower bound of distance
+		if (dot >= 0){
+			cosine = (norm_lo > 0) ? dot / (sqrt(norm_lo) * query_norm) : 1;
+		}
+		else {
+			cosine = (norm_hi > 0) ? dot / (sqrt(norm_hi) * query_norm) : 0;
+		}
+
+		if (norm_lo <= 0){
+			cosine = MAX(cosine, 0);
+		}
+
+		cosine = MIN(cosine, 1);
+	}
+	else {
+		//smallest possible cosine, i.e. upper bound of distance
+		if (dot >= 0){
+			cosine = (norm_hi > 0) ? dot / (sqrt(norm_hi) * query_norm) : 0;
+		}
+		else {
+			cosine = (norm_lo > 0) ? dot / (sqrt(norm_lo) * query_norm) : -1;
+		}
+
+		if (norm_lo <= 0){
+			cosine = MIN(cosine, 0);
+		}
 
+		cosine = MAX(cosine, -1);
+	}
 
+	return 1 - cosine;
+}
 
 
 /*
@@ -1954,7 +3636,7 @@ precompute_differences_ubound_lnorm(feature *f, ArrayType *marks_full, Minkowski
  * (Weber, 2000, Section 5.5.4)
  */
 static float8
-get_bound(BitStringElement *apx, float8* differences, int32 dimensions, int32 partitions, MinkowskiNorm norm)
+get_bound(BitStringElement *apx, float8* differences, int32 dimensions, int32 partitions, MinkowskiNorm norm, AdamDistanceType distance, bool upper)
 {
 	int dim = 0;		/* dimensions */
 	int apx_dim = 0;	/* approximation of dimension */
@@ -1962,21 +3644,12 @@ get_bound(BitStringElement *apx, float8* differences, int32 dimensions, int32 pa
 	float8 trans_result = 0;
 	float8 difference;
 
-	float8 result;
-
-	MemoryContext old_ctx;
-	MemoryContext ctx;
-
-	//switch memory context
-	ctx = AllocSetContextCreate(CurrentMemoryContext, "Marks build temporary context",
-		ALLOCSET_DEFAULT_MINSIZE, ALLOCSET_DEFAULT_INITSIZE, ALLOCSET_DEFAULT_MAXSIZE);
-	old_ctx = MemoryContextSwitchTo(ctx);
+	if (distance != ADAM_DISTANCE_MINKOWSKI){
+		return get_similarity_bound(apx, differences, dimensions, partitions, distance, upper);
+	}
 
 	if (norm < 100 && norm != MINKOWSKI_MAX_NORM){
 		/* L_s norms, where s != Infinity */
-		FmgrInfo in;
-
-		fmgr_info(ARRAYINOID, &in);
 		/* add up the difference for each dimension (Weber, 2000, Formula 5.5.3) */
 		for (dim = 0; dim < dimensions; dim++){
 			apx_dim = MIN(GET_WORD(apx, dim), partitions - 1);
@@ -2001,13 +3674,7 @@ get_bound(BitStringElement *apx, float8* differences, int32 dimensions, int32 pa
 		}
 	}
 
-	MemoryContextSwitchTo(old_ctx);
-
-	result = trans_result;
-
-	MemoryContextDelete(ctx);
-
-	return result;
+	return trans_result;
 }
 
 
@@ -2089,4 +3756,4 @@ void
 vaRedo(XLogRecPtr lsn, XLogRecord *record)
 {
 	elog(PANIC, "va_redo: unimplemented");
-}
\ No newline at end of file
+}
@@ -0,0 +1,461 @@
+/*
+ * ADAM - indexing functions
+ * name: adam_index_va_cache
+ * description: shared memory cache for the approximations of VA files
+ *
+ * src/backend/utils/adt/adam_index_va_cache.c
+ *
+ *
+ *
+ *
+ * addendum: VA files are read in full for every search; with a bulk read
+ * strategy they never stay in shared_buffers, so every search reads the whole
+ * file again; this cache keeps the approximations of a VA file packed one after
+ * the other (i.e. without page headers) in a shared memory area of va_cache_size
+ * kilobytes; a VA file is loaded into the cache by va_prewarm(index) or, if
+ * va_cache_autoload is set, by its first search (see adam_index_va.c)
+ *
+ * an entry is only used as long as the number of changes stored in the meta
+ * page of the VA file has not changed since loading it; entries are dropped if
+ * the relcache entry of the index is invalidated (e.g. by REINDEX, TRUNCATE or
+ * DROP) and if the space is needed for another VA file (least recently used first)
+ *
+ */
+#include "postgres.h"
+
+#include "utils/adam_index_va_cache.h"
+
+#include "access/xact.h"
+#include "miscadmin.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/inval.h"
+#include "utils/rel.h"
+
+/* number of entries a single backend may have pinned at the same time */
+#define VA_CACHE_MAX_PINS		32
+
+struct VACacheEntry
+{
+	Oid			dbid;
+	Oid			relid;
+	Oid			relfilenode;
+	uint32		nChanges;		/* changes of the VA file when it was loaded */
+	bool		inuse;			/* the space of the entry is occupied */
+	bool		valid;			/* the entry may be used for searching */
+	bool		loading;		/* the entry is being filled */
+	bool		invalidated;	/* invalidated while loading */
+	int			pins;			/* number of backends reading the entry */
+	uint64		lastUsed;
+	Size		offset;			/* position in data */
+	Size		len;
+};
+
+typedef struct VACacheShmemStruct
+{
+	Size		size;			/* size of data */
+	uint64		clock;			/* for lastUsed */
+	VACacheEntry entries[VA_CACHE_MAX_ENTRIES];
+	char		data[1];		/* VARIABLE LENGTH ARRAY */
+} VACacheShmemStruct;
+
+static VACacheShmemStruct *VACache = NULL;
+
+/* entries pinned by this backend, released at the end of the transaction at the latest */
+static VACacheEntry *pinnedEntries[VA_CACHE_MAX_PINS];
+static int	numPinned = 0;
+static bool xactCallbackRegistered = false;
+static bool relcacheCallbackRegistered = false;
+
+int			va_cache_size = 0;
+bool		va_cache_autoload = true;
+
+static bool matchesEntry(VACacheEntry *entry, Relation index);
+static bool findFreeSpace(Size len, Size *offset);
+static void rememberPin(VACacheEntry *entry);
+static void forgetPin(VACacheEntry *entry);
+static void releaseEntry(VACacheEntry *entry);
+static void vaCacheRelcacheCallback(Datum arg, Oid relid);
+static void vaCacheXactCallback(XactEvent event, void *arg);
+
+
+/*
+ * size of the shared memory needed for the cache
+ */
+Size
+	VACacheShmemSize(void)
+{
+	Size size = offsetof(VACacheShmemStruct, data);
+
+	if(va_cache_size > 0){
+		size = add_size(size, mul_size(va_cache_size, 1024));
+	}
+
+	return MAXALIGN(size);
+}
+
+/*
+ * creates the cache in shared memory
+ */
+void
+	VACacheShmemInit(void)
+{
+	bool found;
+
+	VACache = (VACacheShmemStruct *) ShmemInitStruct("VA Cache", VACacheShmemSize(), &found);
+
+	if(!found){
+		MemSet(VACache, 0, offsetof(VACacheShmemStruct, data));
+		VACache->size = (va_cache_size > 0) ? (Size) va_cache_size * 1024 : 0;
+	}
+}
+
+/*
+ * is there any space for caching VA files?
+ *
+ * the relcache callback is registered by the first function of a backend asking, since
+ * the number of callbacks is limited and the postmaster runs this initialization
+ * again after every crash of a backend
+ */
+bool
+	vaCacheEnabled(void)
+{
+	if(VACache == NULL || VACache->size == 0){
+		return false;
+	}
+
+	if(!relcacheCallbackRegistered){
+		CacheRegisterRelcacheCallback(vaCacheRelcacheCallback, (Datum) 0);
+		relcacheCallbackRegistered = true;
+	}
+
+	return true;
+}
+
+/*
+ * returns the pinned entry of the VA file if it is cached and up to date, NULL otherwise;
+ * the entry has to be released with vaCacheRelease
+ */
+VACacheEntry *
+	vaCacheLookup(Relation index, uint32 nChanges)
+{
+	VACacheEntry *result = NULL;
+	int i;
+
+	if(!vaCacheEnabled() || numPinned >= VA_CACHE_MAX_PINS){
+		return NULL;
+	}
+
+	LWLockAcquire(VACacheLock, LW_EXCLUSIVE);
+
+	for(i = 0; i < VA_CACHE_MAX_ENTRIES; i++){
+		VACacheEntry *entry = &VACache->entries[i];
+
+		if(!entry->inuse || !entry->valid || !matchesEntry(entry, index)){
+			continue;
+		}
+
+		if(entry->nChanges != nChanges){
+			//the VA file has been changed since it was loaded
+			entry->valid = false;
+			if(entry->pins == 0){
+				entry->inuse = false;
+			}
+			break;
+		}
+
+		entry->pins++;
+		entry->lastUsed = ++VACache->clock;
+		result = entry;
+		break;
+	}
+
+	LWLockRelease(VACacheLock);
+
+	if(result){
+		rememberPin(result);
+	}
+
+	return result;
+}
+
+/*
+ * reserves len bytes in the cache for the VA file, evicting the least recently used
+ * entries if necessary; returns NULL if there is not enough space or if the VA file
+ * is already cached or being loaded; the returned entry is pinned and has to be
+ * filled (see vaCacheData) and then marked as loaded with vaCacheFinish
+ */
+VACacheEntry *
+	vaCacheReserve(Relation index, uint32 nChanges, Size len)
+{
+	VACacheEntry *result = NULL;
+	Size offset = 0;
+	int i;
+
+	if(!vaCacheEnabled() || len == 0 || MAXALIGN(len) > VACache->size || numPinned >= VA_CACHE_MAX_PINS){
+		return NULL;
+	}
+
+	LWLockAcquire(VACacheLock, LW_EXCLUSIVE);
+
+	for(i = 0; i < VA_CACHE_MAX_ENTRIES; i++){
+		VACacheEntry *entry = &VACache->entries[i];
+
+		if(entry->inuse && (entry->valid || entry->loading) && !entry->invalidated && matchesEntry(entry, index)){
+			LWLockRelease(VACacheLock);
+			return NULL;
+		}
+
+		if(!entry->inuse && result == NULL){
+			result = entry;
+		}
+	}
+
+	for(;;){
+		VACacheEntry *victim = NULL;
+
+		if(result && findFreeSpace(len, &offset)){
+			break;
+		}
+
+		//evict the least recently used entry that nobody is reading
+		for(i = 0; i < VA_CACHE_MAX_ENTRIES; i++){
+			VACacheEntry *entry = &VACache->entries[i];
+
+			if(entry->inuse && entry->valid && entry->pins == 0 &&
+				(victim == NULL || entry->lastUsed < victim->lastUsed)){
+				victim = entry;
+			}
+		}
+
+		if(victim == NULL){
+			LWLockRelease(VACacheLock);
+			return NULL;
+		}
+
+		victim->valid = false;
+		victim->inuse = false;
+
+		if(result == NULL){
+			result = victim;
+		}
+	}
+
+	result->dbid = MyDatabaseId;
+	result->relid = RelationGetRelid(index);
+	result->relfilenode = index->rd_node.relNode;
+	result->nChanges = nChanges;
+	result->inuse = true;
+	result->valid = false;
+	result->loading = true;
+	result->invalidated = false;
+	result->pins = 1;
+	result->lastUsed = ++VACache->clock;
+	result->offset = offset;
+	result->len = len;
+
+	LWLockRelease(VACacheLock);
+
+	rememberPin(result);
+
+	return result;
+}
+
+/*
+ * marks a reserved entry as loaded; unless it has been invalidated in the meantime,
+ * it can be used for searching from now on
+ */
+void
+	vaCacheFinish(VACacheEntry *entry)
+{
+	LWLockAcquire(VACacheLock, LW_EXCLUSIVE);
+
+	entry->loading = false;
+	entry->valid = !entry->invalidated;
+
+	LWLockRelease(VACacheLock);
+}
+
+/*
+ * releases the pin of an entry
+ */
+void
+	vaCacheRelease(VACacheEntry *entry)
+{
+	forgetPin(entry);
+	releaseEntry(entry);
+}
+
+/*
+ * returns the approximations stored in the entry
+ */
+char *
+	vaCacheData(VACacheEntry *entry)
+{
+	return VACache->data + entry->offset;
+}
+
+/*
+ * returns the number of bytes stored in the entry
+ */
+Size
+	vaCacheLength(VACacheEntry *entry)
+{
+	return entry->len;
+}
+
+
+/*
+ * checks whether the entry belongs to the index
+ */
+static bool
+	matchesEntry(VACacheEntry *entry, Relation index)
+{
+	return entry->dbid == MyDatabaseId &&
+		entry->relid == RelationGetRelid(index) &&
+		entry->relfilenode == index->rd_node.relNode;
+}
+
+/*
+ * finds the first gap between the occupied entries that is large enough, i.e.
+ * either at the beginning of the cache or right after an occupied entry;
+ * must be called with VACacheLock held
+ */
+static bool
+	findFreeSpace(Size len, Size *offset)
+{
+	Size need = MAXALIGN(len);
+	bool found = false;
+	int i, j;
+
+	for(i = -1; i < VA_CACHE_MAX_ENTRIES; i++){
+		Size start;
+		bool overlaps = false;
+
+		if(i >= 0 && !VACache->entries[i].inuse){
+			continue;
+		}
+
+		start = (i < 0) ? 0 : VACache->entries[i].offset + MAXALIGN(VACache->entries[i].len);
+
+		if(start + need > VACache->size || (found && start >= *offset)){
+			continue;
+		}
+
+		for(j = 0; j < VA_CACHE_MAX_ENTRIES && !overlaps; j++){
+			VACacheEntry *entry = &VACache->entries[j];
+
+			overlaps = entry->inuse && entry->offset < start + need &&
+				entry->offset + MAXALIGN(entry->len) > start;
+		}
+
+		if(!overlaps){
+			*offset = start;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+/*
+ * releases a pin, the space is freed if the entry is no longer valid
+ */
+static void
+	releaseEntry(VACacheEntry *entry)
+{
+	LWLockAcquire(VACacheLock, LW_EXCLUSIVE);
+
+	entry->pins--;
+
+	if(entry->pins <= 0){
+		entry->pins = 0;
+
+		if(!entry->valid){
+			//not finished or invalidated
+			entry->loading = false;
+			entry->inuse = false;
+		}
+	}
+
+	LWLockRelease(VACacheLock);
+}
+
+/*
+ * keeps track of the pins of this backend
+ */
+static void
+	rememberPin(VACacheEntry *entry)
+{
+	if(!xactCallbackRegistered){
+		RegisterXactCallback(vaCacheXactCallback, NULL);
+		xactCallbackRegistered = true;
+	}
+
+	pinnedEntries[numPinned++] = entry;
+}
+
+static void
+	forgetPin(VACacheEntry *entry)
+{
+	int i;
+
+	for(i = numPinned - 1; i >= 0; i--){
+		if(pinnedEntries[i] == entry){
+			pinnedEntries[i] = pinnedEntries[--numPinned];
+			return;
+		}
+	}
+
+	elog(ERROR, "VA cache entry is not pinned");
+}
+
+/*
+ * drops the cached VA file of a relation whose relcache entry is invalidated; a
+ * reset of the whole relcache (InvalidOid) drops nothing, the entries of changed
+ * VA files are recognized by their relfilenode and their number of changes anyway
+ */
+static void
+	vaCacheRelcacheCallback(Datum arg, Oid relid)
+{
+	int i;
+
+	if(!OidIsValid(relid) || !OidIsValid(MyDatabaseId) || !vaCacheEnabled()){
+		return;
+	}
+
+	LWLockAcquire(VACacheLock, LW_EXCLUSIVE);
+
+	for(i = 0; i < VA_CACHE_MAX_ENTRIES; i++){
+		VACacheEntry *entry = &VACache->entries[i];
+
+		if(!entry->inuse || entry->dbid != MyDatabaseId || entry->relid != relid){
+			continue;
+		}
+
+		entry->valid = false;
+		entry->invalidated = true;
+
+		if(entry->pins == 0){
+			entry->loading = false;
+			entry->inuse = false;
+		}
+	}
+
+	LWLockRelease(VACacheLock);
+}
+
+/*
+ * releases the pins left over by searches that have been aborted
+ */
+static void
+	vaCacheXactCallback(XactEvent event, void *arg)
+{
+	if(event != XACT_EVENT_COMMIT && event != XACT_EVENT_ABORT && event != XACT_EVENT_PREPARE){
+		return;
+	}
+
+	while(numPinned > 0){
+		releaseEntry(pinnedEntries[--numPinned]);
+	}
+}
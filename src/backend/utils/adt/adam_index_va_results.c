@@ -0,0 +1,320 @@
+/*
+ * ADAM - indexing functions
+ * name: adam_index_va_results
+ * description: shared memory cache for the results of VA index searches
+ *
+ * src/backend/utils/adt/adam_index_va_results.c
+ *
+ *
+ *
+ *
+ * addendum: applications often search for the same query vectors again and again;
+ * this cache keeps the candidates (i.e. the TIDs) returned by VA index searches in
+ * a shared memory area of va_result_cache_size kilobytes, so that repeated searches
+ * are answered without reading the VA file; the key of a search is the index, a
+ * hash of the query vector, the number of neighbours, the distance and the settings
+ * of the approximate search; the query vector itself is stored with the candidates
+ * and compared on lookup, so that a hash collision cannot return the candidates of
+ * another query; the exact distances of the candidates are still calculated on the
+ * heap, which for k candidates is cheap
+ *
+ * the candidates of a VA index search only depend on the approximations in the
+ * index, not on the snapshot (the visibility is checked on the heap); so a cached
+ * search is valid as long as the index has not been changed, which is checked with
+ * the change counter on the meta page of the index (see vaGetChanges) and the
+ * relfilenode of the index (REINDEX and TRUNCATE start over with a new file)
+ *
+ * if the cache is full, the least recently used search is evicted
+ *
+ */
+#include "postgres.h"
+
+#include "utils/adam_index_va_results.h"
+
+#include "access/hash.h"
+#include "miscadmin.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/adam_data_feature.h"
+#include "utils/adam_index_va.h"
+#include "utils/hsearch.h"
+#include "utils/rel.h"
+
+/* space for the query vector and the candidates of a search */
+#define VA_RESULT_CACHE_DATA_SIZE	16384
+
+typedef struct VAResultKey
+{
+	Oid			dbid;
+	Oid			indexrelid;
+	uint32		hash;			/* hash of the query vector */
+	int32		dimensions;
+	int32		numResults;
+	int32		distance;
+	int32		maxCandidates;	/* settings of the approximate search */
+	float8		norm;
+	float8		recallTarget;
+} VAResultKey;
+
+typedef struct VAResultEntry
+{
+	VAResultKey key;			/* hash key, must be first */
+	Oid			relfilenode;	/* file of the index when the search was cached */
+	uint32		changes;		/* changes of the index when the search was cached */
+	uint64		lastUsed;
+	int			ntids;
+	char		data[VA_RESULT_CACHE_DATA_SIZE];	/* query vector, followed by the candidates */
+} VAResultEntry;
+
+typedef struct VAResultCacheShmemStruct
+{
+	uint64		clock;			/* for lastUsed */
+	long		maxEntries;
+} VAResultCacheShmemStruct;
+
+static VAResultCacheShmemStruct *VAResultCache = NULL;
+static HTAB *resultHash = NULL;
+
+int			va_result_cache_size = 0;
+
+static long getMaxEntries(void);
+static bool buildKey(IndexScanDesc scan, int numResults, AdamScanClause *adamOptions, VAResultKey *key, char **query);
+static void evictResult(void);
+
+
+/*
+ * number of searches that fit into the cache
+ */
+static long
+	getMaxEntries(void)
+{
+	if(va_result_cache_size <= 0){
+		return 0;
+	}
+
+	return Max(((long) va_result_cache_size * 1024L) / (long) sizeof(VAResultEntry), 1);
+}
+
+/*
+ * size of the shared memory needed for the cache
+ */
+Size
+	VAResultCacheShmemSize(void)
+{
+	long maxEntries = getMaxEntries();
+	Size size = MAXALIGN(sizeof(VAResultCacheShmemStruct));
+
+	if(maxEntries > 0){
+		size = add_size(size, hash_estimate_size(maxEntries, sizeof(VAResultEntry)));
+	}
+
+	return size;
+}
+
+/*
+ * creates the cache in shared memory
+ */
+void
+	VAResultCacheShmemInit(void)
+{
+	long maxEntries = getMaxEntries();
+	HASHCTL info;
+	bool found;
+
+	VAResultCache = (VAResultCacheShmemStruct *) ShmemInitStruct("VA Result Cache", sizeof(VAResultCacheShmemStruct), &found);
+
+	if(!found){
+		VAResultCache->clock = 0;
+		VAResultCache->maxEntries = maxEntries;
+	}
+
+	if(maxEntries <= 0){
+		return;
+	}
+
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(VAResultKey);
+	info.entrysize = sizeof(VAResultEntry);
+	info.hash = tag_hash;
+	resultHash = ShmemInitHash("VA Result Cache Searches", maxEntries, maxEntries,
+		&info, HASH_ELEM | HASH_FUNCTION);
+}
+
+/*
+ * is there any space for caching searches?
+ */
+bool
+	vaResultCacheEnabled(void)
+{
+	return resultHash != NULL;
+}
+
+/*
+ * adds the cached candidates of the search to the bitmap; returns false if the
+ * search is not cached for the current state of the index (nChanges)
+ */
+bool
+	vaResultCacheLookup(IndexScanDesc scan, int numResults, AdamScanClause *adamOptions, uint32 nChanges, TIDBitmap *tbm, int64 *ntids)
+{
+	VAResultKey key;
+	VAResultEntry *entry;
+	ItemPointerData *tids = NULL;
+	char *query;
+	Size len;
+	int n = 0;
+	bool found = false;
+
+	if(!buildKey(scan, numResults, adamOptions, &key, &query)){
+		return false;
+	}
+
+	len = key.dimensions * sizeof(float8);
+
+	LWLockAcquire(VAResultCacheLock, LW_EXCLUSIVE);
+
+	entry = (VAResultEntry *) hash_search(resultHash, &key, HASH_FIND, NULL);
+
+	if(entry){
+		if(entry->relfilenode != scan->indexRelation->rd_node.relNode || entry->changes != nChanges){
+			//the index has been changed since the search was cached
+			hash_search(resultHash, &entry->key, HASH_REMOVE, NULL);
+		} else if(memcmp(entry->data, query, len) == 0){
+			n = entry->ntids;
+			tids = (ItemPointerData *) palloc(Max(n, 1) * sizeof(ItemPointerData));
+			memcpy(tids, entry->data + len, n * sizeof(ItemPointerData));
+
+			entry->lastUsed = ++VAResultCache->clock;
+			found = true;
+		}
+	}
+
+	LWLockRelease(VAResultCacheLock);
+
+	if(found){
+		if(n > 0){
+			tbm_add_tuples(tbm, tids, n, false);
+		}
+		pfree(tids);
+		*ntids = n;
+	}
+
+	return found;
+}
+
+/*
+ * caches the candidates of a search done on the index in the state nChanges
+ */
+void
+	vaResultCacheStore(IndexScanDesc scan, int numResults, AdamScanClause *adamOptions, uint32 nChanges, ItemPointer tids, int ntids)
+{
+	VAResultKey key;
+	VAResultEntry *entry;
+	char *query;
+	Size len;
+	bool found;
+
+	if(ntids > VA_RESULT_CACHE_MAX_TIDS || !buildKey(scan, numResults, adamOptions, &key, &query)){
+		return;
+	}
+
+	len = key.dimensions * sizeof(float8);
+
+	if(len + ntids * sizeof(ItemPointerData) > VA_RESULT_CACHE_DATA_SIZE){
+		return;
+	}
+
+	LWLockAcquire(VAResultCacheLock, LW_EXCLUSIVE);
+
+	entry = (VAResultEntry *) hash_search(resultHash, &key, HASH_FIND, NULL);
+
+	if(entry == NULL){
+		if(hash_get_num_entries(resultHash) >= VAResultCache->maxEntries){
+			evictResult();
+		}
+
+		entry = (VAResultEntry *) hash_search(resultHash, &key, HASH_ENTER_NULL, &found);
+
+		if(entry == NULL){
+			LWLockRelease(VAResultCacheLock);
+			return;
+		}
+	}
+
+	//a query vector with the same hash is replaced
+	entry->relfilenode = scan->indexRelation->rd_node.relNode;
+	entry->changes = nChanges;
+	entry->lastUsed = ++VAResultCache->clock;
+	entry->ntids = ntids;
+	memcpy(entry->data, query, len);
+	memcpy(entry->data + len, tids, ntids * sizeof(ItemPointerData));
+
+	LWLockRelease(VAResultCacheLock);
+}
+
+
+/*
+ * builds the key of the search and returns the values of the query vector in
+ * query; returns false if the cache may not be used for the search
+ */
+static bool
+	buildKey(IndexScanDesc scan, int numResults, AdamScanClause *adamOptions, VAResultKey *key, char **query)
+{
+	feature *f;
+	char *data;
+	int len;
+
+	if(!vaResultCacheEnabled()){
+		return false;
+	}
+
+	if(scan->numberOfKeys < 1 || (scan->keyData->sk_flags & SK_ISNULL)){
+		return false;
+	}
+
+	f = (feature *) DatumGetPointer(scan->keyData->sk_argument);
+
+	if(f->typid != FLOAT8OID || ARR_HASNULL(&f->data)){
+		return false;
+	}
+
+	data = ARR_DATA_PTR(&f->data);
+	len = ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data)) * sizeof(float8);
+
+	MemSet(key, 0, sizeof(VAResultKey));
+	key->dbid = MyDatabaseId;
+	key->indexrelid = RelationGetRelid(scan->indexRelation);
+	key->hash = DatumGetUInt32(hash_any((unsigned char *) data, len));
+	key->dimensions = len / sizeof(float8);
+	key->numResults = numResults;
+	key->distance = (int32) adamOptions->nn_distance;
+	key->norm = adamOptions->nn_minkowski;
+	key->maxCandidates = va_max_candidates;
+	key->recallTarget = va_recall_target;
+
+	*query = data;
+
+	return true;
+}
+
+/*
+ * removes the least recently used search
+ */
+static void
+	evictResult(void)
+{
+	HASH_SEQ_STATUS status;
+	VAResultEntry *entry;
+	VAResultEntry *victim = NULL;
+
+	hash_seq_init(&status, resultHash);
+
+	while((entry = (VAResultEntry *) hash_seq_search(&status)) != NULL){
+		if(victim == NULL || entry->lastUsed < victim->lastUsed){
+			victim = entry;
+		}
+	}
+
+	if(victim){
+		hash_search(resultHash, &victim->key, HASH_REMOVE, NULL);
+	}
+}
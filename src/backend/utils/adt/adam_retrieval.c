@@ -17,6 +17,7 @@
 #include "postgres.h"
 
 #include "utils/adam_retrieval.h"
+#include "utils/adam_retrieval_batch.h"
 #include "utils/adam_retrieval_normalization.h"
 
 #include "commands/adam_data_featurefunctioncmds.h"
@@ -34,6 +35,7 @@
 #include "nodes/pg_list.h"
 #include "nodes/parsenodes.h"
 #include "nodes/primnodes.h"
+#include "optimizer/var.h"
 #include "parser/parse_expr.h"
 #include "parser/parse_type.h"
 #include "parser/parse_func.h"
@@ -58,22 +60,36 @@ Datum
 
 /*
 * tries to find the proc id of the distance function given the adam function options statement
-* the proc id can also be "guessed", i.e. looked up if stored at creation time
+* the proc id can also be "guessed", i.e. looked up if stored at creation time;
+* names that are not user-defined distances are looked up in the built-in
+* similarity distances (cosine, inner product, hamming)
 */
 Oid
 	getDistanceProcId(AdamFunctionOptionsStmt *distanceOp, 
 	FieldSelect *ltree, 
-	FeatureFunctionOpt **distanceOptions, MinkowskiNorm* nn_minkowski)
+	FeatureFunctionOpt **distanceOptions, MinkowskiNorm* nn_minkowski, AdamDistanceType *nn_distance)
 {
 	Oid distanceProcId = InvalidOid;
 
 	*distanceOptions = palloc(sizeof(FeatureFunctionOpt));
 	(*distanceOptions)->opts = NIL;
+	*nn_distance = ADAM_DISTANCE_UNKNOWN;
 
 	if(distanceOp && distanceOp->funname && IsA(distanceOp->funname, RangeVar)){
 		//a distance function has been specified manually
-		Oid ffunction = getDistanceOidFromRange((RangeVar *)distanceOp->funname, false);
-		distanceProcId = getProcIdForFeatureFunId(ffunction);
+		RangeVar *range = (RangeVar *) distanceOp->funname;
+		Oid ffunction = getDistanceOidFromRange(range, true);
+
+		if(OidIsValid(ffunction)){
+			distanceProcId = getProcIdForFeatureFunId(ffunction);
+		} else if(!range->schemaname){
+			*nn_distance = getSimilarityDistanceFromName(range->relname, &distanceProcId);
+		}
+
+		if(!OidIsValid(distanceProcId)){
+			//raise the error of the lookup
+			getDistanceOidFromRange(range, false);
+		}
 	
 	} else if(distanceOp && distanceOp->funname && IsA(distanceOp->funname, MinkowskiDistanceStmt)){
 		MinkowskiDistanceStmt *distance = (MinkowskiDistanceStmt *)  distanceOp->funname;
@@ -81,6 +97,7 @@ Oid
 
 		minkowski_arg = (Node *) make_const(NULL, (Value *) distance->norm, -1);
 		*nn_minkowski = getMinkowskiNormFromInput(distance->norm);
+		*nn_distance = ADAM_DISTANCE_MINKOWSKI;
 
 		if(!distance->weights){
 			distanceProcId = MINKOWSKI_PROCOID;
@@ -122,6 +139,7 @@ static Node *
 	Oid					*declared_arg_types;
 
 	MinkowskiNorm		 nn_minkowski = 0;
+	AdamDistanceType	 nn_distance;
 	Datum				*nn_minkowski_datum = palloc(sizeof(Datum));
 
 	ListCell			*cell;
@@ -130,9 +148,11 @@ static Node *
 	int					 n = 0;
 
 	FeatureFunctionOpt	*distanceOptions = NULL;
+	bool				 batch;
 
 	// get proc id
-	distanceProcId = getDistanceProcId(distanceOp, ltree, &distanceOptions, &nn_minkowski);
+	distanceProcId = getDistanceProcId(distanceOp, ltree, &distanceOptions, &nn_minkowski, &nn_distance);
+	batch = isBatchDistanceProc(distanceProcId);
 
 	if(distanceOp && distanceOp->defaults && distanceOp->defaults != NIL){
 		//defaults set
@@ -154,6 +174,14 @@ static Node *
 			errmsg("the number of specified parameters for the distance function is wrong")));
 	}
 
+	if(batch){
+		//the candidates are given one by one, calculateBatchDistance builds the batch
+		Oid *single_arg_types = palloc(sizeof(Oid) * n);
+		memcpy(single_arg_types, declared_arg_types, sizeof(Oid) * n);
+		single_arg_types[1] = FEATURE;
+		declared_arg_types = single_arg_types;
+	}
+
 	foreach(cell, args){
 		Node *node  = lfirst(cell);
 		actual_arg_types[i] = exprType(node);
@@ -166,10 +194,24 @@ static Node *
 	
 	make_fn_arguments(pstate, args, actual_arg_types, declared_arg_types, NULL);
 
+	// a distance in scalar form gets the features in the order written; a distance
+	// in batch form gets the query vector first, the candidates are batched (see
+	// adam_retrieval_batch.c)
+	if(batch){
+		if(contain_var_clause(linitial(args)) && !contain_var_clause(lsecond(args))){
+			Node *tmp = linitial(args);
+			linitial(args) = lsecond(args);
+			lsecond(args) = tmp;
+		}
+
+		args = lcons(makeConst(OIDOID, -1, InvalidOid, sizeof(Oid),
+			ObjectIdGetDatum(distanceProcId), false, true), args);
+	}
+
 	// create node
 	distanceExpr = makeNode(FuncExpr);
-	distanceExpr->funcid = distanceProcId;
-	distanceExpr->funcresulttype = getReturnTypeOfProcOid(distanceProcId);
+	distanceExpr->funcid = batch ? BATCH_DISTANCE_PROCOID : distanceProcId;
+	distanceExpr->funcresulttype = batch ? FLOAT8OID : getReturnTypeOfProcOid(distanceProcId);
 	distanceExpr->funcretset = false;
 	/* opcollid and inputcollid will be set by parse_collate.c */
 	distanceExpr->args = args;
@@ -177,7 +219,14 @@ static Node *
 
 	resultClause = makeNode(AdamQueryClause);
 	resultClause->check_tid = false; //default
+	resultClause->nn_distance = nn_distance;
 	resultClause->nn_minkowski = nn_minkowski;
+
+	//indexes bounding only unweighted distances have to know about the weights
+	if(distanceProcId == MINKOWSKI_WEIGHTED_PROCOID && list_length(args) > 3){
+		resultClause->nn_weights = (Node *) list_nth(args, 3);
+	}
+
 	*adamQueryClause = (Node *) resultClause;
 
 	return (Node *) distanceExpr;
@@ -267,7 +316,12 @@ static Node *
 		}
 	}
 
-	fieldSelectGetAttribute(ltree, &relid, &attname, &attnr);
+	if(ltree){
+		fieldSelectGetAttribute(ltree, &relid, &attname, &attnr);
+	} else {
+		relid = InvalidOid;
+		attname = NULL;
+	}
 		
 	actual_arg_types = palloc(sizeof(Oid) * list_length(args));
 	declared_arg_types = getParameterTypesFeatureFunction(normalizationProcId, &n);
@@ -395,7 +449,7 @@ Node*
 
 	Node					*transLExpr;
 	Node					*transRExpr;
-	Node					*transExpr;
+	Node					*transExpr = NULL;
 
 	Oid						 distanceProcId;
 	List					 *distanceArguments;
@@ -414,9 +468,11 @@ Node*
 
 	args = list_make2(transLExpr, transRExpr);
 
+	//the query vector may be a constant or anything else not depending on the tuple,
+	//e.g. a parameter of a prepared statement, bound at execution time
 	if(IsA(transLExpr, FieldSelect)){
 		transExpr = transLExpr;
-	} else if(IsA(transLExpr, Const) && IsA(transRExpr, FieldSelect)){
+	} else if(!contain_var_clause(transLExpr) && IsA(transRExpr, FieldSelect)){
 		transExpr = transRExpr;
 	} else {
 		if(!distanceOp || !distanceOp->funname){
@@ -0,0 +1,207 @@
+/*
+ * ADAM - batch distance functions
+ * name: adam_retrieval_batch
+ * description: functions for calling distance functions with batches of candidates
+ *
+ * src/backend/utils/adt/adam_retrieval_batch.c
+ *
+ *
+ *
+ *
+ * addendum: a distance function can be defined in batch form, i.e.
+ *
+ * CREATE DISTANCE d(FEATURE, FEATURE[]) RETURNS float8[] ...
+ *
+ * such a function gets the query vector and an array of candidate vectors and
+ * returns one distance per candidate; the scan nodes call it with batches of
+ * ADAM_BATCH_DISTANCE_SIZE candidates (see adam_exec_batch.c), all other places
+ * call it through calculateBatchDistance with a single candidate
+ *
+ * order of the arguments: a distance in scalar form gets the two features in
+ * the order written in the query, e.g. d(x, y) for USING DISTANCE d(x, y); a
+ * distance in batch form always gets the query vector first, i.e. for
+ * USING DISTANCE d(f, '<1,2>') with a column f, it is called as
+ * d('<1,2>', ARRAY[f, ...]); if both or none of the features depend on the
+ * tuple, the first one written is the query vector (see adam_retrieval.c);
+ * the same order holds for calculateBatchDistance and for the batches
+ *
+ */
+#include "postgres.h"
+
+#include "utils/adam_retrieval_batch.h"
+
+#include "access/htup_details.h"
+#include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
+#include "utils/array.h"
+#include "utils/syscache.h"
+
+
+/*
+ * calls the batch distance function given in the first argument for a single candidate;
+ * the arguments are the query vector, the candidate vector and the additional
+ * parameters of the distance function, i.e. the query vector comes first whatever
+ * the order in the query (see above)
+ */
+Datum
+	calculateBatchDistance(PG_FUNCTION_ARGS)
+{
+	FmgrInfo   *flinfo = (FmgrInfo *) fcinfo->flinfo->fn_extra;
+	Oid			procid = PG_GETARG_OID(0);
+
+	Datum		candidate;
+	bool		candidateNull;
+	Datum	   *extras = NULL;
+	bool	   *extraNulls = NULL;
+	int			nextras = PG_NARGS() - 3;
+	int			i;
+
+	float8		result;
+	bool		resultNull;
+
+	if(PG_NARGS() < 3){
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			errmsg("a batch distance function needs a query and a candidate vector")));
+	}
+
+	//cache the function info of the batch distance function
+	if(flinfo == NULL || flinfo->fn_oid != procid){
+		flinfo = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt, sizeof(FmgrInfo));
+		fmgr_info_cxt(procid, flinfo, fcinfo->flinfo->fn_mcxt);
+		fcinfo->flinfo->fn_extra = flinfo;
+	}
+
+	candidate = PG_GETARG_DATUM(2);
+	candidateNull = PG_ARGISNULL(2);
+
+	if(nextras > 0){
+		extras = palloc(sizeof(Datum) * nextras);
+		extraNulls = palloc(sizeof(bool) * nextras);
+
+		for(i = 0; i < nextras; i++){
+			extras[i] = PG_GETARG_DATUM(i + 3);
+			extraNulls[i] = PG_ARGISNULL(i + 3);
+		}
+	}
+
+	callBatchDistance(flinfo, PG_GET_COLLATION(), PG_GETARG_DATUM(1), PG_ARGISNULL(1),
+		&candidate, &candidateNull, 1, extras, extraNulls, nextras, &result, &resultNull);
+
+	if(resultNull){
+		PG_RETURN_NULL();
+	}
+
+	PG_RETURN_FLOAT8(result);
+}
+
+
+/*
+ * checks whether the procedure is a distance function in batch form, i.e. takes
+ * the candidates as feature array and returns an array of distances
+ */
+bool
+	isBatchDistanceProc(Oid procid)
+{
+	HeapTuple		proctup;
+	Form_pg_proc	procform;
+	bool			result = false;
+
+	proctup = SearchSysCache1(PROCOID, ObjectIdGetDatum(procid));
+
+	if(HeapTupleIsValid(proctup)){
+		procform = (Form_pg_proc) GETSTRUCT(proctup);
+
+		result = procform->pronargs >= 2 &&
+			procform->proargtypes.values[1] == FEATUREARRAYOID &&
+			procform->prorettype == FLOAT8ARRAYOID &&
+			!procform->proretset;
+
+		ReleaseSysCache(proctup);
+	}
+
+	return result;
+}
+
+
+/*
+ * calls the batch distance function for n candidates and stores the distances
+ * in results; the memory is allocated in the current memory context
+ */
+void
+	callBatchDistance(FmgrInfo *flinfo, Oid collation, Datum query, bool queryNull,
+	Datum *candidates, bool *candidateNulls, int n,
+	Datum *extras, bool *extraNulls, int nextras,
+	float8 *results, bool *resultNulls)
+{
+	FunctionCallInfoData fcinfo;
+	ArrayType  *candidateArray;
+	ArrayType  *resultArray;
+	Datum		resultDatum;
+	Datum	   *values;
+	bool	   *nulls;
+	int			nvalues;
+	int			lbs = 1;
+	int			i;
+
+	if(flinfo->fn_strict){
+		bool anyNull = queryNull;
+
+		for(i = 0; i < nextras; i++){
+			anyNull |= extraNulls[i];
+		}
+
+		if(anyNull){
+			for(i = 0; i < n; i++){
+				resultNulls[i] = true;
+			}
+			return;
+		}
+	}
+
+	candidateArray = construct_md_array(candidates, candidateNulls, 1, &n, &lbs,
+		FEATURE, -1, false, 'd');
+
+	InitFunctionCallInfoData(fcinfo, flinfo, 2 + nextras, collation, NULL, NULL);
+
+	fcinfo.arg[0] = query;
+	fcinfo.argnull[0] = queryNull;
+	fcinfo.arg[1] = PointerGetDatum(candidateArray);
+	fcinfo.argnull[1] = false;
+
+	for(i = 0; i < nextras; i++){
+		fcinfo.arg[i + 2] = extras[i];
+		fcinfo.argnull[i + 2] = extraNulls[i];
+	}
+
+	resultDatum = FunctionCallInvoke(&fcinfo);
+
+	if(fcinfo.isnull){
+		for(i = 0; i < n; i++){
+			resultNulls[i] = true;
+		}
+		return;
+	}
+
+	resultArray = DatumGetArrayTypeP(resultDatum);
+
+	if(ARR_NDIM(resultArray) > 1 || ARR_ELEMTYPE(resultArray) != FLOAT8OID){
+		ereport(ERROR,
+			(errcode(ERRCODE_DATATYPE_MISMATCH),
+			errmsg("a batch distance function has to return a one-dimensional array of double precision values")));
+	}
+
+	deconstruct_array(resultArray, FLOAT8OID, sizeof(float8), FLOAT8PASSBYVAL, 'd',
+		&values, &nulls, &nvalues);
+
+	if(nvalues != n){
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			errmsg("batch distance function returned %d distances for %d candidates", nvalues, n)));
+	}
+
+	for(i = 0; i < n; i++){
+		resultNulls[i] = nulls[i];
+		results[i] = nulls[i] ? 0 : DatumGetFloat8(values[i]);
+	}
+}
@@ -0,0 +1,759 @@
+/*
+ * ADAM - bag-of-visual-words retrieval
+ * name: adam_retrieval_bow
+ * description: codebooks of visual words, quantization of sets of features and
+ * tf-idf ranking of objects described by sets of features
+ *
+ * src/backend/utils/adt/adam_retrieval_bow.c
+ *
+ *
+ *
+ *
+ * addendum: objects described by many local features (e.g. the keypoint
+ * descriptors of an image) are stored as an array of features, e.g.
+ *
+ * CREATE TABLE images (id int, descriptors feature[], words int4[]);
+ *
+ * SELECT feature_codebook_train('sift', 'images', 'descriptors', 1000);
+ * UPDATE images SET words = feature_visual_words('sift', descriptors);
+ * CREATE INDEX ON images USING gin (words);
+ *
+ * feature_codebook_train clusters the features of a sample of the objects into
+ * visual words with k-means and counts in how many of the sampled objects every
+ * visual word occurs; the codebook is stored in the catalog adam_codebook and
+ * depends on the column it has been trained on, i.e. it is dropped with it
+ *
+ * feature_visual_words maps every feature of a set to the (1-based) id of its
+ * nearest visual word; the ids are repeated as often as they occur, so the
+ * array holds the term frequencies as well; GIN indexes the distinct ids of
+ * the arrays with the array operator class of int4[], so that the objects
+ * sharing a visual word with a query are found in the posting lists of the
+ * inverted index, e.g.
+ *
+ * SELECT id, feature_bow_rank('sift', words, q) AS score FROM images
+ *     WHERE words && q ORDER BY score DESC LIMIT 10;
+ *
+ * feature_bow_rank is the cosine of the tf-idf weighted visual words of an
+ * object and the query; the top-k of the candidates is kept by the bounded
+ * sort of the LIMIT
+ *
+ */
+#include "postgres.h"
+
+#include "utils/adam_retrieval_bow.h"
+
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/sysattr.h"
+#include "catalog/adam_data_codebook.h"
+#include "catalog/dependency.h"
+#include "catalog/indexing.h"
+#include "catalog/pg_type.h"
+#include "commands/vacuum.h"
+#include "miscadmin.h"
+#include "utils/acl.h"
+#include "utils/adam_data_feature.h"
+#include "utils/adam_utils_kmeans.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/tqual.h"
+
+#include <math.h>
+
+/*
+ * codebook as used by the quantization and the ranking; cached in fn_extra
+ */
+typedef struct Codebook {
+	NameData	name;
+	int			dimensions;
+	int			words;
+	float8	   *centroids;		//words x dimensions
+	float8	   *idf;			//inverse document frequency of every visual word
+} Codebook;
+
+static HeapTuple searchCodebook(Relation catalog, const char *name);
+static HeapTuple searchCodebookById(Relation catalog, Oid codebookOid);
+static Codebook *getCodebook(FunctionCallInfo fcinfo, text *codebookName);
+static float8 *getCatalogArray(HeapTuple tuple, TupleDesc tupdesc, AttrNumber attno, int nitems, MemoryContext ctx);
+static int getDescriptors(ArrayType *features, int *dimensions, float8 **vectors);
+static int getWords(ArrayType *words, Codebook *codebook, int32 **result);
+static int compareWords(const void *a, const void *b);
+
+
+/*
+ * trains a codebook of visual words on a sample of the objects of a table and
+ * stores it in the catalog
+ *
+ * arguments: name of the codebook, table, column with the arrays of features,
+ * number of visual words
+ */
+Datum
+	feature_codebook_train(PG_FUNCTION_ARGS)
+{
+	char	   *name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	Oid			relid = PG_GETARG_OID(1);
+	char	   *column = text_to_cstring(PG_GETARG_TEXT_PP(2));
+	int			words = PG_GETARG_INT32(3);
+
+	AclResult	aclresult;
+	Relation	rel;
+	Relation	catalog;
+	TupleDesc	tupdesc;
+	AttrNumber	attno;
+	HeapTuple  *rows;
+	int			nrows;
+	double		totRows;			//total in relation (unimportant here)
+	double		totDeadRows;		//total in relation (unimportant here)
+	MemoryContext tmpCtx;
+	MemoryContext oldCtx;
+
+	int			dimensions = -1;
+	float8	   *vectors = NULL;		//reservoir of the sampled features
+	long		capacity = 0;
+	long		nvectors = 0;
+	double		seen = 0;
+
+	float8	   *centroids;
+	float8	   *frequencies;
+	int		   *lastObject;
+	float8		documents = 0;
+	int			iterations;
+
+	Datum	   *elements;
+	Datum		values[Natts_adam_codebook];
+	bool		nulls[Natts_adam_codebook];
+	NameData	codebookName;
+	HeapTuple	tuple;
+	Oid			codebookOid;
+	ObjectAddress myself;
+	ObjectAddress referenced;
+	int			i, j;
+
+	if(words <= 0){
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			errmsg("the number of visual words must be positive")));
+	}
+
+	if(strlen(name) >= NAMEDATALEN){
+		ereport(ERROR,
+			(errcode(ERRCODE_NAME_TOO_LONG),
+			errmsg("codebook name \"%s\" is too long", name)));
+	}
+
+	aclresult = pg_class_aclcheck(relid, GetUserId(), ACL_SELECT);
+	if(aclresult != ACLCHECK_OK){
+		aclcheck_error(aclresult, ACL_KIND_CLASS, get_rel_name(relid));
+	}
+
+	rel = heap_open(relid, AccessShareLock);
+	tupdesc = RelationGetDescr(rel);
+	attno = get_attnum(relid, column);
+
+	if(attno <= 0){
+		ereport(ERROR,
+			(errcode(ERRCODE_UNDEFINED_COLUMN),
+			errmsg("column \"%s\" of relation \"%s\" does not exist", column, RelationGetRelationName(rel))));
+	}
+
+	if(tupdesc->attrs[attno - 1]->atttypid != FEATUREARRAYOID){
+		ereport(ERROR,
+			(errcode(ERRCODE_DATATYPE_MISMATCH),
+			errmsg("column \"%s\" of relation \"%s\" is not an array of features", column, RelationGetRelationName(rel)),
+			errhint("Aggregate the features of an object with array_agg.")));
+	}
+
+	tmpCtx = AllocSetContextCreate(CurrentMemoryContext, "Codebook training context",
+		ALLOCSET_DEFAULT_MINSIZE, ALLOCSET_DEFAULT_INITSIZE, ALLOCSET_DEFAULT_MAXSIZE);
+
+	//retrieve sample data
+	rows = palloc(sizeof(HeapTuple) * BOW_SAMPLE_OBJECTS);
+	nrows = acquire_sample_rows_outside_analyze(rel, DEBUG1, rows, BOW_SAMPLE_OBJECTS, &totRows, &totDeadRows);
+
+	//sample the features of the objects into a reservoir fitting into work_mem
+	for(i = 0; i < nrows; i++){
+		Datum value;
+		bool isnull;
+		float8 *descriptors;
+		int ndescriptors;
+
+		value = heap_getattr(rows[i], attno, tupdesc, &isnull);
+
+		if(isnull){
+			continue;
+		}
+
+		oldCtx = MemoryContextSwitchTo(tmpCtx);
+		ndescriptors = getDescriptors(DatumGetArrayTypeP(value), &dimensions, &descriptors);
+		MemoryContextSwitchTo(oldCtx);
+
+		if(ndescriptors > 0 && vectors == NULL){
+			capacity = Max(words, (work_mem * 1024L) / (long) (dimensions * sizeof(float8)));
+			capacity = Min(capacity, (long) (MaxAllocSize / (dimensions * sizeof(float8))));
+			vectors = (float8 *) palloc(sizeof(float8) * dimensions * capacity);
+		}
+
+		for(j = 0; j < ndescriptors; j++){
+			long position = nvectors;
+
+			seen++;
+
+			if(nvectors == capacity){
+				position = (long) (seen * anl_random_fract());
+
+				if(position >= capacity){
+					continue;
+				}
+			} else {
+				nvectors++;
+			}
+
+			memcpy(vectors + position * dimensions, descriptors + (Size) j * dimensions, sizeof(float8) * dimensions);
+		}
+
+		MemoryContextReset(tmpCtx);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	if(nvectors < words){
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			errmsg("too few features to train %d visual words", words)));
+	}
+
+	centroids = (float8 *) palloc(sizeof(float8) * dimensions * words);
+	iterations = kmeansCluster(vectors, nvectors, dimensions, words, BOW_KMEANS_ITERATIONS, centroids);
+
+	ereport(DEBUG1,
+		(errmsg("trained %d visual words on %ld features in %d iterations", words, nvectors, iterations)));
+
+	pfree(vectors);
+
+	//count the objects containing the visual words
+	frequencies = (float8 *) palloc0(sizeof(float8) * words);
+	lastObject = (int *) palloc(sizeof(int) * words);
+
+	for(j = 0; j < words; j++){
+		lastObject[j] = -1;
+	}
+
+	for(i = 0; i < nrows; i++){
+		Datum value;
+		bool isnull;
+		float8 *descriptors;
+		int ndescriptors;
+
+		value = heap_getattr(rows[i], attno, tupdesc, &isnull);
+
+		if(isnull){
+			continue;
+		}
+
+		oldCtx = MemoryContextSwitchTo(tmpCtx);
+		ndescriptors = getDescriptors(DatumGetArrayTypeP(value), &dimensions, &descriptors);
+		MemoryContextSwitchTo(oldCtx);
+
+		for(j = 0; j < ndescriptors; j++){
+			int word = kmeansNearest(centroids, words, dimensions, descriptors + (Size) j * dimensions, NULL);
+
+			if(lastObject[word] != i){
+				lastObject[word] = i;
+				frequencies[word]++;
+			}
+		}
+
+		documents++;
+
+		MemoryContextReset(tmpCtx);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	heap_close(rel, NoLock);
+
+	//store the codebook
+	catalog = heap_open(AdamCodebookRelationId, RowExclusiveLock);
+
+	tuple = searchCodebook(catalog, name);
+
+	if(HeapTupleIsValid(tuple)){
+		ereport(ERROR,
+			(errcode(ERRCODE_DUPLICATE_OBJECT),
+			errmsg("codebook \"%s\" already exists", name)));
+	}
+
+	memset(nulls, false, sizeof(nulls));
+
+	namestrcpy(&codebookName, name);
+	values[Anum_adam_codebook_cbname - 1] = NameGetDatum(&codebookName);
+	values[Anum_adam_codebook_cbowner - 1] = ObjectIdGetDatum(GetUserId());
+	values[Anum_adam_codebook_cbdimensions - 1] = Int32GetDatum(dimensions);
+	values[Anum_adam_codebook_cbwords - 1] = Int32GetDatum(words);
+	values[Anum_adam_codebook_cbdocuments - 1] = Float8GetDatum(documents);
+
+	elements = (Datum *) palloc(sizeof(Datum) * dimensions * words);
+
+	for(i = 0; i < dimensions * words; i++){
+		elements[i] = Float8GetDatum(centroids[i]);
+	}
+
+	values[Anum_adam_codebook_cbcentroids - 1] = PointerGetDatum(construct_array(elements, dimensions * words, FLOAT8OID, sizeof(float8), FLOAT8PASSBYVAL, 'd'));
+
+	for(i = 0; i < words; i++){
+		elements[i] = Float8GetDatum(frequencies[i]);
+	}
+
+	values[Anum_adam_codebook_cbfrequencies - 1] = PointerGetDatum(construct_array(elements, words, FLOAT8OID, sizeof(float8), FLOAT8PASSBYVAL, 'd'));
+
+	tuple = heap_form_tuple(RelationGetDescr(catalog), values, nulls);
+	codebookOid = simple_heap_insert(catalog, tuple);
+	CatalogUpdateIndexes(catalog, tuple);
+
+	heap_close(catalog, RowExclusiveLock);
+
+	//the codebook is dropped with the column it has been trained on
+	myself.classId = AdamCodebookRelationId;
+	myself.objectId = codebookOid;
+	myself.objectSubId = 0;
+	referenced.classId = RelationRelationId;
+	referenced.objectId = relid;
+	referenced.objectSubId = attno;
+	recordDependencyOn(&myself, &referenced, DEPENDENCY_AUTO);
+
+	MemoryContextDelete(tmpCtx);
+
+	PG_RETURN_OID(codebookOid);
+}
+
+/*
+ * removes a codebook from the catalog
+ */
+Datum
+	feature_codebook_drop(PG_FUNCTION_ARGS)
+{
+	char	   *name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	Relation	catalog;
+	HeapTuple	tuple;
+	ObjectAddress object;
+
+	catalog = heap_open(AdamCodebookRelationId, RowExclusiveLock);
+
+	tuple = searchCodebook(catalog, name);
+
+	if(!HeapTupleIsValid(tuple)){
+		ereport(ERROR,
+			(errcode(ERRCODE_UNDEFINED_OBJECT),
+			errmsg("codebook \"%s\" does not exist", name)));
+	}
+
+	if(!has_privs_of_role(GetUserId(), ((Form_adam_codebook) GETSTRUCT(tuple))->cbowner)){
+		ereport(ERROR,
+			(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+			errmsg("must be owner of codebook %s", name)));
+	}
+
+	object.classId = AdamCodebookRelationId;
+	object.objectId = HeapTupleGetOid(tuple);
+	object.objectSubId = 0;
+
+	heap_close(catalog, RowExclusiveLock);
+
+	//removes the dependencies as well
+	performDeletion(&object, DROP_RESTRICT, 0);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * removes a codebook from the catalog (called by performDeletion, e.g. if the
+ * table of the codebook is dropped)
+ */
+void
+	removeCodebookById(Oid codebookOid)
+{
+	Relation	catalog;
+	HeapTuple	tuple;
+
+	catalog = heap_open(AdamCodebookRelationId, RowExclusiveLock);
+
+	tuple = searchCodebookById(catalog, codebookOid);
+
+	if(!HeapTupleIsValid(tuple)){
+		elog(ERROR, "cache lookup failed for codebook %u", codebookOid);
+	}
+
+	simple_heap_delete(catalog, &tuple->t_self);
+
+	heap_close(catalog, RowExclusiveLock);
+}
+
+/*
+ * returns the name of a codebook (for the descriptions of dependencies)
+ */
+char *
+	getCodebookName(Oid codebookOid)
+{
+	Relation	catalog;
+	HeapTuple	tuple;
+	char	   *result;
+
+	catalog = heap_open(AdamCodebookRelationId, AccessShareLock);
+
+	tuple = searchCodebookById(catalog, codebookOid);
+
+	if(!HeapTupleIsValid(tuple)){
+		elog(ERROR, "cache lookup failed for codebook %u", codebookOid);
+	}
+
+	result = pstrdup(NameStr(((Form_adam_codebook) GETSTRUCT(tuple))->cbname));
+
+	heap_close(catalog, AccessShareLock);
+
+	return result;
+}
+
+/*
+ * maps every feature of a set to the id of its nearest visual word; the ids
+ * are returned in ascending order
+ */
+Datum
+	feature_visual_words(PG_FUNCTION_ARGS)
+{
+	Codebook   *codebook = getCodebook(fcinfo, PG_GETARG_TEXT_PP(0));
+	ArrayType  *features = PG_GETARG_ARRAYTYPE_P(1);
+	int			dimensions = codebook->dimensions;
+	float8	   *vectors;
+	int32	   *words;
+	Datum	   *elements;
+	int			n;
+	int			i;
+
+	n = getDescriptors(features, &dimensions, &vectors);
+
+	if(n == 0){
+		PG_RETURN_ARRAYTYPE_P(construct_empty_array(INT4OID));
+	}
+
+	words = (int32 *) palloc(sizeof(int32) * n);
+
+	for(i = 0; i < n; i++){
+		words[i] = kmeansNearest(codebook->centroids, codebook->words, dimensions, vectors + (Size) i * dimensions, NULL) + 1;
+	}
+
+	qsort(words, n, sizeof(int32), compareWords);
+
+	elements = (Datum *) palloc(sizeof(Datum) * n);
+
+	for(i = 0; i < n; i++){
+		elements[i] = Int32GetDatum(words[i]);
+	}
+
+	PG_RETURN_ARRAYTYPE_P(construct_array(elements, n, INT4OID, sizeof(int32), true, 'i'));
+}
+
+/*
+ * tf-idf ranking: cosine of the visual words of an object and of a query, every
+ * visual word weighted with its frequency in the set and its inverse document
+ * frequency in the codebook
+ */
+Datum
+	feature_bow_rank(PG_FUNCTION_ARGS)
+{
+	Codebook   *codebook = getCodebook(fcinfo, PG_GETARG_TEXT_PP(0));
+	int32	   *document;
+	int32	   *query;
+	int			ndocument;
+	int			nquery;
+	float8		dot = 0;
+	float8		documentNorm = 0;
+	float8		queryNorm = 0;
+	int			i = 0;
+	int			j = 0;
+
+	ndocument = getWords(PG_GETARG_ARRAYTYPE_P(1), codebook, &document);
+	nquery = getWords(PG_GETARG_ARRAYTYPE_P(2), codebook, &query);
+
+	//merge the sorted visual words; the runs of equal ids are the term frequencies
+	while(i < ndocument || j < nquery){
+		int32 word;
+		int documentFrequency = 0;
+		int queryFrequency = 0;
+		float8 idf;
+
+		if(j >= nquery || (i < ndocument && document[i] <= query[j])){
+			word = document[i];
+		} else {
+			word = query[j];
+		}
+
+		while(i < ndocument && document[i] == word){
+			documentFrequency++;
+			i++;
+		}
+
+		while(j < nquery && query[j] == word){
+			queryFrequency++;
+			j++;
+		}
+
+		idf = codebook->idf[word - 1];
+
+		dot += documentFrequency * idf * queryFrequency * idf;
+		documentNorm += (documentFrequency * idf) * (documentFrequency * idf);
+		queryNorm += (queryFrequency * idf) * (queryFrequency * idf);
+	}
+
+	if(documentNorm <= 0 || queryNorm <= 0){
+		PG_RETURN_FLOAT8(0);
+	}
+
+	PG_RETURN_FLOAT8(dot / sqrt(documentNorm * queryNorm));
+}
+
+
+/*
+ * returns a copy of the catalog tuple of the codebook (or an invalid tuple)
+ */
+static HeapTuple
+	searchCodebook(Relation catalog, const char *name)
+{
+	ScanKeyData key;
+	SysScanDesc scan;
+	HeapTuple	tuple;
+
+	ScanKeyInit(&key, Anum_adam_codebook_cbname, BTEqualStrategyNumber, F_NAMEEQ, CStringGetDatum(name));
+
+	scan = systable_beginscan(catalog, AdamCodebookNameIndexId, true, SnapshotNow, 1, &key);
+	tuple = systable_getnext(scan);
+
+	if(HeapTupleIsValid(tuple)){
+		tuple = heap_copytuple(tuple);
+	}
+
+	systable_endscan(scan);
+
+	return tuple;
+}
+
+/*
+ * returns a copy of the catalog entry of the codebook with the given oid
+ */
+static HeapTuple
+	searchCodebookById(Relation catalog, Oid codebookOid)
+{
+	ScanKeyData key;
+	SysScanDesc scan;
+	HeapTuple	tuple;
+
+	ScanKeyInit(&key, ObjectIdAttributeNumber, BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(codebookOid));
+
+	scan = systable_beginscan(catalog, AdamCodebookOidIndexId, true, SnapshotNow, 1, &key);
+	tuple = systable_getnext(scan);
+
+	if(HeapTupleIsValid(tuple)){
+		tuple = heap_copytuple(tuple);
+	}
+
+	systable_endscan(scan);
+
+	return tuple;
+}
+
+/*
+ * reads the codebook from the catalog; the codebook is kept in fn_extra for the
+ * subsequent calls of the function
+ */
+static Codebook *
+	getCodebook(FunctionCallInfo fcinfo, text *codebookName)
+{
+	Codebook   *codebook = (Codebook *) fcinfo->flinfo->fn_extra;
+	char	   *name = text_to_cstring(codebookName);
+	Relation	catalog;
+	HeapTuple	tuple;
+	Form_adam_codebook form;
+	float8	   *frequencies;
+	float8		documents;
+	int			i;
+
+	if(codebook && strncmp(NameStr(codebook->name), name, NAMEDATALEN) == 0){
+		return codebook;
+	}
+
+	catalog = heap_open(AdamCodebookRelationId, AccessShareLock);
+
+	tuple = searchCodebook(catalog, name);
+
+	if(!HeapTupleIsValid(tuple)){
+		ereport(ERROR,
+			(errcode(ERRCODE_UNDEFINED_OBJECT),
+			errmsg("codebook \"%s\" does not exist", name)));
+	}
+
+	form = (Form_adam_codebook) GETSTRUCT(tuple);
+
+	if(codebook){
+		pfree(codebook->centroids);
+		pfree(codebook->idf);
+	} else {
+		codebook = (Codebook *) MemoryContextAlloc(fcinfo->flinfo->fn_mcxt, sizeof(Codebook));
+	}
+
+	namestrcpy(&codebook->name, name);
+	codebook->dimensions = form->cbdimensions;
+	codebook->words = form->cbwords;
+	documents = form->cbdocuments;
+
+	codebook->centroids = getCatalogArray(tuple, RelationGetDescr(catalog), Anum_adam_codebook_cbcentroids,
+		codebook->words * codebook->dimensions, fcinfo->flinfo->fn_mcxt);
+	frequencies = getCatalogArray(tuple, RelationGetDescr(catalog), Anum_adam_codebook_cbfrequencies,
+		codebook->words, fcinfo->flinfo->fn_mcxt);
+
+	//the frequencies are replaced by the inverse document frequencies
+	codebook->idf = frequencies;
+
+	for(i = 0; i < codebook->words; i++){
+		codebook->idf[i] = log((documents + 1) / (frequencies[i] + 1));
+	}
+
+	heap_close(catalog, AccessShareLock);
+
+	fcinfo->flinfo->fn_extra = codebook;
+
+	return codebook;
+}
+
+/*
+ * copies the values of a float8 array of the catalog tuple into the memory context
+ */
+static float8 *
+	getCatalogArray(HeapTuple tuple, TupleDesc tupdesc, AttrNumber attno, int nitems, MemoryContext ctx)
+{
+	Datum		value;
+	bool		isnull;
+	ArrayType  *array;
+	float8	   *result;
+
+	value = heap_getattr(tuple, attno, tupdesc, &isnull);
+
+	if(isnull){
+		elog(ERROR, "null array in codebook");
+	}
+
+	array = DatumGetArrayTypeP(value);
+
+	if(ARR_NDIM(array) != 1 || ARR_DIMS(array)[0] != nitems || ARR_HASNULL(array) || ARR_ELEMTYPE(array) != FLOAT8OID){
+		elog(ERROR, "invalid array in codebook");
+	}
+
+	result = (float8 *) MemoryContextAlloc(ctx, sizeof(float8) * nitems);
+	memcpy(result, ARR_DATA_PTR(array), sizeof(float8) * nitems);
+
+	return result;
+}
+
+/*
+ * returns the non-null features of an array (as float8 vectors one after the
+ * other); all features must have the same number of dimensions, which is set if
+ * it is still -1
+ */
+static int
+	getDescriptors(ArrayType *features, int *dimensions, float8 **vectors)
+{
+	Datum	   *elements;
+	bool	   *nulls;
+	int			nelements;
+	int			n = 0;
+	int			i;
+
+	deconstruct_array(features, FEATURE, -1, false, 'd', &elements, &nulls, &nelements);
+
+	*vectors = NULL;
+
+	for(i = 0; i < nelements; i++){
+		feature *f;
+		int d;
+
+		if(nulls[i]){
+			continue;
+		}
+
+		f = featureToFloat8((feature *) PG_DETOAST_DATUM(elements[i]));
+		d = ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data));
+
+		if(ARR_HASNULL(&f->data)){
+			ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				errmsg("features with null values cannot be mapped to visual words")));
+		}
+
+		if(*dimensions < 0){
+			*dimensions = d;
+		} else if(*dimensions != d){
+			ereport(ERROR,
+				(errcode(ERRCODE_DATA_EXCEPTION),
+				errmsg("the features of a codebook must have the same number of dimensions")));
+		}
+
+		if(*vectors == NULL){
+			*vectors = (float8 *) palloc(sizeof(float8) * d * nelements);
+		}
+
+		memcpy(*vectors + (Size) n * d, ARR_DATA_PTR(&f->data), sizeof(float8) * d);
+		n++;
+	}
+
+	pfree(elements);
+	pfree(nulls);
+
+	return n;
+}
+
+/*
+ * returns the sorted visual words of an array
+ */
+static int
+	getWords(ArrayType *words, Codebook *codebook, int32 **result)
+{
+	int n = ArrayGetNItems(ARR_NDIM(words), ARR_DIMS(words));
+	int i;
+
+	if(ARR_HASNULL(words)){
+		ereport(ERROR,
+			(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			errmsg("visual words must not be null")));
+	}
+
+	*result = (int32 *) palloc(sizeof(int32) * Max(n, 1));
+	memcpy(*result, ARR_DATA_PTR(words), sizeof(int32) * n);
+
+	for(i = 0; i < n; i++){
+		if((*result)[i] < 1 || (*result)[i] > codebook->words){
+			ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				errmsg("visual word %d does not exist in codebook \"%s\"", (*result)[i], NameStr(codebook->name))));
+		}
+	}
+
+	qsort(*result, n, sizeof(int32), compareWords);
+
+	return n;
+}
+
+static int
+	compareWords(const void *a, const void *b)
+{
+	int32 x = *((const int32 *) a);
+	int32 y = *((const int32 *) b);
+
+	if(x < y){
+		return -1;
+	}
+
+	return (x > y) ? 1 : 0;
+}
@@ -0,0 +1,827 @@
+/*
+ * ADAM - similarity joins
+ * name: adam_retrieval_join
+ * description: kNN-join and epsilon-join between two tables with feature columns
+ *
+ * src/backend/utils/adt/adam_retrieval_join.c
+ *
+ *
+ *
+ *
+ * addendum: the joins are set-returning functions, e.g.
+ *
+ * SELECT * FROM feature_knn_join('keyframes', 'id', 'f', 'images', 'id', 'f', 10, 2)
+ *     AS j(keyframe int, image int, distance float8);
+ *
+ * returns the 10 nearest images of every keyframe (with the distance of
+ * calculateMinkowski); feature_epsilon_join returns all pairs within a distance
+ *
+ * the outer table is read in chunks fitting into work_mem; for every chunk, the
+ * inner table is read once and compared in tiles of ADAM_JOIN_TILE_SIZE bytes
+ * with all outer vectors of the chunk, keeping the k nearest neighbours of every
+ * outer vector in a heap (or emitting the pairs within epsilon); the comparison
+ * of an outer and an inner vector is stopped as soon as the distance exceeds
+ * the current k-th neighbour (or epsilon)
+ *
+ * if the feature column of the inner table has a VA index, only the tuples that
+ * may be among the neighbours of at least one outer vector of the chunk are read
+ * from the inner table (see vaJoinCandidates)
+ *
+ * the planner uses the same method for a LATERAL subquery returning the k nearest
+ * neighbours of a feature of the outer tuple (see nodeSimilarityjoin.c)
+ *
+ */
+#include "postgres.h"
+
+#include "utils/adam_retrieval_join.h"
+
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/relscan.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_index.h"
+#include "catalog/pg_type.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "nodes/tidbitmap.h"
+#include "storage/bufmgr.h"
+#include "utils/acl.h"
+#include "utils/adam_data_feature.h"
+#include "utils/adam_index_marks.h"
+#include "utils/adam_index_va.h"
+#include "utils/adam_retrieval_minkowski.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/tqual.h"
+#include "utils/tuplestore.h"
+
+#include <math.h>
+
+#define EPSILON	0.001
+
+/* number of dimensions after which the distance is compared with the bound */
+#define JOIN_DISTANCE_BLOCK		16
+
+bool enable_similarityjoin = true;
+
+typedef struct JoinSide {
+	Relation	rel;
+	AttrNumber	keyAttno;
+	AttrNumber	featureAttno;
+	Oid			keyType;
+	int16		keyLen;
+	bool		keyByVal;
+} JoinSide;
+
+typedef struct JoinNeighbour {
+	float8		distance;
+	Datum		key;
+	bool		keyNull;
+} JoinNeighbour;
+
+typedef struct SimilarityJoinContext {
+	JoinSide		outer;
+	JoinSide		inner;
+
+	int				k;				//0 for the epsilon-join
+	float8			epsilon;
+	MinkowskiNorm	norm;
+	JoinNorm		joinNorm;
+
+	int				dimensions;		//-1 as long as no feature has been seen
+	Relation		vaIndex;		//VA index of the inner feature column (or NULL)
+	Snapshot		snapshot;
+
+	//chunk of outer tuples
+	int				chunkSize;
+	int				nouter;
+	Datum		   *outerKeys;
+	bool		   *outerKeyNulls;
+	feature		  **outerFeatures;
+	JoinNeighbour  *neighbours;		//chunkSize heaps of k neighbours
+	int			   *nneighbours;
+
+	//tile of inner tuples
+	int				tileSize;
+	int				ninner;
+	Datum		   *innerKeys;
+	bool		   *innerKeyNulls;
+	float8		   *innerVectors;
+
+	Tuplestorestate *tupstore;
+	TupleDesc		tupdesc;
+
+	MemoryContext	chunkCtx;
+	MemoryContext	tileCtx;
+	MemoryContext	tupleCtx;
+} SimilarityJoinContext;
+
+static Datum similarityJoin(FunctionCallInfo fcinfo, int k, float8 epsilon, MinkowskiNorm norm);
+static void openJoinSide(JoinSide *side, Oid relid, text *keyName, text *featureName);
+static Relation findVAIndex(JoinSide *side);
+static feature *getJoinFeature(SimilarityJoinContext *state, JoinSide *side, HeapTuple tuple, Datum *key, bool *keyNull);
+static void initChunk(SimilarityJoinContext *state);
+static void addOuterTuple(SimilarityJoinContext *state, HeapTuple tuple);
+static void joinChunk(SimilarityJoinContext *state);
+static void scanInner(SimilarityJoinContext *state);
+static void scanInnerCandidates(SimilarityJoinContext *state);
+static void addInnerCandidate(HeapTuple tuple, void *arg);
+static void addInnerTuple(SimilarityJoinContext *state, HeapTuple tuple);
+static void compareTile(SimilarityJoinContext *state);
+static void insertNeighbour(SimilarityJoinContext *state, int outer, float8 distance, Datum key, bool keyNull);
+static void emitPair(SimilarityJoinContext *state, int outer, float8 distance, Datum key, bool keyNull);
+static void emitNeighbours(SimilarityJoinContext *state);
+static int compareNeighbours(const void *a, const void *b);
+
+
+/*
+ * kNN-join: returns the k nearest neighbours in the inner table of every tuple
+ * of the outer table
+ *
+ * arguments: outer table, outer key column, outer feature column, inner table,
+ * inner key column, inner feature column, k, norm of the Minkowski distance
+ */
+Datum
+	feature_knn_join(PG_FUNCTION_ARGS)
+{
+	int k = PG_GETARG_INT32(6);
+
+	if(k <= 0){
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			errmsg("the number of neighbours of a kNN-join must be positive")));
+	}
+
+	return similarityJoin(fcinfo, k, 0, PG_GETARG_FLOAT8(7));
+}
+
+/*
+ * epsilon-join: returns all pairs of tuples of the outer and the inner table with
+ * a distance not exceeding epsilon
+ *
+ * arguments: outer table, outer key column, outer feature column, inner table,
+ * inner key column, inner feature column, epsilon, norm of the Minkowski distance
+ */
+Datum
+	feature_epsilon_join(PG_FUNCTION_ARGS)
+{
+	float8 epsilon = PG_GETARG_FLOAT8(6);
+
+	if(epsilon < 0 || isnan(epsilon)){
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			errmsg("the distance of an epsilon-join must not be negative")));
+	}
+
+	return similarityJoin(fcinfo, 0, epsilon, PG_GETARG_FLOAT8(7));
+}
+
+
+static Datum
+	similarityJoin(FunctionCallInfo fcinfo, int k, float8 epsilon, MinkowskiNorm norm)
+{
+	ReturnSetInfo  *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	SimilarityJoinContext		state;
+	HeapScanDesc	scan;
+	HeapTuple		tuple;
+	MemoryContext	oldcontext;
+
+	//check to see if caller supports us returning a tuplestore
+	if(rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo)){
+		ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			errmsg("set-valued function called in context that cannot accept a set")));
+	}
+
+	if(!(rsinfo->allowedModes & SFRM_Materialize)){
+		ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			errmsg("materialize mode required, but it is not allowed in this context")));
+	}
+
+	memset(&state, 0, sizeof(SimilarityJoinContext));
+
+	state.k = k;
+	state.epsilon = epsilon;
+	state.norm = norm;
+	state.dimensions = -1;
+	state.snapshot = GetActiveSnapshot();
+
+	//same distinction of the norms as in calculateMinkowski
+	if(norm == MINKOWSKI_MAX_NORM){
+		state.joinNorm = JOIN_NORM_LMAX;
+	} else if(norm - 1 < EPSILON && norm > 0){
+		state.joinNorm = JOIN_NORM_L1;
+	} else if(fabs(norm - 2) < EPSILON){
+		state.joinNorm = JOIN_NORM_L2;
+	} else if(norm > 0){
+		state.joinNorm = JOIN_NORM_LN;
+	} else {
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			errmsg("invalid norm of the Minkowski distance: %g", norm)));
+	}
+
+	openJoinSide(&state.outer, PG_GETARG_OID(0), PG_GETARG_TEXT_PP(1), PG_GETARG_TEXT_PP(2));
+	openJoinSide(&state.inner, PG_GETARG_OID(3), PG_GETARG_TEXT_PP(4), PG_GETARG_TEXT_PP(5));
+
+	//the VA bounds are only valid for the norms they have been computed for
+	if(state.joinNorm != JOIN_NORM_LN || (norm > 1 && norm < 100)){
+		state.vaIndex = findVAIndex(&state.inner);
+
+		//a VA file on projected features only bounds the Euclidean distance
+		if(state.vaIndex && !vaSupportsNorm(state.vaIndex, norm)){
+			index_close(state.vaIndex, AccessShareLock);
+			state.vaIndex = NULL;
+		}
+	}
+
+	//the result columns are the keys and the distance
+	if(get_call_result_type(fcinfo, NULL, &state.tupdesc) != TYPEFUNC_COMPOSITE){
+		elog(ERROR, "return type must be a row type");
+	}
+
+	if(state.tupdesc->natts != 3
+		|| state.tupdesc->attrs[0]->atttypid != state.outer.keyType
+		|| state.tupdesc->attrs[1]->atttypid != state.inner.keyType
+		|| state.tupdesc->attrs[2]->atttypid != FLOAT8OID){
+		ereport(ERROR,
+			(errcode(ERRCODE_DATATYPE_MISMATCH),
+			errmsg("the result of a similarity join must consist of the outer key, the inner key and the distance"),
+			errhint("Use a column definition list like AS (outer_key %s, inner_key %s, distance float8).",
+				format_type_be(state.outer.keyType), format_type_be(state.inner.keyType))));
+	}
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+	state.tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = state.tupstore;
+	rsinfo->setDesc = CreateTupleDescCopy(state.tupdesc);
+	MemoryContextSwitchTo(oldcontext);
+
+	state.chunkCtx = AllocSetContextCreate(CurrentMemoryContext, "Similarity join chunk context",
+		ALLOCSET_DEFAULT_MINSIZE, ALLOCSET_DEFAULT_INITSIZE, ALLOCSET_DEFAULT_MAXSIZE);
+	state.tileCtx = AllocSetContextCreate(CurrentMemoryContext, "Similarity join tile context",
+		ALLOCSET_DEFAULT_MINSIZE, ALLOCSET_DEFAULT_INITSIZE, ALLOCSET_DEFAULT_MAXSIZE);
+	state.tupleCtx = AllocSetContextCreate(CurrentMemoryContext, "Similarity join tuple context",
+		ALLOCSET_DEFAULT_MINSIZE, ALLOCSET_DEFAULT_INITSIZE, ALLOCSET_DEFAULT_MAXSIZE);
+
+	//read the outer table in chunks
+	scan = heap_beginscan(state.outer.rel, state.snapshot, 0, NULL);
+
+	while((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL){
+		addOuterTuple(&state, tuple);
+
+		if(state.chunkSize > 0 && state.nouter == state.chunkSize){
+			joinChunk(&state);
+		}
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	if(state.nouter > 0){
+		joinChunk(&state);
+	}
+
+	heap_endscan(scan);
+
+	if(state.vaIndex){
+		index_close(state.vaIndex, AccessShareLock);
+	}
+
+	heap_close(state.outer.rel, NoLock);
+	heap_close(state.inner.rel, NoLock);
+
+	MemoryContextDelete(state.chunkCtx);
+	MemoryContextDelete(state.tileCtx);
+	MemoryContextDelete(state.tupleCtx);
+
+	tuplestore_donestoring(state.tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * opens a table of the join and looks up its key and feature column
+ */
+static void
+	openJoinSide(JoinSide *side, Oid relid, text *keyName, text *featureName)
+{
+	AclResult	aclresult;
+	char	   *key = text_to_cstring(keyName);
+	char	   *featureColumn = text_to_cstring(featureName);
+
+	aclresult = pg_class_aclcheck(relid, GetUserId(), ACL_SELECT);
+	if(aclresult != ACLCHECK_OK){
+		aclcheck_error(aclresult, ACL_KIND_CLASS, get_rel_name(relid));
+	}
+
+	side->rel = heap_open(relid, AccessShareLock);
+	side->keyAttno = get_attnum(relid, key);
+	side->featureAttno = get_attnum(relid, featureColumn);
+
+	if(side->keyAttno <= 0 || side->featureAttno <= 0){
+		ereport(ERROR,
+			(errcode(ERRCODE_UNDEFINED_COLUMN),
+			errmsg("column \"%s\" of relation \"%s\" does not exist",
+				(side->keyAttno <= 0) ? key : featureColumn, RelationGetRelationName(side->rel))));
+	}
+
+	if(side->rel->rd_att->attrs[side->featureAttno - 1]->atttypid != FEATURE){
+		ereport(ERROR,
+			(errcode(ERRCODE_DATATYPE_MISMATCH),
+			errmsg("column \"%s\" of relation \"%s\" is not a feature", featureColumn, RelationGetRelationName(side->rel))));
+	}
+
+	side->keyType = side->rel->rd_att->attrs[side->keyAttno - 1]->atttypid;
+	get_typlenbyval(side->keyType, &side->keyLen, &side->keyByVal);
+}
+
+/*
+ * returns the valid, non-partial VA index on the feature column of the table (or NULL)
+ */
+static Relation
+	findVAIndex(JoinSide *side)
+{
+	List	   *indexes = RelationGetIndexList(side->rel);
+	ListCell   *cell;
+	Relation	result = NULL;
+
+	foreach(cell, indexes){
+		Relation index = index_open(lfirst_oid(cell), AccessShareLock);
+
+		if(index->rd_rel->relam == VA_AM_OID && IndexIsValid(index->rd_index)
+			&& index->rd_index->indnatts == 1 && index->rd_index->indkey.values[0] == side->featureAttno
+			&& heap_attisnull(index->rd_indextuple, Anum_pg_index_indpred)){
+			result = index;
+			break;
+		}
+
+		index_close(index, AccessShareLock);
+	}
+
+	list_free(indexes);
+
+	return result;
+}
+
+/*
+ * returns the feature (as float8 feature) and the key of a tuple, or NULL if the
+ * feature is null; the memory is allocated in the current memory context
+ */
+static feature *
+	getJoinFeature(SimilarityJoinContext *state, JoinSide *side, HeapTuple tuple, Datum *key, bool *keyNull)
+{
+	TupleDesc	tupdesc = RelationGetDescr(side->rel);
+	Datum		value;
+	bool		isnull;
+	feature	   *f;
+	int			dimensions;
+
+	value = heap_getattr(tuple, side->featureAttno, tupdesc, &isnull);
+
+	if(isnull){
+		return NULL;
+	}
+
+	f = featureToFloat8((feature *) PG_DETOAST_DATUM(value));
+	dimensions = ArrayGetNItems(ARR_NDIM(&f->data), ARR_DIMS(&f->data));
+
+	if(ARR_HASNULL(&f->data)){
+		ereport(ERROR,
+			(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			errmsg("features with null values cannot be joined")));
+	}
+
+	if(state->dimensions < 0){
+		state->dimensions = dimensions;
+	} else if(state->dimensions != dimensions){
+		ereport(ERROR,
+			(errcode(ERRCODE_DATA_EXCEPTION),
+			errmsg("the features of a similarity join must have the same number of dimensions")));
+	}
+
+	*key = heap_getattr(tuple, side->keyAttno, tupdesc, keyNull);
+
+	return f;
+}
+
+/*
+ * allocates the chunk and the tile once the number of dimensions is known; the
+ * chunk is sized to fit into work_mem
+ */
+static void
+	initChunk(SimilarityJoinContext *state)
+{
+	Size rowSize = MAXALIGN(sizeof(feature) + state->dimensions * sizeof(float8))
+		+ state->k * sizeof(JoinNeighbour) + sizeof(Datum) + 2 * sizeof(int);
+
+	//bounds of every outer vector for scanning the VA file
+	if(state->vaIndex){
+		rowSize += 2 * state->dimensions * MAX_MARKS * sizeof(float8);
+	}
+
+	state->chunkSize = Max(1, Min((work_mem * 1024L) / rowSize, MaxAllocSize / rowSize));
+	state->tileSize = Max(1, ADAM_JOIN_TILE_SIZE / (state->dimensions * sizeof(float8)));
+
+	state->outerKeys = (Datum *) palloc(state->chunkSize * sizeof(Datum));
+	state->outerKeyNulls = (bool *) palloc(state->chunkSize * sizeof(bool));
+	state->outerFeatures = (feature **) palloc(state->chunkSize * sizeof(feature *));
+	state->nneighbours = (int *) palloc(state->chunkSize * sizeof(int));
+
+	if(state->k > 0){
+		state->neighbours = (JoinNeighbour *) palloc(state->chunkSize * state->k * sizeof(JoinNeighbour));
+	}
+
+	state->innerKeys = (Datum *) palloc(state->tileSize * sizeof(Datum));
+	state->innerKeyNulls = (bool *) palloc(state->tileSize * sizeof(bool));
+	state->innerVectors = (float8 *) palloc(state->tileSize * state->dimensions * sizeof(float8));
+}
+
+static void
+	addOuterTuple(SimilarityJoinContext *state, HeapTuple tuple)
+{
+	MemoryContext	oldcontext = MemoryContextSwitchTo(state->tupleCtx);
+	feature		   *f;
+	Datum			key;
+	bool			keyNull;
+
+	f = getJoinFeature(state, &state->outer, tuple, &key, &keyNull);
+
+	if(f){
+		if(state->chunkSize == 0){
+			MemoryContextSwitchTo(oldcontext);
+			initChunk(state);
+		}
+
+		MemoryContextSwitchTo(state->chunkCtx);
+
+		state->outerFeatures[state->nouter] = (feature *) palloc(VARSIZE(f));
+		memcpy(state->outerFeatures[state->nouter], f, VARSIZE(f));
+
+		state->outerKeyNulls[state->nouter] = keyNull;
+		state->outerKeys[state->nouter] = keyNull ? (Datum) 0 :
+			datumCopy(key, state->outer.keyByVal, state->outer.keyLen);
+
+		state->nneighbours[state->nouter] = 0;
+		state->nouter++;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextReset(state->tupleCtx);
+}
+
+/*
+ * compares the chunk of outer tuples with all inner tuples
+ */
+static void
+	joinChunk(SimilarityJoinContext *state)
+{
+	if(state->vaIndex){
+		scanInnerCandidates(state);
+	} else {
+		scanInner(state);
+	}
+
+	if(state->ninner > 0){
+		compareTile(state);
+	}
+
+	if(state->k > 0){
+		emitNeighbours(state);
+	}
+
+	state->nouter = 0;
+	MemoryContextReset(state->chunkCtx);
+}
+
+static void
+	scanInner(SimilarityJoinContext *state)
+{
+	HeapScanDesc	scan;
+	HeapTuple		tuple;
+
+	scan = heap_beginscan(state->inner.rel, state->snapshot, 0, NULL);
+
+	while((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL){
+		addInnerTuple(state, tuple);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	heap_endscan(scan);
+}
+
+/*
+ * reads the inner tuples that the VA file does not exclude
+ */
+static void
+	scanInnerCandidates(SimilarityJoinContext *state)
+{
+	TIDBitmap *tbm;
+
+	tbm = vaJoinCandidates(state->vaIndex, state->outerFeatures, state->nouter, state->k, state->epsilon, state->norm);
+	scanJoinCandidates(state->inner.rel, state->snapshot, tbm, addInnerCandidate, state);
+	tbm_free(tbm);
+}
+
+/*
+ * calls the callback for every visible tuple of the relation in the bitmap of
+ * candidates; the visible tuples of a page are copied so that the page is not
+ * locked while the callback compares them
+ */
+void
+	scanJoinCandidates(Relation rel, Snapshot snapshot, TIDBitmap *tbm, JoinCandidateCallback callback, void *arg)
+{
+	TBMIterator		   *iterator;
+	TBMIterateResult   *tbmres;
+	HeapTuple			copies[MaxHeapTuplesPerPage];
+	BlockNumber			npages = RelationGetNumberOfBlocks(rel);
+
+	iterator = tbm_begin_iterate(tbm);
+
+	while((tbmres = tbm_iterate(iterator)) != NULL){
+		Buffer			buffer;
+		Page			page;
+		HeapTupleData	heapTuple;
+		int				ncopies = 0;
+		int				i;
+
+		if(tbmres->blockno >= npages){
+			continue;
+		}
+
+		buffer = ReadBuffer(rel, tbmres->blockno);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buffer);
+
+		if(tbmres->ntuples >= 0){
+			for(i = 0; i < tbmres->ntuples; i++){
+				ItemPointerData tid;
+
+				ItemPointerSet(&tid, tbmres->blockno, tbmres->offsets[i]);
+
+				if(heap_hot_search_buffer(&tid, rel, buffer, snapshot, &heapTuple, NULL, true)){
+					copies[ncopies++] = heap_copytuple(&heapTuple);
+				}
+			}
+		} else {
+			//lossy page: all visible tuples of the page
+			OffsetNumber maxoff = PageGetMaxOffsetNumber(page);
+			OffsetNumber offnum;
+
+			for(offnum = FirstOffsetNumber; offnum <= maxoff; offnum = OffsetNumberNext(offnum)){
+				ItemId lp = PageGetItemId(page, offnum);
+
+				if(!ItemIdIsNormal(lp)){
+					continue;
+				}
+
+				heapTuple.t_data = (HeapTupleHeader) PageGetItem(page, lp);
+				heapTuple.t_len = ItemIdGetLength(lp);
+				heapTuple.t_tableOid = RelationGetRelid(rel);
+				ItemPointerSet(&heapTuple.t_self, tbmres->blockno, offnum);
+
+				if(HeapTupleSatisfiesVisibility(&heapTuple, snapshot, buffer)){
+					copies[ncopies++] = heap_copytuple(&heapTuple);
+				}
+			}
+		}
+
+		UnlockReleaseBuffer(buffer);
+
+		for(i = 0; i < ncopies; i++){
+			callback(copies[i], arg);
+			heap_freetuple(copies[i]);
+		}
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	tbm_end_iterate(iterator);
+}
+
+static void
+	addInnerCandidate(HeapTuple tuple, void *arg)
+{
+	addInnerTuple((SimilarityJoinContext *) arg, tuple);
+}
+
+static void
+	addInnerTuple(SimilarityJoinContext *state, HeapTuple tuple)
+{
+	MemoryContext	oldcontext = MemoryContextSwitchTo(state->tupleCtx);
+	feature		   *f;
+	Datum			key;
+	bool			keyNull;
+
+	f = getJoinFeature(state, &state->inner, tuple, &key, &keyNull);
+
+	if(f){
+		memcpy(&state->innerVectors[state->ninner * state->dimensions], ARR_DATA_PTR(&f->data),
+			state->dimensions * sizeof(float8));
+
+		MemoryContextSwitchTo(state->tileCtx);
+
+		state->innerKeyNulls[state->ninner] = keyNull;
+		state->innerKeys[state->ninner] = keyNull ? (Datum) 0 :
+			datumCopy(key, state->inner.keyByVal, state->inner.keyLen);
+
+		state->ninner++;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextReset(state->tupleCtx);
+
+	if(state->ninner == state->tileSize){
+		compareTile(state);
+	}
+}
+
+/*
+ * compares all outer vectors of the chunk with the inner vectors of the tile
+ */
+static void
+	compareTile(SimilarityJoinContext *state)
+{
+	int i, j;
+
+	for(i = 0; i < state->nouter; i++){
+		float8 *x = (float8 *) ARR_DATA_PTR(&state->outerFeatures[i]->data);
+
+		for(j = 0; j < state->ninner; j++){
+			float8 bound;
+			float8 distance;
+
+			if(state->k > 0){
+				JoinNeighbour *heap = &state->neighbours[i * state->k];
+
+				bound = (state->nneighbours[i] == state->k) ? heap[0].distance : get_float8_infinity();
+			} else {
+				bound = state->epsilon;
+			}
+
+			distance = joinDistance(x, &state->innerVectors[j * state->dimensions], state->dimensions,
+				state->joinNorm, state->norm, bound);
+
+			if(state->k > 0){
+				if(distance < bound){
+					insertNeighbour(state, i, distance, state->innerKeys[j], state->innerKeyNulls[j]);
+				}
+			} else if(distance <= bound){
+				emitPair(state, i, distance, state->innerKeys[j], state->innerKeyNulls[j]);
+			}
+		}
+	}
+
+	state->ninner = 0;
+	MemoryContextReset(state->tileCtx);
+}
+
+/*
+ * calculates the Minkowski distance (as calculateMinkowski, i.e. without the root);
+ * the calculation stops as soon as the distance exceeds the bound, the value
+ * returned is then larger than the bound, but not the exact distance
+ */
+float8
+	joinDistance(const float8 *x, const float8 *y, int dimensions, JoinNorm joinNorm, MinkowskiNorm norm, float8 bound)
+{
+	float8	result = 0;
+	int		i = 0;
+
+	while(i < dimensions){
+		int end = Min(i + JOIN_DISTANCE_BLOCK, dimensions);
+
+		switch(joinNorm){
+		case JOIN_NORM_L1:
+			for(; i < end; i++){
+				result += fabs(x[i] - y[i]);
+			}
+			break;
+		case JOIN_NORM_L2:
+			for(; i < end; i++){
+				float8 diff = x[i] - y[i];
+				result += diff * diff;
+			}
+			break;
+		case JOIN_NORM_LMAX:
+			for(; i < end; i++){
+				result = Max(result, fabs(x[i] - y[i]));
+			}
+			break;
+		case JOIN_NORM_LN:
+			for(; i < end; i++){
+				result += pow(fabs(x[i] - y[i]), norm);
+			}
+			break;
+		}
+
+		if(result > bound){
+			break;
+		}
+	}
+
+	return result;
+}
+
+/*
+ * inserts an inner tuple into the heap of the nearest neighbours of an outer
+ * tuple (the neighbour with the largest distance is on top)
+ */
+static void
+	insertNeighbour(SimilarityJoinContext *state, int outer, float8 distance, Datum key, bool keyNull)
+{
+	JoinNeighbour  *heap = &state->neighbours[outer * state->k];
+	int			   *size = &state->nneighbours[outer];
+	JoinNeighbour	neighbour;
+	MemoryContext	oldcontext;
+	int				i;
+
+	oldcontext = MemoryContextSwitchTo(state->chunkCtx);
+	neighbour.distance = distance;
+	neighbour.keyNull = keyNull;
+	neighbour.key = keyNull ? (Datum) 0 : datumCopy(key, state->inner.keyByVal, state->inner.keyLen);
+	MemoryContextSwitchTo(oldcontext);
+
+	if(*size < state->k){
+		//sift up
+		i = (*size)++;
+
+		while(i > 0 && heap[(i - 1) / 2].distance < distance){
+			heap[i] = heap[(i - 1) / 2];
+			i = (i - 1) / 2;
+		}
+	} else {
+		//replace the farthest neighbour and sift down
+		if(!heap[0].keyNull && !state->inner.keyByVal){
+			pfree(DatumGetPointer(heap[0].key));
+		}
+
+		i = 0;
+
+		while(2 * i + 1 < state->k){
+			int child = 2 * i + 1;
+
+			if(child + 1 < state->k && heap[child + 1].distance > heap[child].distance){
+				child++;
+			}
+
+			if(heap[child].distance <= distance){
+				break;
+			}
+
+			heap[i] = heap[child];
+			i = child;
+		}
+	}
+
+	heap[i] = neighbour;
+}
+
+static void
+	emitPair(SimilarityJoinContext *state, int outer, float8 distance, Datum key, bool keyNull)
+{
+	Datum	values[3];
+	bool	nulls[3];
+
+	values[0] = state->outerKeys[outer];
+	nulls[0] = state->outerKeyNulls[outer];
+	values[1] = key;
+	nulls[1] = keyNull;
+	values[2] = Float8GetDatum(distance);
+	nulls[2] = false;
+
+	tuplestore_putvalues(state->tupstore, state->tupdesc, values, nulls);
+}
+
+/*
+ * returns the nearest neighbours of all outer tuples of the chunk, ordered by distance
+ */
+static void
+	emitNeighbours(SimilarityJoinContext *state)
+{
+	int i, j;
+
+	for(i = 0; i < state->nouter; i++){
+		JoinNeighbour *heap = &state->neighbours[i * state->k];
+
+		qsort(heap, state->nneighbours[i], sizeof(JoinNeighbour), compareNeighbours);
+
+		for(j = 0; j < state->nneighbours[i]; j++){
+			emitPair(state, i, heap[j].distance, heap[j].key, heap[j].keyNull);
+		}
+	}
+}
+
+static int
+	compareNeighbours(const void *a, const void *b)
+{
+	float8 x = ((const JoinNeighbour *) a)->distance;
+	float8 y = ((const JoinNeighbour *) b)->distance;
+
+	return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
@@ -18,15 +18,23 @@
 
 #include "utils/adam_retrieval_minkowski.h"
 #include "utils/adam_data_feature.h"
+#include "utils/adam_data_compression.h"
 
+#include "access/tuptoaster.h"
 #include "catalog/pg_type.h"
 #include "parser/parse_node.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
 
+#include <math.h>
+
 static Datum calculateMinkowskiL1(feature *f1, feature *f2);
 static Datum calculateMinkowskiLn(feature *f1, feature *f2, Datum n);
 static Datum calculateMinkowskiLmax(feature *f1, feature *f2);
+static Datum calculateCompactMinkowski(feature *f1, feature *f2, float8 n);
+static Datum calculateCompressedMinkowski(struct varlena *v1, feature *f1, struct varlena *v2, feature *f2, float8 n);
+static struct varlena *fetchFeature(Datum d);
+static bool featureIsReadable(feature *f);
 
 static Datum calculateWeightedMinkowskiL1(feature *f1, feature *f2, ArrayType *weights);
 static Datum calculateWeightedMinkowskiLn(feature *f1, feature *f2, ArrayType *weights, Datum n);
@@ -42,11 +50,33 @@ static Datum calculateWeightedMinkowskiLmax(feature *f1, feature *f2, ArrayType
 Datum
 calculateMinkowski(PG_FUNCTION_ARGS)
 {
-	feature *f1 = (feature *)  PG_GETARG_VARLENA_P(0);
-	feature *f2 = (feature *)  PG_GETARG_VARLENA_P(1);
+	struct varlena *v1 = fetchFeature(PG_GETARG_DATUM(0));
+	struct varlena *v2 = fetchFeature(PG_GETARG_DATUM(1));
 	float8 n = DatumGetFloat8(PG_GETARG_DATUM(2));
+	feature *f1 = featureIsCompressed(v1) ? NULL : (feature *) pg_detoast_datum(v1);
+	feature *f2 = featureIsCompressed(v2) ? NULL : (feature *) pg_detoast_datum(v2);
     
 	Datum result;
+
+	//features compressed by TOAST (see adam_data_compression) are decoded while calculating the distance
+	if(f1 == NULL || f2 == NULL){
+		if((f1 == NULL || featureIsReadable(f1)) && (f2 == NULL || featureIsReadable(f2))){
+			PG_RETURN_DATUM(calculateCompressedMinkowski(v1, f1, v2, f2, n));
+		}
+
+		if(f1 == NULL){
+			f1 = (feature *) pg_detoast_datum(v1);
+		}
+
+		if(f2 == NULL){
+			f2 = (feature *) pg_detoast_datum(v2);
+		}
+	}
+
+	//quantized or float4 features are compared without converting them
+	if(featureIsCompact(f1) || featureIsCompact(f2)){
+		PG_RETURN_DATUM(calculateCompactMinkowski(f1, f2, n));
+	}
     
 	if(f1->typid != FLOAT8OID || f2->typid != FLOAT8OID){
 		ereport(ERROR,(errmsg("the minkowski distance can only be used with numeric types")));
@@ -176,12 +206,148 @@ calculateMinkowskiLmax(feature *f1, feature *f2)
 	return maxResult;
 }
 
+/*
+ * calculates the minkowski distance of features of which at least one is stored
+ * in a compact form (see feature_quantize), reading the values from the compact
+ * storage; if both features are int8 codes with the same scale and offset, the
+ * differences of the codes are used, i.e. |x - y| = scale * |code x - code y|
+ */
+static Datum
+calculateCompactMinkowski(feature *f1, feature *f2, float8 n)
+{
+	FeatureReader r1, r2;
+	bool		l1 = (n - 1 < EPSILON && n > 0);
+	bool		lmax = (n < EPSILON && n > 0);
+	float8		result = 0;
+	int			dims;
+	int			i;
+
+	featureInitReader(&r1, f1);
+	featureInitReader(&r2, f2);
+
+	dims = Min(r1.n, r2.n);
+
+	if(r1.storage == FEATURE_INT8 && r2.storage == FEATURE_INT8 &&
+		r1.scale == r2.scale && r1.offset == r2.offset){
+		int8 *x = (int8 *) r1.data;
+		int8 *y = (int8 *) r2.data;
+
+		if(l1 || lmax){
+			int32 sum = 0;
+
+			for(i = 0; i < dims; i++){
+				int32 diff = abs((int32) x[i] - (int32) y[i]);
+
+				if(lmax){
+					sum = Max(sum, diff);
+				} else {
+					sum += diff;
+				}
+			}
+
+			return Float8GetDatum(r1.scale * sum);
+		}
+
+		for(i = 0; i < dims; i++){
+			result += pow(abs((int32) x[i] - (int32) y[i]), n);
+		}
+
+		return Float8GetDatum(pow(r1.scale, n) * result);
+	}
+
+	for(i = 0; i < dims; i++){
+		float8 diff = fabs(featureReaderGet(&r1, i) - featureReaderGet(&r2, i));
+
+		if(l1){
+			result += diff;
+		} else if(lmax){
+			result = Max(result, diff);
+		} else {
+			result += pow(diff, n);
+		}
+	}
+
+	return Float8GetDatum(result);
+}
+
+
+/*
+ * calculates the minkowski distance of features of which at least one is
+ * compressed by TOAST (v1 or v2 with f1 or f2 NULL respectively); the values of
+ * the compressed features are decoded one after the other and added to the
+ * distance right away, without decompressing the features first
+ */
+static Datum
+calculateCompressedMinkowski(struct varlena *v1, feature *f1, struct varlena *v2, feature *f2, float8 n)
+{
+	FeatureDecoder d1, d2;
+	FeatureReader r1, r2;
+	bool		l1 = (n - 1 < EPSILON && n > 0);
+	bool		lmax = (n < EPSILON && n > 0);
+	float8		result = 0;
+	int			dims;
+	int			i;
+
+	if(f1 == NULL){
+		featureInitDecoder(&d1, v1);
+	} else {
+		featureInitReader(&r1, f1);
+	}
+
+	if(f2 == NULL){
+		featureInitDecoder(&d2, v2);
+	} else {
+		featureInitReader(&r2, f2);
+	}
+
+	dims = Min(f1 == NULL ? d1.n : r1.n, f2 == NULL ? d2.n : r2.n);
+
+	for(i = 0; i < dims; i++){
+		float8 x = (f1 == NULL) ? featureDecoderNext(&d1) : featureReaderGet(&r1, i);
+		float8 y = (f2 == NULL) ? featureDecoderNext(&d2) : featureReaderGet(&r2, i);
+		float8 diff = fabs(x - y);
+
+		if(l1){
+			result += diff;
+		} else if(lmax){
+			result = Max(result, diff);
+		} else {
+			result += pow(diff, n);
+		}
+	}
+
+	return Float8GetDatum(result);
+}
+
+/*
+ * returns a feature stored out-of-line, but leaves it compressed
+ */
+static struct varlena *
+fetchFeature(Datum d)
+{
+	struct varlena *v = (struct varlena *) DatumGetPointer(d);
+
+	if(VARATT_IS_EXTERNAL(v)){
+		v = heap_tuple_fetch_attr(v);
+	}
+
+	return v;
+}
+
+/*
+ * checks whether the values of an uncompressed feature can be read by a FeatureReader
+ */
+static bool
+featureIsReadable(feature *f)
+{
+	return (f->typid == FLOAT8OID || featureIsCompact(f)) && !ARR_HASNULL(&f->data);
+}
 
 Datum
 calculateWeightedMinkowski(PG_FUNCTION_ARGS)
 {
-	feature *f1 = (feature *)  PG_GETARG_VARLENA_P(0);
-	feature *f2 = (feature *)  PG_GETARG_VARLENA_P(1);
+	feature *f1 = featureToFloat8((feature *)  PG_GETARG_VARLENA_P(0));
+	feature *f2 = featureToFloat8((feature *)  PG_GETARG_VARLENA_P(1));
 	float8 n = PG_GETARG_FLOAT8(2);
 	ArrayType *weights = PG_GETARG_ARRAYTYPE_P(3);
     
@@ -246,7 +412,7 @@ calculateWeightedMinkowskiL1(feature *f1, feature *f2, ArrayType *weights)
 }
 
 /*
- * calculates the Ln minkowksi distance (i.e. S(x - y)^n) weighted
+ * calculates the Ln minkowksi distance (i.e. S w| x - y |^n) weighted
  */
 static Datum
 calculateWeightedMinkowskiLn(feature *f1, feature *f2, ArrayType *weights, Datum n)
@@ -274,7 +440,7 @@ calculateWeightedMinkowskiLn(feature *f1, feature *f2, ArrayType *weights, Datum
 	while(array_iterate(f1_it, &f1_val, &f1_isnull) && array_iterate(f2_it, &f2_val, &f2_isnull) &&
           array_iterate(w_it, &w_val, &w_isnull)){
 		if (!f1_isnull && !f2_isnull && !w_isnull){
-			diff = DatumGetFloat8(f1_val) - DatumGetFloat8(f2_val);
+			diff = fabs(DatumGetFloat8(f1_val) - DatumGetFloat8(f2_val));
 			pow = DatumGetFloat8(DirectFunctionCall2(dpow, Float8GetDatum(diff), n));
 			transResult = transResult + (DatumGetFloat8(w_val) * pow);
 		}
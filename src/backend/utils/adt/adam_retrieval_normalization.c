@@ -361,6 +361,7 @@ void
 	Oid distance;
 	FeatureFunctionOpt *distanceOptions = NULL;
 	MinkowskiNorm nn_minkowski = 0;
+	AdamDistanceType nn_distance;
 	Datum		  nn_minkowski_datum;
 	
 	IndexInfo *indexInfo;
@@ -369,7 +370,7 @@ void
 	
 	getSampledRows(rel, &rows, &numRows);
 		
-	distance = getDistanceProcId((AdamFunctionOptionsStmt *) stmt->distance, targetFieldSelect, &distanceOptions, &nn_minkowski);
+	distance = getDistanceProcId((AdamFunctionOptionsStmt *) stmt->distance, targetFieldSelect, &distanceOptions, &nn_minkowski, &nn_distance);
 	if(distance != MINKOWSKI_PROCOID){
 		ereport(ERROR,
 			(errcode(ERRCODE_INTERNAL_ERROR),
@@ -411,7 +412,7 @@ static void
 
 	//retrieve sample data
 	results = palloc(sizeof(HeapTuple) * N_SAMPLES);
-	returnedRows = acquire_sample_rows(rel, DEBUG1, results, N_SAMPLES, &totRows, &totDeadRows);
+	returnedRows = acquire_sample_rows_outside_analyze(rel, DEBUG1, results, N_SAMPLES, &totRows, &totDeadRows);
 
 	if(returnedRows < 100){
 		ereport(LOG,
@@ -0,0 +1,262 @@
+/*
+ * ADAM - similarity distance functions
+ * name: adam_retrieval_similarity
+ * description: functions for calculating the cosine, inner product and hamming distances
+ *
+ * src/backend/utils/adt/adam_retrieval_similarity.c
+ *
+ *
+ *
+ *
+ * addendum: contrary to the minkowski functions, the distances in here
+ * do not iterate over the arrays using the fmgr float8 functions, but
+ * work directly on the float8 data of the features; the kernels are
+ * written with SSE2 where available and with unrolled loops otherwise
+ *
+ */
+#include "postgres.h"
+
+#include "utils/adam_retrieval_similarity.h"
+#include "utils/adam_data_feature.h"
+
+#include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static void getSimilarityValues(feature *f1, feature *f2, float8 **x, float8 **y, int *n);
+
+/*
+ * dot product of two float8 arrays
+ */
+float8
+	similarityDotProduct(const float8 *x, const float8 *y, int n)
+{
+	int i = 0;
+	float8 result;
+
+#ifdef __SSE2__
+	__m128d acc0 = _mm_setzero_pd();
+	__m128d acc1 = _mm_setzero_pd();
+	float8 tmp[2];
+
+	for(; i + 4 <= n; i += 4){
+		acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+		acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+	}
+
+	_mm_storeu_pd(tmp, _mm_add_pd(acc0, acc1));
+	result = tmp[0] + tmp[1];
+#else
+	float8 acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+
+	for(; i + 4 <= n; i += 4){
+		acc0 += x[i] * y[i];
+		acc1 += x[i + 1] * y[i + 1];
+		acc2 += x[i + 2] * y[i + 2];
+		acc3 += x[i + 3] * y[i + 3];
+	}
+
+	result = (acc0 + acc1) + (acc2 + acc3);
+#endif
+
+	for(; i < n; i++){
+		result += x[i] * y[i];
+	}
+
+	return result;
+}
+
+/*
+ * squared euclidean norm of a float8 array
+ */
+float8
+	similaritySquaredNorm(const float8 *x, int n)
+{
+	return similarityDotProduct(x, x, n);
+}
+
+/*
+ * number of positions in which the two float8 arrays differ
+ */
+int
+	similarityHammingCount(const float8 *x, const float8 *y, int n)
+{
+	int i = 0;
+	int result = 0;
+
+#ifdef __SSE2__
+	for(; i + 4 <= n; i += 4){
+		int mask0 = _mm_movemask_pd(_mm_cmpneq_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+		int mask1 = _mm_movemask_pd(_mm_cmpneq_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+
+		result += (mask0 & 1) + (mask0 >> 1) + (mask1 & 1) + (mask1 >> 1);
+	}
+#else
+	for(; i + 4 <= n; i += 4){
+		result += (x[i] != y[i]) + (x[i + 1] != y[i + 1]) + (x[i + 2] != y[i + 2]) + (x[i + 3] != y[i + 3]);
+	}
+#endif
+
+	for(; i < n; i++){
+		result += (x[i] != y[i]);
+	}
+
+	return result;
+}
+
+
+/*
+ * calculates the cosine distance between two feature vectors (i.e. 1 - x.y / |x||y|);
+ * a vector without length has a distance of 1 to every other vector
+ */
+Datum
+	calculateCosine(PG_FUNCTION_ARGS)
+{
+	feature *f1 = (feature *)  PG_GETARG_VARLENA_P(0);
+	feature *f2 = (feature *)  PG_GETARG_VARLENA_P(1);
+
+	float8 *x, *y;
+	int n;
+
+	float8 dot, norm;
+	float8 result = 1.0;
+
+	getSimilarityValues(f1, f2, &x, &y, &n);
+
+	dot = similarityDotProduct(x, y, n);
+	norm = sqrt(similaritySquaredNorm(x, n)) * sqrt(similaritySquaredNorm(y, n));
+
+	if(norm > 0){
+		result = 1.0 - dot / norm;
+	}
+
+	//rounding errors may lead to values slightly outside [0,2]
+	if(result < 0){
+		result = 0;
+	} else if(result > 2){
+		result = 2;
+	}
+
+	PG_RETURN_FLOAT8(result);
+}
+
+/*
+ * calculates the inner product distance between two feature vectors (i.e. -x.y),
+ * so that the nearest neighbours are the vectors with the maximum inner product
+ */
+Datum
+	calculateInnerProduct(PG_FUNCTION_ARGS)
+{
+	feature *f1 = (feature *)  PG_GETARG_VARLENA_P(0);
+	feature *f2 = (feature *)  PG_GETARG_VARLENA_P(1);
+
+	float8 *x, *y;
+	int n;
+
+	getSimilarityValues(f1, f2, &x, &y, &n);
+
+	PG_RETURN_FLOAT8(-similarityDotProduct(x, y, n));
+}
+
+/*
+ * calculates the hamming distance between two feature vectors (i.e. the number
+ * of dimensions in which the vectors differ)
+ */
+Datum
+	calculateHamming(PG_FUNCTION_ARGS)
+{
+	feature *f1 = (feature *)  PG_GETARG_VARLENA_P(0);
+	feature *f2 = (feature *)  PG_GETARG_VARLENA_P(1);
+
+	float8 *x, *y;
+	int n;
+
+	getSimilarityValues(f1, f2, &x, &y, &n);
+
+	PG_RETURN_FLOAT8((float8) similarityHammingCount(x, y, n));
+}
+
+
+/*
+ * returns the kind of distance given a name used in USING DISTANCE, together with
+ * the proc id of the built-in distance function; unknown names return
+ * ADAM_DISTANCE_UNKNOWN
+ */
+AdamDistanceType
+	getSimilarityDistanceFromName(const char *name, Oid *procId)
+{
+	*procId = InvalidOid;
+
+	if(pg_strcasecmp(name, "cosine") == 0){
+		*procId = COSINE_PROCOID;
+		return ADAM_DISTANCE_COSINE;
+	} else if(pg_strcasecmp(name, "innerproduct") == 0 || pg_strcasecmp(name, "inner_product") == 0){
+		*procId = INNER_PRODUCT_PROCOID;
+		return ADAM_DISTANCE_INNER_PRODUCT;
+	} else if(pg_strcasecmp(name, "hamming") == 0){
+		*procId = HAMMING_PROCOID;
+		return ADAM_DISTANCE_HAMMING;
+	}
+
+	return ADAM_DISTANCE_UNKNOWN;
+}
+
+
+/*
+ * gets the float8 values of the two features; as in the minkowski functions, only
+ * the dimensions that are set in both features are considered
+ */
+static void
+	getSimilarityValues(feature *f1, feature *f2, float8 **x, float8 **y, int *n)
+{
+	int n1, n2;
+
+	f1 = featureToFloat8(f1);
+	f2 = featureToFloat8(f2);
+
+	if(f1->typid != FLOAT8OID || f2->typid != FLOAT8OID){
+		ereport(ERROR,
+			(errcode(ERRCODE_DATATYPE_MISMATCH),
+			errmsg("the similarity distances can only be used with numeric types")));
+	}
+
+	n1 = ArrayGetNItems(ARR_NDIM(&f1->data), ARR_DIMS(&f1->data));
+	n2 = ArrayGetNItems(ARR_NDIM(&f2->data), ARR_DIMS(&f2->data));
+
+	if(!ARR_HASNULL(&f1->data) && !ARR_HASNULL(&f2->data)){
+		*x = (float8 *) ARR_DATA_PTR(&f1->data);
+		*y = (float8 *) ARR_DATA_PTR(&f2->data);
+		*n = Min(n1, n2);
+	} else {
+		Datum *v1, *v2;
+		bool *null1, *null2;
+		int16 typlen;
+		bool typbyval;
+		char typalign;
+		int i;
+
+		get_typlenbyvalalign(FLOAT8OID, &typlen, &typbyval, &typalign);
+		deconstruct_array(&f1->data, FLOAT8OID, typlen, typbyval, typalign, &v1, &null1, &n1);
+		deconstruct_array(&f2->data, FLOAT8OID, typlen, typbyval, typalign, &v2, &null2, &n2);
+
+		*x = palloc(sizeof(float8) * Min(n1, n2));
+		*y = palloc(sizeof(float8) * Min(n1, n2));
+		*n = 0;
+
+		for(i = 0; i < Min(n1, n2); i++){
+			if(!null1[i] && !null2[i]){
+				(*x)[*n] = DatumGetFloat8(v1[i]);
+				(*y)[*n] = DatumGetFloat8(v2[i]);
+				(*n)++;
+			}
+		}
+	}
+}
@@ -3826,6 +3826,47 @@ RelationGetMarks(Relation relation)
 	return (ArrayType *)relation->rd_marks;
 }
 
+/*
+* returns the projection stored with the index (see adam_index_projection.c); NULL if
+* the index has been built without a projection
+*/
+ArrayType*
+RelationGetProjection(Relation relation)
+{
+	ArrayType  *result;
+	Datum		projection;
+	bool		isnull;
+	MemoryContext oldcxt;
+
+	/* Quick exit if we already computed the result. */
+	if (relation->rd_projection)
+		return (ArrayType *) relation->rd_projection;
+
+	if (relation->rd_indextuple == NULL ||
+		heap_attisnull(relation->rd_indextuple, Anum_pg_index_projection)){
+			RelationReloadIndexInfo(relation);
+
+			if (relation->rd_indextuple == NULL ||
+				heap_attisnull(relation->rd_indextuple, Anum_pg_index_projection)){
+					return NULL;
+			}
+	}
+
+	projection = heap_getattr(relation->rd_indextuple,
+							  Anum_pg_index_projection,
+							  GetPgIndexDescriptor(),
+							  &isnull);
+	result = DatumGetArrayTypeP(projection);
+	Assert(!isnull);
+
+	oldcxt = MemoryContextSwitchTo(relation->rd_indexcxt);
+	relation->rd_projection = palloc(ARR_SIZE(result));
+	memcpy(relation->rd_projection, result, ARR_SIZE(result));
+	MemoryContextSwitchTo(oldcxt);
+
+	return (ArrayType *)relation->rd_projection;
+}
+
 /*
  * RelationGetIndexAttrBitmap -- get a bitmap of index attribute numbers
  *
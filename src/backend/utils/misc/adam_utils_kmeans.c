@@ -0,0 +1,210 @@
+/* 
+* ADAM - k-means
+* name: adam_utils_kmeans
+* description: k-means clustering of float8 vectors
+*
+* src/backend/utils/misc/adam_utils_kmeans.c
+*
+* 
+* 
+*
+* addendum: Lloyd's algorithm with k-means++ seeding on the squared euclidean
+* distance; the vectors are stored row by row (n x dimensions), as are the centroids
+*
+*/
+#include "postgres.h"
+
+#include "utils/adam_utils_kmeans.h"
+
+#include "miscadmin.h"
+#include "utils/builtins.h"
+
+static void seedCentroids(const float8 *vectors, int n, int dimensions, int k, float8 *centroids);
+static float8 squaredDistance(const float8 *x, const float8 *y, int dimensions);
+
+/*
+* clusters the n vectors into k clusters and writes the centroids (k x dimensions);
+* stops after maxIterations or as soon as no vector changes its cluster and returns
+* the number of iterations
+*/
+int
+	kmeansCluster(const float8 *vectors, int n, int dimensions, int k, int maxIterations, float8 *centroids)
+{
+	int *assignment;
+	int *sizes;
+	int iteration;
+	int i, j;
+
+	Assert(k > 0 && k <= n);
+
+	assignment = (int *) palloc(sizeof(int) * n);
+	sizes = (int *) palloc(sizeof(int) * k);
+
+	for(i = 0; i < n; i++){
+		assignment[i] = -1;
+	}
+
+	seedCentroids(vectors, n, dimensions, k, centroids);
+
+	for(iteration = 0; iteration < maxIterations; iteration++){
+		bool changed = false;
+
+		//assignment step
+		for(i = 0; i < n; i++){
+			int nearest = kmeansNearest(centroids, k, dimensions, vectors + (Size) i * dimensions, NULL);
+
+			if(nearest != assignment[i]){
+				assignment[i] = nearest;
+				changed = true;
+			}
+
+			CHECK_FOR_INTERRUPTS();
+		}
+
+		if(!changed){
+			break;
+		}
+
+		//update step; empty clusters keep their centroid
+		memset(sizes, 0, sizeof(int) * k);
+
+		for(i = 0; i < n; i++){
+			sizes[assignment[i]]++;
+		}
+
+		for(j = 0; j < k; j++){
+			if(sizes[j] > 0){
+				memset(centroids + (Size) j * dimensions, 0, sizeof(float8) * dimensions);
+			}
+		}
+
+		for(i = 0; i < n; i++){
+			float8 *centroid = centroids + (Size) assignment[i] * dimensions;
+			const float8 *vector = vectors + (Size) i * dimensions;
+			int d;
+
+			for(d = 0; d < dimensions; d++){
+				centroid[d] += vector[d];
+			}
+		}
+
+		for(j = 0; j < k; j++){
+			float8 *centroid = centroids + (Size) j * dimensions;
+			int d;
+
+			if(sizes[j] == 0){
+				continue;
+			}
+
+			for(d = 0; d < dimensions; d++){
+				centroid[d] /= sizes[j];
+			}
+		}
+	}
+
+	pfree(assignment);
+	pfree(sizes);
+
+	return iteration;
+}
+
+/*
+* returns the index of the centroid nearest to the vector (and its squared distance)
+*/
+int
+	kmeansNearest(const float8 *centroids, int k, int dimensions, const float8 *vector, float8 *distance)
+{
+	int nearest = 0;
+	float8 nearestDistance = get_float8_infinity();
+	int j;
+
+	for(j = 0; j < k; j++){
+		float8 d = squaredDistance(centroids + (Size) j * dimensions, vector, dimensions);
+
+		if(d < nearestDistance){
+			nearestDistance = d;
+			nearest = j;
+		}
+	}
+
+	if(distance){
+		*distance = nearestDistance;
+	}
+
+	return nearest;
+}
+
+/*
+* k-means++ seeding: the first centroid is a random vector, every further centroid is
+* chosen with a probability proportional to the squared distance to the nearest centroid
+*/
+static void
+	seedCentroids(const float8 *vectors, int n, int dimensions, int k, float8 *centroids)
+{
+	float8 *distances = (float8 *) palloc(sizeof(float8) * n);
+	int chosen = random() % n;
+	int i, j;
+
+	memcpy(centroids, vectors + (Size) chosen * dimensions, sizeof(float8) * dimensions);
+
+	for(i = 0; i < n; i++){
+		distances[i] = squaredDistance(centroids, vectors + (Size) i * dimensions, dimensions);
+	}
+
+	for(j = 1; j < k; j++){
+		float8 *centroid = centroids + (Size) j * dimensions;
+		float8 sum = 0;
+		float8 target;
+
+		for(i = 0; i < n; i++){
+			sum += distances[i];
+		}
+
+		chosen = n - 1;
+
+		//all remaining vectors coincide with a centroid
+		if(sum <= 0){
+			chosen = random() % n;
+		} else {
+			target = sum * ((float8) random() / ((float8) MAX_RANDOM_VALUE + 1));
+
+			for(i = 0; i < n; i++){
+				target -= distances[i];
+
+				if(target < 0){
+					chosen = i;
+					break;
+				}
+			}
+		}
+
+		memcpy(centroid, vectors + (Size) chosen * dimensions, sizeof(float8) * dimensions);
+
+		for(i = 0; i < n; i++){
+			float8 d = squaredDistance(centroid, vectors + (Size) i * dimensions, dimensions);
+
+			if(d < distances[i]){
+				distances[i] = d;
+			}
+		}
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	pfree(distances);
+}
+
+static float8
+	squaredDistance(const float8 *x, const float8 *y, int dimensions)
+{
+	float8 sum = 0;
+	int d;
+
+	for(d = 0; d < dimensions; d++){
+		float8 diff = x[d] - y[d];
+
+		sum += diff * diff;
+	}
+
+	return sum;
+}
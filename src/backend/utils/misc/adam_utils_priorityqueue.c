@@ -73,8 +73,9 @@ bool
 {
 	if(q->currentSize < q->maxSize){
 		q->queue[q->currentSize] = insertedElement;
-		qsort_arg((void *) q->queue, q->currentSize, sizeof(Datum), compare_array_elements, (void *) &(q->ctx));
 		q->currentSize++;
+		//the new element has to be sorted in as well, so that the last element is the maximum
+		qsort_arg((void *) q->queue, q->currentSize, sizeof(Datum), compare_array_elements, (void *) &(q->ctx));
 	} else {
 		if(DatumGetInt32(
 			FunctionCall2(&(q->ctx.flinfo), insertedElement, PointerGetDatum(q->queue[q->maxSize - 1]))) <= 0){
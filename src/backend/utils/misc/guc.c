@@ -26,7 +26,13 @@
 #include <syslog.h>
 #endif
 
+#include "utils/adam_data_compression.h"
+#include "utils/adam_index_lsh.h"
+#include "utils/adam_index_marks.h"
 #include "utils/adam_index_va.h"
+#include "utils/adam_index_va_cache.h"
+#include "utils/adam_index_va_results.h"
+#include "utils/adam_retrieval_join.h"
 
 #include "access/gin.h"
 #include "access/transam.h"
@@ -193,6 +199,7 @@ static const char *show_tcp_keepalives_count(void);
 static bool check_maxconnections(int *newval, void **extra, GucSource source);
 static bool check_autovacuum_max_workers(int *newval, void **extra, GucSource source);
 static bool check_effective_io_concurrency(int *newval, void **extra, GucSource source);
+static bool check_va_marks_sample_size(int *newval, void **extra, GucSource source);
 static void assign_effective_io_concurrency(int newval, void *extra);
 static void assign_pgstat_temp_directory(const char *newval, void *extra);
 static bool check_application_name(char **newval, void **extra, GucSource source);
@@ -380,6 +387,16 @@ static const struct config_enum_entry synchronous_commit_options[] = {
 	{NULL, 0, false}
 };
 
+/*
+ * ADAM: compression of features by TOAST
+ */
+static const struct config_enum_entry feature_compression_options[] = {
+	{"none", FEATURE_COMPRESSION_NONE, false},
+	{"pglz", FEATURE_COMPRESSION_PGLZ, false},
+	{"float", FEATURE_COMPRESSION_FLOAT, false},
+	{NULL, 0, false}
+};
+
 /*
  * Options for enum values stored in other modules
  */
@@ -685,6 +702,33 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_lshscan", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of LSH indexing-scan plans."),
+			NULL
+		},
+		&enable_lshscan,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_similarityjoin", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of similarity join plans."),
+			NULL
+		},
+		&enable_similarityjoin,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"va_cache_autoload", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Loads VA indexes into the VA cache when they are searched for the first time."),
+			NULL
+		},
+		&va_cache_autoload,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_indexonlyscan", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of index-only-scan plans."),
@@ -1730,6 +1774,48 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"va_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the shared memory used for caching VA indexes."),
+			gettext_noop("Zero disables the VA cache."),
+			GUC_UNIT_KB
+		},
+		&va_cache_size,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"va_result_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the shared memory used for caching the results of VA index searches."),
+			gettext_noop("Zero disables the VA result cache."),
+			GUC_UNIT_KB
+		},
+		&va_result_cache_size,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"va_max_candidates", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the maximum number of candidates of a VA index search."),
+			gettext_noop("Zero means no limit; searches with a limit are approximate.")
+		},
+		&va_max_candidates,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"va_marks_sample_size", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the number of sampled rows the marks of a VA index are built from."),
+			gettext_noop("Zero means that all rows of the table are read.")
+		},
+		&va_marks_sample_size,
+		N_SAMPLES, 0, MaxAllocSize / sizeof(HeapTuple),
+		check_va_marks_sample_size, NULL, NULL
+	},
+
 	/*
 	 * We use the hopefully-safely-small value of 100kB as the compiled-in
 	 * default for max_stack_depth.  InitializeGUCOptions will increase it if
@@ -2490,6 +2576,16 @@ static struct config_real ConfigureNamesReal[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"va_recall_target", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the estimated recall VA index searches have to reach."),
+			gettext_noop("Values below 1 allow approximate searches that refine fewer candidates.")
+		},
+		&va_recall_target,
+		1.0, 0.0, 1.0,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"geqo_selection_bias", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("GEQO: selective pressure within the population."),
@@ -3172,6 +3268,16 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"feature_compression", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Sets the compression method of TOAST for features."),
+			gettext_noop("With none, features are stored uncompressed out-of-line.")
+		},
+		&feature_compression,
+		FEATURE_COMPRESSION_FLOAT, feature_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"IntervalStyle", PGC_USERSET, CLIENT_CONN_LOCALE,
 			gettext_noop("Sets the display format for interval values."),
@@ -8669,6 +8775,18 @@ check_autovacuum_max_workers(int *newval, void **extra, GucSource source)
 	return true;
 }
 
+static bool
+check_va_marks_sample_size(int *newval, void **extra, GucSource source)
+{
+	/* smaller samples are rejected when the marks are built anyway */
+	if (*newval > 0 && *newval < MIN_SAMPLES)
+	{
+		GUC_check_errdetail("\"va_marks_sample_size\" must be 0 or at least %d.", MIN_SAMPLES);
+		return false;
+	}
+	return true;
+}
+
 static bool
 check_effective_io_concurrency(int *newval, void **extra, GucSource source)
 {
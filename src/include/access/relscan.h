@@ -95,6 +95,8 @@ typedef struct IndexScanDescData
 
 	/* ADAM */
 	Node*		adamScanClause;
+	struct PriorityQueue *adamQueue;	/* ADAM: queue shared by the scans of several partitions */
+	struct VAScanInstrumentation *adamInstrument;	/* ADAM: counters for EXPLAIN ANALYZE, or NULL */
 
 }	IndexScanDescData;
 
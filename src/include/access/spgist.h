@@ -45,6 +45,7 @@ typedef struct spgConfigOut
 	Oid			labelType;		/* Data type of inner-tuple node labels */
 	bool		canReturnData;	/* Opclass can reconstruct original data */
 	bool		longValuesOK;	/* Opclass can cope with values > 1 page */
+	bool		canNNSearch;	/* Opclass can report distance bounds (ADAM) */
 } spgConfigOut;
 
 /*
@@ -141,6 +142,12 @@ typedef struct spgInnerConsistentIn
 	Datum		prefixDatum;	/* if so, the prefix value */
 	int			nNodes;			/* number of nodes in the inner tuple */
 	Datum	   *nodeLabels;		/* node label values (NULL if none) */
+
+	/* ADAM: nearest neighbour search (only if canNNSearch) */
+	bool		nnSearch;		/* distances must be reported? */
+	double		nnNorm;			/* Minkowski norm of the search */
+	void	   *traversalValue;	/* opclass-specific value from parent */
+	MemoryContext traversalMemoryContext;	/* put new traversal values here */
 } spgInnerConsistentIn;
 
 typedef struct spgInnerConsistentOut
@@ -149,6 +156,10 @@ typedef struct spgInnerConsistentOut
 	int		   *nodeNumbers;	/* their indexes in the node array */
 	int		   *levelAdds;		/* increment level by this much for each */
 	Datum	   *reconstructedValues;	/* associated reconstructed values */
+
+	/* ADAM: nearest neighbour search (only if nnSearch) */
+	double	   *distances;		/* lower distance bound for each node */
+	void	  **traversalValues;	/* opclass-specific values for children */
 } spgInnerConsistentOut;
 
 /*
@@ -164,12 +175,17 @@ typedef struct spgLeafConsistentIn
 	bool		returnData;		/* original data must be returned? */
 
 	Datum		leafDatum;		/* datum in leaf tuple */
+
+	/* ADAM: nearest neighbour search (only if canNNSearch) */
+	bool		nnSearch;		/* distance must be reported? */
+	double		nnNorm;			/* Minkowski norm of the search */
 } spgLeafConsistentIn;
 
 typedef struct spgLeafConsistentOut
 {
 	Datum		leafValue;		/* reconstructed original data, if any */
 	bool		recheck;		/* set true if operator must be rechecked */
+	double		distance;		/* ADAM: distance to the query, if nnSearch */
 } spgLeafConsistentOut;
 
 
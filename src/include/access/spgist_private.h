@@ -150,6 +150,11 @@ typedef struct SpGistScanOpaqueData
 	TIDBitmap  *tbm;			/* bitmap being filled */
 	int64		ntids;			/* number of TIDs passed to bitmap */
 
+	/* ADAM: nearest neighbour search in amgetbitmap scans */
+	bool		nnSearch;		/* report only the nnLimit nearest TIDs */
+	double		nnNorm;			/* Minkowski norm of the search */
+	int			nnLimit;		/* number of TIDs to report */
+
 	/* These fields are only used in amgettuple scans: */
 	bool		want_itup;		/* are we reconstructing tuples? */
 	TupleDesc	indexTupDesc;	/* if so, tuple descriptor for them */
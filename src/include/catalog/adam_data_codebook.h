@@ -0,0 +1,53 @@
+/* 
+ * ADAM - codebook catalog table
+ * name: adam_data_codebook
+ * description: system catalogs table storing the trained codebooks of the
+ * bag-of-visual-words retrieval
+ *
+ * src/backend/includes/catalog/adam_data_codebook.h
+ *
+ * 
+ * 
+ *
+ */
+#ifndef ADAM_DATA_CODEBOOK_H
+#define ADAM_DATA_CODEBOOK_H
+
+#include "catalog/genbki.h"
+
+#define AdamCodebookRelationId			4241
+
+CATALOG(adam_codebook,4241)
+{
+	NameData	cbname;			/* codebook's name */
+	Oid			cbowner;		/* codebook owner */
+	int32		cbdimensions;	/* dimensions of the visual words */
+	int32		cbwords;		/* number of visual words */
+	float8		cbdocuments;	/* number of objects the frequencies have been counted in */
+#ifdef CATALOG_VARLEN
+	float8		cbcentroids[1];		/* centroids of the visual words (cbwords x cbdimensions) */
+	float8		cbfrequencies[1];	/* number of objects containing a visual word */
+#endif
+} FormData_adam_codebook;
+
+/* ----------------
+ *		Form_adam_codebook corresponds to a pointer to a tuple with
+ *		the format of adam_codebook relation.
+ * ----------------
+ */
+typedef FormData_adam_codebook *Form_adam_codebook;
+
+/* ----------------
+ *		compiler constants for adam_codebook
+ * ----------------
+ */
+#define Natts_adam_codebook					7
+#define Anum_adam_codebook_cbname			1
+#define Anum_adam_codebook_cbowner			2
+#define Anum_adam_codebook_cbdimensions		3
+#define Anum_adam_codebook_cbwords			4
+#define Anum_adam_codebook_cbdocuments		5
+#define Anum_adam_codebook_cbcentroids		6
+#define Anum_adam_codebook_cbfrequencies	7
+
+#endif   /* ADAM_DATA_CODEBOOK_H */
@@ -148,6 +148,7 @@ typedef enum ObjectClass
 	OCLASS_EXTENSION,			/* pg_extension */
 	OCLASS_EVENT_TRIGGER,		/* pg_event_trigger */
 	OCLASS_ADAMFEATUREFUN,		/* adam_featurefun */
+	OCLASS_ADAMCODEBOOK,		/* adam_codebook */
 	MAX_OCLASS					/* MUST BE LAST */
 } ObjectClass;
 
@@ -115,6 +115,6 @@ extern bool ReindexIsProcessingHeap(Oid heapOid);
 extern bool ReindexIsProcessingIndex(Oid indexOid);
 extern Oid	IndexGetRelation(Oid indexId, bool missing_ok);
 
-extern void UpdateIndexAddMarks(Oid index, Datum marks);
+extern void UpdateIndexAddMarks(Oid index, Datum marks, Datum projection);
 
 #endif   /* INDEX_H */
@@ -316,6 +316,11 @@ DECLARE_UNIQUE_INDEX(adam_featurefun_oid_index, 4351, on adam_featurefun using b
 DECLARE_UNIQUE_INDEX(adam_featurefun_typeName_index, 4352, on adam_featurefun using btree(adamfname name_ops, adamftype oid_ops, adamfnamespace oid_ops));
 #define AdamFeaturefuntypeNameIndexId	4352
 
+DECLARE_UNIQUE_INDEX(adam_codebook_oid_index, 4242, on adam_codebook using btree(oid oid_ops));
+#define AdamCodebookOidIndexId		4242
+DECLARE_UNIQUE_INDEX(adam_codebook_name_index, 4243, on adam_codebook using btree(cbname name_ops));
+#define AdamCodebookNameIndexId		4243
+
 /* last step of initialization script: build the indexes declared above */
 BUILD_INDICES
 
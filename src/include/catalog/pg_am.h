@@ -132,9 +132,12 @@ DESCR("GIN index access method");
 DATA(insert OID = 4000 (  spgist	0 5 f f f f f t f t f f f 0 spginsert spgbeginscan spggettuple spggetbitmap spgrescan spgendscan spgmarkpos spgrestrpos spgbuild spgbuildempty spgbulkdelete spgvacuumcleanup spgcanreturn spgcostestimate spgoptions ));
 DESCR("SP-GiST index access method");
 #define SPGIST_AM_OID 4000
-DATA(insert OID = 5900 (  va		1 1 f t f f t t f f f f f 2281 vaInsert vaBeginScan - vaGetBitmap vaReScan vaEndScan vaMarkPos vaRestorePos vaBuild vaBuildEmpty vaBulkDelete vaVacuumCleanup vaCanReturn vaCostEstimate vaGetOptions ));
+DATA(insert OID = 5900 (  va		1 1 f t f f t t f f f t f 2281 vaInsert vaBeginScan - vaGetBitmap vaReScan vaEndScan vaMarkPos vaRestorePos vaBuild vaBuildEmpty vaBulkDelete vaVacuumCleanup vaCanReturn vaCostEstimate vaGetOptions ));
 DESCR("bloom filter access method");
 #define VA_AM_OID 5900
+DATA(insert OID = 5901 (  lsh		1 1 f f f f f t f f f f f 0 lshInsert lshBeginScan - lshGetBitmap lshReScan lshEndScan lshMarkPos lshRestorePos lshBuild lshBuildEmpty lshBulkDelete lshVacuumCleanup - lshCostEstimate lshGetOptions ));
+DESCR("locality-sensitive hashing access method");
+#define LSH_AM_OID 5901
 
 
 #endif   /* PG_AM_H */
@@ -801,4 +801,11 @@ DATA(insert (	5002   4818 4818 1 s 5014 405 0 ));
 // VA
 DATA(insert (	5005   4817 4817 1 s 5017 5900 0 ));
 
+// LSH
+DATA(insert (	5009   4817 4817 1 s 5017 5901 0 ));
+
+// SP-GiST k-d tree
+DATA(insert (	5006   4817 4817 1 s 5007 4000 0 ));
+DATA(insert (	5006   4817 4817 2 s 5017 4000 0 ));
+
 #endif   /* PG_AMOP_H */
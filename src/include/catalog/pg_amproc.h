@@ -382,6 +382,7 @@ DATA(insert (	3474   3831 3831 5 3473 ));
 /* ADAM */
 // btree
 DATA(insert (	5003   4817 4817 1 4133 ));
+DATA(insert (	5003   4817 4817 2 4234 ));
 DATA(insert (	5004   4818 4818 1 4144 ));
 
 // hash
@@ -391,4 +392,14 @@ DATA(insert (	5002   4818 4818 1 4118 ));
 // VA
 DATA(insert (	5005   4817 4817 1 4110 ));
 
+// LSH
+DATA(insert (	5009   4817 4817 1 4110 ));
+
+// SP-GiST k-d tree
+DATA(insert (	5006   4817 4817 1 5420 ));
+DATA(insert (	5006   4817 4817 2 5421 ));
+DATA(insert (	5006   4817 4817 3 5422 ));
+DATA(insert (	5006   4817 4817 4 5423 ));
+DATA(insert (	5006   4817 4817 5 5424 ));
+
 #endif   /* PG_AMPROC_H */
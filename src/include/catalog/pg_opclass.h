@@ -239,4 +239,10 @@ DATA(insert (	405	physical_ops			PGNSP PGUID 5002  4818 t 0 ));
 
 //bloom
 DATA(insert ( 5900	feature_ops				PGNSP PGUID 5005  4817 t 0 ));
+
+//lsh
+DATA(insert ( 5901	feature_ops				PGNSP PGUID 5009  4817 t 0 ));
+
+//sp-gist
+DATA(insert ( 4000	kd_feature_ops			PGNSP PGUID 5006  4817 t 0 ));
 #endif   /* PG_OPCLASS_H */
@@ -1349,6 +1349,7 @@ DATA(insert OID = 1956 ( "<>"	   PGNSP PGUID b f f 17 17	16 1956 1955 byteane ne
 DESCR("not equal");
 DATA(insert OID = 1957 ( "<"	   PGNSP PGUID b f f 17 17	16 1959 1960 bytealt scalarltsel scalarltjoinsel ));
 DESCR("less than");
+#define ByteaLessOperator	1957	/* ADAM */
 DATA(insert OID = 1958 ( "<="	   PGNSP PGUID b f f 17 17	16 1960 1959 byteale scalarltsel scalarltjoinsel ));
 DESCR("less than or equal");
 DATA(insert OID = 1959 ( ">"	   PGNSP PGUID b f f 17 17	16 1957 1958 byteagt scalargtsel scalargtjoinsel ));
@@ -1744,6 +1745,7 @@ DATA(insert OID = 5007 (  "="	   PGNSP PGUID b t t 4817 4817 16 5007 5008 featur
 DESCR("=");
 DATA(insert OID = 5017 (  "==="	   PGNSP PGUID b f f 4817 4817 16 5017 0 feature_dummy_eq eqsel eqjoinsel  ));
 DESCR("===");
+#define FEATURE_DUMMY_EQ 5017
 DATA(insert OID = 5008 (  "<>"	   PGNSP PGUID b f f 4817 4817 16 5008 5007 feature_neq - - ));
 DESCR("<>");
 DATA(insert OID = 5013 (  "<~>"	   PGNSP PGUID b f f 4817 4817 1700 5013 0 dummyFeatureDistance - - ));
@@ -160,4 +160,10 @@ DATA(insert OID = 5002 (	405		physical_ops	PGNSP PGUID ));
 
 //bloom
 DATA(insert OID = 5005 (	5900	feature_ops		PGNSP PGUID ));
+
+//lsh
+DATA(insert OID = 5009 (	5901	feature_ops		PGNSP PGUID ));
+
+//sp-gist
+DATA(insert OID = 5006 (	4000	kd_feature_ops	PGNSP PGUID ));
 #endif   /* PG_OPFAMILY_H */
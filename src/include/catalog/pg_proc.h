@@ -2600,6 +2600,8 @@ DATA(insert OID = 1934 (  pg_stat_get_blocks_fetched	PGNSP PGUID 12 1 0 0 0 f f
 DESCR("statistics: number of blocks fetched");
 DATA(insert OID = 1935 (  pg_stat_get_blocks_hit		PGNSP PGUID 12 1 0 0 0 f f f f t f s 1 0 20 "26" _null_ _null_ _null_ _null_ pg_stat_get_blocks_hit _null_ _null_ _null_ ));
 DESCR("statistics: number of blocks found in cache");
+DATA(insert OID = 4230 (  pg_stat_get_va_candidates	PGNSP PGUID 12 1 0 0 0 f f f f t f s 1 0 20 "26" _null_ _null_ _null_ _null_ pg_stat_get_va_candidates _null_ _null_ _null_ ));
+DESCR("statistics: number of candidates produced by VA scans");
 DATA(insert OID = 2781 (  pg_stat_get_last_vacuum_time PGNSP PGUID 12 1 0 0 0 f f f f t f s 1 0 1184 "26" _null_ _null_ _null_ _null_	pg_stat_get_last_vacuum_time _null_ _null_ _null_ ));
 DESCR("statistics: last manual vacuum time for a table");
 DATA(insert OID = 2782 (  pg_stat_get_last_autovacuum_time PGNSP PGUID 12 1 0 0 0 f f f f t f s 1 0 1184 "26" _null_ _null_ _null_ _null_	pg_stat_get_last_autovacuum_time _null_ _null_ _null_ ));
@@ -4738,6 +4740,10 @@ DATA(insert OID = 4918 (  feature_in PGNSP PGUID 12 1 0 0 0 f f f f t f i 3 0 48
 DESCR("I/O");
 DATA(insert OID = 4919 (  feature_out PGNSP PGUID 12 1 0 0 0 f f f f t f i 1 0 2275 "4817" _null_ _null_ _null_ _null_	feature_out _null_ _null_ _null_ ));
 DESCR("I/O");
+DATA(insert OID = 4927 (  feature_recv PGNSP PGUID 12 1 0 0 0 f f f f t f s 3 0 4817 "2281 26 23" _null_ _null_ _null_ _null_	feature_recv _null_ _null_ _null_ ));
+DESCR("I/O");
+DATA(insert OID = 4928 (  feature_send PGNSP PGUID 12 1 0 0 0 f f f f t f s 1 0 17 "4817" _null_ _null_ _null_ _null_	feature_send _null_ _null_ _null_ ));
+DESCR("I/O");
 // - casting
 DATA(insert OID = 4925 (  featureArrayCast	PGNSP PGUID 12 1 0 0 0 f f f f t f i 3 0 1231 "4817 23 16" _null_ _null_ _null_ _null_	featureArrayCast _null_ _null_ _null_ ));
 DESCR("feature to array cast");
@@ -4763,6 +4769,8 @@ DATA(insert OID = 4132 (  feature_ge		   PGNSP PGUID 12 1 0 0 0 f f f f t f i 2
 DESCR("implementation of >= operator");
 DATA(insert OID = 4133 (  feature_cmp		   PGNSP PGUID 12 1 0 0 0 f f f f t f i 2 0 23 "4817 4817" _null_ _null_ _null_ _null_ feature_cmp _null_ _null_ _null_ ));
 DESCR("less-equal-greater");
+DATA(insert OID = 4234 (  feature_sortsupport PGNSP PGUID 12 1 0 0 0 f f f f t f i 1 0 2278 "2281" _null_ _null_ _null_ _null_ feature_sortsupport _null_ _null_ _null_ ));
+DESCR("sort support");
 DATA(insert OID = 4115 (  dummyFeatureDistance PGNSP PGUID 12 1 0 0 0 f f f f t f i 2 0 701 "4817 4817" _null_ _null_ _null_ _null_ dummyFeatureDistance _null_ _null_ _null_ ));
 DESCR("implementation of <~> operator");
 DATA(insert OID = 4215 (  calculateMinkowski PGNSP PGUID 12 10000 0 0 0 f f f f t f i 3 0 701 "4817 4817 701" _null_ _null_ _null_ _null_ calculateMinkowski _null_ _null_ _null_ ));
@@ -4771,6 +4779,44 @@ DESCR("minkowski functions");
 DATA(insert OID = 4216 (  calculateWeightedMinkowski PGNSP PGUID 12 10000 0 0 0 f f f f t f i 4 0 701 "4817 4817 701 1022" _null_ _null_ _null_ _null_ calculateWeightedMinkowski _null_ _null_ _null_ ));
 DESCR("minkowski functions");
 #define MINKOWSKI_WEIGHTED_PROCOID 4216
+DATA(insert OID = 4222 (  calculateCosine PGNSP PGUID 12 1000 0 0 0 f f f f t f i 2 0 701 "4817 4817" _null_ _null_ _null_ _null_ calculateCosine _null_ _null_ _null_ ));
+DESCR("similarity functions");
+#define COSINE_PROCOID 4222
+DATA(insert OID = 4223 (  calculateInnerProduct PGNSP PGUID 12 1000 0 0 0 f f f f t f i 2 0 701 "4817 4817" _null_ _null_ _null_ _null_ calculateInnerProduct _null_ _null_ _null_ ));
+DESCR("similarity functions");
+#define INNER_PRODUCT_PROCOID 4223
+DATA(insert OID = 4224 (  calculateHamming PGNSP PGUID 12 1000 0 0 0 f f f f t f i 2 0 701 "4817 4817" _null_ _null_ _null_ _null_ calculateHamming _null_ _null_ _null_ ));
+DESCR("similarity functions");
+#define HAMMING_PROCOID 4224
+DATA(insert OID = 4225 (  calculateBatchDistance PGNSP PGUID 12 1000 0 2276 0 f f f f f f v 2 0 701 "26 2276" "{26,2276}" "{i,v}" _null_ _null_ calculateBatchDistance _null_ _null_ _null_ ));
+DESCR("calls a batch distance function for a single candidate");
+#define BATCH_DISTANCE_PROCOID 4225
+DATA(insert OID = 4226 (  va_prewarm PGNSP PGUID 12 1 0 0 0 f f f f t f v 1 0 20 "2205" _null_ _null_ _null_ _null_ va_prewarm _null_ _null_ _null_ ));
+DESCR("load a VA index into the VA cache");
+DATA(insert OID = 4227 (  va_imbalance PGNSP PGUID 12 1 0 0 0 f f f f t f v 1 0 701 "2205" _null_ _null_ _null_ _null_ va_imbalance _null_ _null_ _null_ ));
+DESCR("imbalance of the cells of a VA index");
+DATA(insert OID = 4228 (  va_changes PGNSP PGUID 12 1 0 0 0 f f f f t f v 1 0 20 "2205" _null_ _null_ _null_ _null_ va_changes _null_ _null_ _null_ ));
+DESCR("number of tuples inserted and removed since a VA index has been built");
+DATA(insert OID = 4229 (  va_build_time PGNSP PGUID 12 1 0 0 0 f f f f t f v 1 0 1184 "2205" _null_ _null_ _null_ _null_ va_build_time _null_ _null_ _null_ ));
+DESCR("time a VA index has been built at");
+DATA(insert OID = 4231 (  feature_quantize PGNSP PGUID 12 1 0 0 0 f f f f t f i 2 0 4817 "4817 25" _null_ _null_ _null_ _null_ feature_quantize _null_ _null_ _null_ ));
+DESCR("store a feature as float8, float4 or float16");
+DATA(insert OID = 4232 (  feature_quantize PGNSP PGUID 12 1 0 0 0 f f f f t f i 4 0 4817 "4817 25 701 701" _null_ _null_ _null_ _null_ feature_quantize_scaled _null_ _null_ _null_ ));
+DESCR("store a feature as int8 codes with scale and offset");
+DATA(insert OID = 4233 (  feature_dequantize PGNSP PGUID 12 1 0 0 0 f f f f t f i 1 0 4817 "4817" _null_ _null_ _null_ _null_ feature_dequantize _null_ _null_ _null_ ));
+DESCR("convert a quantized feature to float8");
+DATA(insert OID = 4239 (  feature_knn_join PGNSP PGUID 12 10000 1000 0 0 f f f f t t s 8 0 2249 "2205 25 25 2205 25 25 23 701" _null_ _null_ _null_ _null_ feature_knn_join _null_ _null_ _null_ ));
+DESCR("k nearest neighbours in the inner table of every tuple of the outer table");
+DATA(insert OID = 4240 (  feature_epsilon_join PGNSP PGUID 12 10000 1000 0 0 f f f f t t s 8 0 2249 "2205 25 25 2205 25 25 701 701" _null_ _null_ _null_ _null_ feature_epsilon_join _null_ _null_ _null_ ));
+DESCR("pairs of tuples of two tables within a distance");
+DATA(insert OID = 4246 (  feature_codebook_train PGNSP PGUID 12 10000 0 0 0 f f f f t f v 4 0 26 "25 2205 25 23" _null_ _null_ _null_ _null_ feature_codebook_train _null_ _null_ _null_ ));
+DESCR("train a codebook of visual words on the arrays of features of a table");
+DATA(insert OID = 4247 (  feature_codebook_drop PGNSP PGUID 12 1 0 0 0 f f f f t f v 1 0 2278 "25" _null_ _null_ _null_ _null_ feature_codebook_drop _null_ _null_ _null_ ));
+DESCR("remove a codebook of visual words");
+DATA(insert OID = 4248 (  feature_visual_words PGNSP PGUID 12 10000 0 0 0 f f f f t f s 2 0 1007 "25 4819" _null_ _null_ _null_ _null_ feature_visual_words _null_ _null_ _null_ ));
+DESCR("map an array of features to visual words");
+DATA(insert OID = 4249 (  feature_bow_rank PGNSP PGUID 12 100 0 0 0 f f f f t f s 3 0 701 "25 1007 1007" _null_ _null_ _null_ _null_ feature_bow_rank _null_ _null_ _null_ ));
+DESCR("tf-idf rank of visual words for a query");
 DATA(insert OID = 4220 (  normalizeMinMax PGNSP PGUID 12 10000 0 0 0 f f f f t f i 2 0 701 "701 701" _null_ _null_ _null_ _null_ normalizeMinMax _null_ _null_ _null_ ));
 DESCR("minkowski functions");
 #define MINMAX_NORMALIZATION 4220
@@ -4890,6 +4936,43 @@ DESCR("va-file(internal)");
 DATA(insert OID = 5416 (  vaGetOptions		   PGNSP PGUID 12 1 0 0 0 f f f f t f s 2 0 17 "1009 16" _null_ _null_ _null_ _null_  vaGetOptions _null_ _null_ _null_ ));
 DESCR("va-file(internal)");
 #define VAOPTIONS 5416
+DATA(insert OID = 5420 (  spg_feature_kd_config	PGNSP PGUID 12 1 0 0 0 f f f f t f i 2 0 2278 "2281 2281" _null_ _null_ _null_ _null_  spg_feature_kd_config _null_ _null_ _null_ ));
+DESCR("SP-GiST support for k-d tree over feature");
+DATA(insert OID = 5421 (  spg_feature_kd_choose	PGNSP PGUID 12 1 0 0 0 f f f f t f i 2 0 2278 "2281 2281" _null_ _null_ _null_ _null_  spg_feature_kd_choose _null_ _null_ _null_ ));
+DESCR("SP-GiST support for k-d tree over feature");
+DATA(insert OID = 5422 (  spg_feature_kd_picksplit	PGNSP PGUID 12 1 0 0 0 f f f f t f i 2 0 2278 "2281 2281" _null_ _null_ _null_ _null_  spg_feature_kd_picksplit _null_ _null_ _null_ ));
+DESCR("SP-GiST support for k-d tree over feature");
+DATA(insert OID = 5423 (  spg_feature_kd_inner_consistent	PGNSP PGUID 12 1 0 0 0 f f f f t f i 2 0 2278 "2281 2281" _null_ _null_ _null_ _null_  spg_feature_kd_inner_consistent _null_ _null_ _null_ ));
+DESCR("SP-GiST support for k-d tree over feature");
+DATA(insert OID = 5424 (  spg_feature_kd_leaf_consistent	PGNSP PGUID 12 1 0 0 0 f f f f t f i 2 0 16 "2281 2281" _null_ _null_ _null_ _null_  spg_feature_kd_leaf_consistent _null_ _null_ _null_ ));
+DESCR("SP-GiST support for k-d tree over feature");
+DATA(insert OID = 5430 (  lshGetBitmap	   PGNSP PGUID 12 1 0 0 0 f f f f t f v 2 0 20 "2281 2281" _null_ _null_ _null_ _null_	lshGetBitmap _null_ _null_ _null_ ));
+DESCR("lsh(internal)");
+DATA(insert OID = 5431 (  lshInsert	   PGNSP PGUID 12 1 0 0 0 f f f f t f v 6 0 16 "2281 2281 2281 2281 2281 2281" _null_ _null_ _null_ _null_	lshInsert _null_ _null_ _null_ ));
+DESCR("lsh(internal)");
+DATA(insert OID = 5432 (  lshBeginScan	   PGNSP PGUID 12 1 0 0 0 f f f f t f v 3 0 2281 "2281 2281 2281" _null_ _null_ _null_ _null_	lshBeginScan _null_ _null_ _null_ ));
+DESCR("lsh(internal)");
+DATA(insert OID = 5433 (  lshReScan	   PGNSP PGUID 12 1 0 0 0 f f f f t f v 5 0 2278 "2281 2281 2281 2281 2281" _null_ _null_ _null_ _null_	lshReScan _null_ _null_ _null_ ));
+DESCR("lsh(internal)");
+DATA(insert OID = 5434 (  lshEndScan	   PGNSP PGUID 12 1 0 0 0 f f f f t f v 1 0 2278 "2281" _null_ _null_ _null_ _null_	lshEndScan _null_ _null_ _null_ ));
+DESCR("lsh(internal)");
+DATA(insert OID = 5435 (  lshMarkPos	   PGNSP PGUID 12 1 0 0 0 f f f f t f v 1 0 2278 "2281" _null_ _null_ _null_ _null_	lshMarkPos _null_ _null_ _null_ ));
+DESCR("lsh(internal)");
+DATA(insert OID = 5436 (  lshRestorePos	   PGNSP PGUID 12 1 0 0 0 f f f f t f v 1 0 2278 "2281" _null_ _null_ _null_ _null_	lshRestorePos _null_ _null_ _null_ ));
+DESCR("lsh(internal)");
+DATA(insert OID = 5437 (  lshBuild	   PGNSP PGUID 12 1 0 0 0 f f f f t f v 3 0 2281 "2281 2281 2281" _null_ _null_ _null_ _null_	lshBuild _null_ _null_ _null_ ));
+DESCR("lsh(internal)");
+DATA(insert OID = 5438 (  lshBuildEmpty	   PGNSP PGUID 12 1 0 0 0 f f f f t f v 1 0 2278 "2281" _null_ _null_ _null_ _null_	lshBuildEmpty _null_ _null_ _null_ ));
+DESCR("lsh(internal)");
+DATA(insert OID = 5439 (  lshBulkDelete	   PGNSP PGUID 12 1 0 0 0 f f f f t f v 4 0 2281 "2281 2281 2281 2281" _null_ _null_ _null_ _null_	lshBulkDelete _null_ _null_ _null_ ));
+DESCR("lsh(internal)");
+DATA(insert OID = 5440 (  lshVacuumCleanup	   PGNSP PGUID 12 1 0 0 0 f f f f t f v 2 0 2281 "2281 2281" _null_ _null_ _null_ _null_	lshVacuumCleanup _null_ _null_ _null_ ));
+DESCR("lsh(internal)");
+DATA(insert OID = 5441 (  lshCostEstimate	   PGNSP PGUID 12 1 0 0 0 f f f f t f v 7 0 2278 "2281 2281 2281 2281 2281 2281 2281" _null_ _null_ _null_ _null_	lshCostEstimate _null_ _null_ _null_ ));
+DESCR("lsh(internal)");
+DATA(insert OID = 5442 (  lshGetOptions	   PGNSP PGUID 12 1 0 0 0 f f f f t f s 2 0 17 "1009 16" _null_ _null_ _null_ _null_	lshGetOptions _null_ _null_ _null_ ));
+DESCR("lsh(internal)");
+#define LSHOPTIONS 5442
 
 
 /*
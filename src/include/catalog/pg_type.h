@@ -468,6 +468,7 @@ DATA(insert OID = 1020 (  _box		 PGNSP PGUID -1 f b A f t \073 0 603 0 array_in
 DATA(insert OID = 1021 (  _float4	 PGNSP PGUID -1 f b A f t \054 0 700 0 array_in array_out array_recv array_send - - array_typanalyze i x f 0 -1 0 0 _null_ _null_ _null_ ));
 #define FLOAT4ARRAYOID 1021
 DATA(insert OID = 1022 (  _float8	 PGNSP PGUID -1 f b A f t \054 0 701 0 array_in array_out array_recv array_send - - array_typanalyze d x f 0 -1 0 0 _null_ _null_ _null_ ));
+#define FLOAT8ARRAYOID 1022
 DATA(insert OID = 1023 (  _abstime	 PGNSP PGUID -1 f b A f t \054 0 702 0 array_in array_out array_recv array_send - - array_typanalyze i x f 0 -1 0 0 _null_ _null_ _null_ ));
 DATA(insert OID = 1024 (  _reltime	 PGNSP PGUID -1 f b A f t \054 0 703 0 array_in array_out array_recv array_send - - array_typanalyze i x f 0 -1 0 0 _null_ _null_ _null_ ));
 DATA(insert OID = 1025 (  _tinterval PGNSP PGUID -1 f b A f t \054 0 704 0 array_in array_out array_recv array_send - - array_typanalyze i x f 0 -1 0 0 _null_ _null_ _null_ ));
@@ -632,9 +633,11 @@ DATA(insert OID = 3927 ( _int8range		PGNSP PGUID  -1 f b A f t \054 0 3926 0 arr
 DATA(insert OID = 4711 (adam_featurefun	PGNSP PGUID -1 f c C f t \054 4318 0 0 record_in record_out record_recv record_send - - - d x f 0 -1 0 0 _null_ _null_ _null_ ));
 
 // data types
-DATA(insert OID = 4817 (  feature   PGNSP PGUID -1 f b a f t \054 0	0 0 feature_in feature_out - - - - - d x f 0 -1 0 0 _null_ _null_ _null_ ));
+DATA(insert OID = 4817 (  feature   PGNSP PGUID -1 f b a f t \054 0	0 4819 feature_in feature_out feature_recv feature_send - - - d x f 0 -1 0 0 _null_ _null_ _null_ ));
 DESCR("feature vector");
 #define FEATURE 4817
+DATA(insert OID = 4819 (  _feature   PGNSP PGUID -1 f b A f t \054 0	4817 0 array_in array_out array_recv array_send - - array_typanalyze d x f 0 -1 0 0 _null_ _null_ _null_ ));
+#define FEATUREARRAYOID 4819
 
 // function types (defined as pseudo-types)
 DATA(insert OID = 4712 (algorithm	PGNSP PGUID -1 f p P f t \054 0 0 0 record_in record_out - - - - - i p f 0 -1 0 0 _null_ _null_ _null_ ));
@@ -49,6 +49,7 @@ DECLARE_TOAST(pg_seclabel, 3598, 3599);
 DECLARE_TOAST(pg_statistic, 2840, 2841);
 DECLARE_TOAST(pg_trigger, 2336, 2337);
 DECLARE_TOAST(pg_index, 4360, 4361);
+DECLARE_TOAST(adam_codebook, 4244, 4245);
 
 /* shared catalogs */
 DECLARE_TOAST(pg_shdescription, 2846, 2847);
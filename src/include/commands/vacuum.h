@@ -180,5 +180,8 @@ extern double anl_get_next_S(double t, int n, double *stateptr);
 extern int acquire_sample_rows(Relation onerel, int elevel,
 					HeapTuple *rows, int targrows,
 					double *totalrows, double *totaldeadrows);
+extern int acquire_sample_rows_outside_analyze(Relation onerel, int elevel,
+					HeapTuple *rows, int targrows,
+					double *totalrows, double *totaldeadrows);
 
 #endif   /* VACUUM_H */
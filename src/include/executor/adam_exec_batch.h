@@ -0,0 +1,58 @@
+/*
+ * ADAM - batch evaluation of distance functions
+ * name: adam_exec_batch
+ * description: evaluates batch distance functions in the scan nodes
+ *
+ * src/include/executor/adam_exec_batch.h
+ *
+ *
+ *
+ *
+ */
+#ifndef ADAM_EXEC_BATCH_H
+#define ADAM_EXEC_BATCH_H
+
+#include "nodes/execnodes.h"
+#include "utils/adam_retrieval_batch.h"
+
+/*
+ * state of a scan node that buffers tuples to evaluate the distance
+ * functions of its projection in batches
+ */
+typedef struct AdamBatchState
+{
+	MemoryContext	batchcxt;		/* holds the buffered tuples and candidates */
+	TupleTableSlot *slot;			/* slot for projecting the buffered tuples */
+	HeapTuple	   *tuples;			/* buffered tuples that passed the quals */
+	int				ntuples;		/* number of buffered tuples */
+	int				current;		/* tuple currently projected */
+	bool			done;			/* underlying scan is exhausted */
+	List		   *distances;		/* list of AdamBatchDistanceState */
+} AdamBatchState;
+
+/*
+ * replaces the expression state of a calculateBatchDistance call in the projection;
+ * evaluating it returns the distance computed for the current tuple of the batch
+ */
+typedef struct AdamBatchDistanceState
+{
+	ExprState		xprstate;
+	AdamBatchState *batch;
+	FmgrInfo		flinfo;			/* batch distance function */
+	Oid				collation;
+	ExprState	   *query;			/* query vector (no Vars) */
+	ExprState	   *candidate;		/* candidate vector */
+	List		   *extras;			/* additional parameters (no Vars) */
+	Datum		   *candidates;
+	bool		   *candidateNulls;
+	float8		   *results;
+	bool		   *resultNulls;
+} AdamBatchDistanceState;
+
+extern void ExecInitAdamBatch(ScanState *node, int eflags);
+extern void ExecAdamBatchReset(AdamBatchState *batch);
+extern void ExecAdamBatchAddTuple(AdamBatchState *batch, ExprContext *econtext, TupleTableSlot *slot);
+extern void ExecAdamBatchCompute(AdamBatchState *batch, ExprContext *econtext);
+extern TupleTableSlot *ExecAdamBatchNextSlot(AdamBatchState *batch);
+
+#endif   /* ADAM_EXEC_BATCH_H */
@@ -0,0 +1,24 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeSimilarityjoin.h
+ *	  prototypes for nodeSimilarityjoin.c (ADAM)
+ *
+ *
+ * Portions Copyright (c) 1996-2013, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/nodeSimilarityjoin.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef NODESIMILARITYJOIN_H
+#define NODESIMILARITYJOIN_H
+
+#include "nodes/execnodes.h"
+
+extern SimilarityJoinState *ExecInitSimilarityJoin(SimilarityJoin *node, EState *estate, int eflags);
+extern TupleTableSlot *ExecSimilarityJoin(SimilarityJoinState *node);
+extern void ExecEndSimilarityJoin(SimilarityJoinState *node);
+extern void ExecReScanSimilarityJoin(SimilarityJoinState *node);
+
+#endif   /* NODESIMILARITYJOIN_H */
@@ -22,5 +22,6 @@ extern void ExecEndSort(SortState *node);
 extern void ExecSortMarkPos(SortState *node);
 extern void ExecSortRestrPos(SortState *node);
 extern void ExecReScanSort(SortState *node);
+extern bool ExecSortSupportsBrowsing(Sort *node);
 
 #endif   /* NODESORT_H */
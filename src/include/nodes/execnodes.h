@@ -1197,6 +1197,7 @@ typedef struct ScanState
 	Relation	ss_currentRelation;
 	HeapScanDesc ss_currentScanDesc;
 	TupleTableSlot *ss_ScanTupleSlot;
+	struct AdamBatchState *adamBatch;	/* ADAM : see adam_exec_batch.h */
 } ScanState;
 
 /*
@@ -1327,6 +1328,8 @@ typedef struct BitmapIndexScanState
 	Relation	biss_RelationDesc;
 	IndexScanDesc biss_ScanDesc;
 	Node		*adamScanClause;
+	struct PriorityQueue *adamQueue;	/* ADAM: queue shared by partitions */
+	struct VAScanInstrumentation *adamInstrument;	/* ADAM: VA counters for EXPLAIN ANALYZE */
 } BitmapIndexScanState;
 
 /* ----------------
@@ -1339,6 +1342,10 @@ typedef struct BitmapIndexScanState
  *		prefetch_iterator  iterator for prefetching ahead of current page
  *		prefetch_pages	   # pages prefetch iterator is ahead of current
  *		prefetch_target    target prefetch distance
+ *		adamPostFilter	   ADAM: VA results are filtered by the quals
+ *		adamLimit		   ADAM: number of requested neighbours
+ *		adamReturned	   ADAM: number of tuples that passed the quals
+ *		adamSeen		   ADAM: TIDs of the previous VA searches (exact)
  * ----------------
  */
 typedef struct BitmapHeapScanState
@@ -1352,6 +1359,10 @@ typedef struct BitmapHeapScanState
 	int			prefetch_pages;
 	int			prefetch_target;
 	Node	   *adamScanClause;
+	bool		adamPostFilter;
+	int			adamLimit;
+	double		adamReturned;
+	HTAB	   *adamSeen;
 } BitmapHeapScanState;
 
 /* ----------------
@@ -1620,6 +1631,43 @@ typedef struct HashJoinState
 	bool		hj_OuterNotEmpty;
 } HashJoinState;
 
+/* ----------------
+ *	 SimilarityJoinState information (ADAM)
+ *
+ *		sj_OuterFeature			query vector of the outer tuple
+ *		sj_Distance				distance of an outer and an inner tuple
+ *		sj_OuterTupleSlot		tuple slot for the outer tuples of a chunk
+ *		sj_InnerTupleSlot		tuple slot for the neighbours
+ *		sj_VAIndex				VA index the candidates are read with
+ *								(NULL if the inner plan is run)
+ *		sj_Chunk				outer tuples joined at once and their
+ *								neighbours (see nodeSimilarityjoin.c)
+ *		sj_OuterDone			true if the outer plan is exhausted
+ *		sj_InnerScanned			true if the inner plan has been run
+ *		sj_Chunks, sj_Pairs, sj_Candidates
+ *								counters for EXPLAIN ANALYZE
+ * ----------------
+ */
+
+/* this struct is private in nodeSimilarityjoin.c: */
+typedef struct SimilarityJoinChunk SimilarityJoinChunk;
+
+typedef struct SimilarityJoinState
+{
+	JoinState	js;				/* its first field is NodeTag */
+	ExprState  *sj_OuterFeature;
+	ExprState  *sj_Distance;
+	TupleTableSlot *sj_OuterTupleSlot;
+	TupleTableSlot *sj_InnerTupleSlot;
+	Relation	sj_VAIndex;
+	SimilarityJoinChunk *sj_Chunk;
+	bool		sj_OuterDone;
+	bool		sj_InnerScanned;
+	double		sj_Chunks;
+	double		sj_Pairs;
+	double		sj_Candidates;
+} SimilarityJoinState;
+
 
 /* ----------------------------------------------------------------
  *				 Materialization State Information
@@ -1657,6 +1705,10 @@ typedef struct SortState
 	bool		bounded_Done;	/* value of bounded we did the sort with */
 	int64		bound_Done;		/* value of bound we did the sort with */
 	void	   *tuplesortstate; /* private state of tuplesort.c */
+	bool		adamBrowse;		/* ADAM: distance browsing, see nodeSort.c */
+	int			adamLimit;		/* ADAM: neighbours of the current round, -1 if last */
+	double		adamThreshold;	/* ADAM: distance up to which the round is complete */
+	int			adamRounds;		/* ADAM: rounds of distance browsing so far */
 } SortState;
 
 /* ---------------------
@@ -1879,6 +1931,7 @@ typedef struct LimitState
 	LimitStateCond lstate;		/* state machine status, as above */
 	int64		position;		/* 1-based index of last tuple returned */
 	TupleTableSlot *subSlot;	/* tuple last obtained from subplan */
+	List	   *adamQueues;		/* ADAM: queues shared by partitions */
 } LimitState;
 
 #endif   /* EXECNODES_H */
@@ -66,6 +66,7 @@ typedef enum NodeTag
 	T_NestLoop,
 	T_MergeJoin,
 	T_HashJoin,
+	T_SimilarityJoin,
 	T_Material,
 	T_Sort,
 	T_Group,
@@ -111,6 +112,7 @@ typedef enum NodeTag
 	T_NestLoopState,
 	T_MergeJoinState,
 	T_HashJoinState,
+	T_SimilarityJoinState,
 	T_MaterialState,
 	T_SortState,
 	T_GroupState,
@@ -222,6 +224,7 @@ typedef enum NodeTag
 	T_NestPath,
 	T_MergePath,
 	T_HashPath,
+	T_SimilarityJoinPath,
 	T_TidPath,
 	T_ForeignPath,
 	T_AppendPath,
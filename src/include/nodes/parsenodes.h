@@ -21,6 +21,7 @@
 #define PARSENODES_H
 
 #include "utils/adam_retrieval_minkowski.h"
+#include "utils/adam_retrieval_similarity.h"
 
 #include "nodes/bitmapset.h"
 #include "nodes/primnodes.h"
@@ -2374,10 +2375,14 @@ typedef struct AdamSelectStmt
 typedef struct AdamQueryClause
 {
 	NodeTag		type;
+	AdamDistanceType nn_distance;	/* kind of distance */
 	MinkowskiNorm nn_minkowski;		/* minkowski distance */
+	Node	   *nn_weights;		/* weights of the weighted minkowski distance */
 	int			nn_limit;			/* number of elements to retrieve */
 	bool		check_tid;			/* is a TID list given with results? */
 	bool		extendedWhereClause;
+	bool		nn_browse;			/* distance browsing, see nodeSort.c */
+	double		nn_threshold;		/* browsing: distance up to which the search is complete */
 } AdamQueryClause;
 
 
@@ -570,6 +570,30 @@ typedef struct HashJoin
 	List	   *hashclauses;
 } HashJoin;
 
+/* ----------------
+ *		similarity join node (ADAM)
+ *
+ * Joins the outer plan with a LATERAL subquery returning the k nearest
+ * neighbours of outerFeature (see SimilarityJoinInfo).  The inner plan is the
+ * subquery without the distance search, its column featureColumn returns the
+ * inner feature.  Until setrefs.c replaces them by the distance expression,
+ * Vars of that column in the targetlist and quals stand for the distance.
+ * If vaIndex is valid, the inner plan is a SeqScan without quals and only the
+ * tuples that the VA index does not exclude are read.
+ * ----------------
+ */
+typedef struct SimilarityJoin
+{
+	Join		join;
+	Index		subqueryrelid;	/* range table index of the subquery */
+	Expr	   *outerFeature;	/* query vector, from the outer tuple */
+	Expr	   *distance;		/* distance of the subquery */
+	AttrNumber	featureColumn;	/* inner column returning the inner feature */
+	int			k;				/* number of neighbours */
+	double		norm;			/* norm of the Minkowski distance */
+	Oid			vaIndex;		/* VA index to read the candidates with */
+} SimilarityJoin;
+
 /* ----------------
  *		materialization node
  * ----------------
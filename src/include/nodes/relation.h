@@ -348,6 +348,8 @@ typedef struct PlannerInfo
  *		subplan - plan for subquery (NULL if it's not a subquery)
  *		subroot - PlannerInfo for subquery (NULL if it's not a subquery)
  *		subplan_params - list of PlannerParamItems to be passed to subquery
+ *		simjoin - ADAM: subquery planned as inner side of a similarity join
+ *				  (NULL if it's not a LATERAL kNN subquery)
  *		fdwroutine - function hooks for FDW, if foreign table (else NULL)
  *		fdw_private - private state for FDW, if foreign table (else NULL)
  *
@@ -442,6 +444,7 @@ typedef struct RelOptInfo
 	struct Plan *subplan;		/* if subquery */
 	PlannerInfo *subroot;		/* if subquery */
 	List	   *subplan_params; /* if subquery */
+	struct SimilarityJoinInfo *simjoin; /* ADAM: if LATERAL kNN subquery */
 	/* use "struct FdwRoutine" to avoid including fdwapi.h here */
 	struct FdwRoutine *fdwroutine;		/* if foreign table */
 	void	   *fdw_private;	/* if foreign table */
@@ -1037,6 +1040,50 @@ typedef struct HashPath
 	int			num_batches;	/* number of batches expected */
 } HashPath;
 
+/*
+ * ADAM: a LATERAL subquery returning the k nearest neighbours of a feature
+ * of the outer relations, e.g.
+ *
+ *		SELECT ... FROM o, LATERAL (SELECT ... FROM i
+ *			USING DISTANCE MINKOWSKI(2)(f, o.f) ORDER USING DISTANCE LIMIT k) s
+ *
+ * can be joined by a similarity join, which searches the neighbours of a
+ * whole chunk of outer tuples at once (see nodeSimilarityjoin.c).  For this,
+ * set_subquery_pathlist plans the subquery a second time without the distance
+ * search; the column of the distance then returns the inner feature.
+ *
+ * distance is the distance expression of the subquery, in which the inner
+ * feature is a Var of that column and the query vector is outerFeature, an
+ * expression of Vars of the outer relations.
+ */
+typedef struct SimilarityJoinInfo
+{
+	struct Plan *plan;			/* plan of the subquery without the search */
+	PlannerInfo *root;			/* PlannerInfo of that plan */
+	Expr	   *distance;		/* distance of the subquery */
+	Expr	   *outerFeature;	/* query vector, from the outer relations */
+	AttrNumber	featureColumn;	/* column of the distance */
+	int			k;				/* number of neighbours */
+	double		norm;			/* norm of the Minkowski distance */
+	Oid			vaIndex;		/* VA index of the inner feature, if any */
+	BlockNumber vaPages;		/* size of that VA index */
+	double		vaTuples;
+} SimilarityJoinInfo;
+
+/*
+ * ADAM: a similarity join of the outer path with a LATERAL kNN subquery.
+ * The inner side is not a path but the plan in innerrel->simjoin; if useVA
+ * is true, only the candidates of its VA index are read.
+ */
+typedef struct SimilarityJoinPath
+{
+	Path		path;
+	Path	   *outerpath;		/* path for the outer side of the join */
+	RelOptInfo *innerrel;		/* the LATERAL kNN subquery */
+	List	   *joinrestrictinfo;		/* RestrictInfos to apply to join */
+	bool		useVA;			/* read the candidates of the VA index? */
+} SimilarityJoinPath;
+
 /*
  * Restriction clause info.
  *
@@ -65,5 +65,6 @@ extern void tbm_end_iterate(TBMIterator *iterator);
 
 extern bool tbm_contains_tuple(TIDBitmap *tbm, const ItemPointer tid);
 extern int tbm_nentries(TIDBitmap *tbm);
+extern double tbm_ntuples(const TIDBitmap *tbm, double tuplesPerPage);
 
 #endif   /* TIDBITMAP_H */
@@ -123,6 +123,12 @@ extern HashPath *create_hashjoin_path(PlannerInfo *root,
 					 List *restrict_clauses,
 					 Relids required_outer,
 					 List *hashclauses);
+extern SimilarityJoinPath *create_similarityjoin_path(PlannerInfo *root,
+						   RelOptInfo *joinrel,
+						   SpecialJoinInfo *sjinfo,
+						   Path *outer_path,
+						   RelOptInfo *innerrel,
+						   List *restrict_clauses);
 
 extern Path *reparameterize_path(PlannerInfo *root, Path *path,
 					Relids required_outer,
@@ -222,8 +222,18 @@ typedef struct
 #define VARDATA_1B(PTR)		(((varattrib_1b *) (PTR))->va_data)
 #define VARDATA_1B_E(PTR)	(((varattrib_1b_e *) (PTR))->va_data)
 
+/*
+ * ADAM: the two high bits of the raw size of a compressed datum hold the
+ * compression method (raw sizes are below 1GB); besides pglz, features may be
+ * compressed by their own method (see adam_data_compression.c)
+ */
 #define VARRAWSIZE_4B_C(PTR) \
-	(((varattrib_4b *) (PTR))->va_compressed.va_rawsize)
+	(((varattrib_4b *) (PTR))->va_compressed.va_rawsize & 0x3FFFFFFF)
+#define VARCOMPRESSMETHOD_4B_C(PTR) \
+	(((varattrib_4b *) (PTR))->va_compressed.va_rawsize >> 30)
+
+#define TOAST_PGLZ_COMPRESSION			0
+#define TOAST_FEATURE_COMPRESSION		1
 
 /* Externally visible macros */
 
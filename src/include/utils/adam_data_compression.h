@@ -0,0 +1,47 @@
+/*
+ * ADAM - feature compression
+ * name: adam_data_compression
+ * description: float-aware compression of TOASTed features
+ *
+ * src/include/utils/adam_data_compression.h
+ *
+ *
+ *
+ *
+ */
+#ifndef ADAM_DATA_COMPRESSION_H
+#define ADAM_DATA_COMPRESSION_H
+
+#include "postgres.h"
+
+/*
+ * compression of features by TOAST (feature_compression)
+ */
+typedef enum FeatureCompression
+{
+	FEATURE_COMPRESSION_NONE,		/* uncompressed, moved out-of-line as a whole */
+	FEATURE_COMPRESSION_PGLZ,		/* generic compression of TOAST */
+	FEATURE_COMPRESSION_FLOAT		/* xor-delta encoding of the values */
+} FeatureCompression;
+
+/*
+ * reads the values of a compressed feature one after the other without
+ * decompressing the feature
+ */
+typedef struct FeatureDecoder {
+	const unsigned char *pos;
+	int			wordsize;
+	int			n;
+	uint64		previous;
+} FeatureDecoder;
+
+extern struct varlena *featureCompress(struct varlena *value);
+extern struct varlena *featureDecompress(struct varlena *value);
+
+extern bool featureIsCompressed(struct varlena *value);
+extern void featureInitDecoder(FeatureDecoder *decoder, struct varlena *value);
+extern float8 featureDecoderNext(FeatureDecoder *decoder);
+
+extern int	feature_compression;
+
+#endif   /* ADAM_DATA_COMPRESSION_H */
@@ -17,6 +17,7 @@
 #ifndef ADAM_DATA_FEATURE_H
 #define ADAM_DATA_FEATURE_H
 
+#include "catalog/pg_type.h"
 #include "utils/array.h"
 
 /*
@@ -28,11 +29,49 @@ typedef struct feature {
 	ArrayType   data;      /* actual data */
 } feature;
 
+/*
+ * storage of quantized features (see feature_quantize): besides float8 and float4
+ * arrays, features may be stored as half precision floats (in an int2 array) or
+ * as int8 codes (in a "char" array followed by the scale and the offset used for
+ * quantizing, i.e. value = offset + scale * code); these are no types of pg_type,
+ * they only mark the typid of such features
+ */
+#define FEATURE_FLOAT16		(-16)
+#define FEATURE_INT8		(-8)
+
+typedef struct FeatureQuantization {
+	float8		scale;
+	float8		offset;
+} FeatureQuantization;
+
+#define FEATURE_QUANTIZATION(f) \
+	((FeatureQuantization *) (((char *) &(f)->data) + MAXALIGN(VARSIZE(&(f)->data))))
+
+/*
+ * reads the values of a feature in any storage without converting the feature;
+ * the distance functions use it to work on the compact storage directly
+ */
+typedef struct FeatureReader {
+	int32		storage;
+	char	   *data;
+	int			n;
+	float8		scale;
+	float8		offset;
+} FeatureReader;
+
+#define featureReaderGet(r, i) \
+	((r)->storage == FLOAT8OID ? ((float8 *) (r)->data)[i] : \
+	 (r)->storage == FLOAT4OID ? (float8) ((float4 *) (r)->data)[i] : \
+	 (r)->storage == FEATURE_FLOAT16 ? halfToFloat8(((uint16 *) (r)->data)[i]) : \
+	 (r)->offset + (r)->scale * ((int8 *) (r)->data)[i])
+
 /*
  * I/O functions
  */
 extern Datum feature_in(PG_FUNCTION_ARGS);
 extern Datum feature_out(PG_FUNCTION_ARGS);
+extern Datum feature_recv(PG_FUNCTION_ARGS);
+extern Datum feature_send(PG_FUNCTION_ARGS);
 extern Datum featureFromArray(FmgrInfo *fmgr, Datum d, Oid typioparam, int32 typmod);
 
 /*
@@ -47,6 +86,19 @@ extern Datum arrayFeatureCast(PG_FUNCTION_ARGS);
 extern char * getFeatureName(int32 typemod);
 
 
+/*
+ * quantization
+ */
+extern Datum feature_quantize(PG_FUNCTION_ARGS);
+extern Datum feature_quantize_scaled(PG_FUNCTION_ARGS);
+extern Datum feature_dequantize(PG_FUNCTION_ARGS);
+
+extern bool featureIsCompact(feature *f);
+extern void featureInitReader(FeatureReader *reader, feature *f);
+extern feature *featureToFloat8(feature *f);
+extern float8 halfToFloat8(uint16 h);
+extern uint16 float8ToHalf(float8 value);
+
 /*
  * operators
  */
@@ -60,6 +112,7 @@ extern Datum feature_le(PG_FUNCTION_ARGS);
 extern Datum feature_ge(PG_FUNCTION_ARGS);
 
 extern Datum feature_cmp(PG_FUNCTION_ARGS);
+extern Datum feature_sortsupport(PG_FUNCTION_ARGS);
 
 extern Datum feature_dummy_eq(PG_FUNCTION_ARGS);
 
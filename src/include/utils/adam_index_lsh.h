@@ -0,0 +1,65 @@
+/*
+ * ADAM - indexing functions
+ * name: adam_index_lsh
+ * description: functions for locality-sensitive hashing index
+ *
+ * src/include/utils/adam_index_lsh.h
+ *
+ *
+ *
+ *
+ *
+ * addendum: the structure of this code is based on the VA-file code
+ * (see adam_index_va.h)
+ *
+ */
+#ifndef ADAM_INDEX_LSH_H
+#define ADAM_INDEX_LSH_H
+
+#include "access/itup.h"
+#include "access/xlog.h"
+#include "fmgr.h"
+
+#define LSH_MAGICK_NUMBER	(0xDBAC15B0)
+
+/*
+ * hash families
+ */
+typedef enum LSHFamily
+{
+	LSH_FAMILY_COSINE = 1,		/* random hyperplanes (Charikar, 2002) */
+	LSH_FAMILY_HAMMING = 2		/* bit sampling (Indyk and Motwani, 1998), binary features only */
+} LSHFamily;
+
+#define LSH_DEFAULT_TABLES		8
+#define LSH_MAX_TABLES			32
+#define LSH_DEFAULT_BITS		16
+#define LSH_MAX_BITS			32
+#define LSH_DEFAULT_PROBES		2
+#define LSH_MAX_BUCKETS			8192
+
+/*
+*  pg_am functions
+*/
+extern Datum lshBuild(PG_FUNCTION_ARGS);
+extern Datum lshInsert(PG_FUNCTION_ARGS);
+extern Datum lshGetOptions(PG_FUNCTION_ARGS);
+extern Datum lshBeginScan(PG_FUNCTION_ARGS);
+extern Datum lshReScan(PG_FUNCTION_ARGS);
+extern Datum lshEndScan(PG_FUNCTION_ARGS);
+extern Datum lshMarkPos(PG_FUNCTION_ARGS);
+extern Datum lshRestorePos(PG_FUNCTION_ARGS);
+extern Datum lshBuildEmpty(PG_FUNCTION_ARGS);
+extern Datum lshGetBitmap(PG_FUNCTION_ARGS);
+extern Datum lshBulkDelete(PG_FUNCTION_ARGS);
+extern Datum lshVacuumCleanup(PG_FUNCTION_ARGS);
+extern Datum lshCostEstimate(PG_FUNCTION_ARGS);
+
+/*
+ * reloptions
+ */
+extern void lshValidateFamilyOption(char *value);
+
+extern bool enable_lshscan;
+
+#endif   /* ADAM_INDEX_LSH_H */
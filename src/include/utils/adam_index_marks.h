@@ -20,6 +20,7 @@
 #include "postgres.h"
 
 #include "utils/adam_data_feature.h"
+#include "utils/adam_index_projection.h"
 
 #include "nodes/execnodes.h"
 #include "utils/relcache.h"
@@ -31,11 +32,13 @@
 //the next  16 bits (most significant) denote the precision, i.e. the number of total digits in the number
 #define NUM_SCALE_PRECISION	    1048585
 #define MAX_MARKS				64
-#define SAMPLING_FREQUENCY		10000
 #define N_SAMPLES				10000
-#define MAX_PARTITIONS			MAX_MARKS - 1
+#define MIN_SAMPLES				256
+#define MAX_PARTITIONS			(MAX_MARKS - 1)
 
-extern Datum calculateMarks(Relation rel, IndexInfo *indexInfo);
+extern Datum calculateMarks(Relation heap, Relation index, IndexInfo *indexInfo, VAProjection projectionMethod, int components, ArrayType **projection);
+
+extern int	va_marks_sample_size;
 
 
 
@@ -0,0 +1,44 @@
+/*
+ * ADAM - index projection
+ * name: adam_index_projection
+ * description: projections reducing the dimensions of the VA approximations
+ *
+ * src/include/utils/adam_index_projection.h
+ *
+ *
+ *
+ *
+ */
+#ifndef ADAM_INDEX_PROJECTION_H
+#define ADAM_INDEX_PROJECTION_H
+
+#include "postgres.h"
+
+#include "utils/adam_data_feature.h"
+#include "utils/array.h"
+
+/*
+ * projection of the features before the VA approximation (vaprojection option);
+ * see adam_index_projection.c
+ */
+typedef enum VAProjection
+{
+	VA_PROJECTION_NONE,
+	VA_PROJECTION_PCA,
+	VA_PROJECTION_RANDOM
+} VAProjection;
+
+#define VA_DEFAULT_COMPONENTS		64
+#define VA_MAX_COMPONENTS			1024
+
+//at most this number of sampled rows is used for learning the projection
+#define VA_PROJECTION_SAMPLES		2000
+#define VA_PROJECTION_ITERATIONS	4
+
+extern void vaValidateProjectionOption(char *value);
+extern VAProjection vaGetProjectionMethod(const char *value);
+
+extern ArrayType *vaLearnProjection(float8 *sample, int n, int dimensions, VAProjection method, int components);
+extern feature *vaProjectFeature(ArrayType *projection, feature *f, bool negateResidual);
+
+#endif   /* ADAM_INDEX_PROJECTION_H */
@@ -24,11 +24,55 @@
 #include "access/itup.h"
 #include "access/xlog.h"
 #include "fmgr.h"
+#include "nodes/nodes.h"
+#include "nodes/tidbitmap.h"
+#include "utils/adam_data_feature.h"
+#include "utils/adam_retrieval_minkowski.h"
+#include "utils/relcache.h"
 
-#define VA_MAGICK_NUMBER	(0xDBAC0DED)
+#define VA_MAGICK_NUMBER	(0xDBAC0DEE)
 
 #define EPSILON	0.001
 
+/*
+ * strategies for distance queries combined with other WHERE clauses
+ *
+ * VA_FILTER_PRE: the VA file is skipped, the exact distances are calculated for all
+ *                tuples fulfilling the other WHERE clauses
+ * VA_FILTER_INDEX: the VA file is scanned, only considering the tuples fulfilling the
+ *                  other WHERE clauses (see bitmapMultiSearch)
+ * VA_FILTER_POST: the VA file is scanned for more than the requested number of neighbours,
+ *                 the other WHERE clauses are checked on the heap afterwards (see
+ *                 nodeBitmapHeapscan.c)
+ */
+typedef enum VAFilterStrategy
+{
+	VA_FILTER_PRE,
+	VA_FILTER_INDEX,
+	VA_FILTER_POST
+} VAFilterStrategy;
+
+/*
+ * counters of the searches of a VA file, shown by EXPLAIN ANALYZE (see explain.c);
+ * the first pass computes the bounds of the approximations, the second pass
+ * collects the candidates
+ */
+typedef struct VAScanInstrumentation
+{
+	double		nscans;				/* searches, e.g. one per loop or partition */
+	double		cachedScans;		/* searches reading the VA cache */
+	double		tuples;				/* approximations considered */
+	double		candidates;			/* approximations passing the lower bound filter */
+	double		boundComputations;	/* lower and upper bounds computed */
+	double		pages;				/* pages read in both passes */
+	double		kthUpperBound;		/* upper bound of the k-th neighbour of the last search */
+	double		pass1Time;			/* in ms */
+	double		pass2Time;			/* in ms */
+	double		approximateScans;	/* searches restricting the candidates */
+	double		recallSum;			/* sum of the estimated recall of these searches */
+	double		resultCacheHits;	/* searches answered by the VA result cache */
+} VAScanInstrumentation;
+
 /*
 *  pg_am functions
 */
@@ -47,10 +91,38 @@ extern Datum vaVacuumCleanup(PG_FUNCTION_ARGS);
 extern Datum vaCostEstimate(PG_FUNCTION_ARGS);
 extern Datum vaCanReturn(PG_FUNCTION_ARGS);
 
+extern Datum va_prewarm(PG_FUNCTION_ARGS);
+extern Datum va_imbalance(PG_FUNCTION_ARGS);
+extern Datum va_changes(PG_FUNCTION_ARGS);
+extern Datum va_build_time(PG_FUNCTION_ARGS);
+
 extern void vaRedo(XLogRecPtr lsn, XLogRecord *record);
 extern void vaDesc(StringInfo buf, uint8 xl_info, char *rec);
 
+extern VAFilterStrategy vaChooseFilterStrategy(double ntuples, BlockNumber pages, double nfiltered, double limit, bool filterKnown, Cost *cost);
+extern double vaPostFilterLimit(double limit, double selectivity, double ntuples);
+extern VAFilterStrategy vaChooseFilterStrategyForBitmap(Relation index, TIDBitmap *filter, int limit);
+
+/*
+ * order of the tuples of a table clustered on a VA file (see vaBeginCluster)
+ */
+typedef struct VAClusterState VAClusterState;
+
+extern VAClusterState *vaBeginCluster(Relation heap, Relation index, TransactionId OldestXmin);
+extern bool vaClusterNext(VAClusterState *cstate, ItemPointer heapPtr);
+extern void vaEndCluster(VAClusterState *cstate);
+
+extern TIDBitmap *vaJoinCandidates(Relation index, feature **queries, int nqueries, int k, float8 epsilon, MinkowskiNorm norm);
+extern Cost vaJoinCost(double ntuples, BlockNumber pages, double nqueries, int k, double *ncandidates);
+
+extern uint32 vaGetChanges(Relation index);
+extern int vaGetMarksStrategy(Relation index);
+extern bool vaSupportsNorm(Relation index, MinkowskiNorm norm);
+extern double vaCellImbalance(Relation index);
+
 extern bool enable_vascan;
+extern double va_recall_target;
+extern int va_max_candidates;
 
 #endif   /* ADAM_INDEX_HASH_H */
 
@@ -0,0 +1,36 @@
+/*
+ * ADAM - indexing functions
+ * name: adam_index_va_cache
+ * description: shared memory cache for the approximations of VA files
+ *
+ * src/include/utils/adam_index_va_cache.h
+ *
+ *
+ *
+ *
+ */
+#ifndef ADAM_INDEX_VA_CACHE_H
+#define ADAM_INDEX_VA_CACHE_H
+
+#include "utils/relcache.h"
+
+/* maximum number of VA files held in the cache at the same time */
+#define VA_CACHE_MAX_ENTRIES	128
+
+typedef struct VACacheEntry VACacheEntry;
+
+extern Size VACacheShmemSize(void);
+extern void VACacheShmemInit(void);
+
+extern bool vaCacheEnabled(void);
+extern VACacheEntry *vaCacheLookup(Relation index, uint32 nChanges);
+extern VACacheEntry *vaCacheReserve(Relation index, uint32 nChanges, Size len);
+extern void vaCacheFinish(VACacheEntry *entry);
+extern void vaCacheRelease(VACacheEntry *entry);
+extern char *vaCacheData(VACacheEntry *entry);
+extern Size vaCacheLength(VACacheEntry *entry);
+
+extern int	va_cache_size;
+extern bool va_cache_autoload;
+
+#endif   /* ADAM_INDEX_VA_CACHE_H */
@@ -0,0 +1,31 @@
+/*
+ * ADAM - indexing functions
+ * name: adam_index_va_results
+ * description: shared memory cache for the results of VA index searches
+ *
+ * src/include/utils/adam_index_va_results.h
+ *
+ *
+ *
+ *
+ */
+#ifndef ADAM_INDEX_VA_RESULTS_H
+#define ADAM_INDEX_VA_RESULTS_H
+
+#include "access/relscan.h"
+#include "nodes/parsenodes.h"
+#include "nodes/tidbitmap.h"
+
+/* maximum number of candidates stored per search */
+#define VA_RESULT_CACHE_MAX_TIDS	1024
+
+extern Size VAResultCacheShmemSize(void);
+extern void VAResultCacheShmemInit(void);
+
+extern bool vaResultCacheEnabled(void);
+extern bool vaResultCacheLookup(IndexScanDesc scan, int numResults, AdamScanClause *adamOptions, uint32 nChanges, TIDBitmap *tbm, int64 *ntids);
+extern void vaResultCacheStore(IndexScanDesc scan, int numResults, AdamScanClause *adamOptions, uint32 nChanges, ItemPointer tids, int ntids);
+
+extern int	va_result_cache_size;
+
+#endif   /* ADAM_INDEX_VA_RESULTS_H */
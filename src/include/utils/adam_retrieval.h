@@ -19,6 +19,7 @@
 
 #include "commands/adam_data_featurefunctioncmds.h"
 #include "utils/adam_retrieval_minkowski.h"
+#include "utils/adam_retrieval_similarity.h"
 
 #include "nodes/pg_list.h"
 #include "nodes/parsenodes.h"
@@ -38,7 +39,7 @@ extern Node* adjustParseTreeForFeatureSearch(ParseState *pstate, AdamSelectStmt
 /*
  * specialized functions for feature functions
  */
-extern Oid getDistanceProcId(AdamFunctionOptionsStmt *distanceOp, FieldSelect *ltree, FeatureFunctionOpt **distanceOptions, MinkowskiNorm* nn_minkowski);
+extern Oid getDistanceProcId(AdamFunctionOptionsStmt *distanceOp, FieldSelect *ltree, FeatureFunctionOpt **distanceOptions, MinkowskiNorm* nn_minkowski, AdamDistanceType *nn_distance);
 
 /*
  * utilities
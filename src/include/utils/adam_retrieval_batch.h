@@ -0,0 +1,28 @@
+/*
+ * ADAM - batch distance functions
+ * name: adam_retrieval_batch
+ * description: functions for calling distance functions with batches of candidates
+ *
+ * src/include/utils/adam_retrieval_batch.h
+ *
+ *
+ *
+ *
+ */
+#ifndef ADAM_RETRIEVAL_BATCH_H
+#define ADAM_RETRIEVAL_BATCH_H
+
+#include "fmgr.h"
+
+/* number of candidates passed to a batch distance function at once */
+#define ADAM_BATCH_DISTANCE_SIZE	256
+
+extern Datum calculateBatchDistance(PG_FUNCTION_ARGS);
+
+extern bool isBatchDistanceProc(Oid procid);
+extern void callBatchDistance(FmgrInfo *flinfo, Oid collation, Datum query, bool queryNull,
+			Datum *candidates, bool *candidateNulls, int n,
+			Datum *extras, bool *extraNulls, int nextras,
+			float8 *results, bool *resultNulls);
+
+#endif   /* ADAM_RETRIEVAL_BATCH_H */
@@ -0,0 +1,32 @@
+/*
+ * ADAM - bag-of-visual-words retrieval
+ * name: adam_retrieval_bow
+ * description: codebooks of visual words, quantization of sets of features and
+ * tf-idf ranking of objects described by sets of features
+ *
+ * src/include/utils/adam_retrieval_bow.h
+ *
+ *
+ *
+ *
+ */
+#ifndef ADAM_RETRIEVAL_BOW_H
+#define ADAM_RETRIEVAL_BOW_H
+
+#include "fmgr.h"
+
+/* number of objects sampled for training a codebook */
+#define BOW_SAMPLE_OBJECTS		30000
+
+/* maximum number of iterations of k-means when training a codebook */
+#define BOW_KMEANS_ITERATIONS	25
+
+extern Datum feature_codebook_train(PG_FUNCTION_ARGS);
+extern Datum feature_codebook_drop(PG_FUNCTION_ARGS);
+extern Datum feature_visual_words(PG_FUNCTION_ARGS);
+extern Datum feature_bow_rank(PG_FUNCTION_ARGS);
+
+extern void removeCodebookById(Oid codebookOid);
+extern char *getCodebookName(Oid codebookOid);
+
+#endif   /* ADAM_RETRIEVAL_BOW_H */
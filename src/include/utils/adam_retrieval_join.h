@@ -0,0 +1,50 @@
+/*
+ * ADAM - similarity joins
+ * name: adam_retrieval_join
+ * description: kNN-join and epsilon-join between two tables with feature columns
+ *
+ * src/include/utils/adam_retrieval_join.h
+ *
+ *
+ *
+ *
+ */
+#ifndef ADAM_RETRIEVAL_JOIN_H
+#define ADAM_RETRIEVAL_JOIN_H
+
+#include "access/htup.h"
+#include "fmgr.h"
+#include "nodes/tidbitmap.h"
+#include "utils/adam_retrieval_minkowski.h"
+#include "utils/relcache.h"
+#include "utils/snapshot.h"
+
+/* size of the tiles of inner vectors compared with the outer vectors (in bytes) */
+#define ADAM_JOIN_TILE_SIZE		(256 * 1024)
+
+/*
+ * cost of comparing an outer with an inner vector (in cpu_operator_cost), as
+ * that of an exact distance in the VA file (VA_DISTANCE_COST)
+ */
+#define ADAM_JOIN_PAIR_COST		50
+
+typedef enum JoinNorm {
+	JOIN_NORM_L1,
+	JOIN_NORM_L2,
+	JOIN_NORM_LN,
+	JOIN_NORM_LMAX
+} JoinNorm;
+
+extern Datum feature_knn_join(PG_FUNCTION_ARGS);
+extern Datum feature_epsilon_join(PG_FUNCTION_ARGS);
+
+/* called for every visible candidate by scanJoinCandidates */
+typedef void (*JoinCandidateCallback) (HeapTuple tuple, void *arg);
+
+extern float8 joinDistance(const float8 *x, const float8 *y, int dimensions, JoinNorm joinNorm, MinkowskiNorm norm, float8 bound);
+
+extern void scanJoinCandidates(Relation rel, Snapshot snapshot, TIDBitmap *tbm, JoinCandidateCallback callback, void *arg);
+
+extern bool enable_similarityjoin;
+
+#endif   /* ADAM_RETRIEVAL_JOIN_H */
@@ -0,0 +1,43 @@
+/*
+ * ADAM - similarity distance functions
+ * name: adam_retrieval_similarity
+ * description: functions for calculating the cosine, inner product and hamming distances
+ *
+ * src/include/utils/adam_retrieval_similarity.h
+ *
+ *
+ *
+ *
+ */
+#ifndef ADAM_RETRIEVAL_SIMILARITY_H
+#define ADAM_RETRIEVAL_SIMILARITY_H
+
+#include "fmgr.h"
+
+/*
+ * kind of distance used in a nearest neighbour query; the indexes
+ * use this to choose the bounds they have to compute
+ */
+typedef enum AdamDistanceType
+{
+	ADAM_DISTANCE_UNKNOWN = 0,		/* user-defined distance, no bounds known */
+	ADAM_DISTANCE_MINKOWSKI,
+	ADAM_DISTANCE_COSINE,
+	ADAM_DISTANCE_INNER_PRODUCT,
+	ADAM_DISTANCE_HAMMING
+} AdamDistanceType;
+
+extern Datum calculateCosine(PG_FUNCTION_ARGS);
+extern Datum calculateInnerProduct(PG_FUNCTION_ARGS);
+extern Datum calculateHamming(PG_FUNCTION_ARGS);
+
+extern AdamDistanceType getSimilarityDistanceFromName(const char *name, Oid *procId);
+
+/*
+ * kernels working on plain float8 arrays
+ */
+extern float8 similarityDotProduct(const float8 *x, const float8 *y, int n);
+extern float8 similaritySquaredNorm(const float8 *x, int n);
+extern int similarityHammingCount(const float8 *x, const float8 *y, int n);
+
+#endif   /* ADAM_RETRIEVAL_SIMILARITY_H */
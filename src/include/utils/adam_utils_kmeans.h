@@ -0,0 +1,20 @@
+/* 
+ * ADAM - k-means
+ * name: adam_utils_kmeans
+ * description: k-means clustering of float8 vectors
+ *
+ * src/include/utils/adam_utils_kmeans.h
+ *
+ * 
+ * 
+ *
+ */
+#ifndef ADAM_UTILS_KMEANS_H
+#define ADAM_UTILS_KMEANS_H
+
+#include "postgres.h"
+
+extern int kmeansCluster(const float8 *vectors, int n, int dimensions, int k, int maxIterations, float8 *centroids);
+extern int kmeansNearest(const float8 *centroids, int k, int dimensions, const float8 *vector, float8 *distance);
+
+#endif   /* ADAM_UTILS_KMEANS_H */
@@ -1133,6 +1133,11 @@ extern Datum spg_kd_config(PG_FUNCTION_ARGS);
 extern Datum spg_kd_choose(PG_FUNCTION_ARGS);
 extern Datum spg_kd_picksplit(PG_FUNCTION_ARGS);
 extern Datum spg_kd_inner_consistent(PG_FUNCTION_ARGS);
+extern Datum spg_feature_kd_config(PG_FUNCTION_ARGS);
+extern Datum spg_feature_kd_choose(PG_FUNCTION_ARGS);
+extern Datum spg_feature_kd_picksplit(PG_FUNCTION_ARGS);
+extern Datum spg_feature_kd_inner_consistent(PG_FUNCTION_ARGS);
+extern Datum spg_feature_kd_leaf_consistent(PG_FUNCTION_ARGS);
 
 /* access/spgist/spgtextproc.c */
 extern Datum spg_text_config(PG_FUNCTION_ARGS);
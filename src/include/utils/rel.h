@@ -154,6 +154,7 @@ typedef struct RelationData
 	void	   *rd_amcache;		/* available for use by index AM */
 	Oid		   *rd_indcollation;	/* OIDs of index collations */
 	ArrayType  *rd_marks;		/* ADAM */
+	ArrayType  *rd_projection;	/* ADAM */
 
 	/*
 	 * foreign-table support
@@ -0,0 +1,29 @@
+--
+-- ADAM: distances in batch form
+--
+CREATE DISTANCE l2_batch(FEATURE, FEATURE[]) RETURNS double precision[] AS $$
+    SELECT ARRAY(SELECT "calculateMinkowski"($1, $2[i], 2) FROM generate_subscripts($2, 1) i ORDER BY i)
+$$ LANGUAGE sql IMMUTABLE STRICT;
+CREATE TABLE batch_features (id int4, f feature);
+INSERT INTO batch_features
+    SELECT i, ('<' || i % 30 || ',' || i / 30 || '>')::feature
+    FROM generate_series(0, 899) i;
+-- the scan passes the candidates in batches
+SELECT id FROM batch_features
+    USING DISTANCE l2_batch(f, '<7.25,12.375>') ORDER USING DISTANCE LIMIT 4;
+-- tuples filtered by other clauses are not passed
+SELECT id FROM batch_features WHERE id % 2 = 1
+    USING DISTANCE l2_batch(f, '<7.25,12.375>') ORDER USING DISTANCE LIMIT 4;
+-- the query vector is passed first, whatever the order written
+CREATE DISTANCE query_first(FEATURE, FEATURE[]) RETURNS double precision[] AS $$
+    SELECT array_fill("calculateMinkowski"($1, '<0,0>', 1), ARRAY[array_length($2, 1)])
+$$ LANGUAGE sql IMMUTABLE STRICT;
+SELECT id FROM batch_features WHERE id < 3
+    USING DISTANCE query_first(f, '<100,0>') ORDER USING DISTANCE LIMIT 1;
+SELECT id FROM batch_features WHERE id < 3
+    USING DISTANCE query_first('<100,0>', f) ORDER USING DISTANCE LIMIT 1;
+DROP TABLE batch_features;
+-- features and feature arrays have a binary representation
+SELECT feature_send('<1.5,-2>');
+SELECT feature_send(feature_quantize('<1.5,-2>', 'int8', 0.5, 0)) = feature_send('<1.5,-2>') AS decoded;
+SELECT array_send('{"<1.5,-2>","<3>"}'::feature[]);
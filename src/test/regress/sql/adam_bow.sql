@@ -0,0 +1,47 @@
+--
+-- ADAM: codebooks of visual words and tf-idf ranking
+--
+CREATE TABLE bow_objects (id int4, descriptors feature[], words int4[]);
+INSERT INTO bow_objects (id, descriptors) VALUES
+    (1, ARRAY['<0,0>', '<0.5,0>', '<100,100>']::feature[]),
+    (2, ARRAY['<0,0.5>']::feature[]),
+    (3, ARRAY['<100,100.5>']::feature[]),
+    (4, ARRAY['<0.25,0.25>', '<0.5,0.5>']::feature[]),
+    (5, NULL);
+SELECT feature_codebook_train('bow_cb', 'bow_objects', 'descriptors', 0);
+SELECT feature_codebook_train('bow_cb', 'bow_objects', 'nosuch', 2);
+SELECT feature_codebook_train('bow_cb', 'bow_objects', 'id', 2);
+SELECT feature_codebook_train('bow_cb', 'bow_objects', 'descriptors', 100);
+-- two visual words, one around <0,0> and one around <100,100>
+SELECT feature_codebook_train('bow_cb', 'bow_objects', 'descriptors', 2) IS NOT NULL AS trained;
+SELECT feature_codebook_train('bow_cb', 'bow_objects', 'descriptors', 2);
+SELECT cbdimensions, cbwords, cbdocuments,
+       (SELECT array_agg(c ORDER BY c) FROM unnest(cbcentroids) c) AS centroids,
+       (SELECT array_agg(n ORDER BY n) FROM unnest(cbfrequencies) n) AS frequencies
+    FROM adam_codebook WHERE cbname = 'bow_cb';
+SELECT id, array_length(words, 1) AS length, words[1] = words[array_length(words, 1)] AS single
+    FROM (SELECT id, feature_visual_words('bow_cb', descriptors) AS words FROM bow_objects) s
+    ORDER BY id;
+UPDATE bow_objects SET words = feature_visual_words('bow_cb', descriptors);
+CREATE INDEX bow_objects_words ON bow_objects USING gin (words);
+SELECT a.words[1] = b.words[1] AS same_word, a.words[1] = c.words[1] AS other_word
+    FROM bow_objects a, bow_objects b, bow_objects c
+    WHERE a.id = 2 AND b.id = 4 AND c.id = 3;
+-- the objects sharing a visual word with the query, ranked by tf-idf
+SET enable_seqscan = off;
+SELECT id, round(feature_bow_rank('bow_cb', words, q)::numeric, 6) AS score
+    FROM bow_objects, feature_visual_words('bow_cb', ARRAY['<0.125,0.125>']::feature[]) q
+    WHERE words && q ORDER BY score DESC, id;
+RESET enable_seqscan;
+SELECT round(feature_bow_rank('bow_cb', a.words, b.words)::numeric, 6) AS disjoint
+    FROM bow_objects a, bow_objects b WHERE a.id = 2 AND b.id = 3;
+SELECT feature_bow_rank('bow_cb', '{3}', '{1}');
+SELECT feature_visual_words('bow_cb', ARRAY['<1,2,3>']::feature[]);
+SELECT feature_codebook_drop('bow_cb');
+SELECT feature_visual_words('bow_cb', ARRAY['<0,0>']::feature[]);
+SELECT feature_codebook_drop('bow_cb');
+-- a codebook is dropped with its column
+SELECT feature_codebook_train('bow_cb', 'bow_objects', 'descriptors', 1) IS NOT NULL AS trained;
+ALTER TABLE bow_objects DROP COLUMN descriptors;
+SELECT count(*) FROM adam_codebook WHERE cbname = 'bow_cb';
+DROP TABLE bow_objects;
@@ -0,0 +1,28 @@
+--
+-- ADAM: compression of TOASTed features
+--
+SHOW feature_compression;
+SET feature_compression = 'zstd';
+CREATE TABLE adam_compression (method text, f feature);
+CREATE FUNCTION adam_compression_feature(scale float8) RETURNS feature LANGUAGE sql AS $$
+    SELECT ('<' || string_agg((i * scale)::text, ',' ORDER BY i) || '>')::feature
+    FROM generate_series(1, 1000) i
+$$;
+SET feature_compression = 'float';
+INSERT INTO adam_compression VALUES ('float', adam_compression_feature(0.25));
+INSERT INTO adam_compression VALUES ('float float4', feature_quantize(adam_compression_feature(0.25), 'float4'));
+SET feature_compression = 'pglz';
+INSERT INTO adam_compression VALUES ('pglz', adam_compression_feature(0.25));
+INSERT INTO adam_compression VALUES ('pglz float4', feature_quantize(adam_compression_feature(0.25), 'float4'));
+SET feature_compression = 'none';
+INSERT INTO adam_compression VALUES ('none', adam_compression_feature(0.25));
+INSERT INTO adam_compression VALUES ('none float4', feature_quantize(adam_compression_feature(0.25), 'float4'));
+RESET feature_compression;
+SELECT method, f = adam_compression_feature(0.25) AS equal,
+       "calculateMinkowski"(f, adam_compression_feature(0), 2) AS l2,
+       "calculateMinkowski"(adam_compression_feature(0.5), f, 1) AS l1
+    FROM adam_compression ORDER BY method;
+SELECT method, pg_column_size(f) < 4000 AS compressed
+    FROM adam_compression WHERE method IN ('float', 'none') ORDER BY method;
+DROP FUNCTION adam_compression_feature(float8);
+DROP TABLE adam_compression;
@@ -0,0 +1,29 @@
+--
+-- ADAM: comparing, sorting and hashing features
+--
+SELECT '<-0,1>'::feature = '<0,1>' AS zero,
+       '<NaN,1>'::feature = '<nan,1>' AS nan,
+       '<1,2>'::feature < '<1,2,3>' AS prefix,
+       '<1,2,3>'::feature < '<2>' AS first,
+       '<1e300,1>'::feature < '<NaN,0>' AS nan_last,
+       '<1,2>'::feature < '<1,NULL>' AS null_last;
+CREATE TABLE feature_order (id int4, f feature);
+INSERT INTO feature_order VALUES (1, '<1,2>'), (2, '<1,2,3>'), (3, '<-0,1>'), (4, '<0,1>'),
+    (5, '<NaN,1>'), (6, '<nan,1>'), (7, '<1,NULL>'), (8, '<-1,5>'), (9, '<2>');
+SELECT id, f FROM feature_order ORDER BY f, id;
+SET enable_hashagg = off;
+SELECT min(id), count(*) FROM feature_order GROUP BY f ORDER BY 1;
+RESET enable_hashagg;
+SET enable_sort = off;
+SELECT min(id), count(*) FROM feature_order GROUP BY f ORDER BY 1;
+RESET enable_sort;
+CREATE INDEX feature_order_btree ON feature_order (f);
+SET enable_seqscan = off;
+SELECT id FROM feature_order WHERE f = '<0,1>' ORDER BY id;
+SELECT id FROM feature_order WHERE f > '<1,2>' AND f < '<NaN>' ORDER BY id;
+DROP INDEX feature_order_btree;
+CREATE INDEX feature_order_hash ON feature_order USING hash (f);
+SELECT id FROM feature_order WHERE f = '<-0,1>' ORDER BY id;
+SELECT id FROM feature_order WHERE f = '<NaN,1>' ORDER BY id;
+RESET enable_seqscan;
+DROP TABLE feature_order;
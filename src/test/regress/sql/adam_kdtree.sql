@@ -0,0 +1,28 @@
+--
+-- ADAM: SP-GiST k-d tree over features (kd_feature_ops)
+--
+CREATE TABLE kd_features (id int4, f feature);
+INSERT INTO kd_features
+    SELECT i, ('<' || i % 40 || ',' || i / 40 || '>')::feature
+    FROM generate_series(0, 999) i;
+-- sequential search
+SELECT id FROM kd_features
+    USING DISTANCE MINKOWSKI(2)(f, '<10.25,20.375>') ORDER USING DISTANCE LIMIT 4;
+CREATE INDEX kd_features_f ON kd_features USING spgist (f kd_feature_ops);
+SET enable_seqscan = off;
+-- the nearest neighbour search walks the tree best-first
+SELECT id FROM kd_features
+    USING DISTANCE MINKOWSKI(2)(f, '<10.25,20.375>') ORDER USING DISTANCE LIMIT 4;
+SELECT id FROM kd_features WHERE f = '<3,4>';
+-- the tree does not bound weighted distances, the candidates are refined
+SELECT id FROM kd_features
+    USING DISTANCE MINKOWSKI(2, '{1,3}')(f, '<10.25,20.375>') ORDER USING DISTANCE LIMIT 4;
+-- the query must have as many dimensions as the indexed features
+SELECT id FROM kd_features
+    USING DISTANCE MINKOWSKI(2)(f, '<10.25,20.375,1>') ORDER USING DISTANCE LIMIT 4;
+-- inserted features are found
+INSERT INTO kd_features VALUES (1000, '<10.25,20.5>');
+SELECT id FROM kd_features
+    USING DISTANCE MINKOWSKI(2)(f, '<10.25,20.375>') ORDER USING DISTANCE LIMIT 4;
+RESET enable_seqscan;
+DROP TABLE kd_features;
@@ -0,0 +1,43 @@
+--
+-- ADAM: LSH index access method
+--
+CREATE TABLE lsh_bits (id int4, f feature);
+INSERT INTO lsh_bits
+    SELECT i, ('<' || array_to_string(ARRAY(SELECT (i >> b) & 1 FROM generate_series(0, 7) b), ',') || '>')::feature
+    FROM generate_series(0, 254) i;
+CREATE INDEX lsh_bits_f ON lsh_bits USING lsh (f) WITH (lshfamily = 'euclidean');
+CREATE INDEX lsh_bits_f ON lsh_bits USING lsh (f) WITH (lshfamily = 'hamming', lshtables = 4, lshbits = 4);
+SET enable_seqscan = off;
+-- a feature is always found in its own buckets
+SELECT id FROM lsh_bits
+    USING DISTANCE hamming(f, '<1,0,1,1,0,0,1,0>') ORDER USING DISTANCE LIMIT 1;
+-- bit sampling only hashes binary features
+INSERT INTO lsh_bits VALUES (255, '<1,0,2,0,0,0,0,0>');
+INSERT INTO lsh_bits VALUES (255, '<1,1,1,1,1,1,1,1>');
+SELECT id FROM lsh_bits
+    USING DISTANCE hamming(f, '<1,1,1,1,1,1,1,1>') ORDER USING DISTANCE LIMIT 1;
+RESET enable_seqscan;
+DROP TABLE lsh_bits;
+-- random hyperplanes do not bound Minkowski distances, so the index is not used
+CREATE TABLE lsh_vectors (id int4, f feature);
+INSERT INTO lsh_vectors
+    SELECT i, ('<' || i % 20 + 1 || ',' || i / 20 + 1 || '>')::feature
+    FROM generate_series(0, 399) i;
+CREATE INDEX lsh_vectors_f ON lsh_vectors USING lsh (f) WITH (lshfamily = 'cosine');
+SET enable_seqscan = off;
+SELECT id FROM lsh_vectors
+    USING DISTANCE MINKOWSKI(2)(f, '<3.25,4.375>') ORDER USING DISTANCE LIMIT 3;
+RESET enable_seqscan;
+DROP TABLE lsh_vectors;
+-- the index of an unlogged table starts from an empty index (a feature is
+-- always found in its own buckets)
+CREATE UNLOGGED TABLE lsh_unlogged (id int4, f feature);
+CREATE INDEX lsh_unlogged_f ON lsh_unlogged USING lsh (f) WITH (lshfamily = 'hamming', lshtables = 2, lshbits = 2);
+INSERT INTO lsh_unlogged VALUES (1, '<1,0,1,1>'), (2, '<0,0,0,1>');
+SET enable_seqscan = off;
+EXPLAIN (COSTS OFF) SELECT id FROM lsh_unlogged
+    USING DISTANCE hamming(f, '<1,0,1,1>') ORDER USING DISTANCE LIMIT 1;
+SELECT id FROM lsh_unlogged
+    USING DISTANCE hamming(f, '<1,0,1,1>') ORDER USING DISTANCE LIMIT 1;
+RESET enable_seqscan;
+DROP TABLE lsh_unlogged;
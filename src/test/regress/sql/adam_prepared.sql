@@ -0,0 +1,44 @@
+--
+-- ADAM: query vectors given as parameters
+--
+CREATE TABLE adam_prepared (id int4, f feature);
+INSERT INTO adam_prepared
+    SELECT i, ('<' || i % 20 || ',' || i / 20 || '>')::feature
+    FROM generate_series(0, 399) i;
+CREATE VA adam_prepared_f ON adam_prepared (f) USING EQUIFREQUENT MARKS;
+ANALYZE adam_prepared;
+SET enable_seqscan = off;
+PREPARE adam_knn(feature) AS
+    SELECT id FROM adam_prepared
+    USING DISTANCE MINKOWSKI(2)(f, $1) ORDER USING DISTANCE LIMIT 3;
+-- more executions than needed for switching to a generic plan
+EXECUTE adam_knn('<3.25,4.375>');
+EXECUTE adam_knn('<17.75,0.125>');
+EXECUTE adam_knn('<9.375,12.25>');
+EXECUTE adam_knn('<0.125,19.75>');
+EXECUTE adam_knn('<11.625,6.25>');
+EXECUTE adam_knn('<5.25,5.375>');
+EXECUTE adam_knn('<3.25,4.375>');
+DEALLOCATE adam_knn;
+-- the query vector may precede the column
+PREPARE adam_knn(feature) AS
+    SELECT id FROM adam_prepared
+    USING DISTANCE MINKOWSKI(1)($1, f) ORDER USING DISTANCE LIMIT 2;
+EXECUTE adam_knn('<3.25,4.375>');
+EXECUTE adam_knn('<17.75,0.125>');
+DEALLOCATE adam_knn;
+CREATE FUNCTION adam_prepared_nearest(q feature) RETURNS int4 LANGUAGE plpgsql AS $$
+DECLARE
+    dist float8;
+    result int4;
+BEGIN
+    SELECT id INTO dist, result FROM adam_prepared
+        USING DISTANCE MINKOWSKI(2)(f, q) ORDER USING DISTANCE LIMIT 1;
+    RETURN result;
+END
+$$;
+SELECT x, y, adam_prepared_nearest(('<' || x || ',' || y || '>')::feature)
+    FROM (VALUES (3.25, 4.375), (17.75, 0.125), (9.375, 12.25)) v(x, y);
+DROP FUNCTION adam_prepared_nearest(feature);
+RESET enable_seqscan;
+DROP TABLE adam_prepared;
@@ -0,0 +1,45 @@
+--
+-- ADAM: quantized feature storage
+--
+SELECT feature_quantize('<1.5,-2.25,3>', 'float4');
+SELECT feature_quantize('<1.5,-2.25,0.333333333333333,70000>', 'float16');
+SELECT feature_quantize('<1,2.5,3.2,1000,-1000>', 'int8', 0.5, 1);
+SELECT feature_dequantize(feature_quantize('<1,2.5,3.2>', 'int8', 0.5, 1));
+SELECT feature_quantize('<1.5,-2.25>', 'float8');
+SELECT feature_quantize('<1,2>', 'int8');
+SELECT feature_quantize('<1,2>', 'int8', 0, 1);
+SELECT feature_quantize('<1,2>', 'int4');
+SELECT feature_quantize('<1,NULL>', 'float4');
+-- quantized features are cast to arrays of their values
+SELECT feature_quantize('<1.5,-2.25>', 'float16')::numeric[] AS float16,
+       feature_quantize('<1,2.5,3.2>', 'int8', 0.5, 1)::numeric[] AS int8;
+-- features are compared by their values, not by their storage
+SELECT feature_quantize('<1.5,-2.25>', 'float4') = '<1.5,-2.25>' AS float4,
+       feature_quantize('<1.5,-2.25>', 'float16') = '<1.5,-2.25>' AS float16,
+       feature_quantize('<1,2>', 'int8', 0.5, 0) = feature_quantize('<1,2>', 'int8', 0.25, 1) AS int8,
+       feature_quantize('<1,2>', 'int8', 1, 0) < '<1,3>' AS lt;
+CREATE TABLE quantization (f feature);
+INSERT INTO quantization VALUES ('<1,2>'), (feature_quantize('<1,2>', 'float4')),
+    (feature_quantize('<1,2>', 'float16')), (feature_quantize('<1,2>', 'int8', 0.5, 0)),
+    ('<2,1>'), (feature_quantize('<2,1>', 'float16'));
+SET enable_hashagg = off;
+SELECT f, count(*) FROM quantization GROUP BY f ORDER BY f;
+RESET enable_hashagg;
+SET enable_sort = off;
+SELECT count(*) FROM (SELECT f FROM quantization GROUP BY f) s;
+RESET enable_sort;
+DROP TABLE quantization;
+-- distances are computed on the quantized values
+SELECT "calculateMinkowski"(feature_quantize('<1,2>', 'int8', 0.5, 0), '<4,6>', 2) AS int8,
+       "calculateMinkowski"(feature_quantize('<1,2>', 'float16'), feature_quantize('<4,6>', 'float4'), 1) AS float16;
+CREATE TABLE quantization (id int4, f feature);
+INSERT INTO quantization
+    SELECT i, ('<' || i % 20 || ',' || i / 20 || '>')::feature
+    FROM generate_series(0, 399) i;
+ALTER TABLE quantization ALTER COLUMN f TYPE feature USING feature_quantize(f, 'int8', 1, 0);
+SELECT id FROM quantization
+    USING DISTANCE MINKOWSKI(2)(f, '<7.25,11.375>') ORDER USING DISTANCE LIMIT 4;
+ALTER TABLE quantization ALTER COLUMN f TYPE feature USING feature_quantize(f, 'float16');
+SELECT id FROM quantization
+    USING DISTANCE MINKOWSKI(2)(f, '<7.25,11.375>') ORDER USING DISTANCE LIMIT 4;
+DROP TABLE quantization;
@@ -0,0 +1,23 @@
+--
+-- ADAM: cosine, inner product and Hamming distances
+--
+SELECT "calculateCosine"('<3,4>', '<4,3>') AS a, "calculateCosine"('<3,4>', '<6,8>') AS b,
+       "calculateCosine"('<3,4>', '<-3,-4>') AS c, "calculateCosine"('<0,0>', '<1,2>') AS d;
+SELECT "calculateInnerProduct"('<1,2,3>', '<4,5,6>') AS ip, "calculateHamming"('<1,0,1,1>', '<1,1,1,0>') AS hamming;
+CREATE TABLE sim_features (id int4, f feature);
+INSERT INTO sim_features
+    SELECT i, ('<' || i % 20 + 1 || ',' || i / 20 + 1 || '>')::feature
+    FROM generate_series(0, 399) i;
+SELECT id FROM sim_features
+    USING DISTANCE cosine(f, '<1,0>') ORDER USING DISTANCE LIMIT 3;
+SELECT id FROM sim_features
+    USING DISTANCE innerproduct(f, '<1,0.0625>') ORDER USING DISTANCE LIMIT 3;
+-- the VA file bounds the similarity distances
+CREATE VA sim_features_va ON sim_features (f) USING EQUIFREQUENT MARKS;
+SET enable_seqscan = off;
+SELECT id FROM sim_features
+    USING DISTANCE cosine(f, '<1,0>') ORDER USING DISTANCE LIMIT 3;
+SELECT id FROM sim_features
+    USING DISTANCE innerproduct(f, '<1,0.0625>') ORDER USING DISTANCE LIMIT 3;
+RESET enable_seqscan;
+DROP TABLE sim_features;
@@ -0,0 +1,74 @@
+--
+-- ADAM: kNN-joins and epsilon-joins
+--
+CREATE TABLE join_outer (id int4, f feature);
+INSERT INTO join_outer VALUES (1, '<3.25,4.375>'), (2, '<17.75,0.125>'), (3, '<9.375,12.25>'), (4, NULL);
+CREATE TABLE join_inner (id int4, f feature);
+INSERT INTO join_inner
+    SELECT i, ('<' || i % 20 || ',' || i / 20 || '>')::feature
+    FROM generate_series(0, 399) i;
+ANALYZE join_outer;
+ANALYZE join_inner;
+SELECT * FROM feature_knn_join('join_outer', 'id', 'f', 'join_inner', 'id', 'f', 3, 2)
+    AS j(outer_id int4, inner_id int4, dist float8) ORDER BY outer_id, dist;
+SELECT * FROM feature_knn_join('join_outer', 'id', 'f', 'join_inner', 'id', 'f', 3, 1)
+    AS j(outer_id int4, inner_id int4, dist float8) ORDER BY outer_id, dist;
+SELECT * FROM feature_epsilon_join('join_outer', 'id', 'f', 'join_inner', 'id', 'f', 1, 2)
+    AS j(outer_id int4, inner_id int4, dist float8) ORDER BY outer_id, dist;
+SELECT * FROM feature_epsilon_join('join_outer', 'id', 'f', 'join_inner', 'id', 'f', 0.75, 1)
+    AS j(outer_id int4, inner_id int4, dist float8) ORDER BY outer_id, dist;
+-- a LATERAL kNN subquery is joined by a similarity join
+SET enable_nestloop = off;
+EXPLAIN (COSTS OFF)
+SELECT o.id, s.* FROM join_outer o,
+    LATERAL (SELECT id FROM join_inner USING DISTANCE MINKOWSKI(2)(f, o.f) ORDER USING DISTANCE LIMIT 3) s;
+SELECT o.id, s.* FROM join_outer o,
+    LATERAL (SELECT id FROM join_inner USING DISTANCE MINKOWSKI(2)(f, o.f) ORDER USING DISTANCE LIMIT 3) s
+    ORDER BY o.id, d, s.id;
+SELECT o.id, s.* FROM join_outer o,
+    LATERAL (SELECT id FROM join_inner WHERE id % 2 = 0 USING DISTANCE MINKOWSKI(1)(f, o.f) ORDER USING DISTANCE LIMIT 2) s
+    WHERE s.id > 20 ORDER BY o.id, d, s.id;
+RESET enable_nestloop;
+SET enable_similarityjoin = off;
+EXPLAIN (COSTS OFF)
+SELECT o.id, s.* FROM join_outer o,
+    LATERAL (SELECT id FROM join_inner USING DISTANCE MINKOWSKI(2)(f, o.f) ORDER USING DISTANCE LIMIT 3) s;
+SELECT o.id, s.* FROM join_outer o,
+    LATERAL (SELECT id FROM join_inner USING DISTANCE MINKOWSKI(2)(f, o.f) ORDER USING DISTANCE LIMIT 3) s
+    ORDER BY o.id, d, s.id;
+RESET enable_similarityjoin;
+-- the inner tuples are pruned with a VA index
+CREATE VA join_inner_f ON join_inner (f) USING EQUIDISTANT MARKS;
+SELECT * FROM feature_knn_join('join_outer', 'id', 'f', 'join_inner', 'id', 'f', 3, 2)
+    AS j(outer_id int4, inner_id int4, dist float8) ORDER BY outer_id, dist;
+SELECT * FROM feature_knn_join('join_outer', 'id', 'f', 'join_inner', 'id', 'f', 3, 1)
+    AS j(outer_id int4, inner_id int4, dist float8) ORDER BY outer_id, dist;
+SELECT * FROM feature_epsilon_join('join_outer', 'id', 'f', 'join_inner', 'id', 'f', 1, 2)
+    AS j(outer_id int4, inner_id int4, dist float8) ORDER BY outer_id, dist;
+SELECT * FROM feature_epsilon_join('join_outer', 'id', 'f', 'join_inner', 'id', 'f', 0.75, 1)
+    AS j(outer_id int4, inner_id int4, dist float8) ORDER BY outer_id, dist;
+-- the candidates of the similarity join are collected with the VA index
+SET enable_nestloop = off;
+EXPLAIN (COSTS OFF)
+SELECT o.id, s.* FROM join_outer o,
+    LATERAL (SELECT id FROM join_inner USING DISTANCE MINKOWSKI(2)(f, o.f) ORDER USING DISTANCE LIMIT 3) s;
+SELECT o.id, s.* FROM join_outer o,
+    LATERAL (SELECT id FROM join_inner USING DISTANCE MINKOWSKI(2)(f, o.f) ORDER USING DISTANCE LIMIT 3) s
+    ORDER BY o.id, d, s.id;
+RESET enable_nestloop;
+SELECT * FROM feature_knn_join('join_outer', 'id', 'f', 'join_inner', 'id', 'f', 0, 2)
+    AS j(outer_id int4, inner_id int4, dist float8);
+SELECT * FROM feature_epsilon_join('join_outer', 'id', 'f', 'join_inner', 'id', 'f', -1, 2)
+    AS j(outer_id int4, inner_id int4, dist float8);
+SELECT * FROM feature_knn_join('join_outer', 'id', 'f', 'join_inner', 'id', 'f', 3, 0)
+    AS j(outer_id int4, inner_id int4, dist float8);
+SELECT * FROM feature_knn_join('join_outer', 'id', 'g', 'join_inner', 'id', 'f', 3, 2)
+    AS j(outer_id int4, inner_id int4, dist float8);
+SELECT * FROM feature_knn_join('join_outer', 'id', 'f', 'join_inner', 'id', 'id', 3, 2)
+    AS j(outer_id int4, inner_id int4, dist float8);
+SELECT * FROM feature_knn_join('join_outer', 'id', 'f', 'join_inner', 'id', 'f', 3, 2)
+    AS j(outer_id int4, inner_id int4);
+INSERT INTO join_outer VALUES (5, '<1,2,3>');
+SELECT * FROM feature_knn_join('join_outer', 'id', 'f', 'join_inner', 'id', 'f', 3, 2)
+    AS j(outer_id int4, inner_id int4, dist float8);
+DROP TABLE join_outer, join_inner;
@@ -0,0 +1,45 @@
+--
+-- ADAM: approximate VA searches
+--
+SHOW va_recall_target;
+SET va_recall_target = 1.5;
+SET va_max_candidates = -1;
+CREATE TABLE va_approximate (id int4, f feature);
+INSERT INTO va_approximate
+    SELECT i, ('<' || i % 30 || ',' || i / 30 || '>')::feature
+    FROM generate_series(0, 899) i;
+CREATE VA va_approximate_f ON va_approximate (f) USING EQUIFREQUENT MARKS;
+ANALYZE va_approximate;
+CREATE FUNCTION va_approximate_rows(query text) RETURNS SETOF text LANGUAGE plpgsql AS $$
+DECLARE
+    r record;
+    n int := 0;
+    ln text;
+BEGIN
+    FOR r IN EXECUTE query LOOP
+        n := n + 1;
+    END LOOP;
+    RETURN NEXT 'rows: ' || n;
+    FOR ln IN EXECUTE 'EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF) ' || query LOOP
+        IF ln ~ 'VA Estimated Recall' THEN
+            RETURN NEXT regexp_replace(trim(ln), 'Recall: [0-9.]+', 'Recall: x');
+        END IF;
+    END LOOP;
+END
+$$;
+SET enable_seqscan = off;
+-- the candidates are capped, but never below the number of neighbours
+SET va_max_candidates = 1;
+SELECT va_approximate_rows($$SELECT id FROM va_approximate
+    USING DISTANCE MINKOWSKI(2)(f, '<14.25,9.375>') ORDER USING DISTANCE LIMIT 3$$);
+RESET va_max_candidates;
+SET va_recall_target = 0.5;
+SELECT va_approximate_rows($$SELECT id FROM va_approximate
+    USING DISTANCE MINKOWSKI(2)(f, '<14.25,9.375>') ORDER USING DISTANCE LIMIT 3$$);
+-- exact searches again
+RESET va_recall_target;
+SELECT id FROM va_approximate
+    USING DISTANCE MINKOWSKI(2)(f, '<14.25,9.375>') ORDER USING DISTANCE LIMIT 3;
+RESET enable_seqscan;
+DROP FUNCTION va_approximate_rows(text);
+DROP TABLE va_approximate;
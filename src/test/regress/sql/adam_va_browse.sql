@@ -0,0 +1,68 @@
+--
+-- ADAM: browsing VA search results without a LIMIT
+--
+CREATE TABLE va_browse (id int4, f feature);
+INSERT INTO va_browse
+    SELECT i, ('<' || (i * 37 % 101 + i * 11 % 16 / 16.0)::float8 || ','
+        || (i * 53 % 97 + i * 5 % 8 / 8.0)::float8 || '>')::feature
+    FROM generate_series(0, 999) i;
+CREATE VA va_browse_f ON va_browse (f) USING EQUIFREQUENT MARKS;
+ANALYZE va_browse;
+SET enable_seqscan = off;
+-- the rounds of the search are crossed while fetching
+BEGIN;
+DECLARE va_browse_cursor CURSOR FOR SELECT id FROM va_browse
+    USING DISTANCE MINKOWSKI(2)(f, '<50.0625,48.1875>') ORDER USING DISTANCE;
+FETCH 3 FROM va_browse_cursor;
+MOVE 95 IN va_browse_cursor;
+FETCH 5 FROM va_browse_cursor;
+MOVE 190 IN va_browse_cursor;
+FETCH 3 FROM va_browse_cursor;
+COMMIT;
+-- scrollable cursors
+BEGIN;
+DECLARE va_browse_cursor SCROLL CURSOR FOR SELECT id FROM va_browse
+    USING DISTANCE MINKOWSKI(2)(f, '<50.0625,48.1875>') ORDER USING DISTANCE;
+FETCH 2 FROM va_browse_cursor;
+FETCH PRIOR FROM va_browse_cursor;
+FETCH ABSOLUTE 120 FROM va_browse_cursor;
+COMMIT;
+-- OFFSET
+SELECT id FROM va_browse
+    USING DISTANCE MINKOWSKI(2)(f, '<50.0625,48.1875>') ORDER USING DISTANCE LIMIT 3 OFFSET 150;
+-- EXPLAIN shows the distance browsing, but not for a bounded sort
+EXPLAIN (COSTS OFF) SELECT id FROM va_browse
+    USING DISTANCE MINKOWSKI(2)(f, '<50.0625,48.1875>') ORDER USING DISTANCE;
+EXPLAIN (COSTS OFF) SELECT id FROM va_browse
+    USING DISTANCE MINKOWSKI(2)(f, '<50.0625,48.1875>') ORDER USING DISTANCE LIMIT 3;
+RESET enable_seqscan;
+DROP TABLE va_browse;
+-- the tuples of the previous rounds are remembered exactly, even if their
+-- pages do not fit into a bitmap of work_mem
+CREATE TABLE va_browse_wide (id int4, f feature, filler text);
+INSERT INTO va_browse_wide
+    SELECT i, ('<' || i % 61 || ',' || i / 61 || '>')::feature, repeat('x', 1900)
+    FROM generate_series(0, 3999) i ORDER BY i * 7919 % 4000;
+CREATE VA va_browse_wide_f ON va_browse_wide (f) USING EQUIFREQUENT MARKS;
+ANALYZE va_browse_wide;
+CREATE FUNCTION va_browse_explain(query text) RETURNS SETOF text LANGUAGE plpgsql AS $$
+DECLARE
+    ln text;
+BEGIN
+    FOR ln IN EXECUTE 'EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF) ' || query LOOP
+        IF ln ~ 'Sort \(|Distance Browsing|Heap Scan' THEN
+            RETURN NEXT ln;
+        END IF;
+    END LOOP;
+END
+$$;
+SET enable_seqscan = off;
+SET work_mem = 64;
+SELECT va_browse_explain($$SELECT count(*), count(DISTINCT id) FROM (SELECT id FROM va_browse_wide
+    USING DISTANCE MINKOWSKI(2)(f, '<30.25,32.375>') ORDER USING DISTANCE) s$$);
+SELECT count(*), count(DISTINCT id) FROM (SELECT id FROM va_browse_wide
+    USING DISTANCE MINKOWSKI(2)(f, '<30.25,32.375>') ORDER USING DISTANCE) s;
+RESET work_mem;
+RESET enable_seqscan;
+DROP FUNCTION va_browse_explain(text);
+DROP TABLE va_browse_wide;
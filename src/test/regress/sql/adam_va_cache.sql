@@ -0,0 +1,55 @@
+--
+-- ADAM: VA cache (disabled in the regression tests, see adam_va_cache_1.out
+-- and "make va-cache-check" for the tests with the cache enabled)
+--
+SHOW va_cache_size;
+SET va_cache_size = 1024;
+CREATE TABLE va_cache (id int4, f feature);
+INSERT INTO va_cache
+    SELECT i, ('<' || i % 25 || ',' || i / 25 || '>')::feature
+    FROM generate_series(0, 624) i;
+CREATE INDEX va_cache_id ON va_cache (id);
+CREATE VA va_cache_f ON va_cache (f) USING EQUIFREQUENT MARKS;
+-- EXPLAIN ANALYZE reports the searches reading the cache
+CREATE FUNCTION va_cache_explain(query text) RETURNS text LANGUAGE plpgsql AS $$
+DECLARE
+    ln text;
+BEGIN
+    FOR ln IN EXECUTE 'EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF) ' || query LOOP
+        IF ln ~ 'Cached Searches' THEN
+            RETURN substring(ln from 'Cached Searches: \d+ of \d+');
+        END IF;
+    END LOOP;
+    RETURN 'not cached';
+END
+$$;
+SELECT va_prewarm('va_cache_f');
+SELECT va_prewarm('va_cache_id');
+SET enable_seqscan = off;
+SET va_cache_autoload = off;
+SELECT id FROM va_cache
+    USING DISTANCE MINKOWSKI(2)(f, '<12.25,3.375>') ORDER USING DISTANCE LIMIT 3;
+SELECT va_cache_explain($$SELECT id FROM va_cache
+    USING DISTANCE MINKOWSKI(2)(f, '<12.25,3.375>') ORDER USING DISTANCE LIMIT 3$$);
+-- a changed VA file is read again
+INSERT INTO va_cache VALUES (625, '<12.25,3.5>');
+SELECT id FROM va_cache
+    USING DISTANCE MINKOWSKI(2)(f, '<12.25,3.375>') ORDER USING DISTANCE LIMIT 3;
+SELECT va_cache_explain($$SELECT id FROM va_cache
+    USING DISTANCE MINKOWSKI(2)(f, '<12.25,3.375>') ORDER USING DISTANCE LIMIT 3$$);
+SELECT va_prewarm('va_cache_f');
+SELECT va_cache_explain($$SELECT id FROM va_cache
+    USING DISTANCE MINKOWSKI(2)(f, '<12.25,3.375>') ORDER USING DISTANCE LIMIT 3$$);
+-- REINDEX drops the cached VA file, the next search loads it again
+REINDEX INDEX va_cache_f;
+SELECT va_cache_explain($$SELECT id FROM va_cache
+    USING DISTANCE MINKOWSKI(2)(f, '<12.25,3.375>') ORDER USING DISTANCE LIMIT 3$$);
+SET va_cache_autoload = on;
+SELECT id FROM va_cache
+    USING DISTANCE MINKOWSKI(2)(f, '<12.25,3.375>') ORDER USING DISTANCE LIMIT 3;
+SELECT va_cache_explain($$SELECT id FROM va_cache
+    USING DISTANCE MINKOWSKI(2)(f, '<12.25,3.375>') ORDER USING DISTANCE LIMIT 3$$);
+RESET enable_seqscan;
+RESET va_cache_autoload;
+DROP FUNCTION va_cache_explain(text);
+DROP TABLE va_cache;
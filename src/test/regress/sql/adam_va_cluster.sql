@@ -0,0 +1,29 @@
+--
+-- ADAM: clustering tables by feature similarity on VA indexes
+--
+CREATE TABLE va_cluster (id int4, f feature);
+INSERT INTO va_cluster
+    SELECT i, ('<' || i % 20 || ',' || i / 20 || '>')::feature
+    FROM generate_series(0, 399) i ORDER BY i * 7919 % 400;
+INSERT INTO va_cluster VALUES (1000, NULL), (1001, NULL);
+CREATE VA va_cluster_f ON va_cluster (f) USING EQUIFREQUENT MARKS;
+CLUSTER va_cluster USING va_cluster_f;
+ANALYZE va_cluster;
+SELECT indisclustered FROM pg_index WHERE indexrelid = 'va_cluster_f'::regclass;
+SELECT count(*), count(f) FROM va_cluster;
+SET enable_seqscan = off;
+SELECT id FROM va_cluster
+    USING DISTANCE MINKOWSKI(2)(f, '<7.25,11.375>') ORDER USING DISTANCE LIMIT 4;
+SELECT id FROM va_cluster
+    USING DISTANCE MINKOWSKI(2)(f, '<18.625,0.125>') ORDER USING DISTANCE LIMIT 4;
+-- the clustered index is used again by a plain CLUSTER
+RESET enable_seqscan;
+INSERT INTO va_cluster VALUES (2000, '<7.25,11.5>'), (2001, '<18.5,0.25>');
+CLUSTER va_cluster;
+SET enable_seqscan = off;
+SELECT id FROM va_cluster
+    USING DISTANCE MINKOWSKI(2)(f, '<7.25,11.375>') ORDER USING DISTANCE LIMIT 4;
+SELECT id FROM va_cluster
+    USING DISTANCE MINKOWSKI(2)(f, '<18.625,0.125>') ORDER USING DISTANCE LIMIT 4;
+RESET enable_seqscan;
+DROP TABLE va_cluster;
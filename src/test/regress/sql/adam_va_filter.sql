@@ -0,0 +1,27 @@
+--
+-- ADAM: VA searches combined with other clauses
+--
+CREATE TABLE va_filter (id int4, cat int4, f feature);
+INSERT INTO va_filter
+    SELECT i, i % 9, ('<' || i % 50 || ',' || i / 50 || '>')::feature
+    FROM generate_series(0, 1999) i;
+CREATE INDEX va_filter_id ON va_filter (id);
+CREATE INDEX va_filter_cat ON va_filter (cat);
+CREATE VA va_filter_f ON va_filter (f) USING EQUIFREQUENT MARKS;
+ANALYZE va_filter;
+SET enable_seqscan = off;
+-- few tuples fulfil the other clause
+SELECT id FROM va_filter WHERE id < 20
+    USING DISTANCE MINKOWSKI(2)(f, '<20.25,15.375>') ORDER USING DISTANCE LIMIT 3;
+-- a ninth of the tuples fulfil the other clause
+SELECT id FROM va_filter WHERE cat = 3
+    USING DISTANCE MINKOWSKI(2)(f, '<20.25,15.375>') ORDER USING DISTANCE LIMIT 3;
+SELECT id FROM va_filter WHERE cat = 3 OR cat = 4
+    USING DISTANCE MINKOWSKI(2)(f, '<20.25,15.375>') ORDER USING DISTANCE LIMIT 3;
+-- most tuples fulfil the other clause
+SELECT id FROM va_filter WHERE cat <> 5
+    USING DISTANCE MINKOWSKI(2)(f, '<20.25,15.375>') ORDER USING DISTANCE LIMIT 3;
+SELECT id FROM va_filter WHERE id % 7 = 0
+    USING DISTANCE MINKOWSKI(2)(f, '<20.25,15.375>') ORDER USING DISTANCE LIMIT 3;
+RESET enable_seqscan;
+DROP TABLE va_filter;
@@ -0,0 +1,21 @@
+--
+-- ADAM: imbalance and changes of VA files
+--
+CREATE TABLE va_drift (id int4, f feature);
+INSERT INTO va_drift
+    SELECT i, ('<' || i || ',' || i * 37 % 400 || '>')::feature
+    FROM generate_series(0, 399) i;
+CREATE VA va_drift_f ON va_drift (f) USING EQUIFREQUENT MARKS;
+SELECT va_imbalance('va_drift_f') BETWEEN 0 AND 1 AS imbalance, va_changes('va_drift_f') AS changes;
+-- new features outside of the marks fall into the outermost cells
+CREATE TABLE va_drift_before AS SELECT va_imbalance('va_drift_f') AS imbalance;
+INSERT INTO va_drift
+    SELECT i, '<100,100>' FROM generate_series(400, 599) i;
+SELECT va_imbalance('va_drift_f') > imbalance AS drifted, va_imbalance('va_drift_f') <= 1 AS bounded,
+       va_changes('va_drift_f') AS changes
+    FROM va_drift_before;
+-- a rebuild resets the changes
+REINDEX INDEX va_drift_f;
+SELECT va_changes('va_drift_f') AS changes;
+SELECT va_imbalance('va_drift');
+DROP TABLE va_drift, va_drift_before;
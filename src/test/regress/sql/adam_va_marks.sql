@@ -0,0 +1,39 @@
+--
+-- ADAM: marks of VA indexes built from a sample or from all rows
+--
+SHOW va_marks_sample_size;
+SET va_marks_sample_size = -1;
+CREATE TABLE va_marks (id int4, f feature);
+INSERT INTO va_marks
+    SELECT i, ('<' || (i % 20) * (i % 20) || ',' || i / 20 || '>')::feature
+    FROM generate_series(0, 399) i;
+ANALYZE va_marks;
+SET enable_seqscan = off;
+-- all rows
+SET va_marks_sample_size = 0;
+CREATE VA va_marks_f ON va_marks (f) USING EQUIFREQUENT MARKS;
+SELECT id FROM va_marks
+    USING DISTANCE MINKOWSKI(2)(f, '<50.25,7.375>') ORDER USING DISTANCE LIMIT 3;
+SELECT id FROM va_marks
+    USING DISTANCE MINKOWSKI(2)(f, '<400.5,25.125>') ORDER USING DISTANCE LIMIT 3;
+DROP INDEX va_marks_f;
+-- a sample smaller than the table, the marks need not cover all values
+SET va_marks_sample_size = 100;
+SET va_marks_sample_size = 300;
+CREATE VA va_marks_f ON va_marks (f) USING EQUIFREQUENT MARKS;
+SELECT id FROM va_marks
+    USING DISTANCE MINKOWSKI(2)(f, '<50.25,7.375>') ORDER USING DISTANCE LIMIT 3;
+SELECT id FROM va_marks
+    USING DISTANCE MINKOWSKI(2)(f, '<400.5,25.125>') ORDER USING DISTANCE LIMIT 3;
+DROP INDEX va_marks_f;
+CREATE VA va_marks_f ON va_marks (f) USING EQUIDISTANT MARKS;
+SELECT id FROM va_marks
+    USING DISTANCE MINKOWSKI(2)(f, '<50.25,7.375>') ORDER USING DISTANCE LIMIT 3;
+SELECT id FROM va_marks
+    USING DISTANCE MINKOWSKI(2)(f, '<400.5,25.125>') ORDER USING DISTANCE LIMIT 3;
+-- the smallest values lie in the first cell of each dimension
+SELECT id FROM va_marks
+    USING DISTANCE MINKOWSKI(2)(f, '<0.25,0.125>') ORDER USING DISTANCE LIMIT 2;
+RESET va_marks_sample_size;
+RESET enable_seqscan;
+DROP TABLE va_marks;
@@ -0,0 +1,31 @@
+--
+-- ADAM: VA searches over inheritance children
+--
+CREATE TABLE va_parts (id int4, f feature);
+CREATE TABLE va_parts_1 () INHERITS (va_parts);
+CREATE TABLE va_parts_2 () INHERITS (va_parts);
+INSERT INTO va_parts_1
+    SELECT i, ('<' || i % 20 || ',' || i / 20 || '>')::feature
+    FROM generate_series(0, 399) i;
+INSERT INTO va_parts_2
+    SELECT i + 400, ('<' || i % 20 + 20 || ',' || i / 20 || '>')::feature
+    FROM generate_series(0, 399) i;
+CREATE VA va_parts_1_f ON va_parts_1 (f) USING EQUIFREQUENT MARKS;
+CREATE VA va_parts_2_f ON va_parts_2 (f) USING EQUIFREQUENT MARKS;
+ANALYZE va_parts_1;
+ANALYZE va_parts_2;
+SET enable_seqscan = off;
+-- the neighbours of both partitions are merged
+SELECT id FROM va_parts
+    USING DISTANCE MINKOWSKI(2)(f, '<19.75,5.375>') ORDER USING DISTANCE LIMIT 4;
+-- the first partition cannot contain any of the neighbours
+SELECT id FROM va_parts
+    USING DISTANCE MINKOWSKI(2)(f, '<35.25,12.375>') ORDER USING DISTANCE LIMIT 4;
+-- every rescan starts with empty queues
+CREATE TABLE va_parts_queries (q feature);
+INSERT INTO va_parts_queries VALUES ('<19.75,5.375>'), ('<35.25,12.375>');
+SELECT q.q, (SELECT array_agg(id) FROM (SELECT id FROM va_parts
+        USING DISTANCE MINKOWSKI(2)(f, q.q) ORDER USING DISTANCE LIMIT 2) s)
+    FROM va_parts_queries q;
+RESET enable_seqscan;
+DROP TABLE va_parts_1, va_parts_2, va_parts, va_parts_queries;
@@ -0,0 +1,40 @@
+--
+-- ADAM: VA indexes on projected features
+--
+CREATE TABLE va_projection (id int4, f feature);
+INSERT INTO va_projection
+    SELECT i, ('<' || i % 10 || ',' || i / 10 % 10 || ',' || i / 100 || ',' || i * 7 % 11 || '>')::feature
+    FROM generate_series(0, 599) i;
+ANALYZE va_projection;
+CREATE INDEX va_projection_f ON va_projection USING va (f) WITH (vaprojection = 'svd');
+CREATE INDEX va_projection_f ON va_projection USING va (f) WITH (vaprojection = 'pca', vacomponents = 0);
+CREATE INDEX va_projection_f ON va_projection USING va (f) WITH (vaprojection = 'pca', vacomponents = 4);
+CREATE INDEX va_projection_f ON va_projection USING va (f)
+    WITH (vamarks = 2, vaprojection = 'pca', vacomponents = 2);
+SELECT array_length(projection, 1) AS rows, array_length(projection, 2) AS columns
+    FROM pg_index WHERE indexrelid = 'va_projection_f'::regclass;
+SET enable_seqscan = off;
+SELECT id FROM va_projection
+    USING DISTANCE MINKOWSKI(2)(f, '<2.25,1.125,2.0625,5.03125>') ORDER USING DISTANCE LIMIT 3;
+SELECT id FROM va_projection
+    USING DISTANCE MINKOWSKI(2)(f, '<9.5,0.25,5.375,10.125>') ORDER USING DISTANCE LIMIT 3;
+-- the bounds of projected features only hold for the Euclidean distance
+SELECT id FROM va_projection
+    USING DISTANCE MINKOWSKI(1)(f, '<2.25,1.125,2.0625,5.03125>') ORDER USING DISTANCE LIMIT 3;
+RESET enable_seqscan;
+DROP INDEX va_projection_f;
+CREATE INDEX va_projection_f ON va_projection USING va (f)
+    WITH (vamarks = 2, vaprojection = 'random', vacomponents = 2);
+SELECT array_length(projection, 1) AS rows, array_length(projection, 2) AS columns
+    FROM pg_index WHERE indexrelid = 'va_projection_f'::regclass;
+SET enable_seqscan = off;
+SELECT id FROM va_projection
+    USING DISTANCE MINKOWSKI(2)(f, '<2.25,1.125,2.0625,5.03125>') ORDER USING DISTANCE LIMIT 3;
+SELECT id FROM va_projection
+    USING DISTANCE MINKOWSKI(2)(f, '<9.5,0.25,5.375,10.125>') ORDER USING DISTANCE LIMIT 3;
+-- the bounds of projected features only hold for the Euclidean distance
+SELECT id FROM va_projection
+    USING DISTANCE MINKOWSKI(1)(f, '<2.25,1.125,2.0625,5.03125>') ORDER USING DISTANCE LIMIT 3;
+RESET enable_seqscan;
+DROP INDEX va_projection_f;
+DROP TABLE va_projection;
@@ -0,0 +1,30 @@
+--
+-- ADAM: cache of VA search results
+--
+SHOW va_result_cache_size;
+SET va_result_cache_size = 1024;
+CREATE TABLE va_result_cache (id int4, f feature);
+INSERT INTO va_result_cache
+    SELECT i, ('<' || i % 20 || ',' || i / 20 || '>')::feature
+    FROM generate_series(0, 399) i;
+CREATE VA va_result_cache_f ON va_result_cache (f) USING EQUIDISTANT MARKS;
+ANALYZE va_result_cache;
+SET enable_seqscan = off;
+-- repeated searches give the same result
+SELECT id FROM va_result_cache
+    USING DISTANCE MINKOWSKI(2)(f, '<4.25,15.375>') ORDER USING DISTANCE LIMIT 3;
+SELECT id FROM va_result_cache
+    USING DISTANCE MINKOWSKI(2)(f, '<4.25,15.375>') ORDER USING DISTANCE LIMIT 3;
+-- changes are seen by the next search, within and after the transaction
+BEGIN;
+INSERT INTO va_result_cache VALUES (1000, '<4.25,15.5>');
+SELECT id FROM va_result_cache
+    USING DISTANCE MINKOWSKI(2)(f, '<4.25,15.375>') ORDER USING DISTANCE LIMIT 3;
+ROLLBACK;
+SELECT id FROM va_result_cache
+    USING DISTANCE MINKOWSKI(2)(f, '<4.25,15.375>') ORDER USING DISTANCE LIMIT 3;
+DELETE FROM va_result_cache WHERE id = 304;
+SELECT id FROM va_result_cache
+    USING DISTANCE MINKOWSKI(2)(f, '<4.25,15.375>') ORDER USING DISTANCE LIMIT 3;
+RESET enable_seqscan;
+DROP TABLE va_result_cache;
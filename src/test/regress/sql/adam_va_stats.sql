@@ -0,0 +1,29 @@
+--
+-- ADAM: instrumentation and statistics of VA indexes
+--
+CREATE TABLE va_stats (id int4, f feature);
+INSERT INTO va_stats
+    SELECT i, ('<' || i % 20 || ',' || i / 20 || '>')::feature
+    FROM generate_series(0, 399) i;
+CREATE VA va_stats_f ON va_stats (f) USING EQUIFREQUENT MARKS;
+ANALYZE va_stats;
+SELECT relname, indexrelname, n_changes, rebuild_age >= interval '0' AS built
+    FROM pg_stat_va_indexes WHERE relname = 'va_stats';
+-- EXPLAIN ANALYZE reports the approximations searched
+CREATE FUNCTION va_stats_explain(query text) RETURNS SETOF text LANGUAGE plpgsql AS $$
+DECLARE
+    ln text;
+BEGIN
+    FOR ln IN EXECUTE 'EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF) ' || query LOOP
+        IF ln ~ 'VA Candidates' THEN
+            RETURN NEXT regexp_replace(trim(ln), 'Candidates: \d+ (of \d+).*$', 'Candidates: x \1');
+        END IF;
+    END LOOP;
+END
+$$;
+SET enable_seqscan = off;
+SELECT va_stats_explain($$SELECT id FROM va_stats
+    USING DISTANCE MINKOWSKI(2)(f, '<3.25,4.375>') ORDER USING DISTANCE LIMIT 3$$);
+RESET enable_seqscan;
+DROP FUNCTION va_stats_explain(text);
+DROP TABLE va_stats;
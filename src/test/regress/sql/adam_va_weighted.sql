@@ -0,0 +1,43 @@
+--
+-- ADAM: weighted Minkowski searches on VA indexes
+--
+CREATE TABLE va_weighted (id int4, f feature);
+INSERT INTO va_weighted
+    SELECT i, ('<' || i % 20 || ',' || i / 20 || '>')::feature
+    FROM generate_series(0, 399) i;
+CREATE VA va_weighted_f ON va_weighted (f) USING EQUIFREQUENT MARKS;
+ANALYZE va_weighted;
+CREATE FUNCTION va_weighted_uses_index(query text) RETURNS bool LANGUAGE plpgsql AS $$
+DECLARE
+    ln text;
+BEGIN
+    FOR ln IN EXECUTE 'EXPLAIN (COSTS OFF) ' || query LOOP
+        IF ln ~ 'Index Scan on va_weighted_f' THEN
+            RETURN true;
+        END IF;
+    END LOOP;
+    RETURN false;
+END
+$$;
+SET enable_seqscan = off;
+SELECT va_weighted_uses_index($$SELECT id FROM va_weighted
+    USING DISTANCE MINKOWSKI(2, '{1,3}')(f, '<7.25,11.375>') ORDER USING DISTANCE LIMIT 3$$);
+SELECT id FROM va_weighted
+    USING DISTANCE MINKOWSKI(2, '{1,3}')(f, '<7.25,11.375>') ORDER USING DISTANCE LIMIT 3;
+SELECT id FROM va_weighted
+    USING DISTANCE MINKOWSKI(1, '{1,3}')(f, '<7.25,11.375>') ORDER USING DISTANCE LIMIT 3;
+-- odd norms sum the absolute differences
+SELECT id FROM va_weighted
+    USING DISTANCE MINKOWSKI(3, '{2,1}')(f, '<7.25,11.375>') ORDER USING DISTANCE LIMIT 3;
+-- relevance feedback: other weights, then the query point moved in one dimension
+SELECT id FROM va_weighted
+    USING DISTANCE MINKOWSKI(2, '{4,1}')(f, '<7.25,11.375>') ORDER USING DISTANCE LIMIT 3;
+SELECT id FROM va_weighted
+    USING DISTANCE MINKOWSKI(2, '{0.5,2}')(f, '<7.25,11.375>') ORDER USING DISTANCE LIMIT 3;
+SELECT id FROM va_weighted
+    USING DISTANCE MINKOWSKI(2, '{0.5,2}')(f, '<13.625,11.375>') ORDER USING DISTANCE LIMIT 3;
+SELECT id FROM va_weighted
+    USING DISTANCE MINKOWSKI(2, '{0.5,2}')(f, '<13.625,2.125>') ORDER USING DISTANCE LIMIT 3;
+RESET enable_seqscan;
+DROP FUNCTION va_weighted_uses_index(text);
+DROP TABLE va_weighted;